@@ -0,0 +1,172 @@
+/**
+ * @file media_calib.c
+ * @brief libMedia 传感器标定工具
+ *
+ * 在设备上直接完成暗场/平场标定：
+ * - 遮住镜头采集 N 帧暗场，叠加得到主暗场和热像素
+ * - 对准均匀光源采集 N 帧平场，得到逐像素增益和坏点
+ * - 保存为紧凑的二进制标定文件，校正时通过 mmap 直接加载
+ *
+ * 更换传感器后无需再把原始数据拷回工作站处理。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 引入 libMedia 头文件
+#include "media.h"
+#include "media_calib.h"
+
+// ========================== 系统配置常量 ==========================
+
+/** @brief 图像宽度，单位：像素 */
+#define WIDTH 1920
+
+/** @brief 图像高度，单位：像素 */
+#define HEIGHT 1080
+
+/** @brief 像素格式：10位BGGR原始数据格式 */
+#define PIXELFORMAT V4L2_PIX_FMT_SBGGR10
+
+/** @brief 默认每种标定帧的数量 */
+#define DEFAULT_FRAMES 16
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 提示用户并等待回车
+ */
+static void wait_for_enter(const char* prompt)
+{
+    char line[16];
+    printf("%s, then press Enter...", prompt);
+    fflush(stdout);
+    if (!fgets(line, sizeof(line), stdin)) {
+        printf("\n");
+    }
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ */
+int main(int argc, char* argv[])
+{
+    const char* output = "calibration.bin";
+    const char* device = "/dev/video0";
+    int frames = DEFAULT_FRAMES;
+    media_session_t* session = NULL;
+    media_calib_t* calib = NULL;
+    int ret = -1;
+
+    // 解析命令行参数: media_calib [output] [frames] [device]
+    if (argc > 1) {
+        output = argv[1];
+    }
+    if (argc > 2) {
+        frames = atoi(argv[2]);
+        if (frames <= 0) {
+            frames = DEFAULT_FRAMES;
+        }
+    }
+    if (argc > 3) {
+        device = argv[3];
+    }
+
+    printf("libMedia Sensor Calibration Tool\n");
+    printf("================================\n");
+    printf("Device: %s\n", device);
+    printf("Frames per stack: %d\n", frames);
+    printf("Output: %s\n", output);
+    printf("libMedia Version: %s\n", libmedia_get_version());
+
+    if (libmedia_init() != 0) {
+        printf("Failed to initialize libMedia\n");
+        return -1;
+    }
+
+    libmedia_set_debug_level(2); // WARNING级别
+
+    media_session_config_t config = {
+        .device_path = device,
+        .format = {
+            .width = WIDTH,
+            .height = HEIGHT,
+            .pixelformat = PIXELFORMAT,
+            .num_planes = 1,
+            .plane_size = {WIDTH * HEIGHT * 2}
+        },
+        .buffer_count = 4,
+        .use_multiplanar = 1,
+        .nonblocking = 0
+    };
+
+    session = libmedia_create_session(&config);
+    if (!session) {
+        printf("Failed to create media session: %s\n",
+               libmedia_get_error_string(libmedia_get_last_error()));
+        goto cleanup;
+    }
+
+    calib = libmedia_calib_create(WIDTH, HEIGHT, PIXELFORMAT);
+    if (!calib) {
+        printf("Failed to create calibration: %s\n",
+               libmedia_get_error_string(libmedia_get_last_error()));
+        goto cleanup;
+    }
+
+    if (libmedia_start_session(session) < 0) {
+        printf("Failed to start session: %s\n",
+               libmedia_get_error_string(libmedia_get_last_error()));
+        goto cleanup;
+    }
+
+    // 暗场采集
+    wait_for_enter("Cover the lens");
+    printf("Capturing %d dark frames...\n", frames);
+    if (libmedia_calib_capture(calib, session, MEDIA_CALIB_DARK, frames, 1000) < 0) {
+        printf("Dark capture failed: %s\n", libmedia_get_error_string(libmedia_get_last_error()));
+        goto cleanup;
+    }
+
+    // 平场采集
+    wait_for_enter("Point the camera at a uniform light source");
+    printf("Capturing %d flat frames...\n", frames);
+    if (libmedia_calib_capture(calib, session, MEDIA_CALIB_FLAT, frames, 1000) < 0) {
+        printf("Flat capture failed: %s\n", libmedia_get_error_string(libmedia_get_last_error()));
+        goto cleanup;
+    }
+
+    libmedia_stop_session(session);
+
+    // 生成主暗场、主平场和坏点表
+    if (libmedia_calib_finalize(calib, NULL) < 0 || libmedia_calib_save(calib, output) < 0) {
+        printf("Failed to build calibration: %s\n",
+               libmedia_get_error_string(libmedia_get_last_error()));
+        goto cleanup;
+    }
+
+    media_calib_info_t info;
+    libmedia_calib_get_info(calib, &info);
+    printf("\nCalibration saved to %s\n", output);
+    printf("  Size:     %ux%u %s\n", info.width, info.height, libmedia_get_format_name(info.pixelformat));
+    printf("  Pedestal: %u\n", info.pedestal);
+    printf("  Frames:   %u dark, %u flat\n", info.dark_frames, info.flat_frames);
+    printf("  Defects:  %u pixels\n", info.defect_count);
+    ret = 0;
+
+cleanup:
+    libmedia_calib_destroy(calib);
+    if (session) {
+        libmedia_destroy_session(session);
+    }
+
+    libmedia_deinit();
+    return ret;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file media_coro.cpp
+ * @brief libMedia C++20 协程多路采集示例程序
+ *
+ * 演示 libmedia_coro.hpp：单个线程上的 epoll 反应器同时服务多个相机，
+ * 每个相机一个协程，通过 co_await 等待下一帧，无需为每个设备创建线程。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// 引入 libMedia 协程头文件
+#include "libmedia_coro.hpp"
+
+// ========================== 全局变量 ==========================
+
+/** @brief 程序运行状态标志 */
+static volatile std::sig_atomic_t running = 1;
+
+/** @brief 单个相机的采集统计 */
+struct CameraStats {
+    const char* device = nullptr;
+    int frames = 0;
+    uint64_t bytes = 0;
+};
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int)
+{
+    running = 0;
+}
+
+/**
+ * @brief 单个相机的采集协程
+ *
+ * 等待期间协程挂起在反应器上，不占用线程；帧对象离开作用域时归还缓冲区。
+ */
+static media::Task stream_camera(media::AsyncSession& camera, CameraStats& stats, int max_frames)
+{
+    while (running && stats.frames < max_frames) {
+        auto frame = co_await camera.next_frame();
+        if (!frame) {
+            if (frame.error().code == MEDIA_ERROR_TIMEOUT) {
+                continue;   // 反应器被取消，回到循环检查退出条件
+            }
+            std::printf("%s: capture failed: %s\n", stats.device, frame.error().message());
+            co_return;
+        }
+
+        stats.frames++;
+        stats.bytes += frame->bytes().size();
+        if (stats.frames % 30 == 0) {
+            std::printf("%s: frame %d, %zu bytes\n", stats.device, stats.frames, frame->bytes().size());
+        }
+    }
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ *
+ * 用法: media_coro [帧数] [设备...]
+ */
+int main(int argc, char* argv[])
+{
+    int max_frames = argc > 1 ? std::atoi(argv[1]) : 300;
+    std::vector<const char*> devices(argv + (argc > 2 ? 2 : argc), argv + argc);
+    if (devices.empty()) {
+        devices.push_back("/dev/video0");
+    }
+
+    std::printf("libMedia Coroutine Example\n");
+    std::printf("Cameras: %zu, frames per camera: %d\n", devices.size(), max_frames);
+
+    media::Library library;
+    media::Reactor reactor;
+    if (!library || !reactor) {
+        std::printf("Failed to initialize libMedia\n");
+        return -1;
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    // 预留容量，保证协程持有的引用在 push_back 后仍然有效
+    std::vector<media::AsyncSession> cameras;
+    std::vector<CameraStats> stats(devices.size());
+    cameras.reserve(devices.size());
+
+    for (std::size_t i = 0; i < devices.size(); i++) {
+        media_session_config_t config{};
+        config.device_path = devices[i];
+        config.format.width = 640;
+        config.format.height = 480;
+        config.format.pixelformat = V4L2_PIX_FMT_NV12;
+        config.format.num_planes = 1;
+        config.buffer_count = 4;
+        config.use_multiplanar = 1;
+
+        auto session = media::Session::create(config);
+        if (!session || !session->start()) {
+            std::printf("%s: failed to start: %s\n", devices[i], media::Error::last().message());
+            continue;
+        }
+        stats[cameras.size()].device = devices[i];
+        cameras.emplace_back(reactor, std::move(*session));
+    }
+
+    // 所有协程在本线程上启动，首次无帧时挂起到反应器
+    for (std::size_t i = 0; i < cameras.size(); i++) {
+        stream_camera(cameras[i], stats[i], max_frames);
+    }
+
+    // 定时醒来检查退出信号；没有协程等待时说明全部完成
+    while (running && reactor.pending() > 0) {
+        if (reactor.run_once(200) < 0) {
+            std::printf("Reactor failed\n");
+            break;
+        }
+    }
+
+    // 唤醒仍在等待的协程，使其在相机销毁前退出
+    running = 0;
+    reactor.cancel();
+
+    for (std::size_t i = 0; i < cameras.size(); i++) {
+        std::printf("%s: %d frames, %llu bytes\n", stats[i].device, stats[i].frames,
+                    static_cast<unsigned long long>(stats[i].bytes));
+    }
+    return 0;
+}
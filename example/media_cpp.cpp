@@ -0,0 +1,125 @@
+/**
+ * @file media_cpp.cpp
+ * @brief libMedia C++ 封装示例程序
+ *
+ * 演示 libmedia.hpp 的 RAII 用法：会话与帧对象离开作用域时自动归还缓冲区，
+ * 即使处理过程中抛出异常也不会造成驱动队列缺少缓冲区。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+// 引入 libMedia C++ 头文件
+#include "libmedia.hpp"
+
+// ========================== 全局变量 ==========================
+
+/** @brief 程序运行状态标志 */
+static volatile std::sig_atomic_t running = 1;
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int)
+{
+    running = 0;
+}
+
+/**
+ * @brief 处理一帧：计算亮度平面均值，模拟偶发的处理异常
+ */
+static double process_frame(const media::Frame& frame, int index)
+{
+    media::Span<const uint8_t> luma = frame.plane(0);
+    if (luma.empty()) {
+        throw std::runtime_error("frame too short for its format");
+    }
+    if (index % 50 == 49) {
+        throw std::runtime_error("simulated processing failure");
+    }
+
+    uint64_t sum = 0;
+    for (uint8_t value : luma) {
+        sum += value;
+    }
+    return static_cast<double>(sum) / luma.size();
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ */
+int main(int argc, char* argv[])
+{
+    const char* device = argc > 1 ? argv[1] : "/dev/video0";
+    int max_frames = argc > 2 ? std::atoi(argv[2]) : 100;
+
+    std::printf("libMedia C++ Example\n");
+    std::printf("Device: %s, frames: %d\n", device, max_frames);
+
+    // 库的初始化与反初始化由 Library 对象管理
+    media::Library library;
+    if (!library) {
+        std::printf("Failed to initialize libMedia\n");
+        return -1;
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    media_session_config_t config{};
+    config.device_path = device;
+    config.format.width = 640;
+    config.format.height = 480;
+    config.format.pixelformat = V4L2_PIX_FMT_NV12;
+    config.format.num_planes = 1;
+    config.buffer_count = 4;
+    config.use_multiplanar = 1;
+
+    // 会话对象析构时自动停止采集并释放设备
+    auto session = media::Session::create(config);
+    if (!session) {
+        std::printf("Failed to create session: %s\n", session.error().message());
+        return -1;
+    }
+    if (auto started = session->start(); !started) {
+        std::printf("Failed to start session: %s\n", started.error().message());
+        return -1;
+    }
+
+    int captured = 0;
+    int failures = 0;
+    while (running && captured < max_frames) {
+        auto frame = session->capture(1000);
+        if (!frame) {
+            if (frame.error().code == MEDIA_ERROR_TIMEOUT) {
+                continue;
+            }
+            std::printf("Capture failed: %s\n", frame.error().message());
+            break;
+        }
+
+        // 异常跳出作用域时 frame 仍会归还缓冲区
+        try {
+            double mean = process_frame(*frame, captured);
+            std::printf("Frame %u: %ux%u, %zu bytes, luma mean %.1f\n",
+                        frame->id(), frame->width(), frame->height(), frame->bytes().size(), mean);
+        } catch (const std::exception& e) {
+            std::printf("Frame %u: %s\n", frame->id(), e.what());
+            failures++;
+        }
+        captured++;
+    }
+
+    std::printf("Captured %d frames, %d processing failures\n", captured, failures);
+    return 0;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file media_expr.cpp
+ * @brief libMedia 融合图像运算示例与基准测试
+ *
+ * 演示 libmedia_expr.hpp：暗电平扣除与增益 `clamp((raw - dark) * 3 >> 2, 0, 1023)`
+ * 写成一个表达式时一次遍历完成；同一运算拆成逐个算子的多次遍历时，每一步
+ * 都要写出并重新读入一幅中间图像。程序在合成的 16 位 Raw 帧上分别计时两种
+ * 写法并核对结果逐像素一致，无需相机。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// 引入 libMedia 表达式模板头文件
+#include "libmedia_expr.hpp"
+
+// ========================== 数据结构 ==========================
+
+/**
+ * @brief 一幅自有内存的图像，行间无填充
+ */
+template <typename T>
+struct Image {
+    std::vector<T> pixels;
+    media::ImageView<T> view;
+
+    Image(uint32_t width, uint32_t height)
+        : pixels((size_t)width * height), view(pixels.data(), width, height, width * sizeof(T)) {}
+};
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 生成合成的 10 位 Raw 帧与暗场
+ */
+static void fill_frames(Image<uint16_t>& raw, Image<uint16_t>& dark)
+{
+    uint32_t state = 1;
+    for (size_t i = 0; i < raw.pixels.size(); i++) {
+        state = state * 1103515245u + 12345u;
+        dark.pixels[i] = (uint16_t)(60 + (state >> 28));
+        raw.pixels[i] = (uint16_t)((state >> 16) & 0x3ff);
+    }
+}
+
+/**
+ * @brief 单次遍历：整条表达式在寄存器中逐像素求值
+ */
+static media::Result<void> run_fused(const Image<uint16_t>& raw, const Image<uint16_t>& dark, Image<uint16_t>& out)
+{
+    media::ImageView<const uint16_t> r = raw.view, d = dark.view;
+    return out.view = media::clamp((r - d) * 3 >> 2, 0, 1023);
+}
+
+/**
+ * @brief 逐算子遍历：每一步写出一幅 32 位中间图像
+ */
+static media::Result<void> run_separate(const Image<uint16_t>& raw, const Image<uint16_t>& dark,
+                                        Image<int32_t>& a, Image<int32_t>& b, Image<uint16_t>& out)
+{
+    media::ImageView<const uint16_t> r = raw.view, d = dark.view;
+    media::ImageView<const int32_t> ca = a.view, cb = b.view;
+    media::Result<void> result = a.view = r - d;
+    if (result) {
+        result = b.view = ca * 3;
+    }
+    if (result) {
+        result = a.view = cb >> 2;
+    }
+    if (result) {
+        result = out.view = media::clamp(ca, 0, 1023);
+    }
+    return result;
+}
+
+/**
+ * @brief 取多次运行耗时的中位数 (毫秒)
+ */
+template <typename Fn>
+static double time_median(int runs, Fn&& fn)
+{
+    std::vector<double> times;
+    for (int i = 0; i < runs; i++) {
+        uint64_t start = libmedia_get_timestamp_ns();
+        fn();
+        times.push_back((libmedia_get_timestamp_ns() - start) / 1e6);
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ *
+ * 用法: media_expr [运行次数] [宽] [高]
+ */
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? std::atoi(argv[1]) : 50;
+    uint32_t width = argc > 2 ? (uint32_t)std::atoi(argv[2]) : 1920;
+    uint32_t height = argc > 3 ? (uint32_t)std::atoi(argv[3]) : 1080;
+    if (runs <= 0 || width == 0 || height == 0) {
+        std::printf("Invalid arguments\n");
+        return -1;
+    }
+
+    std::printf("libMedia Expression Template Benchmark\n");
+    std::printf("clamp((raw - dark) * 3 >> 2, 0, 1023) on %ux%u 16-bit, median of %d runs\n\n", width, height, runs);
+
+    Image<uint16_t> raw(width, height), dark(width, height), fused(width, height), separate(width, height);
+    Image<int32_t> a(width, height), b(width, height);
+    fill_frames(raw, dark);
+
+    media::Result<void> status;
+    double fused_ms = time_median(runs, [&] { status = run_fused(raw, dark, fused); });
+    if (!status) {
+        std::printf("Fused evaluation failed: %s\n", status.error().message());
+        return 1;
+    }
+    double separate_ms = time_median(runs, [&] { status = run_separate(raw, dark, a, b, separate); });
+    if (!status) {
+        std::printf("Separate evaluation failed: %s\n", status.error().message());
+        return 1;
+    }
+
+    std::printf("%-9s %10.3f ms\n", "fused", fused_ms);
+    std::printf("%-9s %10.3f ms\n", "separate", separate_ms);
+    std::printf("fused/separate: %.2f\n", fused_ms / separate_ms);
+
+    if (fused.pixels != separate.pixels) {
+        std::printf("Results differ\n");
+        return 1;
+    }
+
+    // 尺寸不符时赋值返回错误，目标图像保持不变
+    Image<uint16_t> half(width / 2 + 1, height);
+    media::ImageView<const uint16_t> r = raw.view;
+    media::Result<void> mismatch = half.view = r * 2;
+    std::printf("Size mismatch reported: %s\n", mismatch ? "no" : mismatch.error().message());
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file media_format.cpp
+ * @brief libMedia 编译期像素格式特性示例程序
+ *
+ * 演示 libmedia_format.hpp：按格式实例化的 Bayer 通道均值内核，样本宽度与
+ * Bayer 相位在编译期确定，运行时通过 FormatDispatch 表按帧格式选择实例。
+ * 程序在合成的 Raw 帧上运行，无需相机；结果与 libmedia_raw_statistics()
+ * 以及运行时格式描述逐项核对，任一不符即以非零状态退出。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#include <vector>
+
+// 引入 libMedia 格式特性头文件
+#include "libmedia_format.hpp"
+#include "media_proc.h"
+
+// ========================== 格式内核 ==========================
+
+/**
+ * @brief 各 Bayer 通道的样本均值，每种格式实例化一次
+ */
+template <uint32_t F>
+struct ChannelMean {
+    using Traits = media::FormatTraits<F>;
+    static_assert(Traits::known && Traits::bayer != MEDIA_BAYER_NONE, "Bayer formats only");
+    static_assert(Traits::sample_bytes == 1 || Traits::sample_bytes == 2, "unpacked samples only");
+    using Sample = std::conditional_t<Traits::sample_bytes == 1, uint8_t, uint16_t>;
+
+    static void run(const media_plane_t* plane, double* mean)
+    {
+        uint64_t sum[MEDIA_RAW_CHANNELS] = { 0 };
+        uint64_t count[MEDIA_RAW_CHANNELS] = { 0 };
+        for (uint32_t y = 0; y < plane->height; y++) {
+            const Sample* row = reinterpret_cast<const Sample*>(static_cast<const uint8_t*>(plane->data) +
+                                                                (size_t)y * plane->stride);
+            for (uint32_t x = 0; x < plane->width; x++) {
+                // 通道由常量表给出，编译器按格式折叠
+                int channel = Traits::bayer_channel(x, y);
+                sum[channel] += row[x];
+                count[channel]++;
+            }
+        }
+        for (int c = 0; c < MEDIA_RAW_CHANNELS; c++) {
+            mean[c] = count[c] ? (double)sum[c] / count[c] : 0.0;
+        }
+    }
+};
+
+/** @brief 本程序支持的格式，每种一个内核实例 */
+using MeanTable = media::FormatDispatch<ChannelMean, V4L2_PIX_FMT_SRGGB8, V4L2_PIX_FMT_SBGGR10,
+                                        V4L2_PIX_FMT_SGRBG12, V4L2_PIX_FMT_SGBRG16>;
+
+// 编译期常量与 libmedia_get_line_bytes() 的规则一致
+static_assert(media::FormatTraits<V4L2_PIX_FMT_SRGGB10P>::line_bytes(1920) == 2400, "RAW10 packing");
+static_assert(media::FormatTraits<V4L2_PIX_FMT_NV12>::frame_bytes(1920, 1080) == 1920 * 1080 * 3 / 2, "NV12 size");
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 生成合成 Raw 帧：每个通道取不同的固定值，并叠加少量随行变化
+ */
+static void fill_frame(std::vector<uint8_t>& memory, media_plane_t* plane, uint32_t format,
+                       uint32_t width, uint32_t height)
+{
+    const media_format_desc_t* desc = libmedia_get_format_desc(format);
+    size_t stride = libmedia_get_line_bytes(format, width);
+    memory.assign(stride * height, 0);
+    plane->data = memory.data();
+    plane->width = width;
+    plane->height = height;
+    plane->stride = (uint32_t)stride;
+
+    uint32_t full = (1u << desc->bits_per_sample) - 1;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t phase = (y & 1) * 2 + (x & 1);
+            uint32_t value = (full / 5) * (phase + 1) + (y % 7);
+            if (stride == width) {
+                memory[(size_t)y * stride + x] = (uint8_t)value;
+            } else {
+                reinterpret_cast<uint16_t*>(&memory[(size_t)y * stride])[x] = (uint16_t)value;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 对一种格式运行内核并与库函数核对
+ * @return 0 一致，-1 不一致或出错
+ */
+static int check_format(uint32_t format, uint32_t width, uint32_t height)
+{
+    const media_format_desc_t* desc = libmedia_get_format_desc(format);
+    auto run = MeanTable::find(format);
+    if (!desc || !run) {
+        std::printf("%-8s no kernel\n", desc ? desc->name : "?");
+        return -1;
+    }
+
+    std::vector<uint8_t> memory;
+    media_plane_t plane;
+    fill_frame(memory, &plane, format, width, height);
+
+    double mean[MEDIA_RAW_CHANNELS];
+    uint64_t start = libmedia_get_timestamp_ns();
+    run(&plane, mean);
+    uint64_t elapsed = libmedia_get_timestamp_ns() - start;
+
+    media_raw_stats_t stats;
+    if (libmedia_raw_statistics(&plane, format, nullptr, 1, &stats) < 0) {
+        std::printf("%-8s statistics failed: %s\n", desc->name, libmedia_get_error_string(libmedia_get_last_error()));
+        return -1;
+    }
+
+    int status = 0;
+    std::printf("%-8s", desc->name);
+    for (int c = 0; c < MEDIA_RAW_CHANNELS; c++) {
+        double expected = stats.count[c] ? (double)stats.sum[c] / stats.count[c] : 0.0;
+        std::printf(" %9.2f", mean[c]);
+        if (mean[c] < expected - 0.01 || mean[c] > expected + 0.01) {
+            status = -1;
+        }
+    }
+    std::printf(" %8.1f  %s\n", elapsed / 1000.0, status == 0 ? "ok" : "MISMATCH");
+    return status;
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ *
+ * 用法: media_format [宽] [高]
+ */
+int main(int argc, char* argv[])
+{
+    uint32_t width = argc > 1 ? (uint32_t)std::atoi(argv[1]) : 1920;
+    uint32_t height = argc > 2 ? (uint32_t)std::atoi(argv[2]) : 1080;
+    if (width < 2 || height < 2) {
+        std::printf("Invalid size %ux%u\n", width, height);
+        return -1;
+    }
+
+    std::printf("libMedia Format Traits Example\n");
+    std::printf("Synthetic %ux%u raw frames\n\n", width, height);
+    std::printf("%-8s %9s %9s %9s %9s %8s\n", "format", "R", "Gr", "Gb", "B", "us");
+
+    const uint32_t formats[] = { V4L2_PIX_FMT_SRGGB8, V4L2_PIX_FMT_SBGGR10, V4L2_PIX_FMT_SGRBG12,
+                                 V4L2_PIX_FMT_SGBRG16 };
+    int failures = 0;
+    for (uint32_t format : formats) {
+        if (check_format(format, width, height) < 0) {
+            failures++;
+        }
+    }
+
+    // 表中没有的格式返回空指针，由调用者回退到通用路径
+    if (MeanTable::find(V4L2_PIX_FMT_NV12) != nullptr) {
+        std::printf("NV12 unexpectedly dispatched\n");
+        failures++;
+    }
+
+    std::printf("\n%s\n", failures ? "Some formats did not match" : "All formats match libmedia_raw_statistics()");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file media_m2m.c
+ * @brief libMedia M2M 硬件缩放示例程序
+ *
+ * 演示 media_m2m.h：相机采集的帧以 DMABUF 形式直接送入 M2M 设备
+ * (如 Rockchip RGA 或内核测试驱动 vim2m)，CPU 不拷贝也不处理像素，
+ * 只负责提交与取回结果。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+// 引入 libMedia 头文件
+#include "media.h"
+#include "media_m2m.h"
+
+// ========================== 全局变量 ==========================
+
+/** @brief 程序运行状态标志 */
+static volatile sig_atomic_t running = 1;
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ *
+ * 用法: media_m2m [M2M设备] [相机设备] [帧数]
+ */
+int main(int argc, char* argv[])
+{
+    const char* m2m_device = argc > 1 ? argv[1] : "/dev/video1";
+    const char* camera_device = argc > 2 ? argv[2] : "/dev/video0";
+    int max_frames = argc > 3 ? atoi(argv[3]) : 300;
+
+    printf("libMedia M2M Example\n");
+    printf("Camera: %s -> M2M: %s\n", camera_device, m2m_device);
+
+    if (libmedia_init() != 0) {
+        printf("Failed to initialize libMedia\n");
+        return -1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    media_session_config_t config = {
+        .device_path = camera_device,
+        .format = {
+            .width = 1280,
+            .height = 720,
+            .pixelformat = V4L2_PIX_FMT_NV12,
+            .num_planes = 1
+        },
+        .buffer_count = 4,
+        .use_multiplanar = 1
+    };
+    media_session_t* camera = libmedia_create_session(&config);
+
+    // 输入槽数量与相机缓冲区一致，同一缓冲区总是使用同一槽位
+    media_m2m_config_t m2m_config = {
+        .device_path = m2m_device,
+        .input = config.format,
+        .output = {
+            .width = 640,
+            .height = 360,
+            .pixelformat = V4L2_PIX_FMT_NV12
+        },
+        .input_buffers = 4,
+        .output_buffers = 4,
+        .input_memory = MEDIA_M2M_MEMORY_DMABUF
+    };
+    media_m2m_t* scaler = camera ? libmedia_m2m_create(&m2m_config) : NULL;
+
+    if (!scaler || libmedia_start_session(camera) < 0) {
+        printf("Setup failed: %s\n", libmedia_get_error_string(libmedia_get_last_error()));
+        running = 0;
+    } else {
+        media_format_t input, output;
+        libmedia_m2m_get_formats(scaler, &input, &output);
+        printf("Scaling %ux%u -> %ux%u\n", input.width, input.height, output.width, output.height);
+    }
+
+    int frames = 0;
+    uint64_t start = libmedia_get_timestamp_ns();
+    while (running && frames < max_frames) {
+        // 等待超时返回 0 但不填充帧，以 data 为空区分
+        media_frame_t frame = {0};
+        if (libmedia_session_capture_frame(camera, &frame, 1000) < 0 || !frame.data) {
+            continue;
+        }
+
+        // 提交后帧归 M2M 会话所有，设备读取完成后自动归还相机
+        if (libmedia_m2m_submit_frame(scaler, camera, &frame) < 0) {
+            continue;
+        }
+
+        media_frame_t scaled;
+        if (libmedia_m2m_complete(scaler, &scaled, 1000) == 0) {
+            frames++;
+            if (frames % 30 == 0) {
+                printf("Frame %d: %zu bytes, latency %.2f ms\n", frames, scaled.size,
+                       (libmedia_get_timestamp_ns() - scaled.timestamp) / 1e6);
+            }
+            libmedia_m2m_release_frame(scaler, &scaled);
+        }
+    }
+
+    // 打印统计信息
+    media_m2m_stats_t stats;
+    if (libmedia_m2m_get_stats(scaler, &stats) == 0) {
+        double seconds = (libmedia_get_timestamp_ns() - start) / 1e9;
+        printf("Submitted %llu, completed %llu, errors %llu, %.1f fps\n",
+               (unsigned long long)stats.submitted, (unsigned long long)stats.completed,
+               (unsigned long long)stats.errors, seconds > 0 ? stats.completed / seconds : 0.0);
+    }
+
+    // 先销毁 M2M 会话 (归还仍在设备中的相机帧)，再销毁相机会话
+    libmedia_m2m_destroy(scaler);
+    libmedia_destroy_session(camera);
+    libmedia_deinit();
+    return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file media_multi.c
+ * @brief libMedia 单线程多相机采集示例程序
+ *
+ * 演示 media_multi.h：一个线程通过一个 epoll 集合服务多个相机，
+ * 多个相机同时就绪时轮询公平地逐帧取出，并通过各相机的回调处理帧。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+// 引入 libMedia 头文件
+#include "media.h"
+#include "media_multi.h"
+
+// ========================== 全局变量 ==========================
+
+/** @brief 程序运行状态标志 */
+static volatile sig_atomic_t running = 1;
+
+/** @brief 单个相机的上下文 */
+typedef struct {
+    const char* device;         /**< 设备路径 */
+    media_session_t* session;   /**< 采集会话 */
+    int camera;                 /**< 驱动分配的相机编号 */
+    uint64_t bytes;             /**< 累计字节数 */
+} camera_t;
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+/**
+ * @brief 帧回调：在驱动线程上运行，不能阻塞
+ */
+static int on_frame(void* user_data, int camera, media_session_t* session, media_frame_t* frame)
+{
+    camera_t* cam = user_data;
+    (void)camera;
+    (void)session;
+    cam->bytes += frame->size;
+    return 0;   // 返回 0 由驱动归还缓冲区
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ *
+ * 用法: media_multi [秒数] [设备...]
+ */
+int main(int argc, char* argv[])
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 10;
+    int count = argc > 2 ? argc - 2 : 1;
+    if (count > MEDIA_MULTI_MAX_SESSIONS) {
+        count = MEDIA_MULTI_MAX_SESSIONS;
+    }
+
+    printf("libMedia Multi-Camera Example\n");
+    printf("Cameras: %d, duration: %d s\n", count, seconds);
+
+    if (libmedia_init() != 0) {
+        printf("Failed to initialize libMedia\n");
+        return -1;
+    }
+    libmedia_set_thread_preset(MEDIA_THREAD_PRESET_LATENCY);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    media_multi_t* multi = libmedia_multi_create();
+    camera_t cameras[MEDIA_MULTI_MAX_SESSIONS] = { 0 };
+    int added = 0;
+
+    for (int i = 0; i < count && multi; i++) {
+        camera_t* cam = &cameras[added];
+        cam->device = argc > 2 ? argv[i + 2] : "/dev/video0";
+
+        media_session_config_t config = {
+            .device_path = cam->device,
+            .format = {
+                .width = 640,
+                .height = 480,
+                .pixelformat = V4L2_PIX_FMT_NV12,
+                .num_planes = 1
+            },
+            .buffer_count = 4,
+            .use_multiplanar = 1
+        };
+
+        cam->session = libmedia_create_session(&config);
+        if (!cam->session || libmedia_start_session(cam->session) < 0) {
+            printf("%s: failed to start: %s\n", cam->device, libmedia_get_error_string(libmedia_get_last_error()));
+            libmedia_destroy_session(cam->session);
+            continue;
+        }
+        cam->camera = libmedia_multi_add(multi, cam->session, on_frame, cam);
+        added++;
+    }
+
+    // 所有相机由驱动的单个采集线程服务
+    if (added == 0 || libmedia_multi_start(multi) < 0) {
+        printf("No camera running\n");
+    } else {
+        for (int s = 0; s < seconds && running; s++) {
+            sleep(1);
+        }
+        libmedia_multi_stop(multi);
+    }
+
+    // 打印每个相机的统计信息
+    for (int i = 0; i < added; i++) {
+        media_multi_stats_t stats;
+        if (libmedia_multi_get_stats(multi, cameras[i].camera, &stats) == 0) {
+            printf("%s: %llu frames, %llu wakeups, %llu errors, %llu bytes%s\n", cameras[i].device,
+                   (unsigned long long)stats.frames, (unsigned long long)stats.wakeups,
+                   (unsigned long long)stats.errors, (unsigned long long)cameras[i].bytes,
+                   stats.enabled ? "" : " (disabled)");
+        }
+    }
+
+    // 先销毁驱动，再销毁会话
+    libmedia_multi_destroy(multi);
+    for (int i = 0; i < added; i++) {
+        libmedia_destroy_session(cameras[i].session);
+    }
+    libmedia_deinit();
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file media_pmr.cpp
+ * @brief libMedia 多态内存资源示例程序
+ *
+ * 演示 libmedia_pmr.hpp：逐帧处理中的标准容器不再向全局堆申请内存。
+ * 临时数据 (直方图、亮区游程列表) 分配在 FrameArena 中，每帧结束时整体回卷；
+ * 输出掩码由 PoolResource 从帧池中取整块缓冲区。两种资源的上游都换成计数
+ * 资源，打印稳态下实际落到堆上的分配次数。程序在合成帧上运行，无需相机。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <vector>
+
+// 引入 libMedia 内存资源头文件
+#include "libmedia_pmr.hpp"
+
+// ========================== 数据结构 ==========================
+
+/**
+ * @brief 统计经过的分配，再转交全局堆
+ */
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+
+protected:
+    void* do_allocate(std::size_t size, std::size_t align) override
+    {
+        allocations++;
+        bytes += size;
+        return std::pmr::new_delete_resource()->allocate(size, align);
+    }
+
+    void do_deallocate(void* p, std::size_t size, std::size_t align) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, size, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+/** @brief 一行中连续的亮像素 */
+struct Run {
+    uint32_t y;
+    uint32_t x0;
+    uint32_t x1;
+};
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 生成合成亮度帧：背景渐变上叠加随帧移动的亮块
+ */
+static void fill_frame(std::vector<uint8_t>& luma, uint32_t width, uint32_t height, int index)
+{
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t bx = (x + (uint32_t)index * 7) % 64, by = (y + (uint32_t)index * 3) % 48;
+            luma[(size_t)y * width + x] = bx < 16 && by < 12 ? 240 : (uint8_t)((x + y) & 0x7f);
+        }
+    }
+}
+
+/**
+ * @brief 处理一帧：直方图求阈值，输出二值掩码并收集亮区游程
+ * @return 亮区游程数
+ */
+static std::size_t process_frame(const std::vector<uint8_t>& luma, uint32_t width, uint32_t height,
+                                 media::FrameArena& arena, std::pmr::vector<uint8_t>& mask)
+{
+    // 临时数据全部来自帧内存池，帧结束时随 reset() 一并释放
+    std::pmr::vector<uint32_t> histogram(256, 0, &arena);
+    for (uint8_t value : luma) {
+        histogram[value]++;
+    }
+    uint32_t threshold = 255;
+    for (uint32_t count = 0; threshold > 0 && count < luma.size() / 20; threshold--) {
+        count += histogram[threshold];
+    }
+
+    std::pmr::vector<Run> runs(&arena);
+    mask.assign(luma.size(), 0);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = &luma[(size_t)y * width];
+        for (uint32_t x = 0; x < width;) {
+            if (row[x] <= threshold) {
+                x++;
+                continue;
+            }
+            uint32_t x0 = x;
+            while (x < width && row[x] > threshold) {
+                mask[(size_t)y * width + x] = 255;
+                x++;
+            }
+            runs.push_back(Run{ y, x0, x });
+        }
+    }
+    return runs.size();
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ *
+ * 用法: media_pmr [帧数] [内存池 KB] [宽] [高]
+ */
+int main(int argc, char* argv[])
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 100;
+    std::size_t arena_kb = argc > 2 ? (std::size_t)std::atoi(argv[2]) : 256;
+    uint32_t width = argc > 3 ? (uint32_t)std::atoi(argv[3]) : 640;
+    uint32_t height = argc > 4 ? (uint32_t)std::atoi(argv[4]) : 480;
+    if (frames <= 0 || arena_kb == 0 || width == 0 || height == 0) {
+        std::printf("Invalid arguments\n");
+        return -1;
+    }
+
+    std::printf("libMedia Memory Resource Example\n");
+    std::printf("%d synthetic %ux%u frames, %zu KB arena\n\n", frames, width, height, arena_kb);
+
+    CountingResource arena_upstream, pool_upstream;
+    media::FrameArena arena(arena_kb << 10, 0, &arena_upstream);
+    if (!arena) {
+        std::printf("Failed to reserve the arena: %s\n", libmedia_get_error_string(libmedia_get_last_error()));
+        return -1;
+    }
+
+    // 掩码输出池：每帧一块，两块轮换足够
+    media_pool_t* pool = libmedia_pool_create(0);
+    media_pool_key_t key{};
+    key.size = (std::size_t)width * height;
+    if (!pool || libmedia_pool_reserve(pool, &key, 2) < 0) {
+        std::printf("Failed to reserve the mask pool: %s\n", libmedia_get_error_string(libmedia_get_last_error()));
+        libmedia_pool_destroy(pool);
+        return -1;
+    }
+
+    std::vector<uint8_t> luma((std::size_t)width * height);
+    std::size_t total_runs = 0;
+    {
+        media::PoolResource masks(pool, &pool_upstream);
+        for (int i = 0; i < frames; i++) {
+            fill_frame(luma, width, height, i);
+            std::pmr::vector<uint8_t> mask(&masks);
+            total_runs += process_frame(luma, width, height, arena, mask);
+            arena.reset();
+        }
+    }
+    libmedia_pool_destroy(pool);
+
+    std::printf("Bright runs found:        %zu\n", total_runs);
+    std::printf("Arena peak:               %zu of %zu bytes\n", arena.peak(), arena.capacity());
+    std::printf("Arena overflow:           %zu bytes in %zu heap allocations\n",
+                arena.overflow_bytes(), arena_upstream.allocations);
+    std::printf("Mask heap allocations:    %zu\n", pool_upstream.allocations);
+    if (arena_upstream.allocations) {
+        std::printf("Arena too small for this frame size, try a larger arena size\n");
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file media_pretrigger.c
+ * @brief libMedia 预触发录像示例程序
+ *
+ * 演示 media_pretrigger.h：采集线程持续把帧写入预触发缓冲区，
+ * 收到 SIGUSR1 (事件) 后把事件前 N 秒的帧与之后的实时帧无缝写入文件。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+// 引入 libMedia 头文件
+#include "media.h"
+#include "media_pretrigger.h"
+
+// ========================== 全局变量 ==========================
+
+/** @brief 程序运行状态标志 */
+static volatile sig_atomic_t running = 1;
+
+/** @brief 事件标志，由 SIGUSR1 设置 */
+static volatile sig_atomic_t event = 0;
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int sig)
+{
+    if (sig == SIGUSR1) {
+        event = 1;
+    } else {
+        running = 0;
+    }
+}
+
+/**
+ * @brief 录像输出：按采集顺序把帧追加到文件
+ */
+static int write_frame(void* user_data, const media_frame_t* frame, int live)
+{
+    (void)live;
+    FILE* file = user_data;
+    return fwrite(frame->data, 1, frame->size, file) == frame->size ? 0 : -1;
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ *
+ * 用法: media_pretrigger [预触发秒数] [事件后秒数] [输出文件]
+ * 事件: kill -USR1 <pid>
+ */
+int main(int argc, char* argv[])
+{
+    int pre_seconds = argc > 1 ? atoi(argv[1]) : 5;
+    int post_seconds = argc > 2 ? atoi(argv[2]) : 5;
+    const char* output = argc > 3 ? argv[3] : "event.yuv";
+
+    printf("libMedia Pre-Trigger Example (pid %d)\n", (int)getpid());
+    printf("Keeping %d s before the event, recording %d s after it to %s\n",
+           pre_seconds, post_seconds, output);
+
+    if (libmedia_init() != 0) {
+        printf("Failed to initialize libMedia\n");
+        return -1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, signal_handler);
+
+    media_session_config_t config = {
+        .device_path = "/dev/video0",
+        .format = {
+            .width = 640,
+            .height = 480,
+            .pixelformat = V4L2_PIX_FMT_NV12,
+            .num_planes = 1
+        },
+        .buffer_count = 4,
+        .use_multiplanar = 1
+    };
+    media_session_t* session = libmedia_create_session(&config);
+    FILE* file = fopen(output, "wb");
+
+    // 缓冲区按 30fps 的 NV12 帧估算，并留出余量
+    size_t frame_bytes = 640 * 480 * 3 / 2;
+    media_pretrigger_config_t pretrigger_config = {
+        .duration_ns = (uint64_t)pre_seconds * 1000000000ULL,
+        .bytes = frame_bytes * 30 * (pre_seconds + 1),
+        .sink = write_frame,
+        .user_data = file
+    };
+    media_pretrigger_t* history = file ? libmedia_pretrigger_create(&pretrigger_config) : NULL;
+
+    if (!session || !history || libmedia_start_session(session) < 0) {
+        printf("Setup failed: %s\n", libmedia_get_error_string(libmedia_get_last_error()));
+        running = 0;
+    }
+
+    uint64_t stop_at = 0;
+    while (running) {
+        // 等待超时返回 0 但不填充帧，以 data 为空区分
+        media_frame_t frame = {0};
+        if (libmedia_session_capture_frame(session, &frame, 1000) < 0 || !frame.data) {
+            continue;
+        }
+
+        // 事件发生时触发，此后的帧直接写入文件
+        if (event && !stop_at) {
+            printf("Event: recording\n");
+            libmedia_pretrigger_trigger(history);
+            stop_at = libmedia_get_timestamp_ns() + (uint64_t)post_seconds * 1000000000ULL;
+        }
+        libmedia_pretrigger_push(history, &frame);
+        libmedia_session_release_frame(session, &frame);
+
+        if (stop_at && libmedia_get_timestamp_ns() >= stop_at) {
+            libmedia_pretrigger_stop(history);
+            running = 0;
+        }
+    }
+
+    // 打印统计信息
+    media_pretrigger_stats_t stats;
+    if (libmedia_pretrigger_get_stats(history, &stats) == 0) {
+        printf("Stored %llu, evicted %llu, recorded %llu history + %llu live frames\n",
+               (unsigned long long)stats.stored, (unsigned long long)stats.evicted,
+               (unsigned long long)stats.history, (unsigned long long)stats.live);
+    }
+
+    libmedia_pretrigger_destroy(history);
+    libmedia_destroy_session(session);
+    if (file) {
+        fclose(file);
+    }
+    libmedia_deinit();
+    return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file media_sync.c
+ * @brief libMedia 多相机帧同步示例程序
+ *
+ * 演示 media_sync.h：多相机驱动采集的帧直接交给同步器，
+ * 时间戳在容差内的一组帧通过回调交付，未配对的帧被丢弃并计入统计。
+ *
+ * @author Development Team
+ * @date 2025-07-01
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+// 引入 libMedia 头文件
+#include "media.h"
+#include "media_multi.h"
+#include "media_sync.h"
+
+// ========================== 全局变量 ==========================
+
+/** @brief 程序运行状态标志 */
+static volatile sig_atomic_t running = 1;
+
+/** @brief 帧同步器 */
+static media_sync_t* sync_ctx = NULL;
+
+// ========================== 工具函数 ==========================
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+/**
+ * @brief 帧回调：把帧交给同步器，缓冲区由同步器归还
+ */
+static int on_frame(void* user_data, int camera, media_session_t* session, media_frame_t* frame)
+{
+    (void)user_data;
+    libmedia_sync_push(sync_ctx, camera, session, frame);
+    return 1;
+}
+
+/**
+ * @brief 同步组回调：每 30 组打印一次时间偏差
+ */
+static int on_set(void* user_data, media_sync_set_t* set)
+{
+    uint64_t* sets = user_data;
+    if (++*sets % 30 == 0) {
+        printf("Set %llu: skew %.3f ms\n", (unsigned long long)*sets, set->skew_ns / 1e6);
+    }
+    return 0;   // 返回 0 由同步器归还缓冲区
+}
+
+// ========================== 程序主函数 ==========================
+
+/**
+ * @brief 程序入口点
+ *
+ * 用法: media_sync [容差毫秒] [设备...]
+ */
+int main(int argc, char* argv[])
+{
+    double tolerance_ms = argc > 1 ? atof(argv[1]) : 5.0;
+    const char* default_devices[] = { "/dev/video0", "/dev/video1" };
+    int count = argc > 2 ? argc - 2 : 2;
+    if (count > MEDIA_SYNC_MAX_STREAMS) {
+        count = MEDIA_SYNC_MAX_STREAMS;
+    }
+
+    printf("libMedia Frame Sync Example\n");
+    printf("Cameras: %d, tolerance: %.2f ms\n", count, tolerance_ms);
+
+    if (libmedia_init() != 0) {
+        printf("Failed to initialize libMedia\n");
+        return -1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    // 每个相机 4 个缓冲区，同步器最多占用其中 2 个
+    uint64_t sets = 0;
+    media_sync_config_t sync_config = {
+        .stream_count = count,
+        .tolerance_ns = (uint64_t)(tolerance_ms * 1e6),
+        .max_pending = 2,
+        .on_set = on_set,
+        .user_data = &sets
+    };
+    sync_ctx = libmedia_sync_create(&sync_config);
+    media_multi_t* multi = libmedia_multi_create();
+
+    media_session_t* sessions[MEDIA_SYNC_MAX_STREAMS] = { 0 };
+    int started = 0;
+    for (int i = 0; i < count && sync_ctx && multi; i++) {
+        media_session_config_t config = {
+            .device_path = argc > 2 ? argv[i + 2] : default_devices[i],
+            .format = {
+                .width = 640,
+                .height = 480,
+                .pixelformat = V4L2_PIX_FMT_NV12,
+                .num_planes = 1
+            },
+            .buffer_count = 4,
+            .use_multiplanar = 1
+        };
+
+        sessions[i] = libmedia_create_session(&config);
+        if (!sessions[i] || libmedia_start_session(sessions[i]) < 0 ||
+            libmedia_multi_add(multi, sessions[i], on_frame, NULL) != i) {
+            printf("%s: failed to start: %s\n", config.device_path,
+                   libmedia_get_error_string(libmedia_get_last_error()));
+            break;
+        }
+        started++;
+    }
+
+    // 所有相机都启动后才开始同步，相机编号即同步流编号
+    if (started == count && libmedia_multi_start(multi) == 0) {
+        while (running) {
+            sleep(1);
+        }
+        libmedia_multi_stop(multi);
+
+        media_sync_stats_t stats;
+        libmedia_sync_get_stats(sync_ctx, &stats);
+        printf("Sets: %llu, skew mean %.3f ms, max %.3f ms\n", (unsigned long long)stats.sets,
+               stats.skew_mean_ns / 1e6, stats.skew_max_ns / 1e6);
+        for (int i = 0; i < count; i++) {
+            printf("Camera %d dropped: %llu\n", i, (unsigned long long)stats.dropped[i]);
+        }
+    }
+
+    // 先归还同步器持有的缓冲区，再销毁会话
+    libmedia_multi_destroy(multi);
+    libmedia_sync_destroy(sync_ctx);
+    for (int i = 0; i < count; i++) {
+        libmedia_destroy_session(sessions[i]);
+    }
+    libmedia_deinit();
+    return 0;
+}
@@ -5,7 +5,7 @@
  * 本程序是 v4l2_usb.c 的重构版本，使用 libMedia 库来简化V4L2操作。
  * 主要功能包括：
  * - 通过libMedia接口采集RAW格式的图像数据
- * - 使用多线程架构实现实时图像流传输
+ * - 使用 libMedia 流水线实现采集与发送并行 (采集源 -> 发送阶段)
  * - 通过TCP Socket将图像数据发送给客户端
  * - 支持多平面缓冲区管理和内存映射
  *
@@ -19,8 +19,8 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
-#include <pthread.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,6 +33,7 @@
 
 // 引入 libMedia 头文件
 #include "media.h"
+#include "media_pipeline.h"
 
 // ========================== 系统配置常量 ==========================
 
@@ -64,20 +65,6 @@
 
 // ========================== 数据结构定义 ==========================
 
-/**
- * @struct frame_data
- * @brief 图像帧数据结构
- *
- * 封装单帧图像的所有相关信息，用于线程间数据传递。
- */
-struct frame_data
-{
-    uint8_t* data;      /**< 图像数据指针 */
-    size_t size;        /**< 图像数据大小，单位：字节 */
-    uint32_t frame_id;  /**< 帧序号，用于跟踪和调试 */
-    uint64_t timestamp; /**< 时间戳，单位：纳秒 */
-};
-
 /**
  * @struct frame_header
  * @brief 数据帧头部结构
@@ -101,27 +88,32 @@ struct frame_header
 /** @brief 程序运行状态标志 */
 volatile int running = 1;
 
-/** @brief 客户端连接状态 */
-volatile int client_connected = 0;
-
 /** @brief TCP服务器文件描述符 */
 int server_fd = -1;
 
-/** @brief 客户端连接文件描述符 */
-int client_fd = -1;
-
-/** @brief 帧数据访问互斥锁 */
-pthread_mutex_t frame_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-/** @brief 帧准备就绪条件变量 */
-pthread_cond_t frame_ready = PTHREAD_COND_INITIALIZER;
+/**
+ * @brief 客户端连接文件描述符，-1 表示未连接
+ *
+ * 主线程接受连接后写入，发送阶段线程在连接断开时清除，两个线程只通过这一个
+ * 原子变量交接连接。
+ */
+_Atomic int client_fd = -1;
 
-/** @brief 当前帧数据 */
-struct frame_data current_frame = {0};
+/** @brief 发送帧序号 */
+uint32_t sent_frames = 0;
 
 /** @brief libMedia 会话句柄 */
 media_session_t* media_session = NULL;
 
+/** @brief 采集/发送流水线 */
+media_pipeline_t* media_pipeline = NULL;
+
+/** @brief 流水线队列深度：发送慢时最多缓存的帧数 (须小于 BUFFER_COUNT) */
+#define SEND_QUEUE_DEPTH 2
+
+/** @brief 统计输出间隔，单位：纳秒 */
+#define STATS_INTERVAL_NS 5000000000ULL
+
 // ========================== 工具函数 ==========================
 
 /**
@@ -148,14 +140,10 @@ void signal_handler(int sig)
     }
 
     // 关闭客户端连接
-    if (client_fd >= 0) {
-        shutdown(client_fd, SHUT_RDWR);
+    int fd = atomic_load(&client_fd);
+    if (fd >= 0) {
+        shutdown(fd, SHUT_RDWR);
     }
-
-    // 通知条件变量
-    pthread_mutex_lock(&frame_mutex);
-    pthread_cond_broadcast(&frame_ready);
-    pthread_mutex_unlock(&frame_mutex);
 }
 
 // ========================== 网络通信函数 ==========================
@@ -241,128 +229,99 @@ int send_frame(int client_fd, void* data, size_t size, uint32_t frame_id, uint64
     return 0;
 }
 
-// ========================== 多线程处理函数 ==========================
+// ========================== 流水线阶段 ==========================
 
 /**
- * @brief USB数据发送线程函数
+ * @brief 发送阶段 (流水线终点)
+ *
+ * 在独立线程中运行，与采集并行。帧缓冲区在发送完成、包引用释放后才归还驱动，
+ * 发送过程中不会被覆盖。
  */
-void* usb_sender_thread(void* arg)
+static int send_stage(void* user_data, media_packet_t* packet, media_packet_t** output)
 {
-    (void)arg; // 避免未使用参数警告
-    printf("USB sender thread started\n");
+    (void)user_data;
+    *output = NULL; // 终点阶段，不再向下游传递
 
-    while (running) {
-        // 等待客户端连接
-        if (!client_connected) {
-            struct sockaddr_in client_addr;
-            socklen_t client_len = sizeof(client_addr);
+    int fd = atomic_load(&client_fd);
+    if (fd < 0) {
+        return 0;
+    }
 
-            printf("Waiting for client connection...\n");
-            client_fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
+    if (send_frame(fd, packet->frame.data, packet->frame.size,
+                   sent_frames, packet->capture_ns) < 0) {
+        printf("Client disconnected (frame %u)\n", sent_frames);
+        // 先清除再关闭，主线程看到 -1 后才会接受新连接
+        atomic_store(&client_fd, -1);
+        close(fd);
+        return 0;
+    }
 
-            if (client_fd < 0) {
-                if (running) {
-                    perror("accept failed");
-                }
-                continue;
-            }
+    sent_frames++;
+    return 0;
+}
 
-            printf("Client connected from %s\n", inet_ntoa(client_addr.sin_addr));
-            client_connected = 1;
-        }
+/**
+ * @brief 输出流水线统计信息
+ */
+static void print_pipeline_stats(uint64_t interval_ns)
+{
+    static uint64_t last_frames = 0;
+    media_node_stats_t stats;
 
-        // 等待新帧数据
-        pthread_mutex_lock(&frame_mutex);
-        while (current_frame.data == NULL && running) {
-            pthread_cond_wait(&frame_ready, &frame_mutex);
+    int count = libmedia_pipeline_get_node_count(media_pipeline);
+    for (int i = 0; i < count; i++) {
+        if (libmedia_pipeline_get_stats(media_pipeline, i, &stats) < 0) {
+            continue;
         }
-
-        if (current_frame.data && running) {
-            // 发送帧数据
-            if (send_frame(client_fd, current_frame.data, current_frame.size,
-                          current_frame.frame_id, current_frame.timestamp) < 0) {
-                printf("Client disconnected (frame %d)\n", current_frame.frame_id);
-                close(client_fd);
-                client_connected = 0;
-                current_frame.data = NULL;
-            } else {
-                // 发送成功，清理当前帧
-                current_frame.data = NULL;
-            }
+        if (i == 0) {
+            double fps = (double)(stats.packets_in - last_frames) * 1000000000.0 / interval_ns;
+            last_frames = stats.packets_in;
+            printf("Frames %llu, FPS: %.1f, Connected: %s\n", (unsigned long long)stats.packets_in,
+                   fps, atomic_load(&client_fd) >= 0 ? "YES" : "NO");
+        } else {
+            printf("  [%s] in %llu, dropped %llu, latency avg %.2f ms / max %.2f ms, age %.2f ms, queue %u/%u (peak %u)\n",
+                   stats.name, (unsigned long long)stats.packets_in, (unsigned long long)stats.dropped,
+                   stats.latency_avg_ns / 1e6, stats.latency_max_ns / 1e6, stats.age_avg_ns / 1e6,
+                   stats.queue_depth, stats.queue_capacity, stats.queue_high_water);
         }
-
-        pthread_mutex_unlock(&frame_mutex);
-    }
-
-    if (client_connected) {
-        close(client_fd);
     }
-
-    printf("USB sender thread terminated\n");
-    return NULL;
 }
 
-// ========================== 图像采集主循环 ==========================
-
 /**
- * @brief 图像采集主循环函数 (使用libMedia)
+ * @brief 主线程循环：接受客户端连接并定期输出统计
  */
-int capture_loop_libmedia()
+static void accept_loop(void)
 {
-    uint32_t frame_counter = 0;
     uint64_t last_stats_time = get_time_ns();
-    uint32_t frames_in_second = 0;
-
-    printf("Starting libMedia capture loop...\n");
 
     while (running) {
-        media_frame_t frame;
-        
-        // 使用 libMedia 捕获帧 (超时1秒)
-        int result = libmedia_session_capture_frame(media_session, &frame, 1000);
-        
-        if (result < 0) {
-            if (libmedia_get_last_error() == MEDIA_ERROR_TIMEOUT) {
-                printf("Timeout waiting for frame\n");
-                continue;
-            } else {
-                printf("Frame capture failed: %s\n", 
-                       libmedia_get_error_string(libmedia_get_last_error()));
-                continue;
+        if (atomic_load(&client_fd) < 0) {
+            fd_set fds;
+            struct timeval tv = { 1, 0 };
+            FD_ZERO(&fds);
+            FD_SET(server_fd, &fds);
+
+            if (select(server_fd + 1, &fds, NULL, NULL, &tv) > 0) {
+                struct sockaddr_in client_addr;
+                socklen_t client_len = sizeof(client_addr);
+                int fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
+                if (fd >= 0) {
+                    printf("Client connected from %s\n", inet_ntoa(client_addr.sin_addr));
+                    atomic_store(&client_fd, fd);
+                } else if (running) {
+                    perror("accept failed");
+                }
             }
+        } else {
+            sleep(1);
         }
 
-        uint64_t timestamp = get_time_ns();
-
-        // 通知USB发送线程（仅在有客户端时）
-        if (client_connected) {
-            pthread_mutex_lock(&frame_mutex);
-            current_frame.data = frame.data;
-            current_frame.size = frame.size;
-            current_frame.frame_id = frame_counter;
-            current_frame.timestamp = timestamp;
-            pthread_cond_signal(&frame_ready);
-            pthread_mutex_unlock(&frame_mutex);
-        }
-
-        // 释放帧回到队列
-        libmedia_session_release_frame(media_session, &frame);
-
-        frame_counter++;
-        frames_in_second++;
-
-        // 统计信息 - 每5秒输出一次
         uint64_t current_time = get_time_ns();
-        if (current_time - last_stats_time >= 5000000000ULL) {
-            double fps = (double)frames_in_second * 1000000000.0 / (current_time - last_stats_time);
-            printf("Frame %d, FPS: %.1f, Bytes: %zu, Connected: %s\n",
-                   frame_counter, fps, frame.size, client_connected ? "YES" : "NO");
-            frames_in_second = 0;
+        if (current_time - last_stats_time >= STATS_INTERVAL_NS) {
+            print_pipeline_stats(current_time - last_stats_time);
             last_stats_time = current_time;
         }
     }
-
-    return 0;
 }
 
 // ========================== 程序主函数 ==========================
@@ -374,7 +333,6 @@ int main(int argc, char* argv[])
 {
     const char* device = "/dev/video0";
     int port = DEFAULT_PORT;
-    pthread_t usb_thread;
 
     if (argc > 1) {
         port = atoi(argv[1]);
@@ -395,6 +353,9 @@ int main(int argc, char* argv[])
     // 设置调试级别
     libmedia_set_debug_level(3); // INFO级别
 
+    // 采集线程独占一个核并使用实时调度，避免与网络发送争抢 CPU (无权限时仅告警)
+    libmedia_set_thread_preset(MEDIA_THREAD_PRESET_LATENCY);
+
     // 检查系统资源
     printf("Checking system resources...\n");
     int system_ret = system("free -m | head -2 | tail -1 | awk '{print \"Memory: \" $3 \"/\" $2 \" MB used\"}'");
@@ -445,19 +406,38 @@ int main(int argc, char* argv[])
 
     printf("Media session started successfully\n");
 
-    // 启动USB发送线程
-    if (pthread_create(&usb_thread, NULL, usb_sender_thread, NULL) != 0) {
-        perror("Failed to create USB thread");
+    // 构建流水线：采集源 -> 发送阶段，各自运行在独立线程
+    media_pipeline = libmedia_pipeline_create();
+    if (!media_pipeline) {
         goto cleanup;
     }
 
-    // 主采集循环 (使用libMedia)
-    capture_loop_libmedia();
+    media_stage_config_t send_config = {
+        .name = "send",
+        .process = send_stage,
+        .queue_depth = SEND_QUEUE_DEPTH,
+        .backpressure = MEDIA_BACKPRESSURE_DROP_OLDEST,    // 客户端跟不上时丢弃旧帧，始终发送最新画面
+    };
+    int camera = libmedia_pipeline_add_session_source(media_pipeline, "camera", media_session);
+    int sender = libmedia_pipeline_add_stage(media_pipeline, &send_config);
+    if (camera < 0 || sender < 0 || libmedia_pipeline_link(media_pipeline, camera, sender) < 0 ||
+        libmedia_pipeline_start(media_pipeline) < 0) {
+        printf("Failed to start pipeline: %s\n",
+               libmedia_get_error_string(libmedia_get_last_error()));
+        goto cleanup;
+    }
 
-    // 等待线程结束
-    pthread_join(usb_thread, NULL);
+    // 主线程负责客户端连接与统计输出
+    accept_loop();
 
 cleanup:
+    // 流水线持有会话缓冲区，须先于会话销毁
+    libmedia_pipeline_destroy(media_pipeline);
+
+    if (atomic_load(&client_fd) >= 0) {
+        close(atomic_load(&client_fd));
+    }
+
     if (media_session) {
         libmedia_stop_session(media_session);
         libmedia_destroy_session(media_session);
@@ -0,0 +1,433 @@
+/**
+ * @file libmedia.hpp
+ * @brief libMedia C++ wrapper
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Header-only RAII types over the C API for C++17 and later. Device, Session
+ * and Frame are move-only owners: a Frame returns its buffer to the driver
+ * when it goes out of scope, including during stack unwinding, so an
+ * exception can no longer starve the capture queue. Fallible calls return
+ * media::Result<T>, which holds either a value or the library error code.
+ * Everything is inline and holds exactly the state the C calls need, so the
+ * wrapper adds no overhead over calling the C API directly.
+ *
+ * Typical use:
+ * @code
+ * auto session = media::Session::create(config);
+ * if (!session || !session->start()) {
+ *     return session.error().message();
+ * }
+ * if (auto frame = session->capture(1000)) {
+ *     process(frame->bytes());
+ * }   // buffer requeued here
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_HPP
+#define LIBMEDIA_HPP
+
+#include "media.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+#if defined(__cpp_lib_span)
+#include <span>
+#endif
+
+namespace media {
+
+// ============================================================================
+// Errors and Results
+// ============================================================================
+
+/**
+ * @brief Library error code
+ */
+struct Error {
+    media_error_t code = MEDIA_ERROR_NONE;
+
+    const char* message() const noexcept { return libmedia_get_error_string(code); }
+
+    /** Error reported by the last failed C call on this thread */
+    static Error last() noexcept
+    {
+        media_error_t code = libmedia_get_last_error();
+        return Error{ code != MEDIA_ERROR_NONE ? code : MEDIA_ERROR_STREAMING_ERROR };
+    }
+};
+
+/**
+ * @brief Value or error, in the spirit of std::expected
+ *
+ * Accessing the value of a failed result is a programming error (asserted).
+ */
+template <typename T>
+class Result {
+public:
+    Result(T&& value) noexcept : value_(std::move(value)) {}
+    Result(Error error) noexcept : error_(error.code) {}
+
+    bool has_value() const noexcept { return error_ == MEDIA_ERROR_NONE; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    T& value() & noexcept { assert(has_value()); return value_; }
+    const T& value() const& noexcept { assert(has_value()); return value_; }
+    T&& value() && noexcept { assert(has_value()); return std::move(value_); }
+
+    T& operator*() & noexcept { return value(); }
+    const T& operator*() const& noexcept { return value(); }
+    T&& operator*() && noexcept { return std::move(*this).value(); }
+    T* operator->() noexcept { return &value(); }
+    const T* operator->() const noexcept { return &value(); }
+
+    Error error() const noexcept { return Error{ error_ }; }
+
+private:
+    T value_{};
+    media_error_t error_ = MEDIA_ERROR_NONE;
+};
+
+template <>
+class Result<void> {
+public:
+    Result() noexcept = default;
+    Result(Error error) noexcept : error_(error.code) {}
+
+    bool has_value() const noexcept { return error_ == MEDIA_ERROR_NONE; }
+    explicit operator bool() const noexcept { return has_value(); }
+    Error error() const noexcept { return Error{ error_ }; }
+
+    /** Ok if the C call returned a non-negative status */
+    static Result check(int status) noexcept { return status < 0 ? Result(Error::last()) : Result(); }
+
+private:
+    media_error_t error_ = MEDIA_ERROR_NONE;
+};
+
+// ============================================================================
+// Spans
+// ============================================================================
+
+#if defined(__cpp_lib_span)
+template <typename T>
+using Span = std::span<T>;
+#else
+/**
+ * @brief Minimal std::span stand-in for C++17
+ */
+template <typename T>
+class Span {
+public:
+    constexpr Span() noexcept = default;
+    constexpr Span(T* data, std::size_t size) noexcept : data_(data), size_(size) {}
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr std::size_t size() const noexcept { return size_; }
+    constexpr std::size_t size_bytes() const noexcept { return size_ * sizeof(T); }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T* begin() const noexcept { return data_; }
+    constexpr T* end() const noexcept { return data_ + size_; }
+    constexpr T& operator[](std::size_t index) const noexcept { return data_[index]; }
+    constexpr Span subspan(std::size_t offset, std::size_t count) const noexcept { return Span(data_ + offset, count); }
+
+private:
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+#endif
+
+// ============================================================================
+// Frame
+// ============================================================================
+
+/**
+ * @brief Captured frame that requeues its buffer when destroyed
+ */
+class Frame {
+public:
+    Frame() noexcept = default;
+    ~Frame() { reset(); }
+
+    Frame(Frame&& other) noexcept
+        : frame_(other.frame_), session_(std::exchange(other.session_, nullptr)),
+          handle_(std::exchange(other.handle_, -1)) {}
+
+    Frame& operator=(Frame&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            frame_ = other.frame_;
+            session_ = std::exchange(other.session_, nullptr);
+            handle_ = std::exchange(other.handle_, -1);
+        }
+        return *this;
+    }
+
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    /** Return the buffer to the driver now */
+    void reset() noexcept
+    {
+        if (session_) {
+            libmedia_session_release_frame(session_, &frame_);
+        } else if (handle_ >= 0) {
+            libmedia_release_frame(handle_, &frame_);
+        }
+        session_ = nullptr;
+        handle_ = -1;
+    }
+
+    bool valid() const noexcept { return session_ || handle_ >= 0; }
+    explicit operator bool() const noexcept { return valid(); }
+
+    uint32_t width() const noexcept { return frame_.width; }
+    uint32_t height() const noexcept { return frame_.height; }
+    uint32_t pixelformat() const noexcept { return frame_.pixelformat; }
+    uint64_t timestamp() const noexcept { return frame_.timestamp; }
+    uint32_t id() const noexcept { return frame_.frame_id; }
+    uint32_t sequence() const noexcept { return frame_.sequence; }
+    media_meta_t* meta() const noexcept { return frame_.meta; }
+
+    /** Whole buffer */
+    Span<const uint8_t> bytes() const noexcept
+    {
+        return Span<const uint8_t>(static_cast<const uint8_t*>(frame_.data), frame_.size);
+    }
+
+    /**
+     * @brief One colour plane of a frame with packed rows
+     *
+     * Plane 0 is the luma (or only) plane; semi-planar formats have the
+     * interleaved chroma in plane 1, planar formats U and V in planes 1
+     * and 2. Empty if the format has no such plane or the buffer is short.
+     */
+    Span<const uint8_t> plane(int index) const noexcept
+    {
+        const media_format_desc_t* desc = libmedia_get_format_desc(frame_.pixelformat);
+        if (!desc || index < 0 || index >= (desc->planes ? desc->planes : 1)) {
+            return Span<const uint8_t>();
+        }
+
+        if (desc->planes <= 1) {
+            return bytes();
+        }
+
+        std::size_t offset = 0;
+        for (int i = 0; i < index; i++) {
+            offset += libmedia_get_plane_bytes(frame_.pixelformat, i, frame_.width, frame_.height);
+        }
+        std::size_t length = libmedia_get_plane_bytes(frame_.pixelformat, index, frame_.width, frame_.height);
+        if (offset + length > frame_.size) {
+            return Span<const uint8_t>();
+        }
+        return bytes().subspan(offset, length);
+    }
+
+    /** Underlying C frame, still owned by this object */
+    const media_frame_t& get() const noexcept { return frame_; }
+
+    /** Give up ownership; the caller must release the C frame */
+    media_frame_t release() noexcept
+    {
+        session_ = nullptr;
+        handle_ = -1;
+        return frame_;
+    }
+
+private:
+    friend class Session;
+    friend class Device;
+
+    Frame(const media_frame_t& frame, media_session_t* session, int handle) noexcept
+        : frame_(frame), session_(session), handle_(handle) {}
+
+    media_frame_t frame_{};
+    media_session_t* session_ = nullptr;
+    int handle_ = -1;
+};
+
+// ============================================================================
+// Device
+// ============================================================================
+
+/**
+ * @brief Open V4L2 device
+ */
+class Device {
+public:
+    Device() noexcept = default;
+    ~Device() { reset(); }
+
+    Device(Device&& other) noexcept : handle_(std::exchange(other.handle_, -1)) {}
+    Device& operator=(Device&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, -1);
+        }
+        return *this;
+    }
+
+    Device(const Device&) = delete;
+    Device& operator=(const Device&) = delete;
+
+    static Result<Device> open(const char* path) noexcept
+    {
+        int handle = libmedia_open_device(path);
+        if (handle < 0) {
+            return Error::last();
+        }
+        return Device(handle);
+    }
+
+    void reset() noexcept
+    {
+        if (handle_ >= 0) {
+            libmedia_close_device(handle_);
+            handle_ = -1;
+        }
+    }
+
+    bool valid() const noexcept { return handle_ >= 0; }
+    explicit operator bool() const noexcept { return valid(); }
+    int handle() const noexcept { return handle_; }
+
+    Result<media_device_info_t> info() const noexcept
+    {
+        media_device_info_t info{};
+        if (libmedia_get_device_info(handle_, &info) < 0) {
+            return Error::last();
+        }
+        return Result<media_device_info_t>(std::move(info));
+    }
+
+    Result<void> set_format(media_format_t& format) noexcept
+    {
+        return Result<void>::check(libmedia_set_format(handle_, &format));
+    }
+
+    /** Capture from a device whose buffers were requested and streaming started */
+    Result<Frame> capture(int timeout_ms) noexcept
+    {
+        media_frame_t frame{};
+        if (libmedia_capture_frame(handle_, &frame, timeout_ms) < 0) {
+            return Error::last();
+        }
+        if (!frame.data) {
+            return Error{ MEDIA_ERROR_TIMEOUT };
+        }
+        return Frame(frame, nullptr, handle_);
+    }
+
+private:
+    explicit Device(int handle) noexcept : handle_(handle) {}
+
+    int handle_ = -1;
+};
+
+// ============================================================================
+// Session
+// ============================================================================
+
+/**
+ * @brief Capture session, stopped and destroyed with the object
+ *
+ * Frames hold the session's buffers and must be destroyed first.
+ */
+class Session {
+public:
+    Session() noexcept = default;
+    ~Session() { reset(); }
+
+    Session(Session&& other) noexcept : session_(std::exchange(other.session_, nullptr)) {}
+    Session& operator=(Session&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            session_ = std::exchange(other.session_, nullptr);
+        }
+        return *this;
+    }
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    static Result<Session> create(const media_session_config_t& config) noexcept
+    {
+        media_session_t* session = libmedia_create_session(&config);
+        if (!session) {
+            return Error::last();
+        }
+        return Session(session);
+    }
+
+    void reset() noexcept
+    {
+        if (session_) {
+            libmedia_destroy_session(session_);     // Stops streaming if still active
+            session_ = nullptr;
+        }
+    }
+
+    bool valid() const noexcept { return session_ != nullptr; }
+    explicit operator bool() const noexcept { return valid(); }
+    media_session_t* get() const noexcept { return session_; }
+
+    /** Non-blocking device fd, readable when a frame can be dequeued */
+    int fd() const noexcept { return libmedia_session_get_fd(session_); }
+
+    Result<void> start() noexcept { return Result<void>::check(libmedia_start_session(session_)); }
+    Result<void> stop() noexcept { return Result<void>::check(libmedia_stop_session(session_)); }
+
+    /** Wait for the next frame; a timeout is reported as MEDIA_ERROR_TIMEOUT */
+    Result<Frame> capture(int timeout_ms) noexcept
+    {
+        media_frame_t frame{};
+        if (libmedia_session_capture_frame(session_, &frame, timeout_ms) < 0) {
+            return Error::last();
+        }
+        if (!frame.data) {
+            return Error{ MEDIA_ERROR_TIMEOUT };
+        }
+        return Frame(frame, session_, -1);
+    }
+
+private:
+    explicit Session(media_session_t* session) noexcept : session_(session) {}
+
+    media_session_t* session_ = nullptr;
+};
+
+// ============================================================================
+// Library
+// ============================================================================
+
+/**
+ * @brief Initialises the library for the lifetime of the object
+ */
+class Library {
+public:
+    Library() noexcept : ok_(libmedia_init() == 0) {}
+    ~Library() { libmedia_deinit(); }
+
+    Library(const Library&) = delete;
+    Library& operator=(const Library&) = delete;
+
+    explicit operator bool() const noexcept { return ok_; }
+
+private:
+    bool ok_;
+};
+
+} // namespace media
+
+#endif // LIBMEDIA_HPP
@@ -0,0 +1,378 @@
+/**
+ * @file libmedia_coro.hpp
+ * @brief libMedia C++20 coroutine support
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * An epoll reactor and awaitables on top of libmedia.hpp, so one thread can
+ * drive many cameras and sockets. Capture devices are already opened
+ * non-blocking: `co_await camera.next_frame()` first tries a dequeue, and
+ * only if no buffer is done does it park the coroutine on the device fd.
+ * When the fd turns readable the reactor dequeues on the coroutine's behalf
+ * and resumes it only once it holds a frame or an error, so a spurious
+ * wakeup costs one ioctl and no context switch.
+ *
+ * The reactor is single threaded: create, await and run it on one thread.
+ * Each fd may have at most one waiter at a time, and whatever owns the fd
+ * (an AsyncSession, a socket) must outlive any coroutine waiting on it.
+ *
+ * Typical use:
+ * @code
+ * media::Task stream(media::AsyncSession& camera) {
+ *     for (;;) {
+ *         auto frame = co_await camera.next_frame();
+ *         if (!frame) co_return;
+ *         process(frame->bytes());
+ *     }
+ * }
+ *
+ * media::Reactor reactor;
+ * media::AsyncSession camera(reactor, std::move(*session));
+ * stream(camera);
+ * reactor.run();
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_CORO_HPP
+#define LIBMEDIA_CORO_HPP
+
+#include "libmedia.hpp"
+
+#if !defined(__cpp_impl_coroutine)
+#error "libmedia_coro.hpp requires C++20 coroutines"
+#endif
+
+#include <cerrno>
+#include <coroutine>
+#include <exception>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace media {
+
+// ============================================================================
+// Task
+// ============================================================================
+
+/**
+ * @brief Fire-and-forget coroutine
+ *
+ * Starts running when called and frees itself when it returns. Exceptions
+ * escaping the coroutine terminate the program.
+ */
+struct Task {
+    struct promise_type {
+        Task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+// ============================================================================
+// Reactor
+// ============================================================================
+
+/**
+ * @brief Coroutine parked on an fd
+ *
+ * Awaiters derive from this. @c retry, if set, runs in the reactor when the
+ * fd fires and returns false to stay parked instead of resuming.
+ */
+struct Waiter {
+    std::coroutine_handle<> handle;
+    int fd = -1;
+    uint32_t events = 0;                    /**< EPOLLIN / EPOLLOUT */
+    uint32_t revents = 0;                   /**< Events that fired, 0 if cancelled */
+    bool (*retry)(Waiter*) = nullptr;
+    uint64_t id = 0;                        /**< Registration id carried by the epoll event */
+    Waiter* prev = nullptr;
+    Waiter* next = nullptr;
+};
+
+/**
+ * @brief epoll event loop that resumes waiting coroutines
+ */
+class Reactor {
+public:
+    Reactor() noexcept : epfd_(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~Reactor()
+    {
+        if (epfd_ >= 0) {
+            ::close(epfd_);
+        }
+    }
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    explicit operator bool() const noexcept { return epfd_ >= 0; }
+
+    /** Number of coroutines waiting */
+    std::size_t pending() const noexcept { return pending_; }
+
+    /**
+     * @brief Park a waiter until its fd reports one of its events
+     *
+     * Registrations are one-shot, so an fd that is not awaited stays in the
+     * epoll set but never wakes the loop. Closing the fd removes it.
+     * @return 0 on success, -1 if epoll refused the fd
+     */
+    int arm(Waiter* waiter) noexcept
+    {
+        waiter->id = ++next_id_;
+        if (control(waiter) < 0) {
+            return -1;
+        }
+        waiter->prev = nullptr;
+        waiter->next = waiters_;
+        if (waiters_) {
+            waiters_->prev = waiter;
+        }
+        waiters_ = waiter;
+        pending_++;
+        return 0;
+    }
+
+    /**
+     * @brief Wait for ready fds once and resume their coroutines
+     * @param timeout_ms Timeout in milliseconds (-1 for infinite)
+     * @return Number of coroutines resumed, -1 on error
+     */
+    int run_once(int timeout_ms) noexcept
+    {
+        epoll_event events[RUN_BATCH];
+        int count = epoll_wait(epfd_, events, RUN_BATCH, timeout_ms);
+        if (count < 0) {
+            return errno == EINTR ? 0 : -1;
+        }
+
+        // Resuming one coroutine may cancel or end others, so every event is
+        // matched against the waiters still parked rather than trusted
+        int resumed = 0;
+        for (int i = 0; i < count; i++) {
+            Waiter* waiter = find(events[i].data.u64);
+            if (!waiter) {
+                continue;   // Registration gone since epoll_wait returned
+            }
+            waiter->revents = events[i].events;
+            if (waiter->retry && !waiter->retry(waiter) && control(waiter) == 0) {
+                continue;   // Woken without progress: park again
+            }
+            unlink(waiter);
+            waiter->handle.resume();
+            resumed++;
+        }
+        return resumed;
+    }
+
+    /**
+     * @brief Run until no coroutine is waiting or stop() is called
+     * @return 0 on success, -1 on error
+     */
+    int run() noexcept
+    {
+        stopped_ = false;
+        while (!stopped_ && pending_ > 0) {
+            if (run_once(-1) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    /** Make run() return after the current batch */
+    void stop() noexcept { stopped_ = true; }
+
+    /**
+     * @brief Resume every waiting coroutine with revents 0
+     *
+     * Awaiters report this as MEDIA_ERROR_TIMEOUT, letting coroutines check
+     * their exit condition before the objects they wait on are destroyed.
+     */
+    void cancel() noexcept
+    {
+        while (Waiter* waiter = waiters_) {
+            epoll_ctl(epfd_, EPOLL_CTL_DEL, waiter->fd, nullptr);
+            waiter->revents = 0;
+            unlink(waiter);
+            waiter->handle.resume();
+        }
+    }
+
+    /**
+     * @brief Awaiter for fd readiness, yields the events that fired
+     */
+    struct FdWait : Waiter {
+        Reactor& reactor;
+        bool failed = false;
+
+        FdWait(Reactor& r, int wait_fd, uint32_t wait_events) noexcept : reactor(r)
+        {
+            fd = wait_fd;
+            events = wait_events;
+        }
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            handle = h;
+            failed = reactor.arm(this) < 0;
+            return !failed;
+        }
+        Result<uint32_t> await_resume() const noexcept
+        {
+            if (failed) {
+                return Error{ MEDIA_ERROR_INVALID_PARAM };
+            }
+            if (revents == 0) {
+                return Error{ MEDIA_ERROR_TIMEOUT };
+            }
+            return Result<uint32_t>(uint32_t(revents));
+        }
+    };
+
+    /** `co_await reactor.readable(fd)` */
+    FdWait readable(int fd) noexcept { return FdWait(*this, fd, EPOLLIN); }
+
+    /** `co_await reactor.writable(fd)` */
+    FdWait writable(int fd) noexcept { return FdWait(*this, fd, EPOLLOUT); }
+
+private:
+    static constexpr int RUN_BATCH = 16;
+
+    int control(Waiter* waiter) noexcept
+    {
+        epoll_event ev{};
+        ev.events = waiter->events | EPOLLONESHOT;
+        ev.data.u64 = waiter->id;
+        // Re-arming an fd seen before is the common case
+        if (epoll_ctl(epfd_, EPOLL_CTL_MOD, waiter->fd, &ev) == 0) {
+            return 0;
+        }
+        if (errno != ENOENT) {
+            return -1;
+        }
+        return epoll_ctl(epfd_, EPOLL_CTL_ADD, waiter->fd, &ev);
+    }
+
+    Waiter* find(uint64_t id) const noexcept
+    {
+        for (Waiter* waiter = waiters_; waiter; waiter = waiter->next) {
+            if (waiter->id == id) {
+                return waiter;
+            }
+        }
+        return nullptr;
+    }
+
+    void unlink(Waiter* waiter) noexcept
+    {
+        if (waiter->prev) {
+            waiter->prev->next = waiter->next;
+        } else {
+            waiters_ = waiter->next;
+        }
+        if (waiter->next) {
+            waiter->next->prev = waiter->prev;
+        }
+        waiter->prev = waiter->next = nullptr;
+        waiter->id = 0;
+        pending_--;
+    }
+
+    int epfd_ = -1;
+    Waiter* waiters_ = nullptr;
+    std::size_t pending_ = 0;
+    uint64_t next_id_ = 0;
+    bool stopped_ = false;
+};
+
+// ============================================================================
+// Async Session
+// ============================================================================
+
+/**
+ * @brief Capture session whose frames are awaited on a reactor
+ */
+class AsyncSession {
+public:
+    AsyncSession(Reactor& reactor, Session&& session) noexcept
+        : reactor_(&reactor), session_(std::move(session)) {}
+
+    AsyncSession(AsyncSession&&) noexcept = default;
+    AsyncSession& operator=(AsyncSession&&) noexcept = default;
+
+    Session& session() noexcept { return session_; }
+
+    /**
+     * @brief Awaiter for the next captured frame
+     *
+     * Yields the frame, MEDIA_ERROR_STREAMING_ERROR if the device reports an
+     * error (for example streaming stopped), or MEDIA_ERROR_TIMEOUT if the
+     * reactor was cancelled.
+     */
+    struct FrameWait : Waiter {
+        Reactor& reactor;
+        Session& session;
+        Result<Frame> result{ Error{ MEDIA_ERROR_TIMEOUT } };
+
+        FrameWait(Reactor& r, Session& s) noexcept : reactor(r), session(s)
+        {
+            fd = s.fd();
+            events = EPOLLIN;
+            retry = &FrameWait::dequeue;
+        }
+
+        bool await_ready() noexcept
+        {
+            result = session.capture(0);
+            return result || result.error().code != MEDIA_ERROR_TIMEOUT;
+        }
+
+        bool await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            handle = h;
+            if (reactor.arm(this) < 0) {
+                result = Error{ MEDIA_ERROR_STREAMING_ERROR };
+                return false;
+            }
+            return true;
+        }
+
+        Result<Frame> await_resume() noexcept
+        {
+            if (revents == 0 && !result) {
+                return Error{ MEDIA_ERROR_TIMEOUT };
+            }
+            return std::move(result);
+        }
+
+    private:
+        static bool dequeue(Waiter* waiter) noexcept
+        {
+            FrameWait* self = static_cast<FrameWait*>(waiter);
+            self->result = self->session.capture(0);
+            if (self->result || self->result.error().code != MEDIA_ERROR_TIMEOUT) {
+                return true;
+            }
+            if (self->revents & (EPOLLERR | EPOLLHUP)) {
+                self->result = Error{ MEDIA_ERROR_STREAMING_ERROR };
+                return true;
+            }
+            return false;
+        }
+    };
+
+    /** `co_await camera.next_frame()` */
+    FrameWait next_frame() noexcept { return FrameWait(*reactor_, session_); }
+
+private:
+    Reactor* reactor_;
+    Session session_;
+};
+
+} // namespace media
+
+#endif // LIBMEDIA_CORO_HPP
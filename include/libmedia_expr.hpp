@@ -0,0 +1,386 @@
+/**
+ * @file libmedia_expr.hpp
+ * @brief libMedia fused image arithmetic
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Expression templates over media::ImageView. Arithmetic on views, scalars,
+ * clamp(), lut() and cast<T>() builds a lazy tree; assigning the tree to a
+ * view evaluates it in a single pass, one row at a time, with each output
+ * sample computed in registers from its inputs. A chain such as
+ * `(raw - dark) * gain >> 2` therefore reads each source and writes the
+ * destination exactly once instead of once per operator. The per-row loop
+ * is a plain indexed loop that GCC and Clang vectorise at -O3 (and GCC 12+
+ * at -O2) unless a lut() gather is involved.
+ *
+ * Arithmetic follows C++ promotion rules: uint16_t - uint16_t is int, and a
+ * float scalar makes the expression float. Storing narrows with static_cast,
+ * so clamp() to the destination range first where the result can overflow.
+ *
+ * Typical use:
+ * @code
+ * media::ImageView<const uint16_t> raw(src_plane), dark(dark_plane);
+ * media::ImageView<uint8_t> out(dst_plane);
+ * if (!(out = media::clamp((raw - dark) * gain >> 2, 0, 255))) {
+ *     // An operand differs in size from out; out is unchanged
+ * }
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_EXPR_HPP
+#define LIBMEDIA_EXPR_HPP
+
+#include "libmedia.hpp"
+#include "media_proc.h"
+#include <algorithm>
+#include <type_traits>
+
+namespace media {
+
+// ============================================================================
+// Image Views
+// ============================================================================
+
+template <typename E>
+struct Expr;
+
+/**
+ * @brief Typed view of one image plane; does not own the pixels
+ */
+template <typename T>
+class ImageView {
+public:
+    ImageView() noexcept = default;
+    ImageView(T* data, uint32_t width, uint32_t height, std::size_t stride) noexcept
+        : data_(data), width_(width), height_(height), stride_(stride) {}
+    explicit ImageView(const media_plane_t& plane) noexcept
+        : ImageView(static_cast<T*>(plane.data), plane.width, plane.height, plane.stride) {}
+
+    /** Views of mutable pixels convert to views of const pixels */
+    template <typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+    ImageView(const ImageView<U>& other) noexcept
+        : ImageView(other.data(), other.width(), other.height(), other.stride()) {}
+
+    T* data() const noexcept { return data_; }
+    uint32_t width() const noexcept { return width_; }
+    uint32_t height() const noexcept { return height_; }
+    std::size_t stride() const noexcept { return stride_; }     /**< Bytes between rows */
+
+    T* row(uint32_t y) const noexcept
+    {
+        using Byte = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+        return reinterpret_cast<T*>(reinterpret_cast<Byte*>(data_) + y * stride_);
+    }
+
+    /**
+     * @brief Evaluate an expression into this view, as evaluate()
+     *
+     * Assigning another view rebinds this one, like std::span; use
+     * evaluate(dst, src) to copy pixels.
+     * @return MEDIA_ERROR_INVALID_PARAM, with no pixel written, if an
+     *         operand view differs in size from this one
+     */
+    template <typename E>
+    Result<void> operator=(const Expr<E>& expr) noexcept;
+
+    ImageView& operator=(const ImageView&) noexcept = default;
+
+private:
+    T* data_ = nullptr;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    std::size_t stride_ = 0;
+};
+
+// ============================================================================
+// Expression Nodes
+// ============================================================================
+
+/**
+ * @brief Base of every expression node
+ *
+ * A node E provides fits(width, height), telling whether it can produce an
+ * image of that size, and row(y), returning a cheap object whose
+ * operator[](x) computes one sample.
+ */
+template <typename E>
+struct Expr {
+    const E& self() const noexcept { return static_cast<const E&>(*this); }
+};
+
+/** @brief Leaf reading a view */
+template <typename T>
+struct ViewExpr : Expr<ViewExpr<T>> {
+    ImageView<const T> view;
+
+    struct Row {
+        const T* pixels;
+        T operator[](uint32_t x) const noexcept { return pixels[x]; }
+    };
+
+    explicit ViewExpr(ImageView<const T> v) noexcept : view(v) {}
+    bool fits(uint32_t width, uint32_t height) const noexcept
+    {
+        return view.width() == width && view.height() == height;
+    }
+    Row row(uint32_t y) const noexcept { return Row{ view.row(y) }; }
+};
+
+/** @brief Leaf broadcasting a constant */
+template <typename T>
+struct ScalarExpr : Expr<ScalarExpr<T>> {
+    T value;
+
+    struct Row {
+        T value;
+        T operator[](uint32_t) const noexcept { return value; }
+    };
+
+    explicit ScalarExpr(T v) noexcept : value(v) {}
+    bool fits(uint32_t, uint32_t) const noexcept { return true; }
+    Row row(uint32_t) const noexcept { return Row{ value }; }
+};
+
+/** @brief Operator applied to two sub-expressions */
+template <typename Op, typename L, typename R>
+struct BinaryExpr : Expr<BinaryExpr<Op, L, R>> {
+    L left;
+    R right;
+
+    struct Row {
+        typename L::Row left;
+        typename R::Row right;
+        auto operator[](uint32_t x) const noexcept { return Op::apply(left[x], right[x]); }
+    };
+
+    BinaryExpr(const L& l, const R& r) noexcept : left(l), right(r) {}
+    bool fits(uint32_t width, uint32_t height) const noexcept
+    {
+        return left.fits(width, height) && right.fits(width, height);
+    }
+    Row row(uint32_t y) const noexcept { return Row{ left.row(y), right.row(y) }; }
+};
+
+/** @brief Function with bound parameters applied to a sub-expression */
+template <typename Fn, typename E>
+struct UnaryExpr : Expr<UnaryExpr<Fn, E>> {
+    Fn fn;
+    E inner;
+
+    struct Row {
+        Fn fn;
+        typename E::Row inner;
+        auto operator[](uint32_t x) const noexcept { return fn(inner[x]); }
+    };
+
+    UnaryExpr(const Fn& f, const E& e) noexcept : fn(f), inner(e) {}
+    bool fits(uint32_t width, uint32_t height) const noexcept { return inner.fits(width, height); }
+    Row row(uint32_t y) const noexcept { return Row{ fn, inner.row(y) }; }
+};
+
+// ============================================================================
+// Operands
+// ============================================================================
+
+namespace detail {
+
+template <typename T>
+struct is_view : std::false_type {};
+template <typename T>
+struct is_view<ImageView<T>> : std::true_type {};
+
+template <typename T>
+constexpr bool is_expr_v = std::is_base_of_v<Expr<T>, T> || is_view<T>::value;
+
+template <typename T>
+constexpr bool is_operand_v = is_expr_v<T> || std::is_arithmetic_v<T>;
+
+/** Wrap a view or scalar in its leaf node; expressions pass through */
+template <typename T>
+auto operand(const T& value) noexcept
+{
+    if constexpr (is_view<T>::value) {
+        return ViewExpr<std::remove_const_t<std::remove_reference_t<decltype(*value.data())>>>(value);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        return ScalarExpr<T>(value);
+    } else {
+        return value;
+    }
+}
+
+template <typename A, typename B>
+using enable_binary_t = std::enable_if_t<is_operand_v<A> && is_operand_v<B> && (is_expr_v<A> || is_expr_v<B>)>;
+
+template <typename Op, typename A, typename B>
+auto binary(const A& a, const B& b) noexcept
+{
+    using L = decltype(operand(a));
+    using R = decltype(operand(b));
+    return BinaryExpr<Op, L, R>(operand(a), operand(b));
+}
+
+struct Add { template <typename A, typename B> static auto apply(A a, B b) noexcept { return a + b; } };
+struct Sub { template <typename A, typename B> static auto apply(A a, B b) noexcept { return a - b; } };
+struct Mul { template <typename A, typename B> static auto apply(A a, B b) noexcept { return a * b; } };
+struct Div { template <typename A, typename B> static auto apply(A a, B b) noexcept { return a / b; } };
+struct Shr { template <typename A, typename B> static auto apply(A a, B b) noexcept { return a >> b; } };
+struct Shl { template <typename A, typename B> static auto apply(A a, B b) noexcept { return a << b; } };
+struct And { template <typename A, typename B> static auto apply(A a, B b) noexcept { return a & b; } };
+struct Or { template <typename A, typename B> static auto apply(A a, B b) noexcept { return a | b; } };
+struct Min {
+    template <typename A, typename B>
+    static auto apply(A a, B b) noexcept
+    {
+        using C = std::common_type_t<A, B>;
+        return std::min<C>(a, b);
+    }
+};
+struct Max {
+    template <typename A, typename B>
+    static auto apply(A a, B b) noexcept
+    {
+        using C = std::common_type_t<A, B>;
+        return std::max<C>(a, b);
+    }
+};
+
+template <typename T>
+struct Clamp {
+    T lo;
+    T hi;
+    template <typename V>
+    auto operator()(V v) const noexcept
+    {
+        using C = std::common_type_t<V, T>;
+        return std::min<C>(std::max<C>(v, lo), hi);
+    }
+};
+
+template <typename T>
+struct Lookup {
+    const T* table;
+    std::size_t last;
+    template <typename V>
+    T operator()(V v) const noexcept
+    {
+        // Out of range indices saturate to the ends of the table
+        if constexpr (std::is_signed_v<V>) {
+            if (v < V(0)) {
+                return table[0];
+            }
+        }
+        return table[std::min<std::size_t>(static_cast<std::size_t>(v), last)];
+    }
+};
+
+template <typename T>
+struct Cast {
+    template <typename V>
+    T operator()(V v) const noexcept { return static_cast<T>(v); }
+};
+
+} // namespace detail
+
+// ============================================================================
+// Operators and Functions
+// ============================================================================
+
+#define LIBMEDIA_EXPR_OPERATOR(op, Op) \
+    template <typename A, typename B, typename = detail::enable_binary_t<A, B>> \
+    auto operator op(const A& a, const B& b) noexcept { return detail::binary<detail::Op>(a, b); }
+
+LIBMEDIA_EXPR_OPERATOR(+, Add)
+LIBMEDIA_EXPR_OPERATOR(-, Sub)
+LIBMEDIA_EXPR_OPERATOR(*, Mul)
+LIBMEDIA_EXPR_OPERATOR(/, Div)
+LIBMEDIA_EXPR_OPERATOR(>>, Shr)
+LIBMEDIA_EXPR_OPERATOR(<<, Shl)
+LIBMEDIA_EXPR_OPERATOR(&, And)
+LIBMEDIA_EXPR_OPERATOR(|, Or)
+
+#undef LIBMEDIA_EXPR_OPERATOR
+
+/** Per-sample minimum */
+template <typename A, typename B, typename = detail::enable_binary_t<A, B>>
+auto min(const A& a, const B& b) noexcept { return detail::binary<detail::Min>(a, b); }
+
+/** Per-sample maximum */
+template <typename A, typename B, typename = detail::enable_binary_t<A, B>>
+auto max(const A& a, const B& b) noexcept { return detail::binary<detail::Max>(a, b); }
+
+/** Clamp every sample to [lo, hi] */
+template <typename E, typename T, typename = std::enable_if_t<detail::is_expr_v<E> && std::is_arithmetic_v<T>>>
+auto clamp(const E& e, T lo, T hi) noexcept
+{
+    auto inner = detail::operand(e);
+    return UnaryExpr<detail::Clamp<T>, decltype(inner)>(detail::Clamp<T>{ lo, hi }, inner);
+}
+
+/** Map every sample through a table of `size` entries; the table must outlive the expression */
+template <typename E, typename T, typename = std::enable_if_t<detail::is_expr_v<E>>>
+auto lut(const T* table, std::size_t size, const E& e) noexcept
+{
+    assert(table && size > 0);
+    auto inner = detail::operand(e);
+    return UnaryExpr<detail::Lookup<T>, decltype(inner)>(detail::Lookup<T>{ table, size - 1 }, inner);
+}
+
+template <typename E, typename T, typename = std::enable_if_t<detail::is_expr_v<E>>>
+auto lut(Span<const T> table, const E& e) noexcept
+{
+    return lut(table.data(), table.size(), e);
+}
+
+/** Convert every sample to T */
+template <typename T, typename E, typename = std::enable_if_t<detail::is_expr_v<E>>>
+auto cast(const E& e) noexcept
+{
+    auto inner = detail::operand(e);
+    return UnaryExpr<detail::Cast<T>, decltype(inner)>(detail::Cast<T>{}, inner);
+}
+
+// ============================================================================
+// Evaluation
+// ============================================================================
+
+/**
+ * @brief Evaluate an expression into a view in one pass
+ * @return MEDIA_ERROR_INVALID_PARAM if an operand view differs in size from dst
+ */
+template <typename T, typename E>
+Result<void> evaluate(const ImageView<T>& dst, const Expr<E>& expr) noexcept
+{
+    static_assert(!std::is_const_v<T>, "cannot assign to a view of const pixels");
+    const E& e = expr.self();
+    if (!dst.data() || !e.fits(dst.width(), dst.height())) {
+        return Error{ MEDIA_ERROR_INVALID_PARAM };
+    }
+
+    const uint32_t width = dst.width();
+    for (uint32_t y = 0; y < dst.height(); y++) {
+        T* out = dst.row(y);
+        const auto in = e.row(y);
+        for (uint32_t x = 0; x < width; x++) {
+            out[x] = static_cast<T>(in[x]);
+        }
+    }
+    return Result<void>();
+}
+
+/** Evaluate a plain copy of a view */
+template <typename T, typename U>
+Result<void> evaluate(const ImageView<T>& dst, const ImageView<U>& src) noexcept
+{
+    return evaluate(dst, detail::operand(src));
+}
+
+template <typename T>
+template <typename E>
+Result<void> ImageView<T>::operator=(const Expr<E>& expr) noexcept
+{
+    return evaluate(*this, expr);
+}
+
+} // namespace media
+
+#endif // LIBMEDIA_EXPR_HPP
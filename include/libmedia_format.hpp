@@ -0,0 +1,173 @@
+/**
+ * @file libmedia_format.hpp
+ * @brief libMedia compile-time pixel format traits
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * media::FormatTraits<V4L2_PIX_FMT_...> exposes the same facts as
+ * libmedia_get_format_desc() as constants, generated from the same
+ * MEDIA_FORMAT_LIST, so a kernel templated on the format has its sample
+ * size, plane layout and Bayer phase folded at compile time. Kernels are
+ * then instantiated once per format and selected at run time through a
+ * media::FormatDispatch table.
+ *
+ * Typical use:
+ * @code
+ * template <uint32_t F>
+ * struct Mean {
+ *     using T = media::FormatTraits<F>;
+ *     static double run(const uint8_t* data, uint32_t w, uint32_t h) {
+ *         // T::bits_per_sample, T::bayer_channel(x, y), ... are constants
+ *     }
+ * };
+ *
+ * using MeanTable = media::FormatDispatch<Mean, V4L2_PIX_FMT_SRGGB8, V4L2_PIX_FMT_SRGGB16>;
+ * if (auto run = MeanTable::find(frame.pixelformat())) {
+ *     run(data, width, height);
+ * }
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_FORMAT_HPP
+#define LIBMEDIA_FORMAT_HPP
+
+#include "media.h"
+#include "media_raw.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace media {
+
+// ============================================================================
+// Format Traits
+// ============================================================================
+
+/**
+ * @brief Layout constants and sizes shared by every format with one shape
+ */
+template <unsigned Bits, unsigned Bpp, unsigned Planes, unsigned Hs, unsigned Vs, bool Packed,
+          media_bayer_order_t Bayer>
+struct FormatShape {
+    static constexpr bool known = true;
+    static constexpr unsigned bits_per_sample = Bits;   /**< Significant bits per sample */
+    static constexpr unsigned bits_per_pixel = Bpp;     /**< Average storage bits per pixel, 0 if compressed */
+    static constexpr unsigned planes = Planes;          /**< 1 interleaved/raw, 2 semi-planar, 3 planar */
+    static constexpr unsigned h_subsample = Hs;
+    static constexpr unsigned v_subsample = Vs;
+    static constexpr bool packed = Packed;              /**< MIPI bit-packed samples */
+    static constexpr bool compressed = Bpp == 0;
+    static constexpr media_bayer_order_t bayer = Bayer;
+
+    /** Bytes per sample of the main plane, 0 if samples are bit-packed or compressed */
+    static constexpr unsigned sample_bytes = Packed || Bpp == 0 ? 0 : Planes > 1 ? (Bits + 7) / 8 : Bpp / 8;
+
+    /** Pixels per MIPI group: RAW10 packs 4 px into 5 bytes, RAW12 2 px into 3 bytes */
+    static constexpr unsigned group_pixels = Bpp % 8 == 0 ? 1 : Bpp % 4 == 0 ? 2 : Bpp % 2 == 0 ? 4 : 8;
+
+    /** Bytes of one line of the main plane, as libmedia_get_line_bytes() */
+    static constexpr std::size_t line_bytes(uint32_t width) noexcept
+    {
+        if constexpr (Packed) {
+            return (std::size_t(width) + group_pixels - 1) / group_pixels * group_pixels * Bpp / 8;
+        } else {
+            return std::size_t(width) * sample_bytes;
+        }
+    }
+
+    /** Bytes of one plane with packed rows, as libmedia_get_plane_bytes() */
+    static constexpr std::size_t plane_bytes(unsigned plane, uint32_t width, uint32_t height) noexcept
+    {
+        if (Bpp == 0 || plane >= Planes) {
+            return 0;
+        }
+        if (plane == 0) {
+            return line_bytes(width) * height;
+        }
+        std::size_t chroma = std::size_t(width / Hs) * (height / Vs);
+        return Planes == 2 ? chroma * 2 : chroma;
+    }
+
+    /** Bytes of a whole frame with packed rows */
+    static constexpr std::size_t frame_bytes(uint32_t width, uint32_t height) noexcept
+    {
+        std::size_t total = 0;
+        for (unsigned plane = 0; plane < Planes; plane++) {
+            total += plane_bytes(plane, width, height);
+        }
+        return total;
+    }
+
+    /** Colour channel (media_raw_channel_t) of a raw sample, -1 if not Bayer */
+    static constexpr int bayer_channel(uint32_t x, uint32_t y) noexcept
+    {
+        constexpr int channels[5][4] = {
+            { -1, -1, -1, -1 },
+            { MEDIA_RAW_CH_B, MEDIA_RAW_CH_GB, MEDIA_RAW_CH_GR, MEDIA_RAW_CH_R },
+            { MEDIA_RAW_CH_GB, MEDIA_RAW_CH_B, MEDIA_RAW_CH_R, MEDIA_RAW_CH_GR },
+            { MEDIA_RAW_CH_GR, MEDIA_RAW_CH_R, MEDIA_RAW_CH_B, MEDIA_RAW_CH_GB },
+            { MEDIA_RAW_CH_R, MEDIA_RAW_CH_GR, MEDIA_RAW_CH_GB, MEDIA_RAW_CH_B },
+        };
+        return channels[Bayer][(y & 1) * 2 + (x & 1)];
+    }
+};
+
+/**
+ * @brief Traits of a V4L2 pixel format; `known` is false for formats the library does not describe
+ */
+template <uint32_t Fourcc>
+struct FormatTraits {
+    static constexpr bool known = false;
+};
+
+#define LIBMEDIA_FORMAT_TRAITS(fmt, fmt_name, bits, bpp, nplanes, hs, vs, is_packed, order) \
+    template <> \
+    struct FormatTraits<V4L2_PIX_FMT_##fmt> \
+        : FormatShape<bits, bpp, nplanes, hs, vs, is_packed != 0, MEDIA_BAYER_##order> { \
+        static constexpr uint32_t fourcc = V4L2_PIX_FMT_##fmt; \
+        static constexpr const char* name = fmt_name; \
+    };
+
+MEDIA_FORMAT_LIST(LIBMEDIA_FORMAT_TRAITS)
+
+#undef LIBMEDIA_FORMAT_TRAITS
+
+// ============================================================================
+// Dispatch
+// ============================================================================
+
+/**
+ * @brief Table of one kernel instantiated for several formats
+ *
+ * Kernel<F>::run must have the same signature for every listed format.
+ * find() is a linear scan over a constant table, so the format is
+ * resolved once per frame rather than per pixel.
+ */
+template <template <uint32_t> class Kernel, uint32_t First, uint32_t... Rest>
+struct FormatDispatch {
+    using Function = decltype(&Kernel<First>::run);
+
+    struct Entry {
+        uint32_t fourcc;
+        Function run;
+    };
+
+    static constexpr Entry entries[] = {
+        { First, &Kernel<First>::run },
+        { Rest, &Kernel<Rest>::run }...,
+    };
+
+    /** Instantiation for a format, nullptr if the table has none */
+    static constexpr Function find(uint32_t fourcc) noexcept
+    {
+        for (const Entry& entry : entries) {
+            if (entry.fourcc == fourcc) {
+                return entry.run;
+            }
+        }
+        return nullptr;
+    }
+};
+
+} // namespace media
+
+#endif // LIBMEDIA_FORMAT_HPP
@@ -0,0 +1,241 @@
+/**
+ * @file libmedia_pmr.hpp
+ * @brief libMedia polymorphic memory resources
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * std::pmr::memory_resource adapters over libMedia frame pools, so standard
+ * containers used while processing a frame stop allocating from the global
+ * heap:
+ *
+ * - media::FrameArena is a monotonic arena for per-frame kernel scratch.
+ *   Allocation is a pointer bump inside one pre-faulted pool buffer and
+ *   deallocation is free; everything is reclaimed at once when the frame is
+ *   released. Requests that do not fit spill to an upstream resource and
+ *   are counted, so an undersized arena shows up in overflow_bytes().
+ * - media::PoolResource serves outputs from the classes of an existing
+ *   pool, smallest fitting class first, and returns each block to its
+ *   buffer when deallocated.
+ *
+ * Memory comes from libmedia pools, so it is charged to the library memory
+ * budget and can use huge pages or be locked like any other pool.
+ *
+ * Typical use:
+ * @code
+ * media::FrameArena arena(1 << 20);
+ * for (;;) {
+ *     auto frame = session->capture(1000);
+ *     if (!frame) continue;
+ *     auto scope = arena.lease(std::move(*frame));    // Frame and scratch live together
+ *     std::pmr::vector<uint16_t> histogram(4096, &arena);
+ *     process(scope.frame(), histogram);
+ * }   // frame requeued, arena rewound
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_PMR_HPP
+#define LIBMEDIA_PMR_HPP
+
+#include "libmedia.hpp"
+#include "media_pool.h"
+#include <memory_resource>
+
+namespace media {
+
+// ============================================================================
+// Frame Arena
+// ============================================================================
+
+/**
+ * @brief Monotonic per-frame scratch arena backed by one pool buffer
+ *
+ * Not thread-safe: one arena per processing thread.
+ */
+class FrameArena : public std::pmr::memory_resource {
+public:
+    /**
+     * @brief Reserve the arena memory
+     * @param bytes Arena capacity
+     * @param pool_flags MEDIA_POOL_* flags for the backing memory
+     * @param upstream Resource for requests that do not fit
+     */
+    explicit FrameArena(std::size_t bytes, uint32_t pool_flags = 0,
+                        std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+        : upstream_(upstream)
+    {
+        pool_ = libmedia_pool_create(pool_flags);
+        media_pool_key_t key{};
+        key.size = bytes;
+        if (pool_ && libmedia_pool_reserve(pool_, &key, 1) == 0) {
+            buffer_ = libmedia_pool_acquire(pool_, &key);
+        }
+        if (buffer_) {
+            begin_ = static_cast<uint8_t*>(buffer_->frame.data);
+            end_ = begin_ + buffer_->frame.size;
+        }
+        cursor_ = begin_;
+    }
+
+    ~FrameArena() override
+    {
+        reset();
+        libmedia_pool_buffer_unref(buffer_);
+        libmedia_pool_destroy(pool_);
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /** False if the backing memory could not be reserved; allocations then all spill */
+    explicit operator bool() const noexcept { return buffer_ != nullptr; }
+
+    std::size_t capacity() const noexcept { return std::size_t(end_ - begin_); }
+    std::size_t used() const noexcept { return std::size_t(cursor_ - begin_); }
+    std::size_t peak() const noexcept { return peak_; }
+
+    /** Bytes that did not fit since construction */
+    std::size_t overflow_bytes() const noexcept { return overflow_bytes_; }
+
+    /** Release every allocation; memory handed out before must no longer be used */
+    void reset() noexcept
+    {
+        while (Spill* spill = spills_) {
+            spills_ = spill->next;
+            upstream_->deallocate(spill, spill->bytes, spill->align);
+        }
+        cursor_ = begin_;
+    }
+
+    /**
+     * @brief Frame whose release also rewinds the arena
+     */
+    class Lease {
+    public:
+        Lease(FrameArena& arena, Frame&& frame) noexcept : arena_(&arena), frame_(std::move(frame)) {}
+        ~Lease()
+        {
+            frame_.reset();
+            if (arena_) {
+                arena_->reset();
+            }
+        }
+
+        Lease(Lease&& other) noexcept
+            : arena_(std::exchange(other.arena_, nullptr)), frame_(std::move(other.frame_)) {}
+        Lease& operator=(Lease&&) = delete;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        Frame& frame() noexcept { return frame_; }
+        FrameArena& arena() noexcept { return *arena_; }
+
+    private:
+        FrameArena* arena_;
+        Frame frame_;
+    };
+
+    /** Tie the arena's contents to a frame: both are released together */
+    Lease lease(Frame&& frame) noexcept { return Lease(*this, std::move(frame)); }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        uintptr_t start = (reinterpret_cast<uintptr_t>(cursor_) + align - 1) & ~uintptr_t(align - 1);
+        if (cursor_ && start + bytes <= reinterpret_cast<uintptr_t>(end_)) {
+            cursor_ = reinterpret_cast<uint8_t*>(start + bytes);
+            if (used() > peak_) {
+                peak_ = used();
+            }
+            return reinterpret_cast<void*>(start);
+        }
+
+        // Spill: the block carries its own list link so reset() can free it
+        std::size_t header = (sizeof(Spill) + align - 1) & ~(align - 1);
+        std::size_t spill_align = align > alignof(Spill) ? align : alignof(Spill);
+        void* block = upstream_->allocate(header + bytes, spill_align);
+        Spill* spill = static_cast<Spill*>(block);
+        spill->next = spills_;
+        spill->bytes = header + bytes;
+        spill->align = spill_align;
+        spills_ = spill;
+        overflow_bytes_ += bytes;
+        return static_cast<uint8_t*>(block) + header;
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}    // Reclaimed by reset()
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    struct Spill {
+        Spill* next;
+        std::size_t bytes;
+        std::size_t align;
+    };
+
+    std::pmr::memory_resource* upstream_;
+    media_pool_t* pool_ = nullptr;
+    media_pool_buffer_t* buffer_ = nullptr;
+    uint8_t* begin_ = nullptr;
+    uint8_t* end_ = nullptr;
+    uint8_t* cursor_ = nullptr;
+    Spill* spills_ = nullptr;
+    std::size_t peak_ = 0;
+    std::size_t overflow_bytes_ = 0;
+};
+
+// ============================================================================
+// Pool Resource
+// ============================================================================
+
+/**
+ * @brief Memory resource handing out whole buffers of a frame pool
+ *
+ * Each allocation takes one buffer of the smallest class that fits and is
+ * suitably aligned; when none is free the request goes upstream. Buffers
+ * are cache-line aligned, page aligned from one page up. The pool must
+ * outlive the resource and every allocation made from it. Thread-safe
+ * when the upstream resource is.
+ */
+class PoolResource : public std::pmr::memory_resource {
+public:
+    explicit PoolResource(media_pool_t* pool,
+                          std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+        : pool_(pool), upstream_(upstream) {}
+
+    media_pool_t* pool() const noexcept { return pool_; }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        media_pool_buffer_t* buffer = libmedia_pool_acquire_size(pool_, bytes ? bytes : 1);
+        if (buffer && reinterpret_cast<uintptr_t>(buffer->frame.data) % align == 0) {
+            return buffer->frame.data;
+        }
+        libmedia_pool_buffer_unref(buffer);
+        return upstream_->allocate(bytes, align);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override
+    {
+        if (media_pool_buffer_t* buffer = libmedia_pool_find_buffer(pool_, p)) {
+            libmedia_pool_buffer_unref(buffer);
+        } else {
+            upstream_->deallocate(p, bytes, align);
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        const PoolResource* resource = dynamic_cast<const PoolResource*>(&other);
+        return resource && resource->pool_ == pool_ && resource->upstream_->is_equal(*upstream_);
+    }
+
+private:
+    media_pool_t* pool_;
+    std::pmr::memory_resource* upstream_;
+};
+
+} // namespace media
+
+#endif // LIBMEDIA_PMR_HPP
@@ -155,6 +155,7 @@ typedef struct {
     int index;                          /**< Buffer index */
     size_t bytes_used;                  /**< Actual bytes used in the buffer */
     uint64_t timestamp;                 /**< Frame timestamp */
+    uint32_t sequence;                  /**< Driver frame sequence number */
 } media_buffer_t;
 
 /**
@@ -184,6 +185,18 @@ int libmedia_request_buffers_mp(int handle, int count, media_buffer_t* buffers);
  */
 int libmedia_free_buffers(int handle, media_buffer_t* buffers, int count);
 
+/**
+ * @brief Export a capture buffer as a DMABUF descriptor
+ *
+ * The descriptor refers to the buffer memory itself, so other devices
+ * (e.g. an M2M scaler, see media_m2m.h) can read frames without a copy.
+ * It stays valid after the buffers are freed; the caller closes it.
+ * @param handle Device handle
+ * @param index Buffer index (media_frame_t.frame_id)
+ * @return DMABUF file descriptor on success, negative on error
+ */
+int libmedia_export_buffer(int handle, int index);
+
 /**
  * @brief Queue a buffer for capture
  * @param handle Device handle
@@ -216,6 +229,128 @@ int libmedia_dequeue_buffer(int handle, media_buffer_t* buffer);
  */
 int libmedia_dequeue_buffer_mp(int handle, media_buffer_t* buffer);
 
+// ============================================================================
+// Memory Budget
+// ============================================================================
+
+/**
+ * @struct media_memory_stats
+ * @brief Memory charged against the library-wide budget
+ */
+typedef struct {
+    size_t budget;              /**< Budget in bytes (0 = unlimited) */
+    size_t used;                /**< Bytes held by capture buffers, frame pools and queues */
+    size_t peak;                /**< Highest usage since start or the last peak reset */
+    uint64_t refused;           /**< Allocations refused for exceeding the budget */
+    uint64_t downsized;         /**< Buffer requests granted with fewer buffers than asked */
+} media_memory_stats_t;
+
+/**
+ * @brief Limit the memory the library may hold
+ *
+ * V4L2 mmap buffers, frame pools and queue storage are charged against
+ * the budget. A buffer request that does not fit is granted with fewer
+ * buffers (at least two); pools and queues that do not fit fail with
+ * MEDIA_ERROR_OUT_OF_MEMORY.
+ * @param bytes Budget in bytes (0 = unlimited)
+ * @return 0 on success, negative if current usage already exceeds bytes
+ */
+int libmedia_set_memory_budget(size_t bytes);
+
+/**
+ * @brief Get current and peak memory usage
+ * @param stats Output statistics
+ * @return 0 on success, negative on error
+ */
+int libmedia_get_memory_stats(media_memory_stats_t* stats);
+
+/**
+ * @brief Restart peak tracking from the current usage
+ */
+void libmedia_reset_memory_peak(void);
+
+// ============================================================================
+// Thread Policy
+// ============================================================================
+
+/**
+ * @enum media_thread_role
+ * @brief Kinds of threads created by the library
+ */
+typedef enum {
+    MEDIA_THREAD_CAPTURE = 0,   /**< Pipeline sources (frame capture) */
+    MEDIA_THREAD_STAGE = 1,     /**< Pipeline stage workers (processing, sending) */
+    MEDIA_THREAD_HELPER = 2,    /**< Helpers of parallel image processing */
+    MEDIA_THREAD_ROLE_COUNT = 3
+} media_thread_role_t;
+
+/**
+ * @struct media_thread_policy
+ * @brief Scheduling applied to a thread when it starts
+ */
+typedef struct {
+    int policy;                 /**< SCHED_OTHER, SCHED_FIFO or SCHED_RR */
+    int priority;               /**< Real-time priority 1-99 (SCHED_FIFO/SCHED_RR) */
+    int nice;                   /**< Nice value -20..19 (SCHED_OTHER) */
+    uint64_t cpu_mask;          /**< Allowed CPUs, bit N = CPU N (0 = any) */
+} media_thread_policy_t;
+
+/**
+ * @enum media_thread_preset
+ * @brief Ready-made policies for all roles
+ */
+typedef enum {
+    MEDIA_THREAD_PRESET_DEFAULT = 0,    /**< Inherit the creator's scheduling */
+    MEDIA_THREAD_PRESET_LATENCY = 1,    /**< SCHED_FIFO capture on its own core, real-time stages on the others (normal stages on one CPU) */
+    MEDIA_THREAD_PRESET_THROUGHPUT = 2, /**< Normal scheduling on all cores, capture slightly favoured */
+    MEDIA_THREAD_PRESET_BACKGROUND = 3  /**< Low priority, yield to the rest of the system */
+} media_thread_preset_t;
+
+/**
+ * @brief Set the policy of threads of one role started from now on
+ *
+ * Policies the process is not allowed to use (real-time scheduling
+ * without CAP_SYS_NICE) are logged and skipped; the thread still starts.
+ * @param role Thread role
+ * @param policy Policy, NULL to inherit the creator's scheduling
+ * @return 0 on success, negative on error
+ */
+int libmedia_set_thread_policy(media_thread_role_t role, const media_thread_policy_t* policy);
+
+/**
+ * @brief Get the policy of a role
+ * @param role Thread role
+ * @param policy Output policy
+ * @return 0 on success, negative on error
+ */
+int libmedia_get_thread_policy(media_thread_role_t role, media_thread_policy_t* policy);
+
+/**
+ * @brief Set the policies of all roles from a preset
+ *
+ * Presets are computed for the CPUs online at the time of the call.
+ * @param preset Preset
+ * @return 0 on success, negative on error
+ */
+int libmedia_set_thread_preset(media_thread_preset_t preset);
+
+/**
+ * @brief Apply a role's policy to the calling thread
+ *
+ * For application threads doing library work, such as a capture loop
+ * that does not use a pipeline.
+ * @param role Thread role
+ * @return 0 if fully applied, negative if any part was refused
+ */
+int libmedia_apply_thread_policy(media_thread_role_t role);
+
+/**
+ * @brief Lock all current and future process memory in RAM (mlockall)
+ * @param lock 1 to lock, 0 to unlock
+ * @return 0 on success, negative on error
+ */
+int libmedia_lock_memory(int lock);
+
 // ============================================================================
 // Streaming Control
 // ============================================================================
@@ -252,6 +387,12 @@ int libmedia_stop_streaming_mp(int handle);
 // Frame Capture Interface
 // ============================================================================
 
+/**
+ * @struct media_meta
+ * @brief Per-frame metadata block, see media_meta.h
+ */
+typedef struct media_meta media_meta_t;
+
 /**
  * @struct media_frame
  * @brief Frame data structure
@@ -264,6 +405,8 @@ typedef struct {
     uint32_t pixelformat;   /**< Pixel format */
     uint64_t timestamp;     /**< Frame timestamp */
     uint32_t frame_id;      /**< Frame sequence number */
+    uint32_t sequence;      /**< Driver sequence, counts frames the driver dropped */
+    media_meta_t* meta;     /**< Metadata owned by the buffer, NULL if none (media_meta.h) */
 } media_frame_t;
 
 /**
@@ -373,10 +516,122 @@ void libmedia_destroy_session(media_session_t* session);
  */
 int libmedia_session_get_device_handle(media_session_t* session);
 
+/**
+ * @brief Get a descriptor to poll for session frames
+ *
+ * The session's device fd: it polls readable (EPOLLIN) when a captured
+ * buffer can be dequeued and reports EPOLLERR when streaming stops. Add it
+ * to an existing poll/epoll/libuv loop and call
+ * libmedia_session_try_capture() when it fires. Owned by the session; do
+ * not read from or close it.
+ * @param session Session handle
+ * @return File descriptor on success, negative on error
+ */
+int libmedia_session_get_fd(media_session_t* session);
+
+/**
+ * @brief Dequeue a frame if one is ready, without waiting
+ *
+ * Drain until it returns 0 each time the session fd fires.
+ * @param session Session handle
+ * @param frame Output frame, release with libmedia_session_release_frame()
+ * @return 1 if a frame was captured, 0 if none is ready, negative on error
+ */
+int libmedia_session_try_capture(media_session_t* session, media_frame_t* frame);
+
 // ============================================================================
 // Utility Functions
 // ============================================================================
 
+/**
+ * @enum media_bayer_order
+ * @brief Colour filter order of the top-left 2x2 block of a raw frame
+ */
+typedef enum {
+    MEDIA_BAYER_NONE = 0,       /**< Not a Bayer format */
+    MEDIA_BAYER_BGGR = 1,       /**< B G / G R */
+    MEDIA_BAYER_GBRG = 2,       /**< G B / R G */
+    MEDIA_BAYER_GRBG = 3,       /**< G R / B G */
+    MEDIA_BAYER_RGGB = 4        /**< R G / G B */
+} media_bayer_order_t;
+
+/**
+ * @struct media_format_desc
+ * @brief Static description of a pixel format
+ */
+typedef struct {
+    uint32_t pixelformat;       /**< V4L2 pixel format code */
+    const char* name;           /**< Format name */
+    uint8_t bits_per_sample;    /**< Significant bits per sample */
+    uint8_t bits_per_pixel;     /**< Average storage bits per pixel over all planes (0 = compressed) */
+    uint8_t planes;             /**< Colour planes: 1 interleaved/raw, 2 semi-planar, 3 planar */
+    uint8_t h_subsample;        /**< Horizontal chroma subsampling factor */
+    uint8_t v_subsample;        /**< Vertical chroma subsampling factor */
+    uint8_t packed;             /**< Samples are bit-packed (MIPI RAW10: 4 px / 5 bytes, RAW12: 2 px / 3 bytes) */
+    uint8_t bayer;              /**< Bayer order (media_bayer_order_t) */
+} media_format_desc_t;
+
+/**
+ * @brief Every pixel format known to the library, as an X-macro
+ *
+ * X(fmt, name, bits/sample, bits/pixel, planes, h/v subsampling, packed,
+ * Bayer order) is expanded once per format, with fmt the V4L2_PIX_FMT_
+ * suffix and the Bayer order a MEDIA_BAYER_ suffix. The runtime table
+ * behind libmedia_get_format_desc() and the compile-time traits of
+ * libmedia_format.hpp are both generated from it.
+ */
+#define MEDIA_FORMAT_LIST(X) \
+    X(YUYV,     "YUYV",     8, 16, 1, 2, 1, 0, NONE) \
+    X(UYVY,     "UYVY",     8, 16, 1, 2, 1, 0, NONE) \
+    X(YUV420,   "YUV420",   8, 12, 3, 2, 2, 0, NONE) \
+    X(YVU420,   "YVU420",   8, 12, 3, 2, 2, 0, NONE) \
+    X(NV12,     "NV12",     8, 12, 2, 2, 2, 0, NONE) \
+    X(NV21,     "NV21",     8, 12, 2, 2, 2, 0, NONE) \
+    X(NV16,     "NV16",     8, 16, 2, 2, 1, 0, NONE) \
+    X(GREY,     "GREY",     8,  8, 1, 1, 1, 0, NONE) \
+    X(Y10,      "Y10",     10, 16, 1, 1, 1, 0, NONE) \
+    X(Y12,      "Y12",     12, 16, 1, 1, 1, 0, NONE) \
+    X(Y16,      "Y16",     16, 16, 1, 1, 1, 0, NONE) \
+    X(RGB565,   "RGB565",   5, 16, 1, 1, 1, 0, NONE) \
+    X(RGB24,    "RGB24",    8, 24, 1, 1, 1, 0, NONE) \
+    X(BGR24,    "BGR24",    8, 24, 1, 1, 1, 0, NONE) \
+    X(RGB32,    "RGB32",    8, 32, 1, 1, 1, 0, NONE) \
+    X(BGR32,    "BGR32",    8, 32, 1, 1, 1, 0, NONE) \
+    X(MJPEG,    "MJPEG",    8,  0, 1, 1, 1, 0, NONE) \
+    X(JPEG,     "JPEG",     8,  0, 1, 1, 1, 0, NONE) \
+    X(H264,     "H264",     8,  0, 1, 1, 1, 0, NONE) \
+    X(SBGGR8,   "BGGR8",    8,  8, 1, 1, 1, 0, BGGR) \
+    X(SGBRG8,   "GBRG8",    8,  8, 1, 1, 1, 0, GBRG) \
+    X(SGRBG8,   "GRBG8",    8,  8, 1, 1, 1, 0, GRBG) \
+    X(SRGGB8,   "RGGB8",    8,  8, 1, 1, 1, 0, RGGB) \
+    X(SBGGR10,  "BGGR10",  10, 16, 1, 1, 1, 0, BGGR) \
+    X(SGBRG10,  "GBRG10",  10, 16, 1, 1, 1, 0, GBRG) \
+    X(SGRBG10,  "GRBG10",  10, 16, 1, 1, 1, 0, GRBG) \
+    X(SRGGB10,  "RGGB10",  10, 16, 1, 1, 1, 0, RGGB) \
+    X(SBGGR10P, "BGGR10P", 10, 10, 1, 1, 1, 1, BGGR) \
+    X(SGBRG10P, "GBRG10P", 10, 10, 1, 1, 1, 1, GBRG) \
+    X(SGRBG10P, "GRBG10P", 10, 10, 1, 1, 1, 1, GRBG) \
+    X(SRGGB10P, "RGGB10P", 10, 10, 1, 1, 1, 1, RGGB) \
+    X(SBGGR12,  "BGGR12",  12, 16, 1, 1, 1, 0, BGGR) \
+    X(SGBRG12,  "GBRG12",  12, 16, 1, 1, 1, 0, GBRG) \
+    X(SGRBG12,  "GRBG12",  12, 16, 1, 1, 1, 0, GRBG) \
+    X(SRGGB12,  "RGGB12",  12, 16, 1, 1, 1, 0, RGGB) \
+    X(SBGGR12P, "BGGR12P", 12, 12, 1, 1, 1, 1, BGGR) \
+    X(SGBRG12P, "GBRG12P", 12, 12, 1, 1, 1, 1, GBRG) \
+    X(SGRBG12P, "GRBG12P", 12, 12, 1, 1, 1, 1, GRBG) \
+    X(SRGGB12P, "RGGB12P", 12, 12, 1, 1, 1, 1, RGGB) \
+    X(SBGGR16,  "BGGR16",  16, 16, 1, 1, 1, 0, BGGR) \
+    X(SGBRG16,  "GBRG16",  16, 16, 1, 1, 1, 0, GBRG) \
+    X(SGRBG16,  "GRBG16",  16, 16, 1, 1, 1, 0, GRBG) \
+    X(SRGGB16,  "RGGB16",  16, 16, 1, 1, 1, 0, RGGB)
+
+/**
+ * @brief Look up the description of a pixel format
+ * @param pixelformat V4L2 pixel format code
+ * @return Format description, NULL if unknown
+ */
+const media_format_desc_t* libmedia_get_format_desc(uint32_t pixelformat);
+
 /**
  * @brief Get pixel format name
  * @param pixelformat V4L2 pixel format code
@@ -386,11 +641,35 @@ const char* libmedia_get_format_name(uint32_t pixelformat);
 
 /**
  * @brief Get bytes per pixel for a format
+ *
+ * For planar formats this is the main plane; bit-packed raw formats return
+ * 0, use libmedia_get_line_bytes() for them.
  * @param pixelformat V4L2 pixel format code
  * @return Bytes per pixel, 0 if unknown
  */
 int libmedia_get_bytes_per_pixel(uint32_t pixelformat);
 
+/**
+ * @brief Get the minimum number of bytes of one line of the main plane
+ * @param pixelformat V4L2 pixel format code
+ * @param width Line width in pixels
+ * @return Line size in bytes, 0 if unknown or compressed
+ */
+size_t libmedia_get_line_bytes(uint32_t pixelformat, uint32_t width);
+
+/**
+ * @brief Get the size of one plane of a frame with packed rows
+ *
+ * Plane 0 is the main plane; semi-planar formats have the interleaved
+ * chroma in plane 1, planar formats U and V in planes 1 and 2.
+ * @param pixelformat V4L2 pixel format code
+ * @param plane Plane index
+ * @param width Frame width in pixels
+ * @param height Frame height in pixels
+ * @return Plane size in bytes, 0 if the format is unknown, compressed or has no such plane
+ */
+size_t libmedia_get_plane_bytes(uint32_t pixelformat, int plane, uint32_t width, uint32_t height);
+
 /**
  * @brief Calculate frame size for given format
  * @param format Format structure
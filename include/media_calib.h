@@ -0,0 +1,204 @@
+/**
+ * @file media_calib.h
+ * @brief libMedia sensor calibration (dark frame, flat field, defect map)
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Captures dark and flat frames through a capture session, stacks them into
+ * a master dark, a per-pixel flat-field gain and a defect map, and stores the
+ * result in a compact binary file that is memory mapped when loaded. The
+ * correction kernel applies the calibration to raw frames in place.
+ */
+
+#ifndef LIBMEDIA_CALIB_H
+#define LIBMEDIA_CALIB_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Frame Stacking
+// ============================================================================
+
+/**
+ * @struct media_stack
+ * @brief Frame stacking accumulator (opaque structure)
+ */
+typedef struct media_stack media_stack_t;
+
+/**
+ * @brief Create a stacking accumulator
+ * @param width Frame width in pixels
+ * @param height Frame height in pixels
+ * @return Accumulator on success, NULL on error
+ */
+media_stack_t* libmedia_stack_create(uint32_t width, uint32_t height);
+
+/**
+ * @brief Add one frame to the stack
+ *
+ * Supports 8-bit and 16-bit sample containers (raw Bayer, GREY, Y10/Y12/Y16).
+ * @param stack Accumulator
+ * @param frame Frame with the accumulator's dimensions
+ * @return 0 on success, negative on error
+ */
+int libmedia_stack_add_frame(media_stack_t* stack, const media_frame_t* frame);
+
+/**
+ * @brief Get the number of frames accumulated since the last reset
+ * @param stack Accumulator
+ * @return Frame count, negative on error
+ */
+int libmedia_stack_get_count(const media_stack_t* stack);
+
+/**
+ * @brief Compute the rounded per-pixel mean of all stacked frames
+ * @param stack Accumulator
+ * @param mean Output array of width * height samples
+ * @return 0 on success, negative on error
+ */
+int libmedia_stack_mean(const media_stack_t* stack, uint16_t* mean);
+
+/**
+ * @brief Clear the accumulator for a new stack
+ * @param stack Accumulator
+ */
+void libmedia_stack_reset(media_stack_t* stack);
+
+/**
+ * @brief Destroy a stacking accumulator
+ * @param stack Accumulator
+ */
+void libmedia_stack_destroy(media_stack_t* stack);
+
+// ============================================================================
+// Calibration
+// ============================================================================
+
+/**
+ * @struct media_calib
+ * @brief Sensor calibration data (opaque structure)
+ */
+typedef struct media_calib media_calib_t;
+
+/**
+ * @enum media_calib_frame_type
+ * @brief Kind of calibration frame
+ */
+typedef enum {
+    MEDIA_CALIB_DARK = 0,           /**< Lens covered, same exposure and gain as in use */
+    MEDIA_CALIB_FLAT = 1            /**< Uniform illumination, well below saturation */
+} media_calib_frame_type_t;
+
+/**
+ * @struct media_calib_params
+ * @brief Thresholds used to derive the defect map
+ */
+typedef struct {
+    uint32_t hot_threshold;         /**< Dark level above the mean dark that marks a hot pixel (0 = 1/16 of full scale) */
+    uint32_t dead_ratio;            /**< Flat response below this Q8 fraction of the channel mean marks a dead pixel (0 = 128) */
+    uint32_t bright_ratio;          /**< Flat response above this Q8 fraction of the channel mean marks a stuck pixel (0 = 384) */
+} media_calib_params_t;
+
+/**
+ * @struct media_calib_info
+ * @brief Summary of a calibration
+ */
+typedef struct {
+    uint32_t width;                 /**< Frame width */
+    uint32_t height;                /**< Frame height */
+    uint32_t pixelformat;           /**< Raw pixel format the calibration applies to */
+    uint32_t pedestal;              /**< Mean master dark level, restored after correction */
+    uint32_t dark_frames;           /**< Frames stacked into the master dark */
+    uint32_t flat_frames;           /**< Frames stacked into the master flat */
+    uint32_t defect_count;          /**< Pixels in the defect map */
+    int mapped;                     /**< 1 if the data is memory mapped from a file */
+} media_calib_info_t;
+
+/**
+ * @brief Create an empty calibration for a raw format
+ * @param width Frame width in pixels
+ * @param height Frame height in pixels
+ * @param pixelformat Raw pixel format (8-bit or 16-bit container)
+ * @return Calibration on success, NULL on error
+ */
+media_calib_t* libmedia_calib_create(uint32_t width, uint32_t height, uint32_t pixelformat);
+
+/**
+ * @brief Stack one calibration frame
+ *
+ * Dark frames must be added before flat frames, since flats are
+ * dark-subtracted when the master flat is built.
+ * @param calib Calibration under construction
+ * @param type Frame type
+ * @param frame Captured frame
+ * @return 0 on success, negative on error
+ */
+int libmedia_calib_add_frame(media_calib_t* calib, media_calib_frame_type_t type, const media_frame_t* frame);
+
+/**
+ * @brief Capture and stack calibration frames from a running session
+ * @param calib Calibration under construction
+ * @param session Started capture session delivering the calibration format
+ * @param type Frame type
+ * @param count Number of frames to stack
+ * @param timeout_ms Per-frame capture timeout in milliseconds; three
+ *                   consecutive timeouts fail with MEDIA_ERROR_TIMEOUT
+ * @return Number of frames stacked on success, negative on error
+ */
+int libmedia_calib_capture(media_calib_t* calib, media_session_t* session,
+                           media_calib_frame_type_t type, int count, int timeout_ms);
+
+/**
+ * @brief Build the master dark, master flat and defect map
+ * @param calib Calibration under construction
+ * @param params Defect thresholds, NULL for defaults
+ * @return 0 on success, negative on error
+ */
+int libmedia_calib_finalize(media_calib_t* calib, const media_calib_params_t* params);
+
+/**
+ * @brief Save a finalized calibration
+ * @param calib Calibration
+ * @param path Output file path
+ * @return 0 on success, negative on error
+ */
+int libmedia_calib_save(const media_calib_t* calib, const char* path);
+
+/**
+ * @brief Load a calibration file by memory mapping it
+ * @param path Calibration file path
+ * @return Calibration on success, NULL on error
+ */
+media_calib_t* libmedia_calib_load(const char* path);
+
+/**
+ * @brief Get a summary of a calibration
+ * @param calib Calibration
+ * @param info Output summary
+ * @return 0 on success, negative on error
+ */
+int libmedia_calib_get_info(const media_calib_t* calib, media_calib_info_t* info);
+
+/**
+ * @brief Apply dark subtraction, flat-field gain and defect correction in place
+ * @param calib Finalized or loaded calibration
+ * @param frame Raw frame matching the calibration format and size
+ * @return 0 on success, negative on error
+ */
+int libmedia_calib_apply(const media_calib_t* calib, media_frame_t* frame);
+
+/**
+ * @brief Destroy a calibration (unmapping it if loaded from a file)
+ * @param calib Calibration
+ */
+void libmedia_calib_destroy(media_calib_t* calib);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_CALIB_H
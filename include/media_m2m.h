@@ -0,0 +1,208 @@
+/**
+ * @file media_m2m.h
+ * @brief libMedia V4L2 memory-to-memory devices
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Scalers, color converters and encoders (e.g. the Rockchip RGA and VEPU)
+ * are V4L2 memory-to-memory devices. Frames are queued on the OUTPUT queue
+ * and processed results come back on the CAPTURE queue. An M2M session
+ * drives both queues asynchronously: submitting only queues a buffer, and
+ * results are collected later without blocking, or by polling the
+ * session's descriptor from an event loop.
+ *
+ * Input frames come from one of two places:
+ * - MEDIA_M2M_MEMORY_MMAP: the session owns the input buffers.
+ *   libmedia_m2m_acquire_input() lends one to fill, and
+ *   libmedia_m2m_submit() queues it.
+ * - MEDIA_M2M_MEMORY_DMABUF: frames of a capture session are chained with
+ *   libmedia_m2m_submit_frame(). The capture buffer is exported once as a
+ *   DMABUF and handed to the device, so the frame is never copied or
+ *   touched by the CPU. The capture frame is released back to its session
+ *   when the device is done reading it.
+ *
+ * Each queue carries one memory plane: single-planar formats, or
+ * contiguous multi-planar ones such as NV12 (not NV12M). Both the
+ * single-planar and the multi-planar M2M APIs are supported.
+ *
+ * Typical use, scaling camera frames in hardware:
+ * @code
+ * media_m2m_config_t config = {
+ *     .device_path = "/dev/video-rga",
+ *     .input = { .width = 1920, .height = 1080, .pixelformat = V4L2_PIX_FMT_NV12 },
+ *     .output = { .width = 640, .height = 360, .pixelformat = V4L2_PIX_FMT_NV12 },
+ *     .input_memory = MEDIA_M2M_MEMORY_DMABUF
+ * };
+ * media_m2m_t* scaler = libmedia_m2m_create(&config);
+ * libmedia_session_capture_frame(camera, &frame, 1000);
+ * libmedia_m2m_submit_frame(scaler, camera, &frame);     // Scaler owns the frame now
+ * libmedia_m2m_complete(scaler, &scaled, 1000);
+ * use(scaled.data);
+ * libmedia_m2m_release_frame(scaler, &scaled);
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_M2M_H
+#define LIBMEDIA_M2M_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEDIA_M2M_MAX_BUFFERS 16        /**< Maximum buffers per queue */
+
+/**
+ * @struct media_m2m
+ * @brief M2M session (opaque structure)
+ */
+typedef struct media_m2m media_m2m_t;
+
+/**
+ * @enum media_m2m_memory
+ * @brief Memory of the input (OUTPUT) queue
+ */
+typedef enum {
+    MEDIA_M2M_MEMORY_MMAP = 0,          /**< Session-owned buffers, filled by the caller */
+    MEDIA_M2M_MEMORY_DMABUF             /**< Capture session buffers, chained without a copy */
+} media_m2m_memory_t;
+
+/**
+ * @struct media_m2m_config
+ * @brief M2M session configuration
+ */
+typedef struct {
+    const char* device_path;            /**< M2M device path */
+    media_format_t input;               /**< Format sent to the device (OUTPUT queue) */
+    media_format_t output;              /**< Format received from it (CAPTURE queue) */
+    int input_buffers;                  /**< Input buffers, 0 for 4; for DMABUF match the capture session */
+    int output_buffers;                 /**< Result buffers, 0 for 4 */
+    media_m2m_memory_t input_memory;    /**< Where input frames live */
+} media_m2m_config_t;
+
+/**
+ * @struct media_m2m_stats
+ * @brief M2M session counters
+ */
+typedef struct {
+    uint64_t submitted;                 /**< Frames queued to the device */
+    uint64_t completed;                 /**< Results dequeued */
+    uint64_t errors;                    /**< Results the device flagged as failed */
+    uint32_t in_flight;                 /**< Submitted frames not yet read back by the device */
+} media_m2m_stats_t;
+
+/**
+ * @brief Open an M2M device, configure both queues and start streaming
+ * @param config Configuration; formats may be adjusted by the driver, see
+ *        libmedia_m2m_get_formats()
+ * @return Session on success, NULL on error
+ */
+media_m2m_t* libmedia_m2m_create(const media_m2m_config_t* config);
+
+/**
+ * @brief Get the formats the driver actually applied
+ * @param m2m Session
+ * @param input Output input format, may be NULL
+ * @param output Output result format, may be NULL
+ * @return 0 on success, negative on error
+ */
+int libmedia_m2m_get_formats(media_m2m_t* m2m, media_format_t* input, media_format_t* output);
+
+/**
+ * @brief Borrow a free input buffer to fill (MEDIA_M2M_MEMORY_MMAP)
+ *
+ * frame->data and frame->size give the buffer. Fill it, set frame->size to
+ * the bytes used and pass it to libmedia_m2m_submit().
+ * @param m2m Session
+ * @param frame Output input buffer
+ * @return 1 if a buffer was lent, 0 if all are in flight, negative on error
+ */
+int libmedia_m2m_acquire_input(media_m2m_t* m2m, media_frame_t* frame);
+
+/**
+ * @brief Queue an input buffer from libmedia_m2m_acquire_input()
+ *
+ * The timestamp is passed through to the result.
+ * @param m2m Session
+ * @param frame Filled input buffer
+ * @return 0 on success, negative on error
+ */
+int libmedia_m2m_submit(media_m2m_t* m2m, const media_frame_t* frame);
+
+/**
+ * @brief Chain a captured frame into the device (MEDIA_M2M_MEMORY_DMABUF)
+ *
+ * The session owns the frame from now on, also on error, and releases it
+ * back to the capture session once the device has read it. Capture
+ * buffers are exported once and the descriptors are kept for reuse until
+ * the capture session frees or reallocates its buffers; they are then
+ * closed on the next chained frame or when the M2M session is destroyed.
+ * Frames still queued on the device must be collected before the capture
+ * session is destroyed.
+ * @param m2m Session
+ * @param session Capture session the frame came from
+ * @param frame Captured frame
+ * @return 0 on success, negative on error (MEDIA_ERROR_DEVICE_BUSY when
+ *         every input slot is in flight)
+ */
+int libmedia_m2m_submit_frame(media_m2m_t* m2m, media_session_t* session, const media_frame_t* frame);
+
+/**
+ * @brief Get a descriptor that polls readable when a result is ready
+ *
+ * Owned by the session; do not close it.
+ * @param m2m Session
+ * @return File descriptor on success, negative on error
+ */
+int libmedia_m2m_get_fd(media_m2m_t* m2m);
+
+/**
+ * @brief Collect a finished result without blocking
+ *
+ * Also returns input buffers the device has finished reading.
+ * @param m2m Session
+ * @param frame Output result, valid until libmedia_m2m_release_frame()
+ * @return 1 if a result was collected, 0 if none is ready, negative on error
+ */
+int libmedia_m2m_try_complete(media_m2m_t* m2m, media_frame_t* frame);
+
+/**
+ * @brief Wait for the next result
+ * @param m2m Session
+ * @param frame Output result, valid until libmedia_m2m_release_frame()
+ * @param timeout_ms Timeout in milliseconds (-1 for infinite)
+ * @return 0 on success, negative on error or timeout (MEDIA_ERROR_TIMEOUT)
+ */
+int libmedia_m2m_complete(media_m2m_t* m2m, media_frame_t* frame, int timeout_ms);
+
+/**
+ * @brief Give a result buffer back to the device
+ * @param m2m Session
+ * @param frame Result from libmedia_m2m_try_complete() or libmedia_m2m_complete()
+ * @return 0 on success, negative on error
+ */
+int libmedia_m2m_release_frame(media_m2m_t* m2m, const media_frame_t* frame);
+
+/**
+ * @brief Read the counters
+ * @param m2m Session
+ * @param stats Output counters
+ * @return 0 on success, negative on error
+ */
+int libmedia_m2m_get_stats(media_m2m_t* m2m, media_m2m_stats_t* stats);
+
+/**
+ * @brief Stop streaming and close the device
+ *
+ * Chained capture frames still in flight are released to their sessions,
+ * which must therefore still exist.
+ * @param m2m Session
+ */
+void libmedia_m2m_destroy(media_m2m_t* m2m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_M2M_H
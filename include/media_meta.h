@@ -0,0 +1,162 @@
+/**
+ * @file media_meta.h
+ * @brief libMedia per-frame metadata
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * A metadata block is a fixed set of key/value slots travelling with a
+ * frame through media_frame_t.meta. Capture fills in the driver sequence,
+ * the buffer timestamp and the dequeue time. Pipelines add per-stage
+ * processing times. Applications add exposure and gain in effect, image
+ * statistics, hashes or their own keys. Downstream stages and network
+ * sinks read all of it from the frame instead of parallel lookup tables.
+ *
+ * Blocks are preallocated with the buffers they describe, and setting a
+ * key never allocates. A block is cleared when its buffer carries a new
+ * frame. Each key must have one writer at a time; different keys may be
+ * set concurrently, so branches of a pipeline can each add their own
+ * while the frame is shared read-only. Values are 64-bit: integers, or
+ * doubles through libmedia_meta_set_f64().
+ *
+ * Typical use:
+ * @code
+ * uint64_t sequence;
+ * if (frame.meta && libmedia_meta_get(frame.meta, MEDIA_META_SEQUENCE, &sequence)) {
+ *     ...
+ * }
+ * libmedia_meta_set(frame.meta, MEDIA_META_EXPOSURE, exposure);
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_META_H
+#define LIBMEDIA_META_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEDIA_META_MAX_ENTRIES 24       /**< Slots per block */
+
+/**
+ * @enum media_meta_key
+ * @brief Well-known keys; 0 is never a valid key
+ */
+enum {
+    MEDIA_META_SEQUENCE = 1,            /**< Driver frame sequence number */
+    MEDIA_META_TIMESTAMP_NS,            /**< Buffer timestamp */
+    MEDIA_META_DEQUEUE_NS,              /**< Monotonic time the buffer was dequeued */
+    MEDIA_META_EXPOSURE,                /**< Exposure in effect, sensor units */
+    MEDIA_META_GAIN,                    /**< Analogue gain in effect, sensor units */
+    MEDIA_META_DIGITAL_GAIN,            /**< Digital gain in effect, sensor units */
+    MEDIA_META_MEAN_LUMA,               /**< Mean luma (double) */
+    MEDIA_META_SHARPNESS,               /**< Focus measure (double) */
+    MEDIA_META_HASH,                    /**< Content hash, algorithm chosen by the producer */
+    MEDIA_META_SOURCE,                  /**< Camera or stream index */
+
+    MEDIA_META_STAGE_NS = 0x100,        /**< + node id: processing time of a pipeline stage */
+    MEDIA_META_USER = 0x10000           /**< First application-defined key */
+};
+
+/**
+ * @struct media_meta_entry
+ * @brief One key/value slot
+ */
+typedef struct {
+    uint32_t key;                       /**< Key, 0 while the slot is being written */
+    uint32_t reserved;
+    uint64_t value;                     /**< Value, a double's bits for floating-point keys */
+} media_meta_entry_t;
+
+/**
+ * @struct media_meta
+ * @brief Metadata block
+ */
+struct media_meta {
+    uint32_t count;                             /**< Slots claimed (atomic) */
+    uint32_t dropped;                           /**< Sets that found no free slot (atomic) */
+    media_meta_entry_t entries[MEDIA_META_MAX_ENTRIES];
+};
+
+/**
+ * @brief Remove every entry
+ *
+ * Only while no other thread uses the block.
+ * @param meta Metadata block
+ */
+void libmedia_meta_clear(media_meta_t* meta);
+
+/**
+ * @brief Set a key, replacing its value if present
+ * @param meta Metadata block, may be NULL (the call then does nothing)
+ * @param key Key, non-zero
+ * @param value Value
+ * @return 0 on success, negative if the block is full or key is 0
+ */
+int libmedia_meta_set(media_meta_t* meta, uint32_t key, uint64_t value);
+
+/**
+ * @brief Set a key to a floating-point value
+ * @param meta Metadata block, may be NULL
+ * @param key Key, non-zero
+ * @param value Value
+ * @return 0 on success, negative if the block is full or key is 0
+ */
+int libmedia_meta_set_f64(media_meta_t* meta, uint32_t key, double value);
+
+/**
+ * @brief Look up a key
+ * @param meta Metadata block, may be NULL
+ * @param key Key
+ * @param value Output value, may be NULL
+ * @return 1 if the key is present, 0 if not
+ */
+int libmedia_meta_get(const media_meta_t* meta, uint32_t key, uint64_t* value);
+
+/**
+ * @brief Look up a floating-point key
+ * @param meta Metadata block, may be NULL
+ * @param key Key
+ * @param value Output value, may be NULL
+ * @return 1 if the key is present, 0 if not
+ */
+int libmedia_meta_get_f64(const media_meta_t* meta, uint32_t key, double* value);
+
+/**
+ * @brief Add the entries of src whose keys dst does not have yet
+ *
+ * Used when a stage derives a new frame, so the result keeps the
+ * metadata of its input.
+ * @param dst Destination block
+ * @param src Source block, may be NULL
+ * @return Number of entries added
+ */
+int libmedia_meta_merge(media_meta_t* dst, const media_meta_t* src);
+
+/**
+ * @brief Serialize for network sinks
+ *
+ * Layout, little endian: uint32 entry count, then per entry uint32 key and
+ * uint64 value.
+ * @param meta Metadata block, may be NULL (serialized as empty)
+ * @param buffer Output buffer
+ * @param size Buffer size; 4 + 12 * MEDIA_META_MAX_ENTRIES always suffices
+ * @return Bytes written, 0 if the buffer is too small
+ */
+size_t libmedia_meta_serialize(const media_meta_t* meta, void* buffer, size_t size);
+
+/**
+ * @brief Parse a block written by libmedia_meta_serialize()
+ * @param meta Output block, cleared first
+ * @param buffer Serialized data
+ * @param size Data size
+ * @return Bytes consumed, 0 if the data is malformed
+ */
+size_t libmedia_meta_deserialize(media_meta_t* meta, const void* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_META_H
@@ -0,0 +1,154 @@
+/**
+ * @file media_multi.h
+ * @brief libMedia single-thread multi-camera capture
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * A multi-session driver services many started capture sessions from one
+ * thread: all device fds sit in one epoll set, and every wakeup dequeues
+ * without blocking from each ready device and hands the frame to that
+ * camera's callback. When several cameras are ready they are served round
+ * robin, one frame each per round, and the camera served first rotates
+ * between wakeups, so a fast camera cannot starve a slow one. The driver
+ * runs either on a library thread (libmedia_multi_start) or inside the
+ * caller's own loop (libmedia_multi_run_once, libmedia_multi_get_fd).
+ *
+ * Typical use:
+ * @code
+ * media_multi_t* multi = libmedia_multi_create();
+ * for (int i = 0; i < 8; i++) {
+ *     libmedia_multi_add(multi, sessions[i], on_frame, &cameras[i]);
+ * }
+ * libmedia_multi_start(multi);
+ * // ...
+ * libmedia_multi_destroy(multi);
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_MULTI_H
+#define LIBMEDIA_MULTI_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEDIA_MULTI_MAX_SESSIONS 16     /**< Maximum sessions per driver */
+
+/**
+ * @struct media_multi
+ * @brief Multi-session capture driver (opaque structure)
+ */
+typedef struct media_multi media_multi_t;
+
+/**
+ * @brief Frame callback, runs on the driver thread
+ *
+ * The callback must not block: every other camera waits while it runs.
+ * @param user_data User data given to libmedia_multi_add()
+ * @param camera Camera id returned by libmedia_multi_add()
+ * @param session Session the frame came from
+ * @param frame Captured frame
+ * @return 0 to let the driver release the frame, 1 if the callback keeps it
+ *         and will call libmedia_session_release_frame() itself
+ */
+typedef int (*media_multi_frame_fn)(void* user_data, int camera, media_session_t* session,
+                                    media_frame_t* frame);
+
+/**
+ * @struct media_multi_stats
+ * @brief Counters of one camera
+ */
+typedef struct {
+    uint64_t frames;            /**< Frames delivered to the callback */
+    uint64_t wakeups;           /**< Times the device fd was found ready */
+    uint64_t errors;            /**< Capture errors; the camera is disabled after one */
+    int enabled;                /**< Camera is still being serviced */
+} media_multi_stats_t;
+
+/**
+ * @brief Create an empty driver
+ * @return Driver on success, NULL on error
+ */
+media_multi_t* libmedia_multi_create(void);
+
+/**
+ * @brief Add a started session
+ *
+ * May be called while the driver runs only from its own thread (inside a
+ * callback) or when it runs in the caller's loop.
+ * @param multi Driver
+ * @param session Started session, must outlive its registration
+ * @param on_frame Frame callback
+ * @param user_data Passed to the callback
+ * @return Camera id on success, negative on error
+ */
+int libmedia_multi_add(media_multi_t* multi, media_session_t* session,
+                       media_multi_frame_fn on_frame, void* user_data);
+
+/**
+ * @brief Stop servicing a camera; its id is not reused
+ *
+ * Same threading rules as libmedia_multi_add().
+ * @param multi Driver
+ * @param camera Camera id
+ * @return 0 on success, negative on error
+ */
+int libmedia_multi_remove(media_multi_t* multi, int camera);
+
+/**
+ * @brief Wait for ready cameras once and deliver their frames
+ *
+ * For drivers embedded in the caller's loop; not while libmedia_multi_start()
+ * runs.
+ * @param multi Driver
+ * @param timeout_ms Timeout in milliseconds (0 = poll, -1 for infinite)
+ * @return Number of frames delivered, negative on error
+ */
+int libmedia_multi_run_once(media_multi_t* multi, int timeout_ms);
+
+/**
+ * @brief Get a descriptor that polls readable when a camera is ready
+ *
+ * The driver's epoll fd, for nesting in another event loop; call
+ * libmedia_multi_run_once() with a zero timeout when it fires.
+ * @param multi Driver
+ * @return File descriptor on success, negative on error
+ */
+int libmedia_multi_get_fd(media_multi_t* multi);
+
+/**
+ * @brief Service the cameras on a library thread (MEDIA_THREAD_CAPTURE role)
+ * @param multi Driver
+ * @return 0 on success, negative on error
+ */
+int libmedia_multi_start(media_multi_t* multi);
+
+/**
+ * @brief Stop the library thread; safe to call from any thread except the driver's
+ * @param multi Driver
+ * @return 0 on success, negative on error
+ */
+int libmedia_multi_stop(media_multi_t* multi);
+
+/**
+ * @brief Read the counters of one camera
+ * @param multi Driver
+ * @param camera Camera id
+ * @param stats Output counters
+ * @return 0 on success, negative on error
+ */
+int libmedia_multi_get_stats(const media_multi_t* multi, int camera, media_multi_stats_t* stats);
+
+/**
+ * @brief Destroy a driver, stopping it first; sessions are not touched
+ * @param multi Driver
+ */
+void libmedia_multi_destroy(media_multi_t* multi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_MULTI_H
@@ -0,0 +1,328 @@
+/**
+ * @file media_pipeline.h
+ * @brief libMedia processing pipeline
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * A pipeline is a graph of nodes connected by bounded lock-free queues. Sources
+ * (capture sessions or callbacks) produce reference counted packets, stages
+ * transform them and stages without downstream links act as sinks (network,
+ * recorder). Every node runs on its own thread or on a worker shared with
+ * other stages, so capture, conversion, analysis and transmission of
+ * consecutive frames overlap. When a stage's input queue is full its own
+ * backpressure policy decides which packet it loses; a producer only waits
+ * for stages configured with MEDIA_BACKPRESSURE_BLOCK, and delivers to
+ * every non-blocking stage first. A stage that only needs some frames sets
+ * a sampling policy, and the producer withholds the rest before queuing,
+ * so they never reach the stage's thread.
+ *
+ * Typical use:
+ * @code
+ * media_pipeline_t* p = libmedia_pipeline_create();
+ * int cam = libmedia_pipeline_add_session_source(p, "camera", session);
+ * media_stage_config_t send = { .name = "send", .process = send_frame, .user_data = &client };
+ * int tx = libmedia_pipeline_add_stage(p, &send);
+ * libmedia_pipeline_link(p, cam, tx);
+ * libmedia_pipeline_start(p);
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_PIPELINE_H
+#define LIBMEDIA_PIPELINE_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Packets
+// ============================================================================
+
+#define MEDIA_PIPELINE_MAX_NODES 32     /**< Maximum nodes per pipeline */
+#define MEDIA_PIPELINE_MAX_LINKS 8      /**< Maximum downstream links per node */
+
+/**
+ * @struct media_packet
+ * @brief Reference counted frame travelling through a pipeline
+ *
+ * Packets are shared between all downstream branches and must be treated
+ * as read-only once delivered; a stage that modifies pixels should produce
+ * a new packet. Each stage records its processing time in frame.meta under
+ * MEDIA_META_STAGE_NS + node id, and derived frames inherit the metadata of
+ * their input (media_meta.h).
+ */
+typedef struct {
+    media_frame_t frame;        /**< Frame data */
+    uint64_t capture_ns;        /**< Monotonic time the packet entered the pipeline */
+    uint64_t deadline_ns;       /**< Monotonic time processing should be done by (0 = none) */
+    int source;                 /**< Id of the source node */
+    void* user_data;            /**< Free for use by the producer of the packet */
+} media_packet_t;
+
+/**
+ * @brief Release callback invoked when the last packet reference is dropped
+ * @param opaque Producer context given to libmedia_packet_create()
+ * @param packet Packet being released
+ */
+typedef void (*media_packet_release_fn)(void* opaque, media_packet_t* packet);
+
+/**
+ * @struct media_pipeline
+ * @brief Processing pipeline (opaque structure)
+ */
+typedef struct media_pipeline media_pipeline_t;
+
+/**
+ * @brief Wrap a frame into a packet holding one reference
+ *
+ * Packet headers are recycled by the pipeline, so steady-state streaming
+ * does not allocate.
+ * @param pipeline Pipeline the packet will travel through
+ * @param frame Frame to wrap
+ * @param release Called when the last reference is dropped (may be NULL)
+ * @param opaque Context for release
+ * @return Packet on success, NULL on error
+ */
+media_packet_t* libmedia_packet_create(media_pipeline_t* pipeline, const media_frame_t* frame,
+                                       media_packet_release_fn release, void* opaque);
+
+/**
+ * @brief Take an additional reference on a packet
+ * @param packet Packet
+ */
+void libmedia_packet_ref(media_packet_t* packet);
+
+/**
+ * @brief Drop a packet reference, releasing the frame on the last one
+ * @param packet Packet
+ */
+void libmedia_packet_unref(media_packet_t* packet);
+
+// ============================================================================
+// Nodes
+// ============================================================================
+
+/**
+ * @brief Source callback producing the next packet
+ * @param user_data Source context
+ * @param packet Output packet holding one reference
+ * @param timeout_ms Maximum time to wait
+ * @return 1 if a packet was produced, 0 on timeout, negative to end the source
+ */
+typedef int (*media_source_fn)(void* user_data, media_packet_t** packet, int timeout_ms);
+
+/**
+ * @brief Stage callback processing one packet
+ *
+ * *output starts out as packet. A stage that produces a new frame stores a
+ * packet it created in *output and the pipeline drops the input, carrying
+ * capture_ns and source over; storing NULL drops the packet without
+ * forwarding it.
+ * @param user_data Stage context
+ * @param packet Input packet (borrowed)
+ * @param output Packet forwarded to downstream nodes
+ * @return 0 on success, negative on error (the packet is dropped)
+ */
+typedef int (*media_stage_fn)(void* user_data, media_packet_t* packet, media_packet_t** output);
+
+/**
+ * @enum media_backpressure
+ * @brief What a producer does when a stage's input queue is full
+ *
+ * The policy belongs to the consuming stage, so one slow consumer only
+ * loses its own packets and never holds back its siblings.
+ */
+typedef enum {
+    MEDIA_BACKPRESSURE_DROP_NEWEST = 0, /**< Discard the incoming packet */
+    MEDIA_BACKPRESSURE_DROP_OLDEST = 1, /**< Discard the oldest queued packet to make room */
+    MEDIA_BACKPRESSURE_KEEP_LATEST = 2, /**< Hold only the newest packet, replacing any queued one */
+    MEDIA_BACKPRESSURE_BLOCK = 3        /**< Wait up to block_timeout_ms for room, then discard the incoming packet */
+} media_backpressure_t;
+
+/**
+ * @enum media_sampling
+ * @brief Which packets a stage receives from each upstream node
+ *
+ * Applied by the producer at delivery, separately for every link into the
+ * stage. Times are frame timestamps (capture time when the frame has
+ * none), so sampling follows the sensor rather than delivery jitter.
+ */
+typedef enum {
+    MEDIA_SAMPLE_ALL = 0,               /**< Every packet */
+    MEDIA_SAMPLE_EVERY_NTH = 1,         /**< The first packet, then every sample_every-th */
+    MEDIA_SAMPLE_MAX_RATE = 2,          /**< At most one packet per sample_interval_ns on average (1e9 / max fps) */
+    MEDIA_SAMPLE_ALIGNED = 3            /**< The first packet at or after each multiple of sample_interval_ns */
+} media_sampling_t;
+
+/**
+ * @struct media_stage_config
+ * @brief Configuration of a processing stage or sink
+ */
+typedef struct {
+    const char* name;           /**< Stage name used in statistics and logs */
+    media_stage_fn process;     /**< Processing callback */
+    void* user_data;            /**< Callback context */
+    int queue_depth;            /**< Input queue capacity in packets, rounded up to a power of two (0 = 4) */
+    int worker;                 /**< 0 = dedicated thread, N > 0 = share worker N with other stages */
+    media_backpressure_t backpressure;  /**< Full queue policy */
+    int block_timeout_ms;       /**< Longest wait for MEDIA_BACKPRESSURE_BLOCK (0 = 1000, -1 = no limit) */
+    int optional;               /**< Skip the callback and forward the packet unchanged once it is past its deadline */
+    media_sampling_t sampling;  /**< Packets to receive, the others are never queued */
+    uint32_t sample_every;      /**< Decimation factor for MEDIA_SAMPLE_EVERY_NTH */
+    uint64_t sample_interval_ns;    /**< Period for MEDIA_SAMPLE_MAX_RATE and MEDIA_SAMPLE_ALIGNED */
+} media_stage_config_t;
+
+/**
+ * @brief Create an empty pipeline
+ * @return Pipeline on success, NULL on error
+ */
+media_pipeline_t* libmedia_pipeline_create(void);
+
+/**
+ * @brief Add a source driven by a callback
+ * @param pipeline Pipeline (stopped)
+ * @param name Source name
+ * @param produce Packet producer, called repeatedly on the source thread
+ * @param user_data Producer context
+ * @return Node id on success, negative on error
+ */
+int libmedia_pipeline_add_source(media_pipeline_t* pipeline, const char* name,
+                                 media_source_fn produce, void* user_data);
+
+/**
+ * @brief Add a source capturing from a started session
+ *
+ * Captured buffers are returned to the driver when the last packet
+ * reference is dropped, so the session must outlive the pipeline.
+ * @param pipeline Pipeline (stopped)
+ * @param name Source name
+ * @param session Capture session
+ * @return Node id on success, negative on error
+ */
+int libmedia_pipeline_add_session_source(media_pipeline_t* pipeline, const char* name,
+                                         media_session_t* session);
+
+/**
+ * @brief Add a processing stage or sink
+ * @param pipeline Pipeline (stopped)
+ * @param config Stage configuration
+ * @return Node id on success, negative on error
+ */
+int libmedia_pipeline_add_stage(media_pipeline_t* pipeline, const media_stage_config_t* config);
+
+/**
+ * @brief Connect the output of one node to the input queue of a stage
+ *
+ * A node linked to several stages delivers every packet to all of them;
+ * a stage linked from several nodes merges their packets. A stage with
+ * MEDIA_BACKPRESSURE_BLOCK cannot be linked from a stage on the same
+ * shared worker, since that worker would wait for itself.
+ * @param pipeline Pipeline (stopped)
+ * @param from Upstream node id
+ * @param to Downstream stage id
+ * @return 0 on success, negative on error
+ */
+int libmedia_pipeline_link(media_pipeline_t* pipeline, int from, int to);
+
+/**
+ * @brief Give the packets of a source a deadline
+ *
+ * Each packet must be done by its buffer timestamp (its capture time if
+ * the frame has none) plus periods frame periods. Optional stages skip
+ * packets that are already late, so overlays and analytics give way while
+ * essential stages keep up with the sensor. A source callback may also
+ * set deadline_ns itself, which takes precedence.
+ * @param pipeline Pipeline (stopped)
+ * @param source Source node id
+ * @param period_ns Frame period (0 = measure from frame timestamps)
+ * @param periods Latency budget in frame periods (0 = no deadline)
+ * @return 0 on success, negative on error
+ */
+int libmedia_pipeline_set_deadline(media_pipeline_t* pipeline, int source,
+                                   uint64_t period_ns, uint32_t periods);
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+/**
+ * @brief Start all node threads
+ *
+ * Fails if blocking stages would make workers wait on each other in a
+ * cycle, e.g. worker 1 blocking on a stage of worker 2 that blocks on a
+ * stage of worker 1.
+ * @param pipeline Pipeline
+ * @return 0 on success, negative on error
+ */
+int libmedia_pipeline_start(media_pipeline_t* pipeline);
+
+/**
+ * @brief Stop all node threads and drop queued packets
+ * @param pipeline Pipeline
+ * @return 0 on success, negative on error
+ */
+int libmedia_pipeline_stop(media_pipeline_t* pipeline);
+
+/**
+ * @brief Destroy a pipeline, stopping it first if needed
+ * @param pipeline Pipeline
+ */
+void libmedia_pipeline_destroy(media_pipeline_t* pipeline);
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+/**
+ * @struct media_node_stats
+ * @brief Counters of one pipeline node
+ */
+typedef struct {
+    const char* name;           /**< Node name */
+    uint64_t packets_in;        /**< Packets taken from the input queue (produced, for sources) */
+    uint64_t packets_out;       /**< Packets forwarded downstream */
+    uint64_t errors;            /**< Callback failures */
+    uint64_t dropped;           /**< Packets discarded by the backpressure policy */
+    uint64_t skipped;           /**< Late packets an optional stage forwarded without processing */
+    uint64_t decimated;         /**< Packets the sampling policy kept out of the queue */
+    uint64_t blocked_ns;        /**< Time producers spent waiting for room (MEDIA_BACKPRESSURE_BLOCK) */
+    uint64_t latency_avg_ns;    /**< Average callback duration */
+    uint64_t latency_max_ns;    /**< Longest callback duration */
+    uint64_t age_avg_ns;        /**< Average packet age (since capture) when the callback finished */
+    uint32_t queue_depth;       /**< Packets currently queued */
+    uint32_t queue_capacity;    /**< Input queue capacity */
+    uint32_t queue_high_water;  /**< Deepest the queue has been */
+} media_node_stats_t;
+
+/**
+ * @brief Get the number of nodes in a pipeline
+ * @param pipeline Pipeline
+ * @return Node count, negative on error
+ */
+int libmedia_pipeline_get_node_count(const media_pipeline_t* pipeline);
+
+/**
+ * @brief Read the counters of one node
+ *
+ * May be called while the pipeline runs; counters are sampled without
+ * stopping the node.
+ * @param pipeline Pipeline
+ * @param node Node id
+ * @param stats Output counters
+ * @return 0 on success, negative on error
+ */
+int libmedia_pipeline_get_stats(const media_pipeline_t* pipeline, int node, media_node_stats_t* stats);
+
+/**
+ * @brief Reset the counters of every node
+ * @param pipeline Pipeline
+ */
+void libmedia_pipeline_reset_stats(media_pipeline_t* pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_PIPELINE_H
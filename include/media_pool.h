@@ -0,0 +1,148 @@
+/**
+ * @file media_pool.h
+ * @brief libMedia aligned frame pools
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * A frame pool hands out fixed-size, reference counted buffers for processed
+ * frames (RGB, NV12, inference tensors) instead of allocating one per frame.
+ * Buffers are grouped in classes keyed by format and geometry; all memory of
+ * a class is mapped, aligned and pre-faulted when the class is reserved, so
+ * acquiring and releasing buffers afterwards never touches the heap. Acquire
+ * and release are lock-free and may be called from any thread.
+ *
+ * Typical use:
+ * @code
+ * media_pool_t* pool = libmedia_pool_create(MEDIA_POOL_LOCKED);
+ * media_pool_key_t rgb = { .pixelformat = V4L2_PIX_FMT_RGB24, .width = 640, .height = 480 };
+ * libmedia_pool_reserve(pool, &rgb, 4);
+ *
+ * media_pool_buffer_t* out = libmedia_pool_acquire(pool, &rgb);
+ * // ... convert into out->frame.data, hand out->frame downstream ...
+ * libmedia_pool_buffer_unref(out);
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_POOL_H
+#define LIBMEDIA_POOL_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEDIA_POOL_MAX_CLASSES 8        /**< Maximum buffer classes per pool */
+
+#define MEDIA_POOL_HUGEPAGES 0x1        /**< Back buffers with huge pages where available */
+#define MEDIA_POOL_LOCKED 0x2           /**< Lock buffers in RAM (mlock) */
+
+/**
+ * @struct media_pool
+ * @brief Frame pool (opaque structure)
+ */
+typedef struct media_pool media_pool_t;
+
+/**
+ * @struct media_pool_key
+ * @brief Buffer class: format and geometry of the frames it holds
+ */
+typedef struct {
+    uint32_t pixelformat;       /**< V4L2 pixel format, 0 for untyped buffers (tensors) */
+    uint32_t width;             /**< Frame width in pixels */
+    uint32_t height;            /**< Frame height in pixels */
+    size_t size;                /**< Bytes per buffer (0 = computed from the format) */
+} media_pool_key_t;
+
+/**
+ * @struct media_pool_buffer
+ * @brief Pool buffer handle
+ *
+ * frame.data is aligned to a cache line, and to a page for buffers of at
+ * least one page. frame_id holds the buffer's index within its class.
+ */
+typedef struct {
+    media_frame_t frame;        /**< Buffer memory and frame geometry */
+    void* user_data;            /**< Free for use by the current owner */
+} media_pool_buffer_t;
+
+/**
+ * @brief Create an empty pool
+ * @param flags MEDIA_POOL_* flags applied to every class
+ * @return Pool on success, NULL on error
+ */
+media_pool_t* libmedia_pool_create(uint32_t flags);
+
+/**
+ * @brief Allocate the buffers of a class
+ *
+ * Must not run concurrently with other calls on the same pool. Reserving
+ * an existing class again fails.
+ * @param pool Pool
+ * @param key Buffer class
+ * @param count Number of buffers
+ * @return 0 on success, negative on error
+ */
+int libmedia_pool_reserve(media_pool_t* pool, const media_pool_key_t* key, uint32_t count);
+
+/**
+ * @brief Take a free buffer of a class without blocking
+ * @param pool Pool
+ * @param key Buffer class (must have been reserved)
+ * @return Buffer holding one reference, NULL if none is free or on error
+ */
+media_pool_buffer_t* libmedia_pool_acquire(media_pool_t* pool, const media_pool_key_t* key);
+
+/**
+ * @brief Take a free buffer of the smallest class holding at least `size` bytes
+ *
+ * Tries larger classes in turn when smaller ones are exhausted.
+ * @param pool Pool
+ * @param size Bytes needed
+ * @return Buffer holding one reference, NULL if no class has a free buffer or on error
+ */
+media_pool_buffer_t* libmedia_pool_acquire_size(media_pool_t* pool, size_t size);
+
+/**
+ * @brief Find the pool buffer whose memory contains an address
+ * @param pool Pool
+ * @param data Address inside a buffer
+ * @return Buffer, NULL if the address does not belong to the pool
+ */
+media_pool_buffer_t* libmedia_pool_find_buffer(const media_pool_t* pool, const void* data);
+
+/**
+ * @brief Take an additional reference on a buffer
+ * @param buffer Buffer
+ */
+void libmedia_pool_buffer_ref(media_pool_buffer_t* buffer);
+
+/**
+ * @brief Drop a buffer reference, returning it to its pool on the last one
+ * @param buffer Buffer
+ */
+void libmedia_pool_buffer_unref(media_pool_buffer_t* buffer);
+
+/**
+ * @brief Get the number of free buffers of a class
+ * @param pool Pool
+ * @param key Buffer class
+ * @return Free buffers (a snapshot while other threads run), 0 if unknown
+ */
+uint32_t libmedia_pool_get_available(const media_pool_t* pool, const media_pool_key_t* key);
+
+/**
+ * @brief Destroy a pool
+ *
+ * Buffers still referenced stay valid and the pool memory is freed when
+ * the last of them is released. The pool handle itself must not be used
+ * again, so the remaining buffers can only be unreferenced.
+ * @param pool Pool
+ */
+void libmedia_pool_destroy(media_pool_t* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_POOL_H
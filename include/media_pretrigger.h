@@ -0,0 +1,150 @@
+/**
+ * @file media_pretrigger.h
+ * @brief libMedia pre-trigger frame history
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * A pre-trigger buffer keeps the last N seconds of frames in memory so that
+ * event recording can start before the event. Frames of any format are
+ * stored: raw, packed or compressed. Each frame is copied once into a byte
+ * ring that is reserved up front, and the oldest frames are overwritten
+ * when the ring is full or when they fall out of the time window. Steady
+ * state does not allocate.
+ *
+ * On trigger, the next push hands the whole history to the sink, oldest
+ * first, and then passes every new frame straight through until the
+ * recording is stopped. History and live frames are delivered on the
+ * pushing thread in capture order, so there is no gap between them and
+ * live frames are not copied at all.
+ *
+ * Typical use:
+ * @code
+ * media_pretrigger_config_t config = { .duration_ns = 5000000000ULL, .bytes = 64 << 20,
+ *                                      .sink = write_frame, .user_data = file };
+ * media_pretrigger_t* history = libmedia_pretrigger_create(&config);
+ * for (;;) {
+ *     libmedia_session_capture_frame(session, &frame, 1000);
+ *     libmedia_pretrigger_push(history, &frame);
+ *     libmedia_session_release_frame(session, &frame);
+ * }
+ * // On an event, from any thread:
+ * libmedia_pretrigger_trigger(history);
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_PRETRIGGER_H
+#define LIBMEDIA_PRETRIGGER_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct media_pretrigger
+ * @brief Pre-trigger frame history (opaque structure)
+ */
+typedef struct media_pretrigger media_pretrigger_t;
+
+/**
+ * @brief Sink receiving the recording, runs on the pushing thread
+ *
+ * History frames and their metadata point into the ring and are only valid
+ * during the call.
+ * @param user_data User data from the configuration
+ * @param frame Frame to record
+ * @param live 0 for a frame from the history, 1 for a live frame
+ * @return 0 on success, negative on error (counted in the statistics)
+ */
+typedef int (*media_pretrigger_sink_fn)(void* user_data, const media_frame_t* frame, int live);
+
+/**
+ * @struct media_pretrigger_config
+ * @brief Pre-trigger buffer configuration
+ */
+typedef struct {
+    uint64_t duration_ns;               /**< Time window to keep, by frame timestamp */
+    size_t bytes;                       /**< Frame data capacity */
+    uint32_t max_frames;                /**< Frame capacity, 0 for 1024 */
+    uint32_t pool_flags;                /**< MEDIA_POOL_* flags for the frame data memory */
+    media_pretrigger_sink_fn sink;      /**< Receives the recording */
+    void* user_data;                    /**< Passed to the sink */
+} media_pretrigger_config_t;
+
+/**
+ * @struct media_pretrigger_stats
+ * @brief Pre-trigger buffer counters
+ */
+typedef struct {
+    uint64_t stored;            /**< Frames copied into the history */
+    uint64_t evicted;           /**< Frames overwritten before any trigger needed them */
+    uint64_t oversized;         /**< Frames larger than the whole ring, not stored */
+    uint64_t history;           /**< History frames handed to the sink */
+    uint64_t live;              /**< Live frames handed to the sink */
+    uint64_t sink_errors;       /**< Sink calls that failed */
+    uint32_t frames;            /**< Frames held now */
+    size_t bytes;               /**< Frame data held now */
+    uint64_t span_ns;           /**< Time between the oldest and newest frame held */
+    int recording;              /**< Trigger is active */
+} media_pretrigger_stats_t;
+
+/**
+ * @brief Create a pre-trigger buffer, reserving all its memory
+ * @param config Configuration
+ * @return Buffer on success, NULL on error
+ */
+media_pretrigger_t* libmedia_pretrigger_create(const media_pretrigger_config_t* config);
+
+/**
+ * @brief Add a captured frame
+ *
+ * Before a trigger the frame is copied into the history, so the caller can
+ * release it right after. While recording it goes straight to the sink.
+ * Call from one thread only.
+ * @param pretrigger Buffer
+ * @param frame Captured frame
+ * @return 0 on success, negative on error
+ */
+int libmedia_pretrigger_push(media_pretrigger_t* pretrigger, const media_frame_t* frame);
+
+/**
+ * @brief Start recording: the next push delivers the history, then live frames
+ *
+ * Safe to call from any thread. Triggering while recording does nothing.
+ * @param pretrigger Buffer
+ * @return 0 on success, negative on error
+ */
+int libmedia_pretrigger_trigger(media_pretrigger_t* pretrigger);
+
+/**
+ * @brief Stop recording; the history fills again from the next push
+ *
+ * Safe to call from any thread.
+ * @param pretrigger Buffer
+ * @return 0 on success, negative on error
+ */
+int libmedia_pretrigger_stop(media_pretrigger_t* pretrigger);
+
+/**
+ * @brief Read the counters
+ *
+ * The current contents (frames, bytes, span_ns) are only exact when read
+ * from the pushing thread.
+ * @param pretrigger Buffer
+ * @param stats Output counters
+ * @return 0 on success, negative on error
+ */
+int libmedia_pretrigger_get_stats(const media_pretrigger_t* pretrigger, media_pretrigger_stats_t* stats);
+
+/**
+ * @brief Destroy a pre-trigger buffer
+ * @param pretrigger Buffer
+ */
+void libmedia_pretrigger_destroy(media_pretrigger_t* pretrigger);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_PRETRIGGER_H
@@ -0,0 +1,273 @@
+/**
+ * @file media_proc.h
+ * @brief libMedia image processing kernels
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * CPU kernels that operate on captured frames in place or into caller
+ * provided planes. All kernels work on plane views so a region of interest
+ * is expressed by offsetting the data pointer and keeping the stride.
+ */
+
+#ifndef LIBMEDIA_PROC_H
+#define LIBMEDIA_PROC_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Plane Views
+// ============================================================================
+
+/**
+ * @struct media_plane
+ * @brief View of a single image plane
+ */
+typedef struct {
+    void* data;             /**< First pixel of the view */
+    uint32_t width;         /**< Width in pixels */
+    uint32_t height;        /**< Height in pixels */
+    uint32_t stride;        /**< Bytes between the starts of two rows */
+} media_plane_t;
+
+/**
+ * @struct media_rect
+ * @brief Rectangular region of interest in pixels
+ */
+typedef struct {
+    uint32_t x;             /**< Left column */
+    uint32_t y;             /**< Top row */
+    uint32_t width;         /**< Width in pixels */
+    uint32_t height;        /**< Height in pixels */
+} media_rect_t;
+
+/**
+ * @brief Build a plane view over the luma plane of a captured frame
+ *
+ * Works for GREY, NV12, NV21 and YUV420 frames whose rows are packed
+ * (stride equals width).
+ * @param frame Captured frame
+ * @param plane Output plane view
+ * @return 0 on success, negative on error
+ */
+int libmedia_frame_luma_plane(const media_frame_t* frame, media_plane_t* plane);
+
+// ============================================================================
+// Local Contrast Enhancement (CLAHE)
+// ============================================================================
+
+/**
+ * @struct media_clahe
+ * @brief CLAHE context (opaque structure)
+ */
+typedef struct media_clahe media_clahe_t;
+
+/**
+ * @struct media_clahe_config
+ * @brief Configuration for tiled contrast limited histogram equalization
+ */
+typedef struct {
+    uint32_t tiles_x;       /**< Tiles across the image (0 = 8) */
+    uint32_t tiles_y;       /**< Tiles down the image (0 = 8) */
+    uint32_t clip_limit;    /**< Histogram clip limit in Q8 multiples of the mean bin (512 = 2.0, 0 = no clipping) */
+    int threads;            /**< Worker threads used for tiles and rows (0 or 1 = calling thread only) */
+} media_clahe_config_t;
+
+/**
+ * @brief Create a CLAHE context
+ *
+ * The context owns the per-tile lookup tables and column weights, so
+ * processing a stream of equally sized frames performs no allocation.
+ * @param config CLAHE configuration
+ * @return Context on success, NULL on error
+ */
+media_clahe_t* libmedia_clahe_create(const media_clahe_config_t* config);
+
+/**
+ * @brief Apply CLAHE to an 8-bit plane
+ *
+ * src and dst may describe the same memory for in-place operation.
+ * @param clahe CLAHE context
+ * @param src Source 8-bit plane
+ * @param dst Destination 8-bit plane with the same width and height
+ * @return 0 on success, negative on error
+ */
+int libmedia_clahe_process(media_clahe_t* clahe, const media_plane_t* src, media_plane_t* dst);
+
+/**
+ * @brief Apply CLAHE in place to the luma plane of a GREY/NV12/NV21/YUV420 frame
+ *
+ * Chroma is left untouched.
+ * @param clahe CLAHE context
+ * @param frame Frame to enhance
+ * @return 0 on success, negative on error
+ */
+int libmedia_clahe_process_frame(media_clahe_t* clahe, media_frame_t* frame);
+
+/**
+ * @brief Destroy a CLAHE context
+ * @param clahe CLAHE context
+ */
+void libmedia_clahe_destroy(media_clahe_t* clahe);
+
+// ============================================================================
+// Gradient and Edge Kernels (Sobel, Scharr)
+// ============================================================================
+
+/**
+ * @enum media_gradient_op
+ * @brief 3x3 derivative operator
+ */
+typedef enum {
+    MEDIA_GRADIENT_SOBEL = 0,       /**< [1 2 1] smoothing, [-1 0 1] derivative */
+    MEDIA_GRADIENT_SCHARR = 1       /**< [3 10 3] smoothing, [-1 0 1] derivative */
+} media_gradient_op_t;
+
+/**
+ * @enum media_gradient_norm
+ * @brief Gradient magnitude approximation
+ */
+typedef enum {
+    MEDIA_GRADIENT_L1 = 0,          /**< |gx| + |gy| */
+    MEDIA_GRADIENT_L2 = 1           /**< sqrt(gx^2 + gy^2), alpha-max-beta-min approximation (about 6% error) */
+} media_gradient_norm_t;
+
+/**
+ * @struct media_gradient
+ * @brief Gradient kernel context (opaque structure)
+ */
+typedef struct media_gradient media_gradient_t;
+
+/**
+ * @struct media_gradient_config
+ * @brief Configuration for gradient kernels
+ */
+typedef struct {
+    media_gradient_op_t op;         /**< Derivative operator */
+    media_gradient_norm_t norm;     /**< Magnitude approximation */
+    uint32_t orientation_bins;      /**< 4 (0/45/90/135 degrees) or 8 (signed, 45 degree steps) */
+    uint32_t shift;                 /**< Right shift applied to magnitudes of 16-bit sources before saturation */
+} media_gradient_config_t;
+
+/**
+ * @brief Create a gradient kernel context
+ *
+ * The context owns the line buffers, so processing equally sized regions
+ * performs no allocation.
+ * @param config Gradient configuration
+ * @return Context on success, NULL on error
+ */
+media_gradient_t* libmedia_gradient_create(const media_gradient_config_t* config);
+
+/**
+ * @brief Compute gradient magnitude and orientation of an 8-bit plane
+ *
+ * Only pixels inside roi are produced; neighbours outside the roi are read
+ * from src, and the image border is replicated.
+ * @param gradient Gradient context
+ * @param src Source 8-bit plane (whole image)
+ * @param roi Region to process, NULL for the whole plane
+ * @param magnitude Output 16-bit plane of roi size
+ * @param orientation Output 8-bit plane of roi size with bin indices, may be NULL
+ * @return 0 on success, negative on error
+ */
+int libmedia_gradient_u8(media_gradient_t* gradient, const media_plane_t* src, const media_rect_t* roi,
+                         media_plane_t* magnitude, media_plane_t* orientation);
+
+/**
+ * @brief Compute gradient magnitude and orientation of a 16-bit plane
+ *
+ * Same as libmedia_gradient_u8() for 16-bit samples (e.g. unpacked RAW10).
+ * Magnitudes are shifted right by config.shift and saturated to 16 bits.
+ * @param gradient Gradient context
+ * @param src Source 16-bit plane (whole image)
+ * @param roi Region to process, NULL for the whole plane
+ * @param magnitude Output 16-bit plane of roi size
+ * @param orientation Output 8-bit plane of roi size with bin indices, may be NULL
+ * @return 0 on success, negative on error
+ */
+int libmedia_gradient_u16(media_gradient_t* gradient, const media_plane_t* src, const media_rect_t* roi,
+                          media_plane_t* magnitude, media_plane_t* orientation);
+
+/**
+ * @brief Destroy a gradient kernel context
+ * @param gradient Gradient context
+ */
+void libmedia_gradient_destroy(media_gradient_t* gradient);
+
+// ============================================================================
+// Multi-ROI Extraction
+// ============================================================================
+
+#define MEDIA_ROI_MAX_OUTPUTS 16    /**< Maximum regions per plan */
+#define MEDIA_ROI_MAX_SCALE 8       /**< Largest box downscale factor */
+
+/**
+ * @struct media_roi_plan
+ * @brief Precomputed multi-ROI extraction plan (opaque structure)
+ */
+typedef struct media_roi_plan media_roi_plan_t;
+
+/**
+ * @struct media_roi_spec
+ * @brief One output region of a multi-ROI plan
+ */
+typedef struct {
+    media_rect_t rect;          /**< Source region in luma pixels */
+    uint32_t scale;             /**< Box downscale factor 1..MEDIA_ROI_MAX_SCALE (1 = crop) */
+    uint32_t pixelformat;       /**< Output format: V4L2_PIX_FMT_NV12 or V4L2_PIX_FMT_GREY */
+} media_roi_spec_t;
+
+/**
+ * @brief Create a multi-ROI extraction plan
+ *
+ * Output sizes are rect / scale, rounded down to even values for NV12
+ * outputs. NV12 outputs require an NV12 source and an even rect origin.
+ * @param src_width Source frame width
+ * @param src_height Source frame height
+ * @param src_pixelformat Source format: V4L2_PIX_FMT_NV12 or V4L2_PIX_FMT_GREY
+ * @param specs Output regions
+ * @param count Number of regions (1..MEDIA_ROI_MAX_OUTPUTS)
+ * @return Plan on success, NULL on error
+ */
+media_roi_plan_t* libmedia_roi_plan_create(uint32_t src_width, uint32_t src_height, uint32_t src_pixelformat,
+                                           const media_roi_spec_t* specs, int count);
+
+/**
+ * @brief Get the geometry of one plan output
+ * @param plan Multi-ROI plan
+ * @param index Output index
+ * @param width Output width (may be NULL)
+ * @param height Output height (may be NULL)
+ * @return Required buffer size in bytes, 0 on error
+ */
+size_t libmedia_roi_plan_get_output(const media_roi_plan_t* plan, int index, uint32_t* width, uint32_t* height);
+
+/**
+ * @brief Extract all regions of a frame in one pass over its rows
+ *
+ * Each source row is read once, while it is cache resident, and fed to
+ * every region that covers it. outputs[i].data must point to a buffer of
+ * at least libmedia_roi_plan_get_output() bytes; the remaining frame fields
+ * are filled in, with timestamp, frame_id and sequence copied from src.
+ * @param plan Multi-ROI plan
+ * @param src Source frame matching the plan
+ * @param outputs Output frames, one per region
+ * @return 0 on success, negative on error
+ */
+int libmedia_roi_plan_execute(media_roi_plan_t* plan, const media_frame_t* src, media_frame_t* outputs);
+
+/**
+ * @brief Destroy a multi-ROI plan
+ * @param plan Multi-ROI plan
+ */
+void libmedia_roi_plan_destroy(media_roi_plan_t* plan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_PROC_H
@@ -0,0 +1,103 @@
+/**
+ * @file media_queue.h
+ * @brief libMedia lock-free handle queues
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Bounded queues of pointers (frames, packets, buffer handles) for passing
+ * work between threads. Producers never block and never take a lock: a push
+ * into a full queue fails immediately. The consumer can poll or sleep on a
+ * futex until an item arrives; a push only enters the kernel when the
+ * consumer is actually asleep. A consumer running its own event loop can
+ * instead poll the queue's eventfd, for example to receive the output of a
+ * pipeline sink on the loop thread.
+ */
+
+#ifndef LIBMEDIA_QUEUE_H
+#define LIBMEDIA_QUEUE_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum media_queue_type
+ * @brief Producer model of a queue
+ */
+typedef enum {
+    MEDIA_QUEUE_SPSC = 0,       /**< One producer thread, one consumer thread */
+    MEDIA_QUEUE_MPSC = 1        /**< Any number of producer threads, one consumer thread */
+} media_queue_type_t;
+
+/**
+ * @struct media_queue
+ * @brief Lock-free queue (opaque structure)
+ */
+typedef struct media_queue media_queue_t;
+
+/**
+ * @brief Create a queue
+ * @param type Producer model
+ * @param capacity Number of entries, rounded up to a power of two
+ * @return Queue on success, NULL on error
+ */
+media_queue_t* libmedia_queue_create(media_queue_type_t type, uint32_t capacity);
+
+/**
+ * @brief Append an item without blocking
+ * @param queue Queue
+ * @param item Non-NULL item
+ * @return 0 on success, negative if the queue is full
+ */
+int libmedia_queue_push(media_queue_t* queue, void* item);
+
+/**
+ * @brief Take the oldest item, waiting for one if the queue is empty
+ *
+ * Only one thread may pop from a queue.
+ * @param queue Queue
+ * @param item Output item
+ * @param timeout_ms Timeout in milliseconds (0 = poll, -1 for infinite)
+ * @return 1 if an item was taken, 0 on timeout, negative on error
+ */
+int libmedia_queue_pop(media_queue_t* queue, void** item, int timeout_ms);
+
+/**
+ * @brief Get an eventfd that polls readable while items may be waiting
+ *
+ * Created on first use and owned by the queue. When it fires, pop with a
+ * zero timeout until the pop returns 0: the empty pop re-arms the fd, so it
+ * needs no read() by the caller. From then on a push writes the fd only
+ * when the consumer has drained the queue, at most once per drain.
+ * @param queue Queue
+ * @return File descriptor on success, negative on error
+ */
+int libmedia_queue_get_fd(media_queue_t* queue);
+
+/**
+ * @brief Get the number of queued items
+ * @param queue Queue
+ * @return Item count (a snapshot while producers run)
+ */
+uint32_t libmedia_queue_get_count(const media_queue_t* queue);
+
+/**
+ * @brief Get the capacity of a queue
+ * @param queue Queue
+ * @return Capacity in items
+ */
+uint32_t libmedia_queue_get_capacity(const media_queue_t* queue);
+
+/**
+ * @brief Destroy a queue; remaining items are not touched
+ * @param queue Queue
+ */
+void libmedia_queue_destroy(media_queue_t* queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_QUEUE_H
@@ -0,0 +1,153 @@
+/**
+ * @file media_raw.h
+ * @brief libMedia raw Bayer kernels
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Kernels for raw sensor data in every Bayer order at 8, 10, 12 and 16 bits,
+ * stored either in 8/16-bit containers (V4L2_PIX_FMT_SBGGR12, ...) or
+ * MIPI bit-packed (V4L2_PIX_FMT_SBGGR10P, V4L2_PIX_FMT_SBGGR12P, ...).
+ * Samples in 16-bit containers are LSB aligned. Packed sources are decoded
+ * line by line, so no kernel needs an unpacked copy of the frame.
+ */
+
+#ifndef LIBMEDIA_RAW_H
+#define LIBMEDIA_RAW_H
+
+#include "media.h"
+#include "media_proc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Formats
+// ============================================================================
+
+/** @brief Widest line the raw kernels accept */
+#define MEDIA_RAW_MAX_WIDTH 4096
+
+/** @brief 16-bit per channel RGB (LSB aligned, sensor bit depth), demosaic output */
+#define MEDIA_PIX_FMT_RGB48 v4l2_fourcc('M', 'R', '4', '8')
+
+/**
+ * @brief Get the container format holding the same samples unpacked
+ *
+ * RAW10P/RAW12P map to the 16-bit container of the same order and depth;
+ * unpacked formats map to themselves.
+ * @param pixelformat Raw pixel format
+ * @return Unpacked pixel format, 0 if not a raw format
+ */
+uint32_t libmedia_raw_unpacked_format(uint32_t pixelformat);
+
+/**
+ * @brief Get the MIPI packed format for a 10-bit or 12-bit raw format
+ * @param pixelformat Raw pixel format
+ * @return Packed pixel format, 0 if there is none
+ */
+uint32_t libmedia_raw_packed_format(uint32_t pixelformat);
+
+// ============================================================================
+// Pack / Unpack
+// ============================================================================
+
+/**
+ * @brief Unpack a raw plane into 16-bit containers
+ * @param src Source plane (any raw format)
+ * @param src_format Source pixel format
+ * @param dst Destination 16-bit plane, same width and height
+ * @return 0 on success, negative on error
+ */
+int libmedia_raw_unpack(const media_plane_t* src, uint32_t src_format, media_plane_t* dst);
+
+/**
+ * @brief Pack 16-bit samples into a raw format, converting bit depth
+ * @param src Source 16-bit plane
+ * @param src_bits Significant bits of the source samples (8..16)
+ * @param dst Destination plane
+ * @param dst_format Destination raw format (packed or container)
+ * @return 0 on success, negative on error
+ */
+int libmedia_raw_pack(const media_plane_t* src, uint32_t src_bits, media_plane_t* dst, uint32_t dst_format);
+
+// ============================================================================
+// Binning
+// ============================================================================
+
+/**
+ * @brief 2x2 same-colour binning preserving the Bayer pattern
+ *
+ * Each output sample averages the four nearest samples of its colour, so
+ * the output is a half-size frame of the same order and bit depth in
+ * libmedia_raw_unpacked_format(src_format).
+ * @param src Source plane (width and height multiples of 4)
+ * @param src_format Source raw format
+ * @param dst Destination plane of width/2 x height/2
+ * @return 0 on success, negative on error
+ */
+int libmedia_raw_bin2x2(const media_plane_t* src, uint32_t src_format, media_plane_t* dst);
+
+// ============================================================================
+// Demosaic
+// ============================================================================
+
+/**
+ * @brief Bilinear demosaic to interleaved RGB
+ * @param src Source plane (any raw format)
+ * @param src_format Source raw format
+ * @param dst Destination plane of the same size
+ * @param dst_format V4L2_PIX_FMT_RGB24, V4L2_PIX_FMT_BGR24 (scaled to 8 bits) or MEDIA_PIX_FMT_RGB48 (full depth)
+ * @return 0 on success, negative on error
+ */
+int libmedia_raw_demosaic(const media_plane_t* src, uint32_t src_format, media_plane_t* dst, uint32_t dst_format);
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+#define MEDIA_RAW_HIST_BINS 256     /**< Histogram bins per channel over the full sample range */
+
+/**
+ * @enum media_raw_channel
+ * @brief Bayer channel index
+ */
+typedef enum {
+    MEDIA_RAW_CH_R = 0,             /**< Red */
+    MEDIA_RAW_CH_GR = 1,            /**< Green on red rows */
+    MEDIA_RAW_CH_GB = 2,            /**< Green on blue rows */
+    MEDIA_RAW_CH_B = 3,             /**< Blue */
+    MEDIA_RAW_CHANNELS = 4
+} media_raw_channel_t;
+
+/**
+ * @struct media_raw_stats
+ * @brief Per-channel raw statistics
+ */
+typedef struct {
+    uint32_t bits;                          /**< Sample bit depth */
+    uint32_t count[MEDIA_RAW_CHANNELS];     /**< Samples visited */
+    uint64_t sum[MEDIA_RAW_CHANNELS];       /**< Sum of samples */
+    uint32_t min[MEDIA_RAW_CHANNELS];       /**< Minimum sample */
+    uint32_t max[MEDIA_RAW_CHANNELS];       /**< Maximum sample */
+    uint32_t saturated[MEDIA_RAW_CHANNELS]; /**< Samples at full scale */
+    uint32_t histogram[MEDIA_RAW_CHANNELS][MEDIA_RAW_HIST_BINS]; /**< Histogram of the top 8 bits */
+} media_raw_stats_t;
+
+/**
+ * @brief Gather per-channel statistics of a raw frame
+ * @param src Source plane (any raw format)
+ * @param src_format Source raw format
+ * @param roi Region to analyse, NULL for the whole plane (origin rounded down to even)
+ * @param step Visit every step-th 2x2 block in each direction (0 or 1 = all)
+ * @param stats Output statistics
+ * @return 0 on success, negative on error
+ */
+int libmedia_raw_statistics(const media_plane_t* src, uint32_t src_format, const media_rect_t* roi,
+                            uint32_t step, media_raw_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_RAW_H
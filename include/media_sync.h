@@ -0,0 +1,145 @@
+/**
+ * @file media_sync.h
+ * @brief libMedia cross-camera frame synchronization
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * A synchronizer groups frames that several sessions exposed together, for
+ * stereo and multi-view rigs. Captured frames are pushed into it still
+ * dequeued, so it holds the V4L2 buffers themselves instead of copies.
+ * Once every stream has a frame and all their timestamps lie within the
+ * tolerance, the set goes to a callback and the buffers are requeued
+ * afterwards. A frame that can no longer be part of a set is dropped
+ * (requeued) as a straggler. Skew statistics show how well the rig keeps
+ * in step.
+ *
+ * Hardware-triggered rigs can also match by driver sequence number. The
+ * sequence offset between streams is learned from the first set matched
+ * by timestamp. After that, sets are matched by sequence and the timestamp
+ * tolerance only checks them. A set that fails the check is dropped and
+ * the offsets are learned again.
+ *
+ * Typical use, fed from the multi-camera driver:
+ * @code
+ * static int on_frame(void* user_data, int camera, media_session_t* session, media_frame_t* frame)
+ * {
+ *     libmedia_sync_push(sync, camera, session, frame);
+ *     return 1;   // The synchronizer owns the frame now
+ * }
+ * @endcode
+ */
+
+#ifndef LIBMEDIA_SYNC_H
+#define LIBMEDIA_SYNC_H
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEDIA_SYNC_MAX_STREAMS 8        /**< Maximum streams per synchronizer */
+#define MEDIA_SYNC_MAX_PENDING 8        /**< Maximum frames held per stream */
+
+/**
+ * @struct media_sync
+ * @brief Frame synchronizer (opaque structure)
+ */
+typedef struct media_sync media_sync_t;
+
+/**
+ * @struct media_sync_set
+ * @brief Frames exposed together, one per stream
+ */
+typedef struct {
+    int count;                                          /**< Number of streams */
+    media_session_t* sessions[MEDIA_SYNC_MAX_STREAMS];  /**< Session of each frame */
+    media_frame_t frames[MEDIA_SYNC_MAX_STREAMS];       /**< Frame of each stream */
+    uint64_t skew_ns;                                   /**< Latest minus earliest timestamp */
+} media_sync_set_t;
+
+/**
+ * @brief Set callback, runs on the thread that completed the set
+ *
+ * Must not push into the same synchronizer.
+ * @param user_data User data from the configuration
+ * @param set Matched frames
+ * @return 0 to let the synchronizer release the frames, 1 if the callback
+ *         keeps them and will call libmedia_session_release_frame() on each
+ */
+typedef int (*media_sync_set_fn)(void* user_data, media_sync_set_t* set);
+
+/**
+ * @struct media_sync_config
+ * @brief Synchronizer configuration
+ */
+typedef struct {
+    int stream_count;           /**< Streams per set, 2..MEDIA_SYNC_MAX_STREAMS */
+    uint64_t tolerance_ns;      /**< Maximum timestamp spread within a set */
+    int max_pending;            /**< Frames held per stream, 0 for 2; keep below the session's buffer count */
+    int match_sequence;         /**< Match by learned sequence offsets once a set was found */
+    media_sync_set_fn on_set;   /**< Set callback */
+    void* user_data;            /**< Passed to the callback */
+} media_sync_config_t;
+
+/**
+ * @struct media_sync_stats
+ * @brief Synchronizer counters
+ */
+typedef struct {
+    uint64_t sets;                                  /**< Sets delivered */
+    uint64_t dropped[MEDIA_SYNC_MAX_STREAMS];       /**< Frames dropped per stream */
+    uint64_t skew_last_ns;                          /**< Skew of the last set */
+    uint64_t skew_max_ns;                           /**< Largest skew seen */
+    uint64_t skew_mean_ns;                          /**< Mean skew over all sets */
+    uint64_t resyncs;                               /**< Sequence offsets learned again */
+} media_sync_stats_t;
+
+/**
+ * @brief Create a synchronizer
+ * @param config Configuration
+ * @return Synchronizer on success, NULL on error
+ */
+media_sync_t* libmedia_sync_create(const media_sync_config_t* config);
+
+/**
+ * @brief Hand a captured frame to the synchronizer
+ *
+ * The synchronizer owns the frame from now on, also on error, and releases
+ * it to its session when the frame is dropped or its set was delivered.
+ * Thread-safe: each stream may be pushed from its own capture thread.
+ * @param sync Synchronizer
+ * @param stream Stream index, 0..stream_count-1
+ * @param session Session the frame came from
+ * @param frame Captured frame
+ * @return Number of sets delivered, negative on error
+ */
+int libmedia_sync_push(media_sync_t* sync, int stream, media_session_t* session,
+                       const media_frame_t* frame);
+
+/**
+ * @brief Release every held frame, e.g. before stopping the sessions
+ * @param sync Synchronizer
+ * @return 0 on success, negative on error
+ */
+int libmedia_sync_flush(media_sync_t* sync);
+
+/**
+ * @brief Read the counters
+ * @param sync Synchronizer
+ * @param stats Output counters
+ * @return 0 on success, negative on error
+ */
+int libmedia_sync_get_stats(media_sync_t* sync, media_sync_stats_t* stats);
+
+/**
+ * @brief Destroy a synchronizer, releasing held frames first
+ * @param sync Synchronizer
+ */
+void libmedia_sync_destroy(media_sync_t* sync);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBMEDIA_SYNC_H
@@ -12,6 +12,9 @@
 #define _GNU_SOURCE
 
 #include "media.h"
+#include "media_meta.h"
+#include "media_internal.h"
+#include "media_ring.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +27,10 @@
 #include <sys/time.h>
 #include <time.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <linux/videodev2.h>
 
 // ============================================================================
@@ -33,24 +40,7 @@
 #define MAX_DEVICES 16
 #define DEVICE_NAME_SIZE 256
 #define VERSION_STRING "1.0.0"
-
-// Debug output macros
-#define DEBUG_NONE 0
-#define DEBUG_ERROR 1
-#define DEBUG_WARNING 2
-#define DEBUG_INFO 3
-#define DEBUG_DEBUG 4
-
-#define MEDIA_DEBUG(level, fmt, ...) \
-    do { \
-        if (g_debug_level >= level) { \
-            fprintf(stderr, "[MEDIA %s] " fmt "\n", \
-                level == DEBUG_ERROR ? "ERROR" : \
-                level == DEBUG_WARNING ? "WARN" : \
-                level == DEBUG_INFO ? "INFO" : "DEBUG", \
-                ##__VA_ARGS__); \
-        } \
-    } while(0)
+#define MIN_STREAM_BUFFERS 2        /**< Fewest buffers a budget-limited request is shrunk to */
 
 // ============================================================================
 // Internal Data Structures
@@ -70,6 +60,9 @@ typedef struct {
     int streaming;                  /**< Streaming state */
     int use_multiplanar;            /**< Multi-planar mode */
     bool* buffer_queued;            /**< Track which buffers are currently queued */
+    size_t buffer_bytes;            /**< Buffer memory charged to the budget */
+    uint32_t buffer_generation;     /**< Identifies the current buffer set, 0 without buffers (atomic) */
+    media_meta_t* meta;             /**< Metadata block per buffer */
 } device_context_t;
 
 /**
@@ -89,8 +82,23 @@ struct media_session {
 static device_context_t g_devices[MAX_DEVICES];
 static int g_device_count = 0;
 static int g_initialized = 0;
-static media_error_t g_last_error = MEDIA_ERROR_NONE;
-static int g_debug_level = DEBUG_ERROR;
+static __thread media_error_t g_last_error = MEDIA_ERROR_NONE; // Per thread, pipeline stages report independently
+int g_media_debug_level = DEBUG_ERROR;
+
+// Memory budget, all accessed atomically
+static size_t g_mem_budget = 0;
+static size_t g_mem_used = 0;
+static size_t g_mem_peak = 0;
+static uint64_t g_mem_refused = 0;
+static uint64_t g_mem_downsized = 0;
+
+// Buffer sets allocated so far, gives every set a distinct generation
+static uint32_t g_buffer_generation = 0;
+
+// Thread policies per role, NULL entries inherit the creator's scheduling
+static pthread_mutex_t g_thread_policy_lock = PTHREAD_MUTEX_INITIALIZER;
+static media_thread_policy_t g_thread_policy[MEDIA_THREAD_ROLE_COUNT];
+static int g_thread_policy_set[MEDIA_THREAD_ROLE_COUNT];
 
 // Sub-device management
 #define MAX_SUBDEVICES 8
@@ -122,42 +130,20 @@ static int xioctl(int fd, int request, void* arg)
 /**
  * @brief Set last error code
  */
-static void set_last_error(media_error_t error)
+void media_set_last_error(media_error_t error)
 {
     g_last_error = error;
 }
 
+#define FORMAT_DESC(fmt, name, bits, bpp, planes, hs, vs, packed, bayer) \
+    { V4L2_PIX_FMT_##fmt, name, bits, bpp, planes, hs, vs, packed, MEDIA_BAYER_##bayer },
+
 /**
- * @brief Helper function to get pixel format name
+ * @brief Pixel formats known to the library
  */
-static const char* get_format_name_internal(uint32_t pixelformat)
-{
-    switch (pixelformat) {
-        case V4L2_PIX_FMT_YUYV: return "YUYV";
-        case V4L2_PIX_FMT_UYVY: return "UYVY";
-        case V4L2_PIX_FMT_YUV420: return "YU12";
-        case V4L2_PIX_FMT_YVU420: return "YV12";
-        case V4L2_PIX_FMT_NV12: return "NV12";
-        case V4L2_PIX_FMT_NV21: return "NV21";
-        case V4L2_PIX_FMT_RGB565: return "RGB565";
-        case V4L2_PIX_FMT_RGB24: return "RGB24";
-        case V4L2_PIX_FMT_BGR24: return "BGR24";
-        case V4L2_PIX_FMT_RGB32: return "RGB32";
-        case V4L2_PIX_FMT_BGR32: return "BGR32";
-        case V4L2_PIX_FMT_MJPEG: return "MJPEG";
-        case V4L2_PIX_FMT_JPEG: return "JPEG";
-        case V4L2_PIX_FMT_H264: return "H264";
-        case V4L2_PIX_FMT_SBGGR8: return "BGGR8";
-        case V4L2_PIX_FMT_SGBRG8: return "GBRG8";
-        case V4L2_PIX_FMT_SGRBG8: return "GRBG8";
-        case V4L2_PIX_FMT_SRGGB8: return "RGGB8";
-        case V4L2_PIX_FMT_SBGGR10: return "BG10";
-        case V4L2_PIX_FMT_SGBRG10: return "GB10";
-        case V4L2_PIX_FMT_SGRBG10: return "GR10";
-        case V4L2_PIX_FMT_SRGGB10: return "RG10";
-        default: return "UNKNOWN";
-    }
-}
+static const media_format_desc_t g_format_descs[] = {
+    MEDIA_FORMAT_LIST(FORMAT_DESC)
+};
 
 /**
  * @brief Find device context by handle
@@ -165,13 +151,13 @@ static const char* get_format_name_internal(uint32_t pixelformat)
 static device_context_t* find_device(int handle)
 {
     if (handle < 0 || handle >= g_device_count) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return NULL;
     }
     
     device_context_t* dev = &g_devices[handle];
     if (dev->fd < 0) {
-        set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
+        media_set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
         return NULL;
     }
     
@@ -184,13 +170,13 @@ static device_context_t* find_device(int handle)
 static subdev_context_t* find_subdev(int handle)
 {
     if (handle < 0 || handle >= g_subdev_count) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return NULL;
     }
     
     subdev_context_t* subdev = &g_subdevices[handle];
     if (subdev->fd < 0) {
-        set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
+        media_set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
         return NULL;
     }
     
@@ -207,6 +193,349 @@ uint64_t libmedia_get_timestamp_ns(void)
     return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
 
+// ============================================================================
+// Thread Policy
+// ============================================================================
+
+static int thread_policy_valid(const media_thread_policy_t* policy)
+{
+    switch (policy->policy) {
+        case SCHED_OTHER:
+            return policy->nice >= -20 && policy->nice <= 19;
+        case SCHED_FIFO:
+        case SCHED_RR:
+            return policy->priority >= sched_get_priority_min(policy->policy) &&
+                   policy->priority <= sched_get_priority_max(policy->policy);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Apply a policy to the calling thread
+ * @return 0 if fully applied, -1 if any part was refused
+ */
+static int thread_apply_policy(const media_thread_policy_t* policy)
+{
+    int result = 0;
+
+    if (policy->cpu_mask) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+            if (policy->cpu_mask & (1ULL << cpu)) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err) {
+            MEDIA_DEBUG(DEBUG_WARNING, "Failed to set CPU affinity 0x%llx: %s",
+                        (unsigned long long)policy->cpu_mask, strerror(err));
+            result = -1;
+        }
+    }
+
+    struct sched_param param = { .sched_priority = policy->policy == SCHED_OTHER ? 0 : policy->priority };
+    int err = pthread_setschedparam(pthread_self(), policy->policy, &param);
+    if (err) {
+        MEDIA_DEBUG(DEBUG_WARNING, "Failed to set scheduling policy %d priority %d: %s",
+                    policy->policy, policy->priority, strerror(err));
+        result = -1;
+    }
+
+    // Linux keeps nice values per thread
+    if (policy->policy == SCHED_OTHER &&
+        setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), policy->nice) < 0) {
+        MEDIA_DEBUG(DEBUG_WARNING, "Failed to set nice %d: %s", policy->nice, strerror(errno));
+        result = -1;
+    }
+    return result;
+}
+
+/**
+ * @brief Look up the policy of a role
+ * @return 1 if the role has a policy
+ */
+static int thread_get_policy(media_thread_role_t role, media_thread_policy_t* policy)
+{
+    pthread_mutex_lock(&g_thread_policy_lock);
+    int set = g_thread_policy_set[role];
+    *policy = g_thread_policy[role];
+    pthread_mutex_unlock(&g_thread_policy_lock);
+    return set;
+}
+
+int libmedia_set_thread_policy(media_thread_role_t role, const media_thread_policy_t* policy)
+{
+    if (role < 0 || role >= MEDIA_THREAD_ROLE_COUNT || (policy && !thread_policy_valid(policy))) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_thread_policy_lock);
+    g_thread_policy_set[role] = policy != NULL;
+    if (policy) {
+        g_thread_policy[role] = *policy;
+    } else {
+        memset(&g_thread_policy[role], 0, sizeof(g_thread_policy[role]));
+    }
+    pthread_mutex_unlock(&g_thread_policy_lock);
+    return 0;
+}
+
+int libmedia_get_thread_policy(media_thread_role_t role, media_thread_policy_t* policy)
+{
+    if (role < 0 || role >= MEDIA_THREAD_ROLE_COUNT || !policy) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (!thread_get_policy(role, policy)) {
+        // Report what a new thread inherits
+        struct sched_param param;
+        pthread_getschedparam(pthread_self(), &policy->policy, &param);
+        policy->priority = param.sched_priority;
+        policy->nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+        policy->cpu_mask = 0;
+    }
+    return 0;
+}
+
+int libmedia_set_thread_preset(media_thread_preset_t preset)
+{
+    media_thread_policy_t policies[MEDIA_THREAD_ROLE_COUNT];
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    int cpus = online < 1 ? 1 : online > 64 ? 64 : (int)online;
+    uint64_t all = cpus == 64 ? ~0ULL : (1ULL << cpus) - 1;
+    uint64_t last = 1ULL << (cpus - 1);
+
+    memset(policies, 0, sizeof(policies));
+    switch (preset) {
+        case MEDIA_THREAD_PRESET_DEFAULT:
+            for (int role = 0; role < MEDIA_THREAD_ROLE_COUNT; role++) {
+                libmedia_set_thread_policy(role, NULL);
+            }
+            return 0;
+        case MEDIA_THREAD_PRESET_LATENCY:
+            // Capture owns the last core; everything else stays off it. With a single
+            // CPU a busy real-time stage would starve capture, so stages stay normal there
+            policies[MEDIA_THREAD_CAPTURE] = (media_thread_policy_t){ SCHED_FIFO, 50, 0, cpus > 1 ? last : 0 };
+            policies[MEDIA_THREAD_STAGE] = cpus > 1 ? (media_thread_policy_t){ SCHED_FIFO, 40, 0, all & ~last }
+                                                    : (media_thread_policy_t){ SCHED_OTHER, 0, 0, 0 };
+            policies[MEDIA_THREAD_HELPER] = (media_thread_policy_t){ SCHED_OTHER, 0, 0, cpus > 1 ? all & ~last : 0 };
+            break;
+        case MEDIA_THREAD_PRESET_THROUGHPUT:
+            policies[MEDIA_THREAD_CAPTURE] = (media_thread_policy_t){ SCHED_OTHER, 0, -5, 0 };
+            policies[MEDIA_THREAD_STAGE] = (media_thread_policy_t){ SCHED_OTHER, 0, 0, 0 };
+            policies[MEDIA_THREAD_HELPER] = (media_thread_policy_t){ SCHED_OTHER, 0, 0, 0 };
+            break;
+        case MEDIA_THREAD_PRESET_BACKGROUND:
+            policies[MEDIA_THREAD_CAPTURE] = (media_thread_policy_t){ SCHED_OTHER, 0, 5, 0 };
+            policies[MEDIA_THREAD_STAGE] = (media_thread_policy_t){ SCHED_OTHER, 0, 10, 0 };
+            policies[MEDIA_THREAD_HELPER] = (media_thread_policy_t){ SCHED_OTHER, 0, 15, 0 };
+            break;
+        default:
+            media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+            return -1;
+    }
+
+    for (int role = 0; role < MEDIA_THREAD_ROLE_COUNT; role++) {
+        libmedia_set_thread_policy(role, &policies[role]);
+    }
+    return 0;
+}
+
+int libmedia_apply_thread_policy(media_thread_role_t role)
+{
+    if (role < 0 || role >= MEDIA_THREAD_ROLE_COUNT) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    media_thread_policy_t policy;
+    if (thread_get_policy(role, &policy) && thread_apply_policy(&policy) < 0) {
+        media_set_last_error(MEDIA_ERROR_NOT_SUPPORTED);
+        return -1;
+    }
+    return 0;
+}
+
+int libmedia_lock_memory(int lock)
+{
+    if ((lock ? mlockall(MCL_CURRENT | MCL_FUTURE) : munlockall()) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "%s failed: %s", lock ? "mlockall" : "munlockall", strerror(errno));
+        media_set_last_error(MEDIA_ERROR_NOT_SUPPORTED);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @struct thread_start
+ * @brief Start parameters handed from media_thread_create() to the new thread
+ */
+typedef struct {
+    void* (*fn)(void*);                 /**< Thread body */
+    void* arg;                          /**< Thread body argument */
+    media_thread_policy_t policy;       /**< Policy to apply */
+    int has_policy;                     /**< Policy is set */
+    char name[16];                      /**< Thread name */
+} thread_start_t;
+
+static void* thread_start_main(void* arg)
+{
+    thread_start_t start = *(thread_start_t*)arg;
+    free(arg);
+
+    pthread_setname_np(pthread_self(), start.name);
+    if (start.has_policy) {
+        thread_apply_policy(&start.policy);
+    }
+    return start.fn(start.arg);
+}
+
+int media_thread_create(pthread_t* thread, media_thread_role_t role, const char* name,
+                        void* (*fn)(void*), void* arg)
+{
+    thread_start_t* start = malloc(sizeof(thread_start_t));
+    if (!start) {
+        return ENOMEM;
+    }
+
+    start->fn = fn;
+    start->arg = arg;
+    start->has_policy = thread_get_policy(role, &start->policy);
+    snprintf(start->name, sizeof(start->name), "%s", name ? name : "media");
+
+    int err = pthread_create(thread, NULL, thread_start_main, start);
+    if (err) {
+        free(start);
+    }
+    return err;
+}
+
+// ============================================================================
+// Internal Thread Helpers
+// ============================================================================
+
+/**
+ * @struct parallel_job
+ * @brief Work shared by all threads of one media_parallel_for() call
+ */
+typedef struct {
+    void (*fn)(void* ctx, int index);   /**< Work item callback */
+    void* ctx;                          /**< Callback context */
+    int count;                          /**< Number of work items */
+    int next;                           /**< Next unclaimed item (atomic) */
+} parallel_job_t;
+
+struct media_workers {
+    pthread_t threads[MEDIA_MAX_PARALLEL_THREADS];
+    int count;                          /**< Helper threads running */
+    media_event_t start;                /**< Signalled when a job is posted or on stop */
+    media_event_t done;                 /**< Signalled when the last helper leaves a job */
+    parallel_job_t* job;                /**< Current job, published by generation */
+    uint32_t generation;                /**< Jobs posted so far (atomic) */
+    int active;                         /**< Helpers still in the current job (atomic) */
+    int stop;                           /**< Helpers should exit (atomic) */
+};
+
+static void parallel_run(parallel_job_t* job)
+{
+    int index;
+    while ((index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count) {
+        job->fn(job->ctx, index);
+    }
+}
+
+static void* parallel_worker(void* arg)
+{
+    media_workers_t* workers = arg;
+    uint32_t seen = 0;
+
+    for (;;) {
+        // Re-check after announcing the wait so a concurrent post or stop cannot be missed
+        uint32_t key = media_event_prepare(&workers->start);
+        if (__atomic_load_n(&workers->stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        uint32_t generation = __atomic_load_n(&workers->generation, __ATOMIC_ACQUIRE);
+        if (generation == seen) {
+            media_event_wait(&workers->start, key, -1);
+            continue;
+        }
+
+        // The poster waits for every helper, so no job can be skipped
+        seen = generation;
+        parallel_run(workers->job);
+        if (__atomic_sub_fetch(&workers->active, 1, __ATOMIC_ACQ_REL) == 0) {
+            media_event_signal(&workers->done);
+        }
+    }
+    return NULL;
+}
+
+media_workers_t* media_workers_create(int threads)
+{
+    media_workers_t* workers = calloc(1, sizeof(media_workers_t));
+    if (!workers) {
+        return NULL;
+    }
+
+    if (threads > MEDIA_MAX_PARALLEL_THREADS) {
+        threads = MEDIA_MAX_PARALLEL_THREADS;
+    }
+    for (int i = 1; i < threads; i++) {
+        if (media_thread_create(&workers->threads[workers->count], MEDIA_THREAD_HELPER, "media-helper",
+                                parallel_worker, workers) != 0) {
+            MEDIA_DEBUG(DEBUG_WARNING, "Failed to start helper thread, continuing with %d", workers->count + 1);
+            break;
+        }
+        workers->count++;
+    }
+    return workers;
+}
+
+void media_workers_destroy(media_workers_t* workers)
+{
+    if (!workers) {
+        return;
+    }
+
+    __atomic_store_n(&workers->stop, 1, __ATOMIC_RELEASE);
+    media_event_signal(&workers->start);
+    for (int i = 0; i < workers->count; i++) {
+        pthread_join(workers->threads[i], NULL);
+    }
+    free(workers);
+}
+
+int media_parallel_for(media_workers_t* workers, int count, void (*fn)(void* ctx, int index), void* ctx)
+{
+    parallel_job_t job = { fn, ctx, count, 0 };
+
+    if (!workers || workers->count == 0 || count <= 1) {
+        parallel_run(&job);
+        return 0;
+    }
+
+    workers->job = &job;
+    __atomic_store_n(&workers->active, workers->count, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&workers->generation, 1, __ATOMIC_RELEASE);
+    media_event_signal(&workers->start);
+
+    parallel_run(&job);
+
+    // job lives on this stack, so every helper must have left it
+    while (__atomic_load_n(&workers->active, __ATOMIC_ACQUIRE) != 0) {
+        uint32_t key = media_event_prepare(&workers->done);
+        if (__atomic_load_n(&workers->active, __ATOMIC_ACQUIRE) == 0) {
+            break;
+        }
+        media_event_wait(&workers->done, key, -1);
+    }
+    return 0;
+}
+
 // ============================================================================
 // Library Management Functions
 // ============================================================================
@@ -254,7 +583,7 @@ void libmedia_deinit(void)
 
 void libmedia_set_debug_level(int level)
 {
-    g_debug_level = level;
+    g_media_debug_level = level;
 }
 
 // ============================================================================
@@ -268,12 +597,12 @@ int libmedia_open_device(const char* device_path)
     }
     
     if (!device_path) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
     if (g_device_count >= MAX_DEVICES) {
-        set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
         return -1;
     }
     
@@ -281,7 +610,7 @@ int libmedia_open_device(const char* device_path)
     int fd = open(device_path, O_RDWR | O_NONBLOCK);
     if (fd == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "Failed to open device %s: %s", device_path, strerror(errno));
-        set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
+        media_set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
         return -1;
     }
     
@@ -293,6 +622,8 @@ int libmedia_open_device(const char* device_path)
     dev->buffer_count = 0;
     dev->buffers = NULL;
     dev->buffer_queued = NULL;
+    dev->meta = NULL;
+    dev->buffer_generation = 0;
     dev->streaming = 0;
     dev->use_multiplanar = 0;
     
@@ -335,14 +666,14 @@ int libmedia_get_device_info(int handle, media_device_info_t* info)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !info) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
     struct v4l2_capability cap = {0};
     if (xioctl(dev->fd, VIDIOC_QUERYCAP, &cap) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYCAP failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
         return -1;
     }
     
@@ -389,7 +720,7 @@ int libmedia_check_device_caps(int handle)
     struct v4l2_capability cap = {0};
     if (xioctl(dev->fd, VIDIOC_QUERYCAP, &cap) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYCAP failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
         return -1;
     }
     
@@ -398,13 +729,13 @@ int libmedia_check_device_caps(int handle)
     
     if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE_MPLANE)) {
         MEDIA_DEBUG(DEBUG_ERROR, "Device does not support multiplanar video capture");
-        set_last_error(MEDIA_ERROR_NOT_SUPPORTED);
+        media_set_last_error(MEDIA_ERROR_NOT_SUPPORTED);
         return -1;
     }
     
     if (!(cap.capabilities & V4L2_CAP_STREAMING)) {
         MEDIA_DEBUG(DEBUG_ERROR, "Device does not support streaming");
-        set_last_error(MEDIA_ERROR_NOT_SUPPORTED);
+        media_set_last_error(MEDIA_ERROR_NOT_SUPPORTED);
         return -1;
     }
     
@@ -420,7 +751,7 @@ int libmedia_set_format(int handle, media_format_t* format)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !format) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -433,7 +764,7 @@ int libmedia_set_format(int handle, media_format_t* format)
     
     if (xioctl(dev->fd, VIDIOC_S_FMT, &fmt) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_S_FMT failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+        media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
         return -1;
     }
     
@@ -459,7 +790,7 @@ int libmedia_set_format_mp(int handle, media_format_t* format)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !format) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -472,7 +803,7 @@ int libmedia_set_format_mp(int handle, media_format_t* format)
     
     if (xioctl(dev->fd, VIDIOC_S_FMT, &fmt) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_S_FMT (MP) failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+        media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
         return -1;
     }
     
@@ -492,7 +823,7 @@ int libmedia_set_format_mp(int handle, media_format_t* format)
     dev->use_multiplanar = 1;
     
     MEDIA_DEBUG(DEBUG_INFO, "Set MP format: %dx%d, %s, %d planes", 
-                format->width, format->height, get_format_name_internal(format->pixelformat), format->num_planes);
+                format->width, format->height, libmedia_get_format_name(format->pixelformat), format->num_planes);
     
     return 0;
 }
@@ -501,7 +832,7 @@ int libmedia_get_format(int handle, media_format_t* format)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !format) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -514,15 +845,206 @@ int libmedia_get_format_mp(int handle, media_format_t* format)
     return libmedia_get_format(handle, format);
 }
 
+// ============================================================================
+// Memory Budget
+// ============================================================================
+
+int media_budget_charge(size_t bytes)
+{
+    size_t used = __atomic_load_n(&g_mem_used, __ATOMIC_RELAXED);
+    size_t next;
+    do {
+        size_t budget = __atomic_load_n(&g_mem_budget, __ATOMIC_RELAXED);
+        next = used + bytes;
+        if (next < used || (budget && next > budget)) {
+            __atomic_fetch_add(&g_mem_refused, 1, __ATOMIC_RELAXED);
+            MEDIA_DEBUG(DEBUG_WARNING, "Memory budget exceeded: %zu bytes requested, %zu of %zu in use",
+                        bytes, used, budget);
+            media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&g_mem_used, &used, next, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    size_t peak = __atomic_load_n(&g_mem_peak, __ATOMIC_RELAXED);
+    while (next > peak && !__atomic_compare_exchange_n(&g_mem_peak, &peak, next, 1,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return 0;
+}
+
+void media_budget_release(size_t bytes)
+{
+    __atomic_fetch_sub(&g_mem_used, bytes, __ATOMIC_RELAXED);
+}
+
+int libmedia_set_memory_budget(size_t bytes)
+{
+    if (bytes && bytes < __atomic_load_n(&g_mem_used, __ATOMIC_RELAXED)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    __atomic_store_n(&g_mem_budget, bytes, __ATOMIC_RELAXED);
+    MEDIA_DEBUG(DEBUG_INFO, "Memory budget set to %zu bytes", bytes);
+    return 0;
+}
+
+int libmedia_get_memory_stats(media_memory_stats_t* stats)
+{
+    if (!stats) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    stats->budget = __atomic_load_n(&g_mem_budget, __ATOMIC_RELAXED);
+    stats->used = __atomic_load_n(&g_mem_used, __ATOMIC_RELAXED);
+    stats->peak = __atomic_load_n(&g_mem_peak, __ATOMIC_RELAXED);
+    stats->refused = __atomic_load_n(&g_mem_refused, __ATOMIC_RELAXED);
+    stats->downsized = __atomic_load_n(&g_mem_downsized, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void libmedia_reset_memory_peak(void)
+{
+    __atomic_store_n(&g_mem_peak, __atomic_load_n(&g_mem_used, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Size of one buffer of a granted request, all planes included
+ */
+static size_t query_buffer_bytes(device_context_t* dev, uint32_t type)
+{
+    struct v4l2_buffer buf = {0};
+    struct v4l2_plane planes[VIDEO_MAX_PLANES] = {0};
+
+    buf.type = type;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = 0;
+    if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        buf.m.planes = planes;
+        buf.length = VIDEO_MAX_PLANES;
+    }
+    if (xioctl(dev->fd, VIDIOC_QUERYBUF, &buf) == -1) {
+        return 0;
+    }
+    if (type != V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+        return buf.length;
+    }
+
+    size_t bytes = 0;
+    for (uint32_t p = 0; p < buf.length; p++) {
+        bytes += planes[p].length;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Return a device's buffer charge to the budget
+ */
+static void device_release_budget(device_context_t* dev)
+{
+    media_budget_release(dev->buffer_bytes);
+    dev->buffer_bytes = 0;
+}
+
+/**
+ * @brief Shrink a granted buffer request to the memory budget and charge it
+ *
+ * Replaces the charge of any earlier request, whose buffers the granted
+ * one has freed. On failure the driver buffers are released again.
+ * @return 0 on success, -1 on error
+ */
+static int request_fit_budget(device_context_t* dev, struct v4l2_requestbuffers* reqbuf)
+{
+    // A granted VIDIOC_REQBUFS has already dropped the previous buffers
+    device_release_budget(dev);
+
+    uint32_t requested = reqbuf->count;
+    size_t per_buffer = query_buffer_bytes(dev, reqbuf->type);
+    if (per_buffer == 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYBUF failed: %s", strerror(errno));
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        goto release;
+    }
+
+    size_t budget = __atomic_load_n(&g_mem_budget, __ATOMIC_RELAXED);
+    size_t used = __atomic_load_n(&g_mem_used, __ATOMIC_RELAXED);
+    if (budget) {
+        size_t fit = budget > used ? (budget - used) / per_buffer : 0;
+        if (fit < reqbuf->count && fit >= MIN_STREAM_BUFFERS) {
+            reqbuf->count = (uint32_t)fit;
+            if (xioctl(dev->fd, VIDIOC_REQBUFS, reqbuf) == -1) {
+                MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_REQBUFS failed: %s", strerror(errno));
+                media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+                goto release;
+            }
+            __atomic_fetch_add(&g_mem_downsized, 1, __ATOMIC_RELAXED);
+            MEDIA_DEBUG(DEBUG_WARNING, "Memory budget: %u of %u buffers granted", reqbuf->count, requested);
+        }
+    }
+
+    // The driver may still insist on more buffers than fit; the charge then refuses them
+    if (media_budget_charge(per_buffer * reqbuf->count) < 0) {
+        goto release;
+    }
+    dev->buffer_bytes = per_buffer * reqbuf->count;
+    return 0;
+
+release:
+    reqbuf->count = 0;
+    xioctl(dev->fd, VIDIOC_REQBUFS, reqbuf);
+    return -1;
+}
+
 // ============================================================================
 // Buffer Management Functions
 // ============================================================================
 
+/**
+ * @brief Allocate one metadata block per buffer; frames carry none if this fails
+ */
+static void device_alloc_meta(device_context_t* dev)
+{
+    free(dev->meta);
+    dev->meta = calloc(dev->buffer_count, sizeof(media_meta_t));
+    if (!dev->meta) {
+        MEDIA_DEBUG(DEBUG_WARNING, "Failed to allocate frame metadata");
+    }
+}
+
+/**
+ * @brief Give a newly allocated buffer set a generation no earlier set had
+ */
+static void device_new_generation(device_context_t* dev)
+{
+    uint32_t generation = __atomic_add_fetch(&g_buffer_generation, 1, __ATOMIC_RELAXED);
+    if (generation == 0) {
+        generation = __atomic_add_fetch(&g_buffer_generation, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&dev->buffer_generation, generation, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Reset a dequeued buffer's metadata to what capture knows
+ */
+static media_meta_t* device_frame_meta(device_context_t* dev, const media_buffer_t* buffer)
+{
+    if (!dev->meta) {
+        return NULL;
+    }
+
+    media_meta_t* meta = &dev->meta[buffer->index];
+    libmedia_meta_clear(meta);
+    libmedia_meta_set(meta, MEDIA_META_SEQUENCE, buffer->sequence);
+    libmedia_meta_set(meta, MEDIA_META_TIMESTAMP_NS, buffer->timestamp);
+    libmedia_meta_set(meta, MEDIA_META_DEQUEUE_NS, libmedia_get_timestamp_ns());
+    return meta;
+}
+
 int libmedia_request_buffers(int handle, int count, media_buffer_t* buffers)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || count <= 0 || !buffers) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -533,7 +1055,10 @@ int libmedia_request_buffers(int handle, int count, media_buffer_t* buffers)
     
     if (xioctl(dev->fd, VIDIOC_REQBUFS, &reqbuf) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_REQBUFS failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+    if (request_fit_budget(dev, &reqbuf) < 0) {
         return -1;
     }
     
@@ -546,14 +1071,16 @@ int libmedia_request_buffers(int handle, int count, media_buffer_t* buffers)
         
         if (xioctl(dev->fd, VIDIOC_QUERYBUF, &buf) == -1) {
             MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYBUF failed for buffer %d: %s", i, strerror(errno));
-            set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+            media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+            device_release_budget(dev);
             return -1;
         }
         
         buffers[i].start[0] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, dev->fd, buf.m.offset);
         if (buffers[i].start[0] == MAP_FAILED) {
             MEDIA_DEBUG(DEBUG_ERROR, "mmap failed for buffer %d: %s", i, strerror(errno));
-            set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            device_release_budget(dev);
             return -1;
         }
         
@@ -564,6 +1091,8 @@ int libmedia_request_buffers(int handle, int count, media_buffer_t* buffers)
     
     dev->buffers = buffers;
     dev->buffer_count = reqbuf.count;
+    device_alloc_meta(dev);
+    device_new_generation(dev);
     
     MEDIA_DEBUG(DEBUG_INFO, "Allocated %d buffers", reqbuf.count);
     return reqbuf.count;
@@ -573,7 +1102,7 @@ int libmedia_request_buffers_mp(int handle, int count, media_buffer_t* buffers)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || count <= 0 || !buffers) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -584,7 +1113,10 @@ int libmedia_request_buffers_mp(int handle, int count, media_buffer_t* buffers)
     
     if (xioctl(dev->fd, VIDIOC_REQBUFS, &reqbuf) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_REQBUFS (MP) failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+    if (request_fit_budget(dev, &reqbuf) < 0) {
         return -1;
     }
     
@@ -601,7 +1133,8 @@ int libmedia_request_buffers_mp(int handle, int count, media_buffer_t* buffers)
         
         if (xioctl(dev->fd, VIDIOC_QUERYBUF, &buf) == -1) {
             MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYBUF (MP) failed for buffer %d: %s", i, strerror(errno));
-            set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+            media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+            device_release_budget(dev);
             return -1;
         }
         
@@ -613,7 +1146,8 @@ int libmedia_request_buffers_mp(int handle, int count, media_buffer_t* buffers)
                                      MAP_SHARED, dev->fd, buf.m.planes[p].m.mem_offset);
             if (buffers[i].start[p] == MAP_FAILED) {
                 MEDIA_DEBUG(DEBUG_ERROR, "mmap failed for buffer %d plane %d: %s", i, p, strerror(errno));
-                set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+                media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+                device_release_budget(dev);
                 return -1;
             }
             buffers[i].length[p] = buf.m.planes[p].length;
@@ -624,8 +1158,11 @@ int libmedia_request_buffers_mp(int handle, int count, media_buffer_t* buffers)
     
     dev->buffers = buffers;
     dev->buffer_count = reqbuf.count;
+    device_alloc_meta(dev);
+    device_new_generation(dev);
     
-    // 分配缓冲区状态跟踪数组
+    // 分配缓冲区状态跟踪数组（重复申请时替换旧数组）
+    free(dev->buffer_queued);
     dev->buffer_queued = calloc(reqbuf.count, sizeof(bool));
     if (!dev->buffer_queued) {
         MEDIA_DEBUG(DEBUG_ERROR, "Failed to allocate buffer tracking array");
@@ -640,7 +1177,7 @@ int libmedia_free_buffers(int handle, media_buffer_t* buffers, int count)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !buffers || count <= 0) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -659,19 +1196,54 @@ int libmedia_free_buffers(int handle, media_buffer_t* buffers, int count)
         free(dev->buffer_queued);
         dev->buffer_queued = NULL;
     }
+    free(dev->meta);
+    dev->meta = NULL;
     
     dev->buffers = NULL;
     dev->buffer_count = 0;
+    __atomic_store_n(&dev->buffer_generation, 0, __ATOMIC_RELEASE);
+    device_release_budget(dev);
     
     MEDIA_DEBUG(DEBUG_INFO, "Freed %d buffers", count);
     return 0;
 }
 
+uint32_t media_device_buffer_generation(int handle)
+{
+    if (handle < 0 || handle >= g_device_count || g_devices[handle].fd < 0) {
+        return 0;
+    }
+    return __atomic_load_n(&g_devices[handle].buffer_generation, __ATOMIC_ACQUIRE);
+}
+
+int libmedia_export_buffer(int handle, int index)
+{
+    device_context_t* dev = find_device(handle);
+    if (!dev || index < 0 || index >= dev->buffer_count) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    struct v4l2_exportbuffer expbuf;
+    memset(&expbuf, 0, sizeof(expbuf));
+    expbuf.type = dev->use_multiplanar ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE : V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    expbuf.index = index;
+    expbuf.plane = 0;
+    expbuf.flags = O_RDONLY | O_CLOEXEC;
+
+    if (xioctl(dev->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_EXPBUF failed for buffer %d: %s", index, strerror(errno));
+        media_set_last_error(errno == ENOTTY || errno == EINVAL ? MEDIA_ERROR_NOT_SUPPORTED : MEDIA_ERROR_IOCTL_FAILED);
+        return -1;
+    }
+    return expbuf.fd;
+}
+
 int libmedia_queue_buffer(int handle, int index)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || index < 0 || index >= dev->buffer_count) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -682,7 +1254,7 @@ int libmedia_queue_buffer(int handle, int index)
     
     if (xioctl(dev->fd, VIDIOC_QBUF, &buf) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QBUF failed for buffer %d: %s", index, strerror(errno));
-        set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
         return -1;
     }
     
@@ -693,7 +1265,7 @@ int libmedia_queue_buffer_mp(int handle, int index)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || index < 0 || index >= dev->buffer_count) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -715,7 +1287,7 @@ int libmedia_queue_buffer_mp(int handle, int index)
     
     if (xioctl(dev->fd, VIDIOC_QUERYBUF, &querybuf) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYBUF failed for buffer %d: %s", index, strerror(errno));
-        set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
         return -1;
     }
     
@@ -761,7 +1333,7 @@ int libmedia_queue_buffer_mp(int handle, int index)
             return 0;  // 假设成功，因为缓冲区已经在队列中
         }
         
-        set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
         return -1;
     }
     
@@ -777,7 +1349,7 @@ int libmedia_dequeue_buffer(int handle, media_buffer_t* buffer)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !buffer) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -787,17 +1359,17 @@ int libmedia_dequeue_buffer(int handle, media_buffer_t* buffer)
     
     if (xioctl(dev->fd, VIDIOC_DQBUF, &buf) == -1) {
         if (errno == EAGAIN) {
-            set_last_error(MEDIA_ERROR_TIMEOUT);
+            media_set_last_error(MEDIA_ERROR_TIMEOUT);
         } else {
             MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_DQBUF failed: %s", strerror(errno));
-            set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+            media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
         }
         return -1;
     }
     
     if ((uint32_t)buf.index >= (uint32_t)dev->buffer_count) {
         MEDIA_DEBUG(DEBUG_ERROR, "Invalid buffer index %d", buf.index);
-        set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
         return -1;
     }
     
@@ -805,6 +1377,7 @@ int libmedia_dequeue_buffer(int handle, media_buffer_t* buffer)
     buffer->bytes_used = buf.bytesused;
     buffer->timestamp = (uint64_t)buf.timestamp.tv_sec * 1000000000ULL + 
                        (uint64_t)buf.timestamp.tv_usec * 1000ULL;
+    buffer->sequence = buf.sequence;
     
     return 0;
 }
@@ -813,7 +1386,7 @@ int libmedia_dequeue_buffer_mp(int handle, media_buffer_t* buffer)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !buffer) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -827,17 +1400,17 @@ int libmedia_dequeue_buffer_mp(int handle, media_buffer_t* buffer)
     
     if (xioctl(dev->fd, VIDIOC_DQBUF, &buf) == -1) {
         if (errno == EAGAIN) {
-            set_last_error(MEDIA_ERROR_TIMEOUT);
+            media_set_last_error(MEDIA_ERROR_TIMEOUT);
         } else {
             MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_DQBUF (MP) failed: %s", strerror(errno));
-            set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+            media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
         }
         return -1;
     }
     
     if ((uint32_t)buf.index >= (uint32_t)dev->buffer_count) {
         MEDIA_DEBUG(DEBUG_ERROR, "Invalid buffer index %d", buf.index);
-        set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
         return -1;
     }
     
@@ -845,6 +1418,7 @@ int libmedia_dequeue_buffer_mp(int handle, media_buffer_t* buffer)
     buffer->bytes_used = buf.m.planes[0].bytesused;
     buffer->timestamp = (uint64_t)buf.timestamp.tv_sec * 1000000000ULL + 
                        (uint64_t)buf.timestamp.tv_usec * 1000ULL;
+    buffer->sequence = buf.sequence;
     
     // 标记缓冲区为未队列状态
     if (dev->buffer_queued) {
@@ -871,7 +1445,7 @@ int libmedia_start_streaming(int handle)
     
     if (xioctl(dev->fd, VIDIOC_STREAMON, &type) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_STREAMON failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+        media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
         return -1;
     }
     
@@ -891,7 +1465,7 @@ int libmedia_start_streaming_mp(int handle)
     
     if (xioctl(dev->fd, VIDIOC_STREAMON, &type) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_STREAMON (MP) failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+        media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
         return -1;
     }
     
@@ -911,7 +1485,7 @@ int libmedia_stop_streaming(int handle)
     
     if (xioctl(dev->fd, VIDIOC_STREAMOFF, &type) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_STREAMOFF failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+        media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
         return -1;
     }
     
@@ -931,7 +1505,7 @@ int libmedia_stop_streaming_mp(int handle)
     
     if (xioctl(dev->fd, VIDIOC_STREAMOFF, &type) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_STREAMOFF (MP) failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+        media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
         return -1;
     }
     
@@ -968,16 +1542,16 @@ int libmedia_wait_for_frame(int handle, int timeout_ms)
     
     if (result == -1) {
         if (errno == EINTR) {
-            set_last_error(MEDIA_ERROR_TIMEOUT);
+            media_set_last_error(MEDIA_ERROR_TIMEOUT);
             return 0;
         }
         MEDIA_DEBUG(DEBUG_ERROR, "select failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
         return -1;
     }
     
     if (result == 0) {
-        set_last_error(MEDIA_ERROR_TIMEOUT);
+        media_set_last_error(MEDIA_ERROR_TIMEOUT);
         return 0;
     }
     
@@ -988,7 +1562,7 @@ int libmedia_capture_frame(int handle, media_frame_t* frame, int timeout_ms)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !frame) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1014,6 +1588,8 @@ int libmedia_capture_frame(int handle, media_frame_t* frame, int timeout_ms)
     frame->pixelformat = dev->format.pixelformat;
     frame->timestamp = buffer.timestamp;
     frame->frame_id = buffer.index;  // Use buffer index as frame ID
+    frame->sequence = buffer.sequence;
+    frame->meta = device_frame_meta(dev, &buffer);
     
     return 0;
 }
@@ -1022,7 +1598,7 @@ int libmedia_capture_frame_mp(int handle, media_frame_t* frame, int timeout_ms)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !frame) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1048,6 +1624,8 @@ int libmedia_capture_frame_mp(int handle, media_frame_t* frame, int timeout_ms)
     frame->pixelformat = dev->format.pixelformat;
     frame->timestamp = buffer.timestamp;
     frame->frame_id = buffer.index;  // Use buffer index as frame ID
+    frame->sequence = buffer.sequence;
+    frame->meta = device_frame_meta(dev, &buffer);
     
     return 0;
 }
@@ -1056,7 +1634,7 @@ int libmedia_release_frame(int handle, media_frame_t* frame)
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !frame) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1077,13 +1655,13 @@ int libmedia_release_frame(int handle, media_frame_t* frame)
 media_session_t* libmedia_create_session(const media_session_config_t* config)
 {
     if (!config || !config->device_path) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return NULL;
     }
     
     media_session_t* session = malloc(sizeof(media_session_t));
     if (!session) {
-        set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
         return NULL;
     }
     
@@ -1120,7 +1698,7 @@ media_session_t* libmedia_create_session(const media_session_config_t* config)
     if (!buffers) {
         libmedia_close_device(handle);
         free(session);
-        set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
         return NULL;
     }
     
@@ -1145,7 +1723,7 @@ media_session_t* libmedia_create_session(const media_session_config_t* config)
 int libmedia_start_session(media_session_t* session)
 {
     if (!session || !session->device) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1184,7 +1762,7 @@ int libmedia_start_session(media_session_t* session)
 int libmedia_stop_session(media_session_t* session)
 {
     if (!session || !session->device) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1204,12 +1782,12 @@ int libmedia_stop_session(media_session_t* session)
 int libmedia_session_capture_frame(media_session_t* session, media_frame_t* frame, int timeout_ms)
 {
     if (!session || !session->device || !frame) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
     if (!session->active) {
-        set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+        media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
         return -1;
     }
     
@@ -1225,7 +1803,7 @@ int libmedia_session_capture_frame(media_session_t* session, media_frame_t* fram
 int libmedia_session_release_frame(media_session_t* session, media_frame_t* frame)
 {
     if (!session || !session->device || !frame) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1256,13 +1834,37 @@ void libmedia_destroy_session(media_session_t* session)
 int libmedia_session_get_device_handle(media_session_t* session)
 {
     if (!session || !session->device) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
     return session->device - g_devices;
 }
 
+int libmedia_session_get_fd(media_session_t* session)
+{
+    if (!session || !session->device) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    return session->device->fd;
+}
+
+int libmedia_session_try_capture(media_session_t* session, media_frame_t* frame)
+{
+    if (!frame) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    // Devices are opened O_NONBLOCK, so a zero timeout is a single DQBUF
+    frame->data = NULL;
+    if (libmedia_session_capture_frame(session, frame, 0) < 0) {
+        return libmedia_get_last_error() == MEDIA_ERROR_TIMEOUT ? 0 : -1;
+    }
+    return 1;
+}
+
 // ============================================================================
 // Camera Control Interface Implementation
 // ============================================================================
@@ -1274,12 +1876,12 @@ int libmedia_open_subdev(const char* subdev_path)
     }
     
     if (!subdev_path) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
     if (g_subdev_count >= MAX_SUBDEVICES) {
-        set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
         return -1;
     }
     
@@ -1287,7 +1889,7 @@ int libmedia_open_subdev(const char* subdev_path)
     int fd = open(subdev_path, O_RDWR);
     if (fd == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "Failed to open sub-device %s: %s", subdev_path, strerror(errno));
-        set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
+        media_set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
         return -1;
     }
     
@@ -1321,7 +1923,7 @@ int libmedia_get_control(int subdev_handle, uint32_t control_id, int32_t* value)
 {
     subdev_context_t* subdev = find_subdev(subdev_handle);
     if (!subdev || !value) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1330,7 +1932,7 @@ int libmedia_get_control(int subdev_handle, uint32_t control_id, int32_t* value)
     
     if (xioctl(subdev->fd, VIDIOC_G_CTRL, &ctrl) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_G_CTRL failed for control 0x%08x: %s", control_id, strerror(errno));
-        set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
         return -1;
     }
     
@@ -1343,7 +1945,7 @@ int libmedia_set_control(int subdev_handle, uint32_t control_id, int32_t value)
 {
     subdev_context_t* subdev = find_subdev(subdev_handle);
     if (!subdev) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1353,7 +1955,7 @@ int libmedia_set_control(int subdev_handle, uint32_t control_id, int32_t value)
     
     if (xioctl(subdev->fd, VIDIOC_S_CTRL, &ctrl) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_S_CTRL failed for control 0x%08x = %d: %s", control_id, value, strerror(errno));
-        set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
         return -1;
     }
     
@@ -1365,7 +1967,7 @@ int libmedia_get_control_info(int subdev_handle, uint32_t control_id, media_cont
 {
     subdev_context_t* subdev = find_subdev(subdev_handle);
     if (!subdev || !info) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1374,7 +1976,7 @@ int libmedia_get_control_info(int subdev_handle, uint32_t control_id, media_cont
     
     if (xioctl(subdev->fd, VIDIOC_QUERYCTRL, &queryctrl) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYCTRL failed for control 0x%08x: %s", control_id, strerror(errno));
-        set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
         return -1;
     }
     
@@ -1403,7 +2005,7 @@ int libmedia_list_controls(int subdev_handle, media_control_info_t* controls, in
 {
     subdev_context_t* subdev = find_subdev(subdev_handle);
     if (!subdev || !controls || max_controls <= 0) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1506,7 +2108,7 @@ int libmedia_set_crop_selection(int handle, int top, int left, int width, int he
 {
     device_context_t* dev = find_device(handle);
     if (!dev) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1520,7 +2122,7 @@ int libmedia_set_crop_selection(int handle, int top, int left, int width, int he
     
     if (xioctl(dev->fd, VIDIOC_S_SELECTION, &sel) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_S_SELECTION (crop) failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
         return -1;
     }
     
@@ -1533,7 +2135,7 @@ int libmedia_get_crop_selection(int handle, int* top, int* left, int* width, int
 {
     device_context_t* dev = find_device(handle);
     if (!dev || !top || !left || !width || !height) {
-        set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
         return -1;
     }
     
@@ -1543,7 +2145,7 @@ int libmedia_get_crop_selection(int handle, int* top, int* left, int* width, int
     
     if (xioctl(dev->fd, VIDIOC_G_SELECTION, &sel) == -1) {
         MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_G_SELECTION (crop) failed: %s", strerror(errno));
-        set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
         return -1;
     }
     
@@ -1561,50 +2163,65 @@ int libmedia_get_crop_selection(int handle, int* top, int* left, int* width, int
 // Utility Functions
 // ============================================================================
 
-const char* libmedia_get_format_name(uint32_t pixelformat)
+const media_format_desc_t* libmedia_get_format_desc(uint32_t pixelformat)
 {
-    switch (pixelformat) {
-        case V4L2_PIX_FMT_YUYV: return "YUYV";
-        case V4L2_PIX_FMT_UYVY: return "UYVY";
-        case V4L2_PIX_FMT_NV12: return "NV12";
-        case V4L2_PIX_FMT_NV21: return "NV21";
-        case V4L2_PIX_FMT_YUV420: return "YUV420";
-        case V4L2_PIX_FMT_RGB24: return "RGB24";
-        case V4L2_PIX_FMT_BGR24: return "BGR24";
-        case V4L2_PIX_FMT_RGB32: return "RGB32";
-        case V4L2_PIX_FMT_BGR32: return "BGR32";
-        case V4L2_PIX_FMT_MJPEG: return "MJPEG";
-        case V4L2_PIX_FMT_SBGGR8: return "BGGR8";
-        case V4L2_PIX_FMT_SBGGR10: return "BGGR10";
-        case V4L2_PIX_FMT_SBGGR12: return "BGGR12";
-        default: return "UNKNOWN";
+    for (size_t i = 0; i < sizeof(g_format_descs) / sizeof(g_format_descs[0]); i++) {
+        if (g_format_descs[i].pixelformat == pixelformat) {
+            return &g_format_descs[i];
+        }
     }
+    return NULL;
+}
+
+const char* libmedia_get_format_name(uint32_t pixelformat)
+{
+    const media_format_desc_t* desc = libmedia_get_format_desc(pixelformat);
+    return desc ? desc->name : "UNKNOWN";
 }
 
 int libmedia_get_bytes_per_pixel(uint32_t pixelformat)
 {
-    switch (pixelformat) {
-        case V4L2_PIX_FMT_YUYV:
-        case V4L2_PIX_FMT_UYVY:
-            return 2;
-        case V4L2_PIX_FMT_RGB24:
-        case V4L2_PIX_FMT_BGR24:
-            return 3;
-        case V4L2_PIX_FMT_RGB32:
-        case V4L2_PIX_FMT_BGR32:
-            return 4;
-        case V4L2_PIX_FMT_NV12:
-        case V4L2_PIX_FMT_NV21:
-        case V4L2_PIX_FMT_YUV420:
-            return 1; // Main plane
-        case V4L2_PIX_FMT_SBGGR8:
-            return 1;
-        case V4L2_PIX_FMT_SBGGR10:
-        case V4L2_PIX_FMT_SBGGR12:
-            return 2;
-        default:
-            return 0;
+    const media_format_desc_t* desc = libmedia_get_format_desc(pixelformat);
+    if (!desc || desc->packed || desc->bits_per_pixel == 0) {
+        return 0;
+    }
+
+    if (desc->planes > 1) {
+        return 1; // Main plane
+    }
+    return desc->bits_per_pixel / 8;
+}
+
+size_t libmedia_get_line_bytes(uint32_t pixelformat, uint32_t width)
+{
+    const media_format_desc_t* desc = libmedia_get_format_desc(pixelformat);
+    if (!desc || desc->bits_per_pixel == 0) {
+        return 0;
+    }
+
+    if (desc->packed) {
+        // Whole MIPI groups: RAW10 packs 4 px into 5 bytes, RAW12 2 px into 3 bytes
+        uint32_t group = 1;
+        while ((group * desc->bits_per_pixel) % 8) {
+            group++;
+        }
+        return ((size_t)width + group - 1) / group * group * desc->bits_per_pixel / 8;
+    }
+    return (size_t)width * libmedia_get_bytes_per_pixel(pixelformat);
+}
+
+size_t libmedia_get_plane_bytes(uint32_t pixelformat, int plane, uint32_t width, uint32_t height)
+{
+    const media_format_desc_t* desc = libmedia_get_format_desc(pixelformat);
+    if (!desc || desc->bits_per_pixel == 0 || plane < 0 || plane >= desc->planes) {
+        return 0;
+    }
+
+    if (plane == 0) {
+        return libmedia_get_line_bytes(pixelformat, width) * height;
     }
+    size_t chroma = (size_t)(width / desc->h_subsample) * (height / desc->v_subsample);
+    return desc->planes == 2 ? chroma * 2 : chroma;     // Semi-planar interleaves U and V
 }
 
 size_t libmedia_calculate_frame_size(const media_format_t* format)
@@ -0,0 +1,787 @@
+/**
+ * @file media_calib.c
+ * @brief Dark frame, flat field and defect map calibration
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Calibration file layout (little endian, every array page aligned so the
+ * file can be mapped and used directly by the correction kernel):
+ *
+ *   calib_file_header_t
+ *   master dark      uint16_t[width * height]
+ *   flat gain (Q12)  uint16_t[width * height]
+ *   defect bitmap    uint8_t[((width + 7) / 8) * height], LSB first
+ */
+
+#define _GNU_SOURCE
+
+#include "media_calib.h"
+#include "media_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ============================================================================
+// Internal Constants and Data Structures
+// ============================================================================
+
+#define CALIB_MAGIC 0x4C434D4CU     /**< "LMCL" */
+#define CALIB_VERSION 1
+#define CALIB_PAGE_SIZE 4096
+#define CALIB_GAIN_SHIFT 12         /**< Flat gain is Q12 (4096 = 1.0) */
+#define CALIB_GAIN_MAX 0xFFFF
+#define CALIB_MAX_DIMENSION 16384   /**< Largest width or height accepted from a file */
+#define CALIB_MAX_TIMEOUTS 3        /**< Consecutive capture timeouts before giving up */
+
+/**
+ * @struct calib_file_header
+ * @brief On-disk calibration header
+ */
+typedef struct {
+    uint32_t magic;                 /**< CALIB_MAGIC */
+    uint16_t version;               /**< CALIB_VERSION */
+    uint16_t header_size;           /**< sizeof(calib_file_header_t) */
+    uint32_t width;                 /**< Frame width */
+    uint32_t height;                /**< Frame height */
+    uint32_t pixelformat;           /**< Raw pixel format */
+    uint32_t pedestal;              /**< Mean master dark level */
+    uint32_t dark_frames;           /**< Frames in the master dark */
+    uint32_t flat_frames;           /**< Frames in the master flat */
+    uint32_t defect_count;          /**< Set bits in the defect bitmap */
+    uint32_t reserved0;             /**< Keeps the offsets 8-byte aligned */
+    uint64_t dark_offset;           /**< File offset of the master dark */
+    uint64_t gain_offset;           /**< File offset of the flat gain */
+    uint64_t defect_offset;         /**< File offset of the defect bitmap */
+    uint64_t file_size;             /**< Total file size */
+} calib_file_header_t;
+
+/**
+ * @struct media_stack
+ * @brief Frame stacking accumulator
+ */
+struct media_stack {
+    uint32_t width;                 /**< Frame width */
+    uint32_t height;                /**< Frame height */
+    uint32_t* sum;                  /**< Per-pixel sums */
+    int count;                      /**< Frames accumulated */
+};
+
+/**
+ * @struct media_calib
+ * @brief Sensor calibration data
+ */
+struct media_calib {
+    media_calib_info_t info;        /**< Summary */
+    uint32_t sample_max;            /**< Largest valid sample value */
+    int sample_bytes;               /**< 1 or 2 bytes per sample */
+    int bayer;                      /**< Defects are repaired from same-colour neighbours */
+    uint16_t* dark;                 /**< Master dark */
+    uint16_t* gain;                 /**< Q12 flat-field gain */
+    uint8_t* defects;               /**< Defect bitmap */
+    uint32_t defect_stride;         /**< Bytes per bitmap row */
+    media_stack_t* stack;           /**< Accumulator while building */
+    media_calib_frame_type_t stacking; /**< Type currently in the accumulator */
+    int finalized;                  /**< Master frames are complete */
+    void* map_base;                 /**< Mapping of a loaded file */
+    size_t map_size;                /**< Size of the mapping */
+};
+
+// ============================================================================
+// Internal Helpers
+// ============================================================================
+
+/**
+ * @brief Describe the raw container of a calibration format
+ * @return 0 if supported, negative otherwise
+ */
+static int calib_format_layout(uint32_t pixelformat, int* sample_bytes, uint32_t* sample_max, int* bayer)
+{
+    const media_format_desc_t* desc = libmedia_get_format_desc(pixelformat);
+
+    // One sample per pixel in an 8-bit or 16-bit container: Bayer raw or monochrome.
+    // Bit-packed raw must be unpacked first (libmedia_raw_unpack)
+    if (!desc || desc->packed || desc->planes != 1 ||
+        (desc->bits_per_pixel != 8 && desc->bits_per_pixel != 16) ||
+        desc->bits_per_pixel != 8 * ((desc->bits_per_sample + 7) / 8)) {
+        return -1;
+    }
+
+    *bayer = desc->bayer != MEDIA_BAYER_NONE;
+    *sample_bytes = desc->bits_per_pixel / 8;
+    *sample_max = (1u << desc->bits_per_sample) - 1;
+    return 0;
+}
+
+static inline int defect_test(const media_calib_t* calib, uint32_t x, uint32_t y)
+{
+    return (calib->defects[(size_t)y * calib->defect_stride + (x >> 3)] >> (x & 7)) & 1;
+}
+
+static inline void defect_set(media_calib_t* calib, uint32_t x, uint32_t y)
+{
+    calib->defects[(size_t)y * calib->defect_stride + (x >> 3)] |= (uint8_t)(1u << (x & 7));
+}
+
+/**
+ * @brief Reduce the accumulator into the master dark
+ */
+static int calib_reduce_dark(media_calib_t* calib)
+{
+    if (libmedia_stack_mean(calib->stack, calib->dark) < 0) {
+        return -1;
+    }
+    calib->info.dark_frames = (uint32_t)libmedia_stack_get_count(calib->stack);
+    libmedia_stack_reset(calib->stack);
+    return 0;
+}
+
+// ============================================================================
+// Frame Stacking
+// ============================================================================
+
+media_stack_t* libmedia_stack_create(uint32_t width, uint32_t height)
+{
+    if (width == 0 || height == 0) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_stack_t* stack = calloc(1, sizeof(media_stack_t));
+    if (!stack) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    stack->width = width;
+    stack->height = height;
+    stack->sum = calloc((size_t)width * height, sizeof(uint32_t));
+    if (!stack->sum) {
+        free(stack);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    return stack;
+}
+
+int libmedia_stack_add_frame(media_stack_t* stack, const media_frame_t* frame)
+{
+    int sample_bytes, bayer;
+    uint32_t sample_max;
+
+    if (!stack || !frame || !frame->data ||
+        frame->width != stack->width || frame->height != stack->height) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    if (calib_format_layout(frame->pixelformat, &sample_bytes, &sample_max, &bayer) < 0) {
+        media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+        return -1;
+    }
+
+    size_t pixels = (size_t)stack->width * stack->height;
+    if (frame->size && frame->size < pixels * sample_bytes) {
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+
+    // 65535 * 65536 still fits the 32-bit sums
+    if (stack->count >= 65536) {
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+
+    uint32_t* restrict sum = stack->sum;
+    if (sample_bytes == 1) {
+        const uint8_t* restrict src = frame->data;
+        for (size_t i = 0; i < pixels; i++) {
+            sum[i] += src[i];
+        }
+    } else {
+        const uint16_t* restrict src = frame->data;
+        for (size_t i = 0; i < pixels; i++) {
+            sum[i] += src[i];
+        }
+    }
+
+    stack->count++;
+    return 0;
+}
+
+int libmedia_stack_get_count(const media_stack_t* stack)
+{
+    if (!stack) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    return stack->count;
+}
+
+int libmedia_stack_mean(const media_stack_t* stack, uint16_t* mean)
+{
+    if (!stack || !mean || stack->count == 0) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    size_t pixels = (size_t)stack->width * stack->height;
+    uint32_t count = (uint32_t)stack->count;
+    uint32_t half = count / 2;
+
+    for (size_t i = 0; i < pixels; i++) {
+        mean[i] = (uint16_t)((stack->sum[i] + half) / count);
+    }
+    return 0;
+}
+
+void libmedia_stack_reset(media_stack_t* stack)
+{
+    if (!stack) {
+        return;
+    }
+
+    memset(stack->sum, 0, (size_t)stack->width * stack->height * sizeof(uint32_t));
+    stack->count = 0;
+}
+
+void libmedia_stack_destroy(media_stack_t* stack)
+{
+    if (!stack) {
+        return;
+    }
+
+    free(stack->sum);
+    free(stack);
+}
+
+// ============================================================================
+// Calibration Construction
+// ============================================================================
+
+media_calib_t* libmedia_calib_create(uint32_t width, uint32_t height, uint32_t pixelformat)
+{
+    media_calib_t* calib = calloc(1, sizeof(media_calib_t));
+    if (!calib) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    if (width == 0 || height == 0 ||
+        calib_format_layout(pixelformat, &calib->sample_bytes, &calib->sample_max, &calib->bayer) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Calibration not supported for %ux%u %s",
+                    width, height, libmedia_get_format_name(pixelformat));
+        free(calib);
+        media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+        return NULL;
+    }
+
+    size_t pixels = (size_t)width * height;
+    calib->info.width = width;
+    calib->info.height = height;
+    calib->info.pixelformat = pixelformat;
+    calib->defect_stride = (width + 7) / 8;
+    calib->stacking = MEDIA_CALIB_DARK;
+    calib->dark = calloc(pixels, sizeof(uint16_t));
+    calib->gain = malloc(pixels * sizeof(uint16_t));
+    calib->defects = calloc((size_t)calib->defect_stride * height, 1);
+    calib->stack = libmedia_stack_create(width, height);
+
+    if (!calib->dark || !calib->gain || !calib->defects || !calib->stack) {
+        libmedia_calib_destroy(calib);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    // Unit gain until a flat is stacked
+    for (size_t i = 0; i < pixels; i++) {
+        calib->gain[i] = 1u << CALIB_GAIN_SHIFT;
+    }
+
+    return calib;
+}
+
+int libmedia_calib_add_frame(media_calib_t* calib, media_calib_frame_type_t type, const media_frame_t* frame)
+{
+    if (!calib || !calib->stack || calib->finalized || !frame ||
+        frame->pixelformat != calib->info.pixelformat) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    if (type != calib->stacking) {
+        if (type == MEDIA_CALIB_DARK) {
+            MEDIA_DEBUG(DEBUG_ERROR, "Dark frames must be stacked before flat frames");
+            media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+            return -1;
+        }
+        // Switching to flats: the darks are complete
+        if (libmedia_stack_get_count(calib->stack) > 0 && calib_reduce_dark(calib) < 0) {
+            return -1;
+        }
+        calib->stacking = type;
+    }
+
+    return libmedia_stack_add_frame(calib->stack, frame);
+}
+
+int libmedia_calib_capture(media_calib_t* calib, media_session_t* session,
+                           media_calib_frame_type_t type, int count, int timeout_ms)
+{
+    if (!calib || !session || count <= 0) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    int stacked = 0;
+    int timeouts = 0;
+    while (stacked < count) {
+        // A capture timeout also returns 0, with the frame left untouched
+        media_frame_t frame = {0};
+        if (libmedia_session_capture_frame(session, &frame, timeout_ms) < 0 &&
+            libmedia_get_last_error() != MEDIA_ERROR_TIMEOUT) {
+            return -1;
+        }
+        if (!frame.data) {
+            if (++timeouts >= CALIB_MAX_TIMEOUTS) {
+                MEDIA_DEBUG(DEBUG_ERROR, "No frame within %d ms after %d attempts", timeout_ms, timeouts);
+                media_set_last_error(MEDIA_ERROR_TIMEOUT);
+                return -1;
+            }
+            continue;
+        }
+        timeouts = 0;
+
+        int result = libmedia_calib_add_frame(calib, type, &frame);
+        libmedia_session_release_frame(session, &frame);
+        if (result < 0) {
+            return -1;
+        }
+        stacked++;
+    }
+
+    MEDIA_DEBUG(DEBUG_INFO, "Stacked %d %s frames", stacked, type == MEDIA_CALIB_DARK ? "dark" : "flat");
+    return stacked;
+}
+
+int libmedia_calib_finalize(media_calib_t* calib, const media_calib_params_t* params)
+{
+    if (!calib || !calib->stack || calib->finalized) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    media_calib_params_t p = {0};
+    if (params) {
+        p = *params;
+    }
+    if (p.hot_threshold == 0) {
+        p.hot_threshold = (calib->sample_max + 1) / 16;
+    }
+    if (p.dead_ratio == 0) {
+        p.dead_ratio = 128;
+    }
+    if (p.bright_ratio == 0) {
+        p.bright_ratio = 384;
+    }
+
+    uint32_t width = calib->info.width;
+    uint32_t height = calib->info.height;
+    size_t pixels = (size_t)width * height;
+    int have_flat = calib->stacking == MEDIA_CALIB_FLAT && libmedia_stack_get_count(calib->stack) > 0;
+
+    if (calib->stacking == MEDIA_CALIB_DARK && libmedia_stack_get_count(calib->stack) > 0) {
+        if (calib_reduce_dark(calib) < 0) {
+            return -1;
+        }
+    }
+
+    // Master dark statistics and hot pixels
+    uint64_t dark_sum = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        dark_sum += calib->dark[i];
+    }
+    calib->info.pedestal = (uint32_t)(dark_sum / pixels);
+
+    uint32_t hot_level = calib->info.pedestal + p.hot_threshold;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            if (calib->info.dark_frames > 0 && calib->dark[(size_t)y * width + x] > hot_level) {
+                defect_set(calib, x, y);
+            }
+        }
+    }
+
+    // Master flat: dark-subtracted response normalised per Bayer phase
+    if (have_flat) {
+        uint16_t* flat = malloc(pixels * sizeof(uint16_t));
+        if (!flat) {
+            media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        libmedia_stack_mean(calib->stack, flat);
+        calib->info.flat_frames = (uint32_t)libmedia_stack_get_count(calib->stack);
+
+        uint64_t phase_sum[4] = {0};
+        uint64_t phase_count[4] = {0};
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                size_t i = (size_t)y * width + x;
+                int phase = calib->bayer ? (int)(((y & 1) << 1) | (x & 1)) : 0;
+                flat[i] = flat[i] > calib->dark[i] ? flat[i] - calib->dark[i] : 0;
+                phase_sum[phase] += flat[i];
+                phase_count[phase]++;
+            }
+        }
+
+        uint32_t phase_mean[4];
+        for (int i = 0; i < 4; i++) {
+            phase_mean[i] = phase_count[i] ? (uint32_t)(phase_sum[i] / phase_count[i]) : 0;
+        }
+
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                size_t i = (size_t)y * width + x;
+                uint32_t mean = phase_mean[calib->bayer ? (((y & 1) << 1) | (x & 1)) : 0];
+                uint32_t response = flat[i];
+
+                if ((uint64_t)response * 256 < (uint64_t)mean * p.dead_ratio ||
+                    (uint64_t)response * 256 > (uint64_t)mean * p.bright_ratio) {
+                    defect_set(calib, x, y);
+                    calib->gain[i] = 1u << CALIB_GAIN_SHIFT;
+                    continue;
+                }
+
+                uint64_t gain = ((uint64_t)mean << CALIB_GAIN_SHIFT) / (response ? response : 1);
+                calib->gain[i] = (uint16_t)(gain > CALIB_GAIN_MAX ? CALIB_GAIN_MAX : gain);
+            }
+        }
+        free(flat);
+    }
+
+    uint32_t defects = 0;
+    for (size_t i = 0; i < (size_t)calib->defect_stride * height; i++) {
+        defects += (uint32_t)__builtin_popcount(calib->defects[i]);
+    }
+    calib->info.defect_count = defects;
+
+    // The accumulator is the largest allocation; it is not needed any more
+    libmedia_stack_destroy(calib->stack);
+    calib->stack = NULL;
+    calib->finalized = 1;
+
+    MEDIA_DEBUG(DEBUG_INFO, "Calibration finalized: %u dark, %u flat frames, pedestal %u, %u defects",
+                calib->info.dark_frames, calib->info.flat_frames, calib->info.pedestal, defects);
+    return 0;
+}
+
+// ============================================================================
+// Persistence
+// ============================================================================
+
+static int write_all(int fd, const void* data, size_t size)
+{
+    const uint8_t* p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static int pwrite_all(int fd, const void* data, size_t size, off_t offset)
+{
+    const uint8_t* p = data;
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Check that [offset, offset + length) lies within limit bytes, without overflow
+ */
+static int section_fits(uint64_t offset, uint64_t length, uint64_t limit)
+{
+    return offset <= limit && length <= limit - offset;
+}
+
+int libmedia_calib_save(const media_calib_t* calib, const char* path)
+{
+    if (!calib || !path || !calib->finalized) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    size_t pixels = (size_t)calib->info.width * calib->info.height;
+    size_t defect_size = (size_t)calib->defect_stride * calib->info.height;
+
+    calib_file_header_t header = {0};
+    header.magic = CALIB_MAGIC;
+    header.version = CALIB_VERSION;
+    header.header_size = sizeof(header);
+    header.width = calib->info.width;
+    header.height = calib->info.height;
+    header.pixelformat = calib->info.pixelformat;
+    header.pedestal = calib->info.pedestal;
+    header.dark_frames = calib->info.dark_frames;
+    header.flat_frames = calib->info.flat_frames;
+    header.defect_count = calib->info.defect_count;
+    header.dark_offset = CALIB_PAGE_SIZE;
+    header.gain_offset = MEDIA_ALIGN_UP(header.dark_offset + pixels * sizeof(uint16_t), CALIB_PAGE_SIZE);
+    header.defect_offset = MEDIA_ALIGN_UP(header.gain_offset + pixels * sizeof(uint16_t), CALIB_PAGE_SIZE);
+    header.file_size = header.defect_offset + defect_size;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Failed to create %s: %s", path, strerror(errno));
+        media_set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
+        return -1;
+    }
+
+    int result = 0;
+    if (write_all(fd, &header, sizeof(header)) < 0 ||
+        pwrite_all(fd, calib->dark, pixels * sizeof(uint16_t), (off_t)header.dark_offset) < 0 ||
+        pwrite_all(fd, calib->gain, pixels * sizeof(uint16_t), (off_t)header.gain_offset) < 0 ||
+        pwrite_all(fd, calib->defects, defect_size, (off_t)header.defect_offset) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Failed to write %s: %s", path, strerror(errno));
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        result = -1;
+    }
+
+    close(fd);
+    if (result == 0) {
+        MEDIA_DEBUG(DEBUG_INFO, "Saved calibration to %s (%llu bytes)", path,
+                    (unsigned long long)header.file_size);
+    }
+    return result;
+}
+
+media_calib_t* libmedia_calib_load(const char* path)
+{
+    if (!path) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Failed to open %s: %s", path, strerror(errno));
+        media_set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(calib_file_header_t)) {
+        close(fd);
+        media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+        return NULL;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        MEDIA_DEBUG(DEBUG_ERROR, "mmap of %s failed: %s", path, strerror(errno));
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    // Dimensions are bounded first so the section sizes below cannot overflow
+    const calib_file_header_t* header = base;
+    int dimensions_ok = header->width > 0 && header->height > 0 &&
+                        header->width <= CALIB_MAX_DIMENSION && header->height <= CALIB_MAX_DIMENSION;
+    uint64_t plane_bytes = dimensions_ok ? (uint64_t)header->width * header->height * sizeof(uint16_t) : 0;
+    uint64_t defect_stride = dimensions_ok ? (header->width + 7) / 8 : 0;
+
+    media_calib_t* calib = calloc(1, sizeof(media_calib_t));
+    if (!calib) {
+        munmap(base, (size_t)st.st_size);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    calib->map_base = base;
+    calib->map_size = (size_t)st.st_size;
+
+    if (header->magic != CALIB_MAGIC || header->version != CALIB_VERSION ||
+        header->header_size != sizeof(calib_file_header_t) || !dimensions_ok ||
+        header->file_size > (uint64_t)st.st_size ||
+        (header->dark_offset | header->gain_offset) % sizeof(uint16_t) != 0 ||
+        !section_fits(header->dark_offset, plane_bytes, header->file_size) ||
+        !section_fits(header->gain_offset, plane_bytes, header->file_size) ||
+        !section_fits(header->defect_offset, defect_stride * header->height, header->file_size) ||
+        calib_format_layout(header->pixelformat, &calib->sample_bytes,
+                            &calib->sample_max, &calib->bayer) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "%s is not a valid calibration file", path);
+        libmedia_calib_destroy(calib);
+        media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+        return NULL;
+    }
+
+    calib->info.width = header->width;
+    calib->info.height = header->height;
+    calib->info.pixelformat = header->pixelformat;
+    calib->info.pedestal = header->pedestal;
+    calib->info.dark_frames = header->dark_frames;
+    calib->info.flat_frames = header->flat_frames;
+    calib->info.defect_count = header->defect_count;
+    calib->info.mapped = 1;
+    calib->dark = (uint16_t*)((uint8_t*)base + header->dark_offset);
+    calib->gain = (uint16_t*)((uint8_t*)base + header->gain_offset);
+    calib->defects = (uint8_t*)base + header->defect_offset;
+    calib->defect_stride = (uint32_t)defect_stride;
+    calib->finalized = 1;
+
+    MEDIA_DEBUG(DEBUG_INFO, "Mapped calibration %s: %ux%u %s, %u defects", path,
+                header->width, header->height, libmedia_get_format_name(header->pixelformat),
+                header->defect_count);
+    return calib;
+}
+
+int libmedia_calib_get_info(const media_calib_t* calib, media_calib_info_t* info)
+{
+    if (!calib || !info) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    *info = calib->info;
+    return 0;
+}
+
+// ============================================================================
+// Correction Kernel
+// ============================================================================
+
+/**
+ * @brief Replace one defective sample by the mean of its valid same-colour neighbours
+ */
+static uint32_t repair_sample(const media_calib_t* calib, const void* data, uint32_t x, uint32_t y)
+{
+    const int step = calib->bayer ? 2 : 1;
+    const int offsets[4][2] = { { -step, 0 }, { step, 0 }, { 0, -step }, { 0, step } };
+    uint32_t width = calib->info.width;
+    uint32_t height = calib->info.height;
+    uint32_t sum = 0;
+    uint32_t count = 0;
+
+    for (int i = 0; i < 4; i++) {
+        int64_t nx = (int64_t)x + offsets[i][0];
+        int64_t ny = (int64_t)y + offsets[i][1];
+        if (nx < 0 || ny < 0 || nx >= width || ny >= height ||
+            defect_test(calib, (uint32_t)nx, (uint32_t)ny)) {
+            continue;
+        }
+        size_t j = (size_t)ny * width + (size_t)nx;
+        sum += calib->sample_bytes == 1 ? ((const uint8_t*)data)[j] : ((const uint16_t*)data)[j];
+        count++;
+    }
+
+    return count ? (sum + count / 2) / count : calib->info.pedestal;
+}
+
+int libmedia_calib_apply(const media_calib_t* calib, media_frame_t* frame)
+{
+    if (!calib || !calib->finalized || !frame || !frame->data ||
+        frame->width != calib->info.width || frame->height != calib->info.height ||
+        frame->pixelformat != calib->info.pixelformat) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    size_t pixels = (size_t)calib->info.width * calib->info.height;
+    if (frame->size && frame->size < pixels * calib->sample_bytes) {
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+
+    const uint16_t* restrict dark = calib->dark;
+    const uint16_t* restrict gain = calib->gain;
+    const int32_t pedestal = (int32_t)calib->info.pedestal;
+    const int32_t max = (int32_t)calib->sample_max;
+    const int32_t round = 1 << (CALIB_GAIN_SHIFT - 1);
+
+    if (calib->sample_bytes == 1) {
+        uint8_t* restrict data = frame->data;
+        for (size_t i = 0; i < pixels; i++) {
+            int32_t v = (int32_t)data[i] - dark[i];
+            v = v < 0 ? 0 : v;
+            v = ((v * gain[i] + round) >> CALIB_GAIN_SHIFT) + pedestal;
+            data[i] = (uint8_t)(v > max ? max : v);
+        }
+    } else {
+        uint16_t* restrict data = frame->data;
+        for (size_t i = 0; i < pixels; i++) {
+            int64_t v = (int64_t)data[i] - dark[i];
+            v = v < 0 ? 0 : v;
+            v = ((v * gain[i] + round) >> CALIB_GAIN_SHIFT) + pedestal;
+            data[i] = (uint16_t)(v > max ? max : v);
+        }
+    }
+
+    if (calib->info.defect_count == 0) {
+        return 0;
+    }
+
+    // Scan the bitmap a word at a time; defects are sparse
+    uint32_t width = calib->info.width;
+    for (uint32_t y = 0; y < calib->info.height; y++) {
+        const uint8_t* row = calib->defects + (size_t)y * calib->defect_stride;
+        for (uint32_t bx = 0; bx < calib->defect_stride; bx++) {
+            if (row[bx] == 0) {
+                continue;
+            }
+            for (uint32_t bit = 0; bit < 8; bit++) {
+                uint32_t x = bx * 8 + bit;
+                if (x >= width || !((row[bx] >> bit) & 1)) {
+                    continue;
+                }
+                uint32_t v = repair_sample(calib, frame->data, x, y);
+                size_t i = (size_t)y * width + x;
+                if (calib->sample_bytes == 1) {
+                    ((uint8_t*)frame->data)[i] = (uint8_t)v;
+                } else {
+                    ((uint16_t*)frame->data)[i] = (uint16_t)v;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+void libmedia_calib_destroy(media_calib_t* calib)
+{
+    if (!calib) {
+        return;
+    }
+
+    if (calib->map_base) {
+        munmap(calib->map_base, calib->map_size);
+    } else {
+        free(calib->dark);
+        free(calib->gain);
+        free(calib->defects);
+    }
+    libmedia_stack_destroy(calib->stack);
+    free(calib);
+}
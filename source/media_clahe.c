@@ -0,0 +1,380 @@
+/**
+ * @file media_clahe.c
+ * @brief Tiled CLAHE (contrast limited adaptive histogram equalization)
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * The image is split into tiles_x * tiles_y tiles. Every tile gets a clipped
+ * histogram and an equalization LUT, then each output pixel is blended
+ * bilinearly from the LUTs of the four nearest tile centres in Q8 fixed point.
+ * Tile histograms and row bands are spread over helper threads that the
+ * context starts once and keeps for its lifetime.
+ */
+
+#include "media_proc.h"
+#include "media_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Internal Constants and Data Structures
+// ============================================================================
+
+#define CLAHE_DEFAULT_TILES 8
+#define CLAHE_MAX_TILES 64
+#define CLAHE_BINS 256
+
+/**
+ * @struct media_clahe
+ * @brief CLAHE context
+ */
+struct media_clahe {
+    media_clahe_config_t config;    /**< Effective configuration */
+    uint8_t* luts;                  /**< tiles_y * tiles_x LUTs of 256 entries */
+    uint32_t* col_off0;             /**< Per column: offset of the left tile LUT */
+    uint32_t* col_off1;             /**< Per column: offset of the right tile LUT */
+    uint16_t* col_w;                /**< Per column: Q8 weight of the right tile */
+    uint32_t width;                 /**< Width the column tables were built for */
+    uint32_t height;                /**< Height of the last processed plane */
+    media_workers_t* workers;       /**< Helper threads, NULL for the calling thread only */
+};
+
+/**
+ * @struct clahe_job
+ * @brief Arguments shared by the parallel histogram and blend passes
+ */
+typedef struct {
+    media_clahe_t* clahe;
+    const media_plane_t* src;
+    media_plane_t* dst;
+    int bands;                      /**< Number of row bands for the blend pass */
+} clahe_job_t;
+
+// ============================================================================
+// Internal Helpers
+// ============================================================================
+
+/**
+ * @brief First pixel of tile `t` out of `tiles` tiles over `size` pixels
+ */
+static inline uint32_t tile_start(uint32_t t, uint32_t tiles, uint32_t size)
+{
+    return (uint32_t)(((uint64_t)t * size) / tiles);
+}
+
+/**
+ * @brief Centre of tile `t`
+ */
+static inline uint32_t tile_center(uint32_t t, uint32_t tiles, uint32_t size)
+{
+    return (tile_start(t, tiles, size) + tile_start(t + 1, tiles, size)) / 2;
+}
+
+/**
+ * @brief Locate the two tiles bracketing `pos` and the Q8 weight of the second
+ */
+static void tile_neighbours(uint32_t pos, uint32_t tiles, uint32_t size,
+                            uint32_t* t0, uint32_t* t1, uint32_t* w)
+{
+    uint32_t first = tile_center(0, tiles, size);
+    uint32_t last = tile_center(tiles - 1, tiles, size);
+
+    if (pos <= first || tiles == 1) {
+        *t0 = *t1 = 0;
+        *w = 0;
+        return;
+    }
+    if (pos >= last) {
+        *t0 = *t1 = tiles - 1;
+        *w = 0;
+        return;
+    }
+
+    uint32_t t = (uint32_t)(((uint64_t)pos * tiles) / size);
+    if (t > 0 && pos < tile_center(t, tiles, size)) {
+        t--;
+    }
+    uint32_t c0 = tile_center(t, tiles, size);
+    uint32_t c1 = tile_center(t + 1, tiles, size);
+
+    *t0 = t;
+    *t1 = t + 1;
+    *w = ((pos - c0) << 8) / (c1 - c0);
+}
+
+/**
+ * @brief (Re)build the per-column blend tables when the width changes
+ */
+static int clahe_prepare(media_clahe_t* clahe, uint32_t width, uint32_t height)
+{
+    if (clahe->width != width) {
+        uint32_t* off0 = realloc(clahe->col_off0, width * sizeof(uint32_t));
+        if (off0) {
+            clahe->col_off0 = off0;
+        }
+        uint32_t* off1 = realloc(clahe->col_off1, width * sizeof(uint32_t));
+        if (off1) {
+            clahe->col_off1 = off1;
+        }
+        uint16_t* w = realloc(clahe->col_w, width * sizeof(uint16_t));
+        if (w) {
+            clahe->col_w = w;
+        }
+        if (!off0 || !off1 || !w) {
+            clahe->width = 0;
+            media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t t0, t1, wx;
+            tile_neighbours(x, clahe->config.tiles_x, width, &t0, &t1, &wx);
+            clahe->col_off0[x] = t0 * CLAHE_BINS;
+            clahe->col_off1[x] = t1 * CLAHE_BINS;
+            clahe->col_w[x] = (uint16_t)wx;
+        }
+        clahe->width = width;
+    }
+
+    clahe->height = height;
+    return 0;
+}
+
+/**
+ * @brief Build the clipped histogram and LUT of one tile
+ */
+static void clahe_tile_worker(void* ctx, int index)
+{
+    clahe_job_t* job = ctx;
+    media_clahe_t* clahe = job->clahe;
+    const media_plane_t* src = job->src;
+    uint32_t tiles_x = clahe->config.tiles_x;
+    uint32_t tiles_y = clahe->config.tiles_y;
+    uint32_t tx = (uint32_t)index % tiles_x;
+    uint32_t ty = (uint32_t)index / tiles_x;
+
+    uint32_t x0 = tile_start(tx, tiles_x, src->width);
+    uint32_t x1 = tile_start(tx + 1, tiles_x, src->width);
+    uint32_t y0 = tile_start(ty, tiles_y, src->height);
+    uint32_t y1 = tile_start(ty + 1, tiles_y, src->height);
+    uint32_t area = (x1 - x0) * (y1 - y0);
+    uint8_t* lut = clahe->luts + (size_t)index * CLAHE_BINS;
+
+    if (area == 0) {
+        for (int i = 0; i < CLAHE_BINS; i++) {
+            lut[i] = (uint8_t)i;
+        }
+        return;
+    }
+
+    // Four interleaved sub-histograms break the load/increment/store
+    // dependency on runs of equal pixels
+    uint32_t sub[4][CLAHE_BINS];
+    memset(sub, 0, sizeof(sub));
+
+    for (uint32_t y = y0; y < y1; y++) {
+        const uint8_t* row = (const uint8_t*)src->data + (size_t)y * src->stride;
+        uint32_t x = x0;
+        for (; x + 4 <= x1; x += 4) {
+            sub[0][row[x]]++;
+            sub[1][row[x + 1]]++;
+            sub[2][row[x + 2]]++;
+            sub[3][row[x + 3]]++;
+        }
+        for (; x < x1; x++) {
+            sub[0][row[x]]++;
+        }
+    }
+
+    uint32_t hist[CLAHE_BINS];
+    for (int i = 0; i < CLAHE_BINS; i++) {
+        hist[i] = sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
+    }
+
+    // Clip and redistribute the excess uniformly
+    if (clahe->config.clip_limit > 0) {
+        uint32_t limit = (uint32_t)(((uint64_t)clahe->config.clip_limit * area) / (CLAHE_BINS * 256));
+        if (limit < 1) {
+            limit = 1;
+        }
+
+        uint32_t excess = 0;
+        for (int i = 0; i < CLAHE_BINS; i++) {
+            if (hist[i] > limit) {
+                excess += hist[i] - limit;
+                hist[i] = limit;
+            }
+        }
+
+        uint32_t per_bin = excess / CLAHE_BINS;
+        uint32_t residual = excess % CLAHE_BINS;
+        for (int i = 0; i < CLAHE_BINS; i++) {
+            hist[i] += per_bin;
+        }
+        if (residual > 0) {
+            uint32_t step = CLAHE_BINS / residual;
+            for (uint32_t i = 0; i < CLAHE_BINS && residual > 0; i += step, residual--) {
+                hist[i]++;
+            }
+        }
+    }
+
+    uint64_t cdf = 0;
+    for (int i = 0; i < CLAHE_BINS; i++) {
+        cdf += hist[i];
+        uint64_t v = (cdf * 255 + area / 2) / area;
+        lut[i] = (uint8_t)(v > 255 ? 255 : v);
+    }
+}
+
+/**
+ * @brief Blend one band of rows from the four surrounding tile LUTs
+ */
+static void clahe_band_worker(void* ctx, int index)
+{
+    clahe_job_t* job = ctx;
+    media_clahe_t* clahe = job->clahe;
+    const media_plane_t* src = job->src;
+    media_plane_t* dst = job->dst;
+    uint32_t tiles_x = clahe->config.tiles_x;
+    uint32_t tiles_y = clahe->config.tiles_y;
+    uint32_t width = src->width;
+    uint32_t y_begin = (uint32_t)(((uint64_t)index * src->height) / job->bands);
+    uint32_t y_end = (uint32_t)(((uint64_t)(index + 1) * src->height) / job->bands);
+
+    const uint32_t* restrict off0 = clahe->col_off0;
+    const uint32_t* restrict off1 = clahe->col_off1;
+    const uint16_t* restrict col_w = clahe->col_w;
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        uint32_t ty0, ty1, wy;
+        tile_neighbours(y, tiles_y, src->height, &ty0, &ty1, &wy);
+
+        const uint8_t* restrict top = clahe->luts + (size_t)ty0 * tiles_x * CLAHE_BINS;
+        const uint8_t* restrict bottom = clahe->luts + (size_t)ty1 * tiles_x * CLAHE_BINS;
+        const uint8_t* s = (const uint8_t*)src->data + (size_t)y * src->stride;
+        uint8_t* d = (uint8_t*)dst->data + (size_t)y * dst->stride;
+        uint32_t wy1 = wy;
+        uint32_t wy0 = 256 - wy;
+
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t p = s[x];
+            uint32_t wx1 = col_w[x];
+            uint32_t wx0 = 256 - wx1;
+            uint32_t t = top[off0[x] + p] * wx0 + top[off1[x] + p] * wx1;
+            uint32_t b = bottom[off0[x] + p] * wx0 + bottom[off1[x] + p] * wx1;
+            d[x] = (uint8_t)((t * wy0 + b * wy1 + (1u << 15)) >> 16);
+        }
+    }
+}
+
+// ============================================================================
+// Public Interface
+// ============================================================================
+
+media_clahe_t* libmedia_clahe_create(const media_clahe_config_t* config)
+{
+    media_clahe_t* clahe = calloc(1, sizeof(media_clahe_t));
+    if (!clahe) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    if (config) {
+        clahe->config = *config;
+    }
+    if (clahe->config.tiles_x == 0) {
+        clahe->config.tiles_x = CLAHE_DEFAULT_TILES;
+    }
+    if (clahe->config.tiles_y == 0) {
+        clahe->config.tiles_y = CLAHE_DEFAULT_TILES;
+    }
+    if (clahe->config.tiles_x > CLAHE_MAX_TILES || clahe->config.tiles_y > CLAHE_MAX_TILES) {
+        MEDIA_DEBUG(DEBUG_ERROR, "CLAHE tile grid %ux%u exceeds %d",
+                    clahe->config.tiles_x, clahe->config.tiles_y, CLAHE_MAX_TILES);
+        free(clahe);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+    if (clahe->config.threads < 1) {
+        clahe->config.threads = 1;
+    }
+
+    clahe->luts = malloc((size_t)clahe->config.tiles_x * clahe->config.tiles_y * CLAHE_BINS);
+    if (clahe->config.threads > 1) {
+        clahe->workers = media_workers_create(clahe->config.threads);
+    }
+    if (!clahe->luts || (clahe->config.threads > 1 && !clahe->workers)) {
+        libmedia_clahe_destroy(clahe);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    MEDIA_DEBUG(DEBUG_INFO, "Created CLAHE context: %ux%u tiles, clip %u/256, %d threads",
+                clahe->config.tiles_x, clahe->config.tiles_y,
+                clahe->config.clip_limit, clahe->config.threads);
+    return clahe;
+}
+
+int libmedia_clahe_process(media_clahe_t* clahe, const media_plane_t* src, media_plane_t* dst)
+{
+    if (!clahe || !src || !dst || !src->data || !dst->data ||
+        src->width != dst->width || src->height != dst->height ||
+        src->stride < src->width || dst->stride < dst->width) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    if (src->width < clahe->config.tiles_x || src->height < clahe->config.tiles_y) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    if (clahe_prepare(clahe, src->width, src->height) < 0) {
+        return -1;
+    }
+
+    clahe_job_t job = { clahe, src, dst, 0 };
+    int tiles = (int)(clahe->config.tiles_x * clahe->config.tiles_y);
+
+    // All LUTs must be complete before any row is written, which also makes
+    // in-place operation safe
+    media_parallel_for(clahe->workers, tiles, clahe_tile_worker, &job);
+
+    job.bands = clahe->config.threads * 4;
+    if ((uint32_t)job.bands > src->height) {
+        job.bands = (int)src->height;
+    }
+    media_parallel_for(clahe->workers, job.bands, clahe_band_worker, &job);
+
+    return 0;
+}
+
+int libmedia_clahe_process_frame(media_clahe_t* clahe, media_frame_t* frame)
+{
+    media_plane_t luma;
+    if (!clahe) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    // Keeps the error the plane lookup reported, e.g. an unsupported format
+    if (libmedia_frame_luma_plane(frame, &luma) < 0) {
+        return -1;
+    }
+
+    return libmedia_clahe_process(clahe, &luma, &luma);
+}
+
+void libmedia_clahe_destroy(media_clahe_t* clahe)
+{
+    if (!clahe) {
+        return;
+    }
+
+    media_workers_destroy(clahe->workers);
+    free(clahe->luts);
+    free(clahe->col_off0);
+    free(clahe->col_off1);
+    free(clahe->col_w);
+    free(clahe);
+}
@@ -0,0 +1,119 @@
+/**
+ * @file media_internal.h
+ * @brief libMedia internal helpers shared between translation units
+ * @version 1.0.0
+ *
+ * Not installed. Provides the debug output macro and error reporting used by
+ * every module of the library so they behave exactly like media.c.
+ */
+
+#ifndef LIBMEDIA_INTERNAL_H
+#define LIBMEDIA_INTERNAL_H
+
+#include "media.h"
+#include <stdio.h>
+#include <pthread.h>
+
+// ============================================================================
+// Internal Constants and Macros
+// ============================================================================
+
+#define MEDIA_INTERNAL __attribute__((visibility("hidden")))
+
+// Debug output levels
+#define DEBUG_NONE 0
+#define DEBUG_ERROR 1
+#define DEBUG_WARNING 2
+#define DEBUG_INFO 3
+#define DEBUG_DEBUG 4
+
+#define MEDIA_DEBUG(level, fmt, ...) \
+    do { \
+        if (g_media_debug_level >= level) { \
+            fprintf(stderr, "[MEDIA %s] " fmt "\n", \
+                level == DEBUG_ERROR ? "ERROR" : \
+                level == DEBUG_WARNING ? "WARN" : \
+                level == DEBUG_INFO ? "INFO" : "DEBUG", \
+                ##__VA_ARGS__); \
+        } \
+    } while(0)
+
+#define MEDIA_ALIGN_UP(x, a) (((x) + ((a) - 1)) & ~((size_t)(a) - 1))
+
+#define MEDIA_MAX_PARALLEL_THREADS 16
+
+// ============================================================================
+// Shared State
+// ============================================================================
+
+/** Current debug level, set through libmedia_set_debug_level() */
+extern MEDIA_INTERNAL int g_media_debug_level;
+
+/**
+ * @brief Set last error code
+ */
+MEDIA_INTERNAL void media_set_last_error(media_error_t error);
+
+/**
+ * @brief Charge an allocation against the memory budget
+ * @return 0 if it fits, -1 (MEDIA_ERROR_OUT_OF_MEMORY set) if it does not
+ */
+MEDIA_INTERNAL int media_budget_charge(size_t bytes);
+
+/**
+ * @brief Return a charge taken with media_budget_charge()
+ */
+MEDIA_INTERNAL void media_budget_release(size_t bytes);
+
+/**
+ * @brief Get the generation of a capture device's current buffer set
+ *
+ * Every buffer allocation gets a new value, so anything derived from the
+ * buffers (DMABUF exports, mappings) is stale once the generation differs.
+ * @param handle Device handle
+ * @return Generation, 0 if the device is closed or has no buffers
+ */
+MEDIA_INTERNAL uint32_t media_device_buffer_generation(int handle);
+
+/**
+ * @brief Start a library thread with its role's policy and a name
+ *
+ * Every thread the library creates goes through here.
+ * @param name Thread name (truncated to 15 characters)
+ * @return 0 on success, an errno value on error
+ */
+MEDIA_INTERNAL int media_thread_create(pthread_t* thread, media_thread_role_t role, const char* name,
+                                       void* (*fn)(void*), void* arg);
+
+/**
+ * @struct media_workers
+ * @brief Persistent helper threads for media_parallel_for() (opaque)
+ */
+typedef struct media_workers media_workers_t;
+
+/**
+ * @brief Start threads - 1 helper threads that sleep until work is posted
+ *
+ * Owned by the context that runs per-frame parallel passes, so the threads
+ * are created once instead of on every call. If helpers cannot be started
+ * the set runs with fewer of them.
+ * @return Worker set, NULL on allocation failure
+ */
+MEDIA_INTERNAL media_workers_t* media_workers_create(int threads);
+
+/**
+ * @brief Stop and join the helper threads
+ */
+MEDIA_INTERNAL void media_workers_destroy(media_workers_t* workers);
+
+/**
+ * @brief Run fn(ctx, i) for i in [0, count) on the helpers and the calling thread
+ *
+ * Returns once every item is done. A NULL worker set runs inline. Calls on
+ * one worker set must not overlap.
+ * @return 0 on success
+ */
+MEDIA_INTERNAL int media_parallel_for(media_workers_t* workers, int count,
+                                      void (*fn)(void* ctx, int index), void* ctx);
+
+#endif // LIBMEDIA_INTERNAL_H
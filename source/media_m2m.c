@@ -0,0 +1,751 @@
+/**
+ * @file media_m2m.c
+ * @brief V4L2 memory-to-memory devices
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * The device fd is non-blocking, so submitting and collecting never wait.
+ * Input buffers the device has finished reading come back on the OUTPUT
+ * queue. They are reaped whenever the session is used, and chained capture
+ * frames are released to their sessions at that point. Capture buffers are
+ * exported as DMABUF the first time they are chained. Exports are keyed by
+ * device handle and buffer generation rather than by session pointer, which
+ * a later session may reuse: once the capture device frees or reallocates
+ * its buffers (session destroyed, format changed) the generation changes
+ * and every export of the old set is closed on the next chained frame.
+ */
+
+#include "media_m2m.h"
+#include "media_meta.h"
+#include "media_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+// ============================================================================
+// Internal Data Structures
+// ============================================================================
+
+#define M2M_DEFAULT_BUFFERS 4
+#define M2M_MAX_EXPORTS 32              /**< Capture buffers exported at once */
+
+enum {
+    M2M_BUFFER_FREE,                    /**< Owned by the session */
+    M2M_BUFFER_LENT,                    /**< Input lent to the caller for filling */
+    M2M_BUFFER_QUEUED,                  /**< Owned by the device */
+    M2M_BUFFER_DONE                     /**< Result held by the caller */
+};
+
+/**
+ * @struct m2m_buffer
+ * @brief One buffer of either queue
+ */
+typedef struct {
+    void* start;                        /**< Mapping (MMAP memory) */
+    size_t length;                      /**< Mapping length */
+    int state;                          /**< M2M_BUFFER_* */
+    media_session_t* session;           /**< Source of a chained frame */
+    media_frame_t frame;                /**< Chained frame, released when reaped */
+    media_meta_t meta;                  /**< Metadata of a result */
+} m2m_buffer_t;
+
+/**
+ * @struct m2m_export
+ * @brief Exported capture buffer
+ */
+typedef struct {
+    int handle;                         /**< Capture device handle */
+    uint32_t generation;                /**< Buffer set exported from, 0 for a free entry */
+    uint32_t index;
+    int fd;
+    size_t length;
+} m2m_export_t;
+
+struct media_m2m {
+    int fd;
+    int mplane;                         /**< Multi-planar M2M API */
+    uint32_t input_type;                /**< OUTPUT queue buffer type */
+    uint32_t output_type;               /**< CAPTURE queue buffer type */
+    uint32_t input_memory;              /**< V4L2_MEMORY_* of the OUTPUT queue */
+    media_format_t input_format;
+    media_format_t output_format;
+
+    m2m_buffer_t inputs[MEDIA_M2M_MAX_BUFFERS];
+    int input_count;
+    m2m_buffer_t outputs[MEDIA_M2M_MAX_BUFFERS];
+    int output_count;
+
+    m2m_export_t exports[M2M_MAX_EXPORTS];
+    int export_count;
+    int export_next;                    /**< Entry replaced when the table is full */
+
+    size_t charged;                     /**< Bytes charged to the memory budget */
+    media_m2m_stats_t stats;
+};
+
+// ============================================================================
+// Queue Helpers
+// ============================================================================
+
+static int m2m_ioctl(int fd, unsigned long request, void* arg)
+{
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+/**
+ * @brief Prepare a buffer descriptor with its single plane
+ */
+static void m2m_init_buf(media_m2m_t* m2m, struct v4l2_buffer* buf, struct v4l2_plane* plane,
+                         uint32_t type, uint32_t memory, uint32_t index)
+{
+    memset(buf, 0, sizeof(*buf));
+    memset(plane, 0, sizeof(*plane));
+    buf->type = type;
+    buf->memory = memory;
+    buf->index = index;
+    if (m2m->mplane) {
+        buf->m.planes = plane;
+        buf->length = 1;
+    }
+}
+
+static void m2m_set_payload(media_m2m_t* m2m, struct v4l2_buffer* buf, size_t bytes, uint64_t timestamp)
+{
+    if (m2m->mplane) {
+        buf->m.planes[0].bytesused = (uint32_t)bytes;
+    } else {
+        buf->bytesused = (uint32_t)bytes;
+    }
+    buf->timestamp.tv_sec = (time_t)(timestamp / 1000000000ULL);
+    buf->timestamp.tv_usec = (suseconds_t)(timestamp % 1000000000ULL / 1000);
+}
+
+static int m2m_set_format(media_m2m_t* m2m, uint32_t type, media_format_t* format)
+{
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = type;
+    if (m2m->mplane) {
+        fmt.fmt.pix_mp.width = format->width;
+        fmt.fmt.pix_mp.height = format->height;
+        fmt.fmt.pix_mp.pixelformat = format->pixelformat;
+        fmt.fmt.pix_mp.field = format->field;
+        fmt.fmt.pix_mp.num_planes = 1;
+    } else {
+        fmt.fmt.pix.width = format->width;
+        fmt.fmt.pix.height = format->height;
+        fmt.fmt.pix.pixelformat = format->pixelformat;
+        fmt.fmt.pix.field = format->field;
+    }
+
+    if (m2m_ioctl(m2m->fd, VIDIOC_S_FMT, &fmt) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_S_FMT (M2M type %u) failed: %s", type, strerror(errno));
+        media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+        return -1;
+    }
+
+    if (m2m->mplane) {
+        if (fmt.fmt.pix_mp.num_planes != 1) {
+            MEDIA_DEBUG(DEBUG_ERROR, "M2M format %s needs %u memory planes, only 1 is supported",
+                        libmedia_get_format_name(fmt.fmt.pix_mp.pixelformat), fmt.fmt.pix_mp.num_planes);
+            media_set_last_error(MEDIA_ERROR_NOT_SUPPORTED);
+            return -1;
+        }
+        format->width = fmt.fmt.pix_mp.width;
+        format->height = fmt.fmt.pix_mp.height;
+        format->pixelformat = fmt.fmt.pix_mp.pixelformat;
+        format->field = fmt.fmt.pix_mp.field;
+        format->plane_size[0] = fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
+    } else {
+        format->width = fmt.fmt.pix.width;
+        format->height = fmt.fmt.pix.height;
+        format->pixelformat = fmt.fmt.pix.pixelformat;
+        format->field = fmt.fmt.pix.field;
+        format->plane_size[0] = fmt.fmt.pix.sizeimage;
+    }
+    format->num_planes = 1;
+    return 0;
+}
+
+/**
+ * @brief Allocate a queue's buffers, mapping them for MMAP memory
+ * @return Number of buffers on success, negative on error
+ */
+static int m2m_request_buffers(media_m2m_t* m2m, uint32_t type, uint32_t memory, int count,
+                               m2m_buffer_t* buffers)
+{
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = (uint32_t)count;
+    req.type = type;
+    req.memory = memory;
+    if (m2m_ioctl(m2m->fd, VIDIOC_REQBUFS, &req) < 0 || req.count == 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_REQBUFS (M2M type %u) failed: %s", type, strerror(errno));
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+    if (req.count > MEDIA_M2M_MAX_BUFFERS) {
+        req.count = MEDIA_M2M_MAX_BUFFERS;     // Extra driver buffers are never queued
+    }
+    if (memory != V4L2_MEMORY_MMAP) {
+        return (int)req.count;
+    }
+
+    for (uint32_t i = 0; i < req.count; i++) {
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+        m2m_init_buf(m2m, &buf, &plane, type, memory, i);
+        if (m2m_ioctl(m2m->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYBUF (M2M) failed: %s", strerror(errno));
+            media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+            return -1;
+        }
+
+        size_t length = m2m->mplane ? plane.length : buf.length;
+        off_t offset = m2m->mplane ? (off_t)plane.m.mem_offset : (off_t)buf.m.offset;
+        if (media_budget_charge(length) < 0) {
+            return -1;
+        }
+        m2m->charged += length;
+
+        buffers[i].start = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, m2m->fd, offset);
+        if (buffers[i].start == MAP_FAILED) {
+            buffers[i].start = NULL;
+            MEDIA_DEBUG(DEBUG_ERROR, "M2M buffer mmap failed: %s", strerror(errno));
+            media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        buffers[i].length = length;
+    }
+    return (int)req.count;
+}
+
+static int m2m_queue_output(media_m2m_t* m2m, uint32_t index)
+{
+    struct v4l2_buffer buf;
+    struct v4l2_plane plane;
+    m2m_init_buf(m2m, &buf, &plane, m2m->output_type, V4L2_MEMORY_MMAP, index);
+    if (m2m->mplane) {
+        plane.length = (uint32_t)m2m->outputs[index].length;
+    }
+    if (m2m_ioctl(m2m->fd, VIDIOC_QBUF, &buf) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QBUF (M2M capture %u) failed: %s", index, strerror(errno));
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+    m2m->outputs[index].state = M2M_BUFFER_QUEUED;
+    return 0;
+}
+
+/**
+ * @brief Give a consumed input slot back, releasing its chained frame
+ */
+static void m2m_free_input(m2m_buffer_t* input)
+{
+    if (input->session) {
+        libmedia_session_release_frame(input->session, &input->frame);
+        input->session = NULL;
+    }
+    input->state = M2M_BUFFER_FREE;
+}
+
+/**
+ * @brief Dequeue every input buffer the device has finished reading
+ */
+static int m2m_reap_inputs(media_m2m_t* m2m)
+{
+    while (m2m->stats.in_flight > 0) {
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+        m2m_init_buf(m2m, &buf, &plane, m2m->input_type, m2m->input_memory, 0);
+        if (m2m_ioctl(m2m->fd, VIDIOC_DQBUF, &buf) < 0) {
+            if (errno == EAGAIN) {
+                return 0;
+            }
+            MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_DQBUF (M2M output) failed: %s", strerror(errno));
+            media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+            return -1;
+        }
+        if (buf.index < (uint32_t)m2m->input_count) {
+            m2m_free_input(&m2m->inputs[buf.index]);
+            m2m->stats.in_flight--;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Get the DMABUF of a capture buffer, exporting it on first use
+ */
+static m2m_export_t* m2m_export(media_m2m_t* m2m, media_session_t* session, const media_frame_t* frame)
+{
+    int handle = libmedia_session_get_device_handle(session);
+    uint32_t generation = handle < 0 ? 0 : media_device_buffer_generation(handle);
+    if (generation == 0) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    m2m_export_t* found = NULL;
+    for (int i = 0; i < m2m->export_count; i++) {
+        m2m_export_t* e = &m2m->exports[i];
+        if (!e->generation) {
+            continue;
+        }
+        if (e->generation != media_device_buffer_generation(e->handle)) {
+            // Device closed or buffers reallocated since the export
+            close(e->fd);
+            e->generation = 0;
+        } else if (e->handle == handle && e->index == frame->frame_id) {
+            found = e;
+        }
+    }
+    if (found) {
+        return found;
+    }
+
+    int fd = libmedia_export_buffer(handle, (int)frame->frame_id);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    m2m_export_t* e = NULL;
+    for (int i = 0; i < m2m->export_count && !e; i++) {
+        if (!m2m->exports[i].generation) {
+            e = &m2m->exports[i];
+        }
+    }
+    if (!e && m2m->export_count < M2M_MAX_EXPORTS) {
+        e = &m2m->exports[m2m->export_count++];
+    }
+    if (!e) {
+        e = &m2m->exports[m2m->export_next];
+        m2m->export_next = (m2m->export_next + 1) % M2M_MAX_EXPORTS;
+        close(e->fd);
+    }
+
+    off_t length = lseek(fd, 0, SEEK_END);
+    e->handle = handle;
+    e->generation = generation;
+    e->index = frame->frame_id;
+    e->fd = fd;
+    e->length = length > 0 ? (size_t)length : frame->size;
+    return e;
+}
+
+// ============================================================================
+// M2M API
+// ============================================================================
+
+media_m2m_t* libmedia_m2m_create(const media_m2m_config_t* config)
+{
+    if (!config || !config->device_path ||
+        config->input_buffers < 0 || config->input_buffers > MEDIA_M2M_MAX_BUFFERS ||
+        config->output_buffers < 0 || config->output_buffers > MEDIA_M2M_MAX_BUFFERS ||
+        (config->input_memory != MEDIA_M2M_MEMORY_MMAP && config->input_memory != MEDIA_M2M_MEMORY_DMABUF)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_m2m_t* m2m = calloc(1, sizeof(media_m2m_t));
+    if (!m2m) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    m2m->fd = open(config->device_path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (m2m->fd < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Failed to open M2M device %s: %s", config->device_path, strerror(errno));
+        free(m2m);
+        media_set_last_error(MEDIA_ERROR_DEVICE_NOT_FOUND);
+        return NULL;
+    }
+
+    struct v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (m2m_ioctl(m2m->fd, VIDIOC_QUERYCAP, &cap) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QUERYCAP failed on %s: %s", config->device_path, strerror(errno));
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        libmedia_m2m_destroy(m2m);
+        return NULL;
+    }
+    uint32_t caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps : cap.capabilities;
+    if (caps & V4L2_CAP_VIDEO_M2M_MPLANE) {
+        m2m->mplane = 1;
+        m2m->input_type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+        m2m->output_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    } else if (caps & V4L2_CAP_VIDEO_M2M) {
+        m2m->input_type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+        m2m->output_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    } else {
+        MEDIA_DEBUG(DEBUG_ERROR, "%s is not a memory-to-memory device", config->device_path);
+        media_set_last_error(MEDIA_ERROR_NOT_SUPPORTED);
+        libmedia_m2m_destroy(m2m);
+        return NULL;
+    }
+    m2m->input_memory = config->input_memory == MEDIA_M2M_MEMORY_DMABUF ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_MMAP;
+
+    m2m->input_format = config->input;
+    m2m->output_format = config->output;
+    if (m2m_set_format(m2m, m2m->input_type, &m2m->input_format) < 0 ||
+        m2m_set_format(m2m, m2m->output_type, &m2m->output_format) < 0) {
+        libmedia_m2m_destroy(m2m);
+        return NULL;
+    }
+
+    m2m->input_count = m2m_request_buffers(m2m, m2m->input_type, m2m->input_memory,
+                                           config->input_buffers ? config->input_buffers : M2M_DEFAULT_BUFFERS,
+                                           m2m->inputs);
+    if (m2m->input_count < 0) {
+        m2m->input_count = 0;
+        libmedia_m2m_destroy(m2m);
+        return NULL;
+    }
+    m2m->output_count = m2m_request_buffers(m2m, m2m->output_type, V4L2_MEMORY_MMAP,
+                                            config->output_buffers ? config->output_buffers : M2M_DEFAULT_BUFFERS,
+                                            m2m->outputs);
+    if (m2m->output_count < 0) {
+        m2m->output_count = 0;
+        libmedia_m2m_destroy(m2m);
+        return NULL;
+    }
+
+    for (int i = 0; i < m2m->output_count; i++) {
+        if (m2m_queue_output(m2m, (uint32_t)i) < 0) {
+            libmedia_m2m_destroy(m2m);
+            return NULL;
+        }
+    }
+
+    enum v4l2_buf_type types[2] = { m2m->input_type, m2m->output_type };
+    for (int i = 0; i < 2; i++) {
+        if (m2m_ioctl(m2m->fd, VIDIOC_STREAMON, &types[i]) < 0) {
+            MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_STREAMON (M2M type %u) failed: %s", types[i], strerror(errno));
+            media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+            libmedia_m2m_destroy(m2m);
+            return NULL;
+        }
+    }
+
+    MEDIA_DEBUG(DEBUG_INFO, "M2M %s: %s %ux%u -> %s %ux%u, %d+%d buffers%s", config->device_path,
+                libmedia_get_format_name(m2m->input_format.pixelformat), m2m->input_format.width,
+                m2m->input_format.height, libmedia_get_format_name(m2m->output_format.pixelformat),
+                m2m->output_format.width, m2m->output_format.height, m2m->input_count, m2m->output_count,
+                m2m->input_memory == V4L2_MEMORY_DMABUF ? ", DMABUF input" : "");
+    return m2m;
+}
+
+int libmedia_m2m_get_formats(media_m2m_t* m2m, media_format_t* input, media_format_t* output)
+{
+    if (!m2m) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (input) {
+        *input = m2m->input_format;
+    }
+    if (output) {
+        *output = m2m->output_format;
+    }
+    return 0;
+}
+
+int libmedia_m2m_acquire_input(media_m2m_t* m2m, media_frame_t* frame)
+{
+    if (!m2m || !frame || m2m->input_memory != V4L2_MEMORY_MMAP) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (m2m_reap_inputs(m2m) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < m2m->input_count; i++) {
+        m2m_buffer_t* input = &m2m->inputs[i];
+        if (input->state == M2M_BUFFER_FREE) {
+            input->state = M2M_BUFFER_LENT;
+            memset(frame, 0, sizeof(*frame));
+            frame->data = input->start;
+            frame->size = input->length;
+            frame->width = m2m->input_format.width;
+            frame->height = m2m->input_format.height;
+            frame->pixelformat = m2m->input_format.pixelformat;
+            frame->frame_id = (uint32_t)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int libmedia_m2m_submit(media_m2m_t* m2m, const media_frame_t* frame)
+{
+    if (!m2m || !frame || m2m->input_memory != V4L2_MEMORY_MMAP ||
+        frame->frame_id >= (uint32_t)m2m->input_count ||
+        m2m->inputs[frame->frame_id].state != M2M_BUFFER_LENT ||
+        frame->size > m2m->inputs[frame->frame_id].length) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    struct v4l2_buffer buf;
+    struct v4l2_plane plane;
+    m2m_init_buf(m2m, &buf, &plane, m2m->input_type, V4L2_MEMORY_MMAP, frame->frame_id);
+    if (m2m->mplane) {
+        plane.length = (uint32_t)m2m->inputs[frame->frame_id].length;
+    }
+    m2m_set_payload(m2m, &buf, frame->size, frame->timestamp);
+    if (m2m_ioctl(m2m->fd, VIDIOC_QBUF, &buf) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QBUF (M2M output %u) failed: %s", frame->frame_id, strerror(errno));
+        m2m->inputs[frame->frame_id].state = M2M_BUFFER_FREE;
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+
+    m2m->inputs[frame->frame_id].state = M2M_BUFFER_QUEUED;
+    m2m->stats.submitted++;
+    m2m->stats.in_flight++;
+    return 0;
+}
+
+int libmedia_m2m_submit_frame(media_m2m_t* m2m, media_session_t* session, const media_frame_t* frame)
+{
+    if (!session || !frame) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    media_frame_t held = *frame;
+    if (!m2m || m2m->input_memory != V4L2_MEMORY_DMABUF) {
+        libmedia_session_release_frame(session, &held);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (m2m_reap_inputs(m2m) < 0) {
+        libmedia_session_release_frame(session, &held);
+        return -1;
+    }
+
+    // Same capture buffer, same slot: the driver keeps the DMABUF attached
+    int slot = -1;
+    if (frame->frame_id < (uint32_t)m2m->input_count &&
+        m2m->inputs[frame->frame_id].state == M2M_BUFFER_FREE) {
+        slot = (int)frame->frame_id;
+    }
+    for (int i = 0; i < m2m->input_count && slot < 0; i++) {
+        if (m2m->inputs[i].state == M2M_BUFFER_FREE) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        libmedia_session_release_frame(session, &held);
+        media_set_last_error(MEDIA_ERROR_DEVICE_BUSY);
+        return -1;
+    }
+
+    m2m_export_t* e = m2m_export(m2m, session, frame);
+    if (!e) {
+        libmedia_session_release_frame(session, &held);
+        return -1;
+    }
+
+    struct v4l2_buffer buf;
+    struct v4l2_plane plane;
+    m2m_init_buf(m2m, &buf, &plane, m2m->input_type, V4L2_MEMORY_DMABUF, (uint32_t)slot);
+    if (m2m->mplane) {
+        plane.m.fd = e->fd;
+        plane.length = (uint32_t)e->length;
+    } else {
+        buf.m.fd = e->fd;
+        buf.length = (uint32_t)e->length;
+    }
+    m2m_set_payload(m2m, &buf, frame->size, frame->timestamp);
+    if (m2m_ioctl(m2m->fd, VIDIOC_QBUF, &buf) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_QBUF (M2M DMABUF %d) failed: %s", slot, strerror(errno));
+        libmedia_session_release_frame(session, &held);
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+
+    m2m_buffer_t* input = &m2m->inputs[slot];
+    input->state = M2M_BUFFER_QUEUED;
+    input->session = session;
+    input->frame = held;
+    m2m->stats.submitted++;
+    m2m->stats.in_flight++;
+    return 0;
+}
+
+int libmedia_m2m_get_fd(media_m2m_t* m2m)
+{
+    if (!m2m) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    return m2m->fd;
+}
+
+int libmedia_m2m_try_complete(media_m2m_t* m2m, media_frame_t* frame)
+{
+    if (!m2m || !frame) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (m2m_reap_inputs(m2m) < 0) {
+        return -1;
+    }
+
+    for (;;) {
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+        m2m_init_buf(m2m, &buf, &plane, m2m->output_type, V4L2_MEMORY_MMAP, 0);
+        if (m2m_ioctl(m2m->fd, VIDIOC_DQBUF, &buf) < 0) {
+            if (errno == EAGAIN) {
+                return 0;
+            }
+            MEDIA_DEBUG(DEBUG_ERROR, "VIDIOC_DQBUF (M2M capture) failed: %s", strerror(errno));
+            media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+            return -1;
+        }
+        if (buf.index >= (uint32_t)m2m->output_count) {
+            MEDIA_DEBUG(DEBUG_ERROR, "Invalid M2M buffer index %u", buf.index);
+            media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+            return -1;
+        }
+
+        if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+            m2m->stats.errors++;
+            if (m2m_queue_output(m2m, buf.index) < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        m2m_buffer_t* output = &m2m->outputs[buf.index];
+        output->state = M2M_BUFFER_DONE;
+        frame->data = output->start;
+        frame->size = m2m->mplane ? plane.bytesused : buf.bytesused;
+        frame->width = m2m->output_format.width;
+        frame->height = m2m->output_format.height;
+        frame->pixelformat = m2m->output_format.pixelformat;
+        frame->timestamp = (uint64_t)buf.timestamp.tv_sec * 1000000000ULL +
+                           (uint64_t)buf.timestamp.tv_usec * 1000ULL;
+        frame->frame_id = buf.index;
+        frame->sequence = buf.sequence;
+        frame->meta = &output->meta;
+        libmedia_meta_clear(frame->meta);
+        libmedia_meta_set(frame->meta, MEDIA_META_SEQUENCE, buf.sequence);
+        libmedia_meta_set(frame->meta, MEDIA_META_TIMESTAMP_NS, frame->timestamp);
+        libmedia_meta_set(frame->meta, MEDIA_META_DEQUEUE_NS, libmedia_get_timestamp_ns());
+        m2m->stats.completed++;
+        return 1;
+    }
+}
+
+int libmedia_m2m_complete(media_m2m_t* m2m, media_frame_t* frame, int timeout_ms)
+{
+    uint64_t deadline = timeout_ms >= 0 ? libmedia_get_timestamp_ns() + (uint64_t)timeout_ms * 1000000ULL : 0;
+
+    for (;;) {
+        int result = libmedia_m2m_try_complete(m2m, frame);
+        if (result != 0) {
+            return result > 0 ? 0 : -1;
+        }
+
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            uint64_t now = libmedia_get_timestamp_ns();
+            wait_ms = now >= deadline ? 0 : (int)((deadline - now + 999999) / 1000000);
+        }
+        struct pollfd pfd = { .fd = m2m->fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, wait_ms);
+        if (ready < 0 && errno != EINTR) {
+            MEDIA_DEBUG(DEBUG_ERROR, "poll failed on M2M device: %s", strerror(errno));
+            media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+            return -1;
+        }
+        if (ready == 0) {
+            media_set_last_error(MEDIA_ERROR_TIMEOUT);
+            return -1;
+        }
+        if (pfd.revents & POLLERR) {
+            // Nothing queued on one of the queues; only a submit can change that
+            result = libmedia_m2m_try_complete(m2m, frame);
+            if (result == 0) {
+                media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+            }
+            return result > 0 ? 0 : -1;
+        }
+    }
+}
+
+int libmedia_m2m_release_frame(media_m2m_t* m2m, const media_frame_t* frame)
+{
+    if (!m2m || !frame || frame->frame_id >= (uint32_t)m2m->output_count ||
+        m2m->outputs[frame->frame_id].state != M2M_BUFFER_DONE) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    return m2m_queue_output(m2m, frame->frame_id);
+}
+
+int libmedia_m2m_get_stats(media_m2m_t* m2m, media_m2m_stats_t* stats)
+{
+    if (!m2m || !stats) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    *stats = m2m->stats;
+    return 0;
+}
+
+void libmedia_m2m_destroy(media_m2m_t* m2m)
+{
+    if (!m2m) {
+        return;
+    }
+
+    // STREAMOFF hands every queued buffer back
+    enum v4l2_buf_type types[2] = { m2m->input_type, m2m->output_type };
+    for (int i = 0; i < 2 && types[i]; i++) {
+        m2m_ioctl(m2m->fd, VIDIOC_STREAMOFF, &types[i]);
+    }
+    for (int i = 0; i < m2m->input_count; i++) {
+        m2m_free_input(&m2m->inputs[i]);
+    }
+
+    for (int i = 0; i < MEDIA_M2M_MAX_BUFFERS; i++) {
+        if (m2m->inputs[i].start) {
+            munmap(m2m->inputs[i].start, m2m->inputs[i].length);
+        }
+        if (m2m->outputs[i].start) {
+            munmap(m2m->outputs[i].start, m2m->outputs[i].length);
+        }
+    }
+    if (m2m->input_type) {
+        struct v4l2_requestbuffers req;
+        memset(&req, 0, sizeof(req));
+        req.type = m2m->input_type;
+        req.memory = m2m->input_memory;
+        m2m_ioctl(m2m->fd, VIDIOC_REQBUFS, &req);
+        req.type = m2m->output_type;
+        req.memory = V4L2_MEMORY_MMAP;
+        m2m_ioctl(m2m->fd, VIDIOC_REQBUFS, &req);
+    }
+
+    for (int i = 0; i < m2m->export_count; i++) {
+        if (m2m->exports[i].generation) {
+            close(m2m->exports[i].fd);
+        }
+    }
+    media_budget_release(m2m->charged);
+    close(m2m->fd);
+    free(m2m);
+}
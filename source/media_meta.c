@@ -0,0 +1,205 @@
+/**
+ * @file media_meta.c
+ * @brief Per-frame metadata
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Slots are only ever appended while a block is in use. A writer claims a
+ * slot index, stores the value, and then publishes the key with release
+ * order. Readers scan the claimed slots and skip any whose key is not
+ * published yet. This needs no lock even when pipeline branches add keys
+ * concurrently.
+ */
+
+#include "media_meta.h"
+#include "media_internal.h"
+#include <string.h>
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint32_t meta_claimed(const media_meta_t* meta)
+{
+    uint32_t count = __atomic_load_n(&meta->count, __ATOMIC_ACQUIRE);
+    return count < MEDIA_META_MAX_ENTRIES ? count : MEDIA_META_MAX_ENTRIES;
+}
+
+static const media_meta_entry_t* meta_find(const media_meta_t* meta, uint32_t key)
+{
+    uint32_t count = meta_claimed(meta);
+    for (uint32_t i = 0; i < count; i++) {
+        if (__atomic_load_n(&meta->entries[i].key, __ATOMIC_ACQUIRE) == key) {
+            return &meta->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void meta_put_u32(uint8_t* p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint32_t meta_get_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// ============================================================================
+// Metadata API
+// ============================================================================
+
+void libmedia_meta_clear(media_meta_t* meta)
+{
+    if (!meta) {
+        return;
+    }
+
+    // Keys go back to 0 so a slot claimed later is not read with a stale key
+    uint32_t count = meta_claimed(meta);
+    for (uint32_t i = 0; i < count; i++) {
+        meta->entries[i].key = 0;
+    }
+    meta->dropped = 0;
+    __atomic_store_n(&meta->count, 0, __ATOMIC_RELEASE);
+}
+
+int libmedia_meta_set(media_meta_t* meta, uint32_t key, uint64_t value)
+{
+    if (!meta) {
+        return 0;
+    }
+    if (key == 0) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    media_meta_entry_t* entry = (media_meta_entry_t*)meta_find(meta, key);
+    if (entry) {
+        __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    uint32_t index = MEDIA_META_MAX_ENTRIES;
+    if (__atomic_load_n(&meta->count, __ATOMIC_RELAXED) < MEDIA_META_MAX_ENTRIES) {
+        index = __atomic_fetch_add(&meta->count, 1, __ATOMIC_RELAXED);
+    }
+    if (index >= MEDIA_META_MAX_ENTRIES) {
+        __atomic_fetch_add(&meta->dropped, 1, __ATOMIC_RELAXED);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    entry = &meta->entries[index];
+    __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->key, key, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int libmedia_meta_set_f64(media_meta_t* meta, uint32_t key, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return libmedia_meta_set(meta, key, bits);
+}
+
+int libmedia_meta_get(const media_meta_t* meta, uint32_t key, uint64_t* value)
+{
+    if (!meta || key == 0) {
+        return 0;
+    }
+
+    const media_meta_entry_t* entry = meta_find(meta, key);
+    if (!entry) {
+        return 0;
+    }
+    if (value) {
+        *value = __atomic_load_n(&entry->value, __ATOMIC_RELAXED);
+    }
+    return 1;
+}
+
+int libmedia_meta_get_f64(const media_meta_t* meta, uint32_t key, double* value)
+{
+    uint64_t bits;
+    if (!libmedia_meta_get(meta, key, &bits)) {
+        return 0;
+    }
+    if (value) {
+        memcpy(value, &bits, sizeof(*value));
+    }
+    return 1;
+}
+
+int libmedia_meta_merge(media_meta_t* dst, const media_meta_t* src)
+{
+    if (!dst || !src || dst == src) {
+        return 0;
+    }
+
+    int added = 0;
+    uint32_t count = meta_claimed(src);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t key = __atomic_load_n(&src->entries[i].key, __ATOMIC_ACQUIRE);
+        if (key && !meta_find(dst, key) &&
+            libmedia_meta_set(dst, key, __atomic_load_n(&src->entries[i].value, __ATOMIC_RELAXED)) == 0) {
+            added++;
+        }
+    }
+    return added;
+}
+
+size_t libmedia_meta_serialize(const media_meta_t* meta, void* buffer, size_t size)
+{
+    if (!buffer || size < 4) {
+        return 0;
+    }
+
+    uint8_t* out = buffer;
+    uint32_t written = 0;
+    size_t offset = 4;
+    uint32_t count = meta ? meta_claimed(meta) : 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t key = __atomic_load_n(&meta->entries[i].key, __ATOMIC_ACQUIRE);
+        if (!key) {
+            continue;
+        }
+        if (offset + 12 > size) {
+            return 0;
+        }
+        uint64_t value = __atomic_load_n(&meta->entries[i].value, __ATOMIC_RELAXED);
+        meta_put_u32(out + offset, key);
+        meta_put_u32(out + offset + 4, (uint32_t)value);
+        meta_put_u32(out + offset + 8, (uint32_t)(value >> 32));
+        offset += 12;
+        written++;
+    }
+    meta_put_u32(out, written);
+    return offset;
+}
+
+size_t libmedia_meta_deserialize(media_meta_t* meta, const void* buffer, size_t size)
+{
+    if (!meta || !buffer || size < 4) {
+        return 0;
+    }
+
+    const uint8_t* in = buffer;
+    uint32_t count = meta_get_u32(in);
+    if (count > MEDIA_META_MAX_ENTRIES || size < 4 + (size_t)count * 12) {
+        return 0;
+    }
+
+    libmedia_meta_clear(meta);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* p = in + 4 + i * 12;
+        uint64_t value = meta_get_u32(p + 4) | (uint64_t)meta_get_u32(p + 8) << 32;
+        if (libmedia_meta_set(meta, meta_get_u32(p), value) < 0) {
+            return 0;
+        }
+    }
+    return 4 + (size_t)count * 12;
+}
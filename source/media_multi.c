@@ -0,0 +1,324 @@
+/**
+ * @file media_multi.c
+ * @brief Single-thread multi-camera capture
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * One level-triggered epoll set holds every device fd plus an eventfd used
+ * to interrupt the wait on stop. A wakeup collects the ready cameras, orders
+ * them starting from a rotating index and then drains them in rounds of one
+ * non-blocking DQBUF per camera until each reports no more done buffers.
+ * Each device has only a handful of buffers, so the rounds always end.
+ */
+
+#include "media_multi.h"
+#include "media_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+// ============================================================================
+// Internal Data Structures
+// ============================================================================
+
+#define MULTI_WAKE_ID UINT32_MAX       /**< epoll data of the stop eventfd */
+
+/**
+ * @struct multi_camera
+ * @brief Registered session and its counters
+ */
+typedef struct {
+    media_session_t* session;           /**< Capture session */
+    media_multi_frame_fn on_frame;      /**< Frame callback */
+    void* user_data;                    /**< Callback argument */
+    int fd;                             /**< Device fd */
+    int enabled;                        /**< In the epoll set (atomic) */
+    uint64_t frames;                    /**< Frames delivered (atomic) */
+    uint64_t wakeups;                   /**< Ready notifications (atomic) */
+    uint64_t errors;                    /**< Capture errors (atomic) */
+} multi_camera_t;
+
+struct media_multi {
+    int epoll_fd;                                       /**< Device fds and wake_fd */
+    int wake_fd;                                        /**< Interrupts epoll_wait on stop */
+    multi_camera_t cameras[MEDIA_MULTI_MAX_SESSIONS];
+    int camera_count;                                   /**< Ids handed out */
+    uint32_t next;                                      /**< Camera served first on the next wakeup */
+    int running;                                        /**< Library thread should keep going (atomic) */
+    int started;                                        /**< Library thread exists */
+    pthread_t thread;
+};
+
+// ============================================================================
+// Servicing
+// ============================================================================
+
+/**
+ * @brief Stop servicing a camera after an error or on request
+ */
+static void multi_disable(media_multi_t* multi, multi_camera_t* cam)
+{
+    if (__atomic_load_n(&cam->enabled, __ATOMIC_RELAXED)) {
+        epoll_ctl(multi->epoll_fd, EPOLL_CTL_DEL, cam->fd, NULL);
+        __atomic_store_n(&cam->enabled, 0, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Dequeue one frame of a ready camera and hand it to the callback
+ * @return 1 if a frame was delivered, 0 if the camera has no more
+ */
+static int multi_service(media_multi_t* multi, int id, uint32_t revents)
+{
+    multi_camera_t* cam = &multi->cameras[id];
+    if (!__atomic_load_n(&cam->enabled, __ATOMIC_RELAXED)) {
+        return 0;   // Removed by an earlier callback
+    }
+
+    media_frame_t frame;
+    int result = libmedia_session_try_capture(cam->session, &frame);
+    if (result == 0 && !(revents & (EPOLLERR | EPOLLHUP))) {
+        return 0;
+    }
+    if (result <= 0) {
+        // Ready with an error and nothing to dequeue: streaming stopped or the device failed
+        MEDIA_DEBUG(DEBUG_ERROR, "Camera %d failed, no longer serviced", id);
+        __atomic_fetch_add(&cam->errors, 1, __ATOMIC_RELAXED);
+        multi_disable(multi, cam);
+        return 0;
+    }
+
+    __atomic_fetch_add(&cam->frames, 1, __ATOMIC_RELAXED);
+    if (cam->on_frame(cam->user_data, id, cam->session, &frame) == 0) {
+        libmedia_session_release_frame(cam->session, &frame);
+    }
+    return 1;
+}
+
+int libmedia_multi_run_once(media_multi_t* multi, int timeout_ms)
+{
+    if (!multi) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    struct epoll_event events[MEDIA_MULTI_MAX_SESSIONS + 1];
+    int count = epoll_wait(multi->epoll_fd, events, MEDIA_MULTI_MAX_SESSIONS + 1, timeout_ms);
+    if (count < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        MEDIA_DEBUG(DEBUG_ERROR, "epoll_wait failed: %s", strerror(errno));
+        media_set_last_error(MEDIA_ERROR_IOCTL_FAILED);
+        return -1;
+    }
+
+    // Ready cameras in round-robin order starting at multi->next
+    uint32_t revents[MEDIA_MULTI_MAX_SESSIONS] = { 0 };
+    for (int i = 0; i < count; i++) {
+        uint32_t id = events[i].data.u32;
+        if (id == MULTI_WAKE_ID) {
+            uint64_t value;
+            ssize_t cleared = read(multi->wake_fd, &value, sizeof(value));
+            (void)cleared;
+            continue;
+        }
+        revents[id] = events[i].events;
+        __atomic_fetch_add(&multi->cameras[id].wakeups, 1, __ATOMIC_RELAXED);
+    }
+
+    int ready[MEDIA_MULTI_MAX_SESSIONS];
+    int ready_count = 0;
+    for (int i = 0; i < multi->camera_count; i++) {
+        int id = (int)((multi->next + i) % multi->camera_count);
+        if (revents[id]) {
+            ready[ready_count++] = id;
+        }
+    }
+    if (multi->camera_count > 0) {
+        multi->next = (multi->next + 1) % multi->camera_count;
+    }
+
+    // One frame per camera per round; drop cameras from the round once drained
+    int delivered = 0;
+    while (ready_count > 0) {
+        int kept = 0;
+        for (int i = 0; i < ready_count; i++) {
+            if (multi_service(multi, ready[i], revents[ready[i]])) {
+                delivered++;
+                ready[kept++] = ready[i];
+            }
+        }
+        ready_count = kept;
+    }
+    return delivered;
+}
+
+// ============================================================================
+// Driver API
+// ============================================================================
+
+media_multi_t* libmedia_multi_create(void)
+{
+    media_multi_t* multi = calloc(1, sizeof(media_multi_t));
+    if (!multi) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    multi->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    multi->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = MULTI_WAKE_ID };
+    if (multi->epoll_fd < 0 || multi->wake_fd < 0 ||
+        epoll_ctl(multi->epoll_fd, EPOLL_CTL_ADD, multi->wake_fd, &ev) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Failed to create multi-camera event set: %s", strerror(errno));
+        if (multi->epoll_fd >= 0) {
+            close(multi->epoll_fd);
+        }
+        if (multi->wake_fd >= 0) {
+            close(multi->wake_fd);
+        }
+        free(multi);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    return multi;
+}
+
+int libmedia_multi_add(media_multi_t* multi, media_session_t* session,
+                       media_multi_frame_fn on_frame, void* user_data)
+{
+    if (!multi || !session || !on_frame) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (multi->camera_count >= MEDIA_MULTI_MAX_SESSIONS) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    int fd = libmedia_session_get_fd(session);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int id = multi->camera_count;
+    multi_camera_t* cam = &multi->cameras[id];
+    memset(cam, 0, sizeof(*cam));
+    cam->session = session;
+    cam->on_frame = on_frame;
+    cam->user_data = user_data;
+    cam->fd = fd;
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)id };
+    if (epoll_ctl(multi->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Failed to watch camera fd %d: %s", fd, strerror(errno));
+        media_set_last_error(errno == EEXIST ? MEDIA_ERROR_DEVICE_BUSY : MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    __atomic_store_n(&cam->enabled, 1, __ATOMIC_RELAXED);
+    multi->camera_count++;
+    return id;
+}
+
+int libmedia_multi_remove(media_multi_t* multi, int camera)
+{
+    if (!multi || camera < 0 || camera >= multi->camera_count) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    multi_disable(multi, &multi->cameras[camera]);
+    return 0;
+}
+
+int libmedia_multi_get_fd(media_multi_t* multi)
+{
+    if (!multi) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    return multi->epoll_fd;
+}
+
+static void* multi_thread_main(void* arg)
+{
+    media_multi_t* multi = arg;
+    while (__atomic_load_n(&multi->running, __ATOMIC_ACQUIRE)) {
+        if (libmedia_multi_run_once(multi, -1) < 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+int libmedia_multi_start(media_multi_t* multi)
+{
+    if (!multi) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (multi->started) {
+        return 0;
+    }
+
+    __atomic_store_n(&multi->running, 1, __ATOMIC_RELEASE);
+    if (media_thread_create(&multi->thread, MEDIA_THREAD_CAPTURE, "media-multi", multi_thread_main, multi) != 0) {
+        __atomic_store_n(&multi->running, 0, __ATOMIC_RELEASE);
+        MEDIA_DEBUG(DEBUG_ERROR, "Failed to start multi-camera thread");
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+    multi->started = 1;
+    MEDIA_DEBUG(DEBUG_INFO, "Multi-camera driver started with %d cameras", multi->camera_count);
+    return 0;
+}
+
+int libmedia_multi_stop(media_multi_t* multi)
+{
+    if (!multi) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (!multi->started) {
+        return 0;
+    }
+
+    __atomic_store_n(&multi->running, 0, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    ssize_t written = write(multi->wake_fd, &one, sizeof(one));
+    (void)written;
+    pthread_join(multi->thread, NULL);
+    multi->started = 0;
+    MEDIA_DEBUG(DEBUG_INFO, "Multi-camera driver stopped");
+    return 0;
+}
+
+int libmedia_multi_get_stats(const media_multi_t* multi, int camera, media_multi_stats_t* stats)
+{
+    if (!multi || !stats || camera < 0 || camera >= multi->camera_count) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    const multi_camera_t* cam = &multi->cameras[camera];
+    stats->frames = __atomic_load_n(&cam->frames, __ATOMIC_RELAXED);
+    stats->wakeups = __atomic_load_n(&cam->wakeups, __ATOMIC_RELAXED);
+    stats->errors = __atomic_load_n(&cam->errors, __ATOMIC_RELAXED);
+    stats->enabled = __atomic_load_n(&cam->enabled, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void libmedia_multi_destroy(media_multi_t* multi)
+{
+    if (!multi) {
+        return;
+    }
+
+    libmedia_multi_stop(multi);
+    close(multi->wake_fd);
+    close(multi->epoll_fd);
+    free(multi);
+}
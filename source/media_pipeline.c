@@ -0,0 +1,1030 @@
+/**
+ * @file media_pipeline.c
+ * @brief Processing pipeline: nodes, bounded queues and worker threads
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Every source owns a thread that produces packets and pushes one reference
+ * into the input queue of each linked stage. Stages are grouped into
+ * workers: a dedicated worker serves one stage, a shared worker serves its
+ * stages round robin. Input queues are lock-free rings (SPSC for a single
+ * upstream, MPSC when several nodes feed a stage). A push into a full queue
+ * applies the consuming stage's backpressure policy: drop the new packet,
+ * evict the oldest one (the ring then also allows the producer to pop), or
+ * wait on the queue's space event for a bounded time. Workers sleep on a
+ * futex event count that a push only touches when the worker is actually
+ * asleep. Sources with a deadline stamp each packet with its buffer
+ * timestamp plus a latency budget; optional stages pass late packets
+ * through untouched instead of processing them. Sampling is decided per
+ * link by the upstream node's thread, which owns the link's state, so it
+ * needs no synchronization and a withheld packet never touches the queue.
+ */
+
+#include "media_pipeline.h"
+#include "media_meta.h"
+#include "media_internal.h"
+#include "media_ring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// ============================================================================
+// Internal Constants and Data Structures
+// ============================================================================
+
+#define PIPELINE_DEFAULT_QUEUE_DEPTH 4
+#define PIPELINE_DEFAULT_BLOCK_TIMEOUT_MS 1000
+#define PIPELINE_SOURCE_TIMEOUT_MS 100      /**< Source poll period, bounds stop latency */
+#define PIPELINE_MAX_TIMESTAMP_AGE_NS 1000000000ULL /**< Older frame timestamps are taken to be on another clock */
+
+typedef struct pipeline_node pipeline_node_t;
+typedef struct pipeline_worker pipeline_worker_t;
+
+/**
+ * @struct pipeline_packet
+ * @brief Packet header with reference count and recycling link
+ */
+typedef struct pipeline_packet {
+    media_packet_t pub;                 /**< Public part, must be first */
+    int refcount;                       /**< Reference count (atomic) */
+    media_packet_release_fn release;    /**< Producer release callback */
+    void* opaque;                       /**< Release callback context */
+    media_pipeline_t* pipeline;         /**< Owning pipeline */
+    struct pipeline_packet* next;       /**< Free list link */
+    media_meta_t meta;                  /**< Metadata for frames that bring none */
+} pipeline_packet_t;
+
+/**
+ * @struct pipeline_queue
+ * @brief Bounded input queue of packet references
+ */
+typedef struct {
+    media_ring_t ring;          /**< Lock-free storage, built at start */
+    uint32_t depth;             /**< Requested capacity */
+    media_backpressure_t policy;    /**< Full queue policy */
+    int block_timeout_ms;       /**< Longest producer wait for MEDIA_BACKPRESSURE_BLOCK, -1 = no limit */
+    media_event_t space;        /**< Signalled when a blocking queue is drained */
+    uint32_t high_water;        /**< Largest count seen (atomic) */
+    uint64_t dropped;           /**< References discarded by the policy (atomic) */
+    uint64_t decimated;         /**< References withheld by the sampling policy (atomic) */
+    uint64_t blocked_ns;        /**< Producer time spent waiting for room (atomic) */
+} pipeline_queue_t;
+
+/**
+ * @struct pipeline_counters
+ * @brief Node counters, written by the node's thread and read atomically
+ */
+typedef struct {
+    uint64_t packets_in;
+    uint64_t packets_out;
+    uint64_t errors;
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+    uint64_t age_sum_ns;
+    uint64_t skipped;
+} pipeline_counters_t;
+
+/**
+ * @struct pipeline_deadline
+ * @brief Deadline settings and period estimate of a source
+ */
+typedef struct {
+    uint32_t periods;           /**< Latency budget in frame periods, 0 = no deadline */
+    uint64_t period_ns;         /**< Configured frame period, 0 = measured */
+    uint64_t measured_ns;       /**< Smoothed interval between frame timestamps */
+    uint64_t last_timestamp;    /**< Previous frame timestamp */
+} pipeline_deadline_t;
+
+/**
+ * @struct pipeline_sampler
+ * @brief Sampling state of one link, kept by the upstream node's thread
+ */
+typedef struct {
+    uint64_t seen;              /**< Packets offered (MEDIA_SAMPLE_EVERY_NTH) */
+    uint64_t next_ns;           /**< Schedule of the next delivery, 0 = none yet (MEDIA_SAMPLE_MAX_RATE) */
+    uint64_t slot;              /**< Interval index of the last delivery + 1, 0 = none yet (MEDIA_SAMPLE_ALIGNED) */
+} pipeline_sampler_t;
+
+struct pipeline_node {
+    char name[32];                          /**< Node name */
+    int id;                                 /**< Index in the pipeline */
+    int is_source;                          /**< Node produces packets */
+    media_pipeline_t* pipeline;             /**< Owning pipeline */
+    media_session_t* session;               /**< Capture session of a session source */
+    media_source_fn produce;                /**< Source callback */
+    media_stage_fn process;                 /**< Stage callback */
+    void* user_data;                        /**< Callback context */
+    int optional;                           /**< Skip late packets */
+    media_sampling_t sampling;              /**< Packets to receive from each upstream node */
+    uint32_t sample_every;                  /**< Decimation factor */
+    uint64_t sample_interval_ns;            /**< Sampling period */
+    pipeline_deadline_t deadline;           /**< Packet deadlines (sources only) */
+    int worker_id;                          /**< Requested shared worker, 0 = dedicated */
+    pipeline_worker_t* worker;              /**< Thread serving the node */
+    pipeline_queue_t queue;                 /**< Input queue (stages only) */
+    pipeline_node_t* links[MEDIA_PIPELINE_MAX_LINKS];  /**< Downstream stages */
+    pipeline_sampler_t samplers[MEDIA_PIPELINE_MAX_LINKS];  /**< Sampling state per link */
+    int link_count;                         /**< Number of downstream stages */
+    pipeline_counters_t counters;           /**< Statistics */
+};
+
+struct pipeline_worker {
+    media_pipeline_t* pipeline;             /**< Owning pipeline */
+    pthread_t thread;                       /**< Worker thread */
+    int started;                            /**< Thread is running */
+    int shared_id;                          /**< Shared worker id, 0 = dedicated */
+    media_event_t event;                    /**< Signalled on push and stop */
+    pipeline_node_t* nodes[MEDIA_PIPELINE_MAX_NODES];  /**< Nodes served */
+    int node_count;                         /**< Number of nodes served */
+};
+
+struct media_pipeline {
+    pipeline_node_t nodes[MEDIA_PIPELINE_MAX_NODES];
+    int node_count;
+    pipeline_worker_t workers[MEDIA_PIPELINE_MAX_NODES];
+    int worker_count;
+    int running;                            /**< Threads should keep going (atomic) */
+    pthread_mutex_t packet_lock;            /**< Protects free_packets */
+    pipeline_packet_t* free_packets;        /**< Recycled packet headers */
+};
+
+static inline int pipeline_running(const media_pipeline_t* pipeline)
+{
+    return __atomic_load_n(&pipeline->running, __ATOMIC_ACQUIRE);
+}
+
+static inline void counter_add(uint64_t* counter, uint64_t value)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Buffer timestamp of a packet, or its capture time if the frame has none
+ */
+static uint64_t packet_timestamp(const media_packet_t* packet)
+{
+    // V4L2 stamps buffers on CLOCK_MONOTONIC, like capture_ns; anything else falls back to capture time
+    uint64_t timestamp = packet->frame.timestamp;
+    if (timestamp == 0 || timestamp > packet->capture_ns ||
+        packet->capture_ns - timestamp > PIPELINE_MAX_TIMESTAMP_AGE_NS) {
+        timestamp = packet->capture_ns;
+    }
+    return timestamp;
+}
+
+// ============================================================================
+// Packets
+// ============================================================================
+
+media_packet_t* libmedia_packet_create(media_pipeline_t* pipeline, const media_frame_t* frame,
+                                       media_packet_release_fn release, void* opaque)
+{
+    if (!pipeline || !frame) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pipeline->packet_lock);
+    pipeline_packet_t* packet = pipeline->free_packets;
+    if (packet) {
+        pipeline->free_packets = packet->next;
+    }
+    pthread_mutex_unlock(&pipeline->packet_lock);
+
+    if (!packet) {
+        packet = malloc(sizeof(pipeline_packet_t));
+        if (!packet) {
+            media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    memset(packet, 0, sizeof(*packet));
+    packet->pub.frame = *frame;
+    if (!frame->meta) {
+        packet->pub.frame.meta = &packet->meta;
+    }
+    packet->pub.capture_ns = libmedia_get_timestamp_ns();
+    packet->pub.source = -1;
+    packet->refcount = 1;
+    packet->release = release;
+    packet->opaque = opaque;
+    packet->pipeline = pipeline;
+    return &packet->pub;
+}
+
+void libmedia_packet_ref(media_packet_t* packet)
+{
+    if (packet) {
+        __atomic_fetch_add(&((pipeline_packet_t*)packet)->refcount, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void libmedia_packet_unref(media_packet_t* packet)
+{
+    if (!packet) {
+        return;
+    }
+
+    pipeline_packet_t* p = (pipeline_packet_t*)packet;
+    if (__atomic_sub_fetch(&p->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+
+    if (p->release) {
+        p->release(p->opaque, packet);
+    }
+
+    media_pipeline_t* pipeline = p->pipeline;
+    pthread_mutex_lock(&pipeline->packet_lock);
+    p->next = pipeline->free_packets;
+    pipeline->free_packets = p;
+    pthread_mutex_unlock(&pipeline->packet_lock);
+}
+
+// ============================================================================
+// Queues
+// ============================================================================
+
+/**
+ * @brief Wait for room in a MEDIA_BACKPRESSURE_BLOCK queue
+ * @return 1 if the packet was queued
+ */
+static int queue_wait_push(pipeline_node_t* node, media_packet_t* packet)
+{
+    pipeline_queue_t* q = &node->queue;
+    uint64_t start = libmedia_get_timestamp_ns();
+    uint64_t deadline = q->block_timeout_ms < 0 ? UINT64_MAX : start + (uint64_t)q->block_timeout_ms * 1000000ULL;
+    int pushed = 0;
+
+    for (;;) {
+        // Announce the wait before the last attempt so a concurrent pop or stop cannot be missed
+        uint32_t key = media_event_prepare(&q->space);
+        if (media_ring_push(&q->ring, packet) == 0) {
+            pushed = 1;
+            break;
+        }
+        if (!pipeline_running(node->pipeline)) {
+            break;
+        }
+
+        uint64_t now = libmedia_get_timestamp_ns();
+        if (now >= deadline) {
+            break;
+        }
+        media_event_wait(&q->space, key, deadline == UINT64_MAX ? -1 : (int)((deadline - now + 999999) / 1000000));
+    }
+
+    __atomic_fetch_add(&q->blocked_ns, libmedia_get_timestamp_ns() - start, __ATOMIC_RELAXED);
+    return pushed;
+}
+
+/**
+ * @brief Append a packet reference, applying the stage's backpressure policy when full
+ * @return 0 if queued, -1 if discarded (the reference stays with the caller)
+ */
+static int queue_push(pipeline_node_t* node, media_packet_t* packet)
+{
+    pipeline_queue_t* q = &node->queue;
+
+    if (q->policy == MEDIA_BACKPRESSURE_KEEP_LATEST) {
+        // The ring has a spare slot; replace whatever is queued
+        media_packet_t* stale;
+        while ((stale = media_ring_pop(&q->ring)) != NULL) {
+            __atomic_fetch_add(&q->dropped, 1, __ATOMIC_RELAXED);
+            libmedia_packet_unref(stale);
+        }
+    }
+    int pushed = media_ring_push(&q->ring, packet) == 0;
+
+    if (!pushed) {
+        switch (q->policy) {
+            case MEDIA_BACKPRESSURE_DROP_OLDEST:
+            case MEDIA_BACKPRESSURE_KEEP_LATEST:
+                // Each eviction frees a slot unless another producer takes it first
+                for (uint32_t i = 0; !pushed && i <= media_ring_capacity(&q->ring); i++) {
+                    media_packet_t* oldest = media_ring_pop(&q->ring);
+                    if (oldest) {
+                        __atomic_fetch_add(&q->dropped, 1, __ATOMIC_RELAXED);
+                        libmedia_packet_unref(oldest);
+                    }
+                    pushed = media_ring_push(&q->ring, packet) == 0;
+                }
+                break;
+            case MEDIA_BACKPRESSURE_BLOCK:
+                pushed = queue_wait_push(node, packet);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!pushed) {
+        __atomic_fetch_add(&q->dropped, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    uint32_t count = media_ring_count(&q->ring);
+    uint32_t high = __atomic_load_n(&q->high_water, __ATOMIC_RELAXED);
+    while (count > high && !__atomic_compare_exchange_n(&q->high_water, &high, count, 1,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    media_event_signal(&node->worker->event);
+    return 0;
+}
+
+/**
+ * @brief Take the oldest packet of a stage's input queue (worker side)
+ */
+static media_packet_t* queue_pop(pipeline_node_t* node)
+{
+    media_packet_t* packet = media_ring_pop(&node->queue.ring);
+    if (packet && node->queue.policy == MEDIA_BACKPRESSURE_BLOCK) {
+        media_event_signal(&node->queue.space);
+    }
+    return packet;
+}
+
+/**
+ * @brief Decide whether a link passes a packet on to its stage
+ * @return 1 to deliver, 0 to withhold
+ */
+static int link_sample(const pipeline_node_t* link, pipeline_sampler_t* s, const media_packet_t* packet)
+{
+    uint64_t interval = link->sample_interval_ns;
+
+    switch (link->sampling) {
+        case MEDIA_SAMPLE_EVERY_NTH:
+            return s->seen++ % link->sample_every == 0;
+        case MEDIA_SAMPLE_MAX_RATE: {
+            uint64_t t = packet_timestamp(packet);
+            // A schedule that was never this far ahead means the timestamps went backwards
+            if (s->next_ns > t + 2 * interval) {
+                s->next_ns = 0;
+            }
+            // A quarter interval of slack absorbs timestamp jitter; the schedule keeps the average rate
+            if (s->next_ns && t + interval / 4 < s->next_ns) {
+                return 0;
+            }
+            s->next_ns = s->next_ns && t < s->next_ns + interval ? s->next_ns + interval : t + interval;
+            return 1;
+        }
+        case MEDIA_SAMPLE_ALIGNED: {
+            uint64_t slot = packet_timestamp(packet) / interval + 1;
+            if (slot == s->slot) {
+                return 0;
+            }
+            s->slot = slot;
+            return 1;
+        }
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Hand one packet reference to every downstream stage
+ *
+ * Consumes the caller's reference. Links whose sampling policy withholds
+ * the packet are decided first and never see it. Stages that may make the
+ * producer wait are served last, so they never delay delivery to the others.
+ */
+static void node_deliver(pipeline_node_t* node, media_packet_t* packet)
+{
+    int selected[MEDIA_PIPELINE_MAX_LINKS];
+    int delivered = 0;
+
+    for (int i = 0; i < node->link_count; i++) {
+        pipeline_node_t* link = node->links[i];
+        selected[i] = link_sample(link, &node->samplers[i], packet);
+        if (!selected[i]) {
+            __atomic_fetch_add(&link->queue.decimated, 1, __ATOMIC_RELAXED);
+        }
+        delivered |= selected[i];
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < node->link_count; i++) {
+            pipeline_node_t* link = node->links[i];
+            if (!selected[i] || (link->queue.policy == MEDIA_BACKPRESSURE_BLOCK) != pass) {
+                continue;
+            }
+            libmedia_packet_ref(packet);
+            if (queue_push(link, packet) < 0) {
+                libmedia_packet_unref(packet);
+            }
+        }
+    }
+    if (delivered) {
+        counter_add(&node->counters.packets_out, 1);
+    }
+    libmedia_packet_unref(packet);
+}
+
+// ============================================================================
+// Node Threads
+// ============================================================================
+
+static void stage_run(pipeline_node_t* node, media_packet_t* packet)
+{
+    media_packet_t* output = packet;
+    uint64_t start = libmedia_get_timestamp_ns();
+
+    if (node->optional && packet->deadline_ns && start >= packet->deadline_ns) {
+        counter_add(&node->counters.skipped, 1);
+        node_deliver(node, packet);
+        return;
+    }
+
+    int result = node->process(node->user_data, packet, &output);
+    uint64_t end = libmedia_get_timestamp_ns();
+
+    pipeline_counters_t* c = &node->counters;
+    counter_add(&c->packets_in, 1);
+    counter_add(&c->latency_sum_ns, end - start);
+    counter_add(&c->age_sum_ns, end - packet->capture_ns);
+    if (end - start > c->latency_max_ns) {
+        __atomic_store_n(&c->latency_max_ns, end - start, __ATOMIC_RELAXED);
+    }
+
+    if (result < 0) {
+        counter_add(&c->errors, 1);
+        MEDIA_DEBUG(DEBUG_WARNING, "Stage %s failed on frame %u", node->name, packet->frame.frame_id);
+        if (output != packet) {
+            libmedia_packet_unref(output);
+        }
+        output = NULL;
+    }
+
+    if (output != packet) {
+        // A derived frame keeps the origin of its input so ages stay end to end
+        if (output) {
+            output->capture_ns = packet->capture_ns;
+            output->deadline_ns = packet->deadline_ns;
+            output->source = packet->source;
+            libmedia_meta_merge(output->frame.meta, packet->frame.meta);
+        }
+        libmedia_packet_unref(packet);
+    }
+    if (output) {
+        libmedia_meta_set(output->frame.meta, MEDIA_META_STAGE_NS + (uint32_t)node->id, end - start);
+        node_deliver(node, output);
+    }
+}
+
+static int worker_has_work(const pipeline_worker_t* worker)
+{
+    for (int i = 0; i < worker->node_count; i++) {
+        if (media_ring_count(&worker->nodes[i]->queue.ring) > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void* stage_worker_main(void* arg)
+{
+    pipeline_worker_t* worker = arg;
+    media_pipeline_t* pipeline = worker->pipeline;
+
+    while (pipeline_running(pipeline)) {
+        // Round robin, one packet per stage per pass
+        int progress = 0;
+        for (int i = 0; i < worker->node_count && pipeline_running(pipeline); i++) {
+            media_packet_t* packet = queue_pop(worker->nodes[i]);
+            if (packet) {
+                stage_run(worker->nodes[i], packet);
+                progress = 1;
+            }
+        }
+        if (progress) {
+            continue;
+        }
+
+        // Re-check after announcing the wait so a concurrent push or stop cannot be missed
+        uint32_t key = media_event_prepare(&worker->event);
+        if (pipeline_running(pipeline) && !worker_has_work(worker)) {
+            media_event_wait(&worker->event, key, -1);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Set a packet's deadline from its buffer timestamp and the frame period
+ */
+static void source_stamp_deadline(pipeline_deadline_t* d, media_packet_t* packet)
+{
+    uint64_t timestamp = packet_timestamp(packet);
+    if (d->last_timestamp && timestamp > d->last_timestamp) {
+        uint64_t interval = timestamp - d->last_timestamp;
+        d->measured_ns = d->measured_ns ? (d->measured_ns * 7 + interval) / 8 : interval;
+    }
+    d->last_timestamp = timestamp;
+
+    uint64_t period = d->period_ns ? d->period_ns : d->measured_ns;
+    if (period) {
+        packet->deadline_ns = timestamp + period * d->periods;
+    }
+}
+
+static void* source_worker_main(void* arg)
+{
+    pipeline_worker_t* worker = arg;
+    media_pipeline_t* pipeline = worker->pipeline;
+    pipeline_node_t* node = worker->nodes[0];
+
+    while (pipeline_running(pipeline)) {
+        media_packet_t* packet = NULL;
+        int result = node->produce(node->user_data, &packet, PIPELINE_SOURCE_TIMEOUT_MS);
+        if (result < 0) {
+            counter_add(&node->counters.errors, 1);
+            MEDIA_DEBUG(DEBUG_WARNING, "Source %s ended", node->name);
+            break;
+        }
+        if (result == 0 || !packet) {
+            continue;
+        }
+
+        packet->source = node->id;
+        if (node->deadline.periods && !packet->deadline_ns) {
+            source_stamp_deadline(&node->deadline, packet);
+        }
+        counter_add(&node->counters.packets_in, 1);
+        node_deliver(node, packet);
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Session Source
+// ============================================================================
+
+static void session_packet_release(void* opaque, media_packet_t* packet)
+{
+    libmedia_session_release_frame(opaque, &packet->frame);
+}
+
+static int session_source_produce(void* user_data, media_packet_t** packet, int timeout_ms)
+{
+    pipeline_node_t* node = user_data;
+    media_frame_t frame = { 0 };
+
+    // A capture timeout also returns 0, with the frame left untouched
+    if (libmedia_session_capture_frame(node->session, &frame, timeout_ms) < 0) {
+        return libmedia_get_last_error() == MEDIA_ERROR_TIMEOUT ? 0 : -1;
+    }
+    if (!frame.data) {
+        return 0;
+    }
+
+    *packet = libmedia_packet_create(node->pipeline, &frame, session_packet_release, node->session);
+    if (!*packet) {
+        libmedia_session_release_frame(node->session, &frame);
+        return 0;
+    }
+    return 1;
+}
+
+// ============================================================================
+// Graph Construction
+// ============================================================================
+
+media_pipeline_t* libmedia_pipeline_create(void)
+{
+    media_pipeline_t* pipeline = calloc(1, sizeof(media_pipeline_t));
+    if (!pipeline) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pipeline->packet_lock, NULL);
+    MEDIA_DEBUG(DEBUG_INFO, "Pipeline created");
+    return pipeline;
+}
+
+static pipeline_node_t* pipeline_new_node(media_pipeline_t* pipeline, const char* name)
+{
+    if (!pipeline || pipeline_running(pipeline) || pipeline->node_count >= MEDIA_PIPELINE_MAX_NODES) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    pipeline_node_t* node = &pipeline->nodes[pipeline->node_count];
+    memset(node, 0, sizeof(*node));
+    node->id = pipeline->node_count;
+    node->pipeline = pipeline;
+    snprintf(node->name, sizeof(node->name), "%s", name ? name : "node");
+    return node;
+}
+
+int libmedia_pipeline_add_source(media_pipeline_t* pipeline, const char* name,
+                                 media_source_fn produce, void* user_data)
+{
+    if (!produce) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pipeline_node_t* node = pipeline_new_node(pipeline, name);
+    if (!node) {
+        return -1;
+    }
+
+    node->is_source = 1;
+    node->produce = produce;
+    node->user_data = user_data;
+    return pipeline->node_count++;
+}
+
+int libmedia_pipeline_add_session_source(media_pipeline_t* pipeline, const char* name,
+                                         media_session_t* session)
+{
+    if (!session) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pipeline_node_t* node = pipeline_new_node(pipeline, name);
+    if (!node) {
+        return -1;
+    }
+
+    node->is_source = 1;
+    node->session = session;
+    node->produce = session_source_produce;
+    node->user_data = node;
+    return pipeline->node_count++;
+}
+
+int libmedia_pipeline_add_stage(media_pipeline_t* pipeline, const media_stage_config_t* config)
+{
+    if (!config || !config->process || config->queue_depth < 0 || config->worker < 0 ||
+        config->backpressure < MEDIA_BACKPRESSURE_DROP_NEWEST || config->backpressure > MEDIA_BACKPRESSURE_BLOCK ||
+        config->sampling < MEDIA_SAMPLE_ALL || config->sampling > MEDIA_SAMPLE_ALIGNED ||
+        (config->sampling == MEDIA_SAMPLE_EVERY_NTH && config->sample_every == 0) ||
+        (config->sampling >= MEDIA_SAMPLE_MAX_RATE && config->sample_interval_ns == 0)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pipeline_node_t* node = pipeline_new_node(pipeline, config->name);
+    if (!node) {
+        return -1;
+    }
+
+    node->queue.depth = config->queue_depth ? (uint32_t)config->queue_depth : PIPELINE_DEFAULT_QUEUE_DEPTH;
+    node->queue.policy = config->backpressure;
+    node->queue.block_timeout_ms = config->block_timeout_ms ? config->block_timeout_ms : PIPELINE_DEFAULT_BLOCK_TIMEOUT_MS;
+    if (node->queue.policy == MEDIA_BACKPRESSURE_KEEP_LATEST) {
+        node->queue.depth = 1;
+    }
+    node->process = config->process;
+    node->user_data = config->user_data;
+    node->optional = config->optional;
+    node->sampling = config->sampling;
+    node->sample_every = config->sample_every;
+    node->sample_interval_ns = config->sample_interval_ns;
+    node->worker_id = config->worker;
+    return pipeline->node_count++;
+}
+
+/**
+ * @brief Check whether `to` is reachable downstream of `from`
+ */
+static int node_reaches(const pipeline_node_t* from, const pipeline_node_t* to)
+{
+    if (from == to) {
+        return 1;
+    }
+    for (int i = 0; i < from->link_count; i++) {
+        if (node_reaches(from->links[i], to)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int libmedia_pipeline_link(media_pipeline_t* pipeline, int from, int to)
+{
+    if (!pipeline || pipeline_running(pipeline) ||
+        from < 0 || from >= pipeline->node_count || to < 0 || to >= pipeline->node_count) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pipeline_node_t* src = &pipeline->nodes[from];
+    pipeline_node_t* dst = &pipeline->nodes[to];
+
+    // Cycles would let a full queue wait on itself
+    if (dst->is_source || src->link_count >= MEDIA_PIPELINE_MAX_LINKS || node_reaches(dst, src)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    // A blocking push would wait for the very thread that is pushing
+    if (dst->queue.policy == MEDIA_BACKPRESSURE_BLOCK && src->worker_id > 0 && src->worker_id == dst->worker_id) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Stage %s blocks its producer %s on their shared worker %d",
+                    dst->name, src->name, dst->worker_id);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    for (int i = 0; i < src->link_count; i++) {
+        if (src->links[i] == dst) {
+            return 0;
+        }
+    }
+
+    src->links[src->link_count++] = dst;
+    MEDIA_DEBUG(DEBUG_INFO, "Pipeline link %s -> %s", src->name, dst->name);
+    return 0;
+}
+
+int libmedia_pipeline_set_deadline(media_pipeline_t* pipeline, int source,
+                                   uint64_t period_ns, uint32_t periods)
+{
+    if (!pipeline || pipeline_running(pipeline) || source < 0 || source >= pipeline->node_count ||
+        !pipeline->nodes[source].is_source) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pipeline_deadline_t* d = &pipeline->nodes[source].deadline;
+    memset(d, 0, sizeof(*d));
+    d->period_ns = period_ns;
+    d->periods = periods;
+    return 0;
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+/**
+ * @brief Find or create the worker serving a node
+ */
+static pipeline_worker_t* pipeline_assign_worker(media_pipeline_t* pipeline, pipeline_node_t* node)
+{
+    int shared = node->is_source ? 0 : node->worker_id;
+
+    if (shared > 0) {
+        for (int i = 0; i < pipeline->worker_count; i++) {
+            if (pipeline->workers[i].shared_id == shared) {
+                pipeline_worker_t* worker = &pipeline->workers[i];
+                worker->nodes[worker->node_count++] = node;
+                return worker;
+            }
+        }
+    }
+
+    pipeline_worker_t* worker = &pipeline->workers[pipeline->worker_count++];
+    memset(worker, 0, sizeof(*worker));
+    worker->pipeline = pipeline;
+    worker->shared_id = shared;
+    worker->nodes[worker->node_count++] = node;
+    return worker;
+}
+
+/**
+ * @brief Check whether worker `from` can end up waiting on itself through blocking links
+ */
+static int worker_waits_on(const media_pipeline_t* pipeline, const pipeline_worker_t* from,
+                           const pipeline_worker_t* target, uint32_t* visited)
+{
+    for (int i = 0; i < from->node_count; i++) {
+        const pipeline_node_t* node = from->nodes[i];
+        for (int j = 0; j < node->link_count; j++) {
+            const pipeline_node_t* link = node->links[j];
+            if (link->queue.policy != MEDIA_BACKPRESSURE_BLOCK) {
+                continue;
+            }
+            if (link->worker == target) {
+                return 1;
+            }
+            uint32_t bit = 1u << (link->worker - pipeline->workers);
+            if (!(*visited & bit)) {
+                *visited |= bit;
+                if (worker_waits_on(pipeline, link->worker, target, visited)) {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Return every queued frame to its producer and release the rings
+ */
+static void pipeline_free_queues(media_pipeline_t* pipeline)
+{
+    for (int i = 0; i < pipeline->node_count; i++) {
+        media_ring_t* ring = &pipeline->nodes[i].queue.ring;
+        media_packet_t* packet;
+        while (ring->slots && (packet = media_ring_pop(ring)) != NULL) {
+            libmedia_packet_unref(packet);
+        }
+        media_ring_free(ring);
+    }
+}
+
+int libmedia_pipeline_start(media_pipeline_t* pipeline)
+{
+    if (!pipeline || pipeline->node_count == 0) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (pipeline_running(pipeline)) {
+        return 0;
+    }
+
+    // A stage fed by one node gets the cheaper SPSC ring; evicting policies let producers pop too
+    int inputs[MEDIA_PIPELINE_MAX_NODES] = { 0 };
+    for (int i = 0; i < pipeline->node_count; i++) {
+        for (int j = 0; j < pipeline->nodes[i].link_count; j++) {
+            inputs[pipeline->nodes[i].links[j]->id]++;
+        }
+    }
+    for (int i = 0; i < pipeline->node_count; i++) {
+        pipeline_node_t* node = &pipeline->nodes[i];
+        memset(node->samplers, 0, sizeof(node->samplers));
+        int flags = (inputs[i] > 1 ? MEDIA_RING_MULTI_PRODUCER : 0) |
+                    (node->queue.policy == MEDIA_BACKPRESSURE_DROP_OLDEST ||
+                     node->queue.policy == MEDIA_BACKPRESSURE_KEEP_LATEST ? MEDIA_RING_MULTI_CONSUMER : 0);
+        if (!node->is_source && media_ring_init(&node->queue.ring, flags, node->queue.depth) < 0) {
+            pipeline_free_queues(pipeline);
+            media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+    }
+
+    pipeline->worker_count = 0;
+    for (int i = 0; i < pipeline->node_count; i++) {
+        pipeline->nodes[i].worker = pipeline_assign_worker(pipeline, &pipeline->nodes[i]);
+    }
+
+    // A worker blocked on a queue only its own thread drains, directly or
+    // through other blocked workers, would never wake up
+    for (int i = 0; i < pipeline->worker_count; i++) {
+        uint32_t visited = 0;
+        if (worker_waits_on(pipeline, &pipeline->workers[i], &pipeline->workers[i], &visited)) {
+            MEDIA_DEBUG(DEBUG_ERROR, "Blocking stages form a wait cycle through worker of %s",
+                        pipeline->workers[i].nodes[0]->name);
+            pipeline->worker_count = 0;
+            pipeline_free_queues(pipeline);
+            media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+            return -1;
+        }
+    }
+
+    __atomic_store_n(&pipeline->running, 1, __ATOMIC_RELEASE);
+
+    // Consumers first, so sources never push into a queue nobody drains
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < pipeline->worker_count; i++) {
+            pipeline_worker_t* worker = &pipeline->workers[i];
+            int is_source = worker->nodes[0]->is_source;
+            if (is_source != pass) {
+                continue;
+            }
+            char name[16];
+            if (worker->shared_id) {
+                snprintf(name, sizeof(name), "worker-%d", worker->shared_id);
+            } else {
+                snprintf(name, sizeof(name), "%.15s", worker->nodes[0]->name);
+            }
+            if (media_thread_create(&worker->thread, is_source ? MEDIA_THREAD_CAPTURE : MEDIA_THREAD_STAGE, name,
+                                    is_source ? source_worker_main : stage_worker_main, worker) != 0) {
+                MEDIA_DEBUG(DEBUG_ERROR, "Failed to start pipeline thread for %s", worker->nodes[0]->name);
+                libmedia_pipeline_stop(pipeline);
+                media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+                return -1;
+            }
+            worker->started = 1;
+        }
+    }
+
+    MEDIA_DEBUG(DEBUG_INFO, "Pipeline started: %d nodes on %d threads", pipeline->node_count, pipeline->worker_count);
+    return 0;
+}
+
+int libmedia_pipeline_stop(media_pipeline_t* pipeline)
+{
+    if (!pipeline) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (!pipeline_running(pipeline)) {
+        return 0;
+    }
+
+    __atomic_store_n(&pipeline->running, 0, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < pipeline->worker_count; i++) {
+        media_event_signal(&pipeline->workers[i].event);
+    }
+    for (int i = 0; i < pipeline->node_count; i++) {
+        media_event_signal(&pipeline->nodes[i].queue.space);
+    }
+
+    for (int i = 0; i < pipeline->worker_count; i++) {
+        pipeline_worker_t* worker = &pipeline->workers[i];
+        if (worker->started) {
+            pthread_join(worker->thread, NULL);
+            worker->started = 0;
+        }
+    }
+    pipeline->worker_count = 0;
+
+    pipeline_free_queues(pipeline);
+
+    MEDIA_DEBUG(DEBUG_INFO, "Pipeline stopped");
+    return 0;
+}
+
+void libmedia_pipeline_destroy(media_pipeline_t* pipeline)
+{
+    if (!pipeline) {
+        return;
+    }
+
+    libmedia_pipeline_stop(pipeline);
+
+    while (pipeline->free_packets) {
+        pipeline_packet_t* next = pipeline->free_packets->next;
+        free(pipeline->free_packets);
+        pipeline->free_packets = next;
+    }
+    pthread_mutex_destroy(&pipeline->packet_lock);
+    free(pipeline);
+    MEDIA_DEBUG(DEBUG_INFO, "Pipeline destroyed");
+}
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+int libmedia_pipeline_get_node_count(const media_pipeline_t* pipeline)
+{
+    if (!pipeline) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    return pipeline->node_count;
+}
+
+int libmedia_pipeline_get_stats(const media_pipeline_t* pipeline, int node, media_node_stats_t* stats)
+{
+    if (!pipeline || !stats || node < 0 || node >= pipeline->node_count) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    const pipeline_node_t* n = &pipeline->nodes[node];
+    const pipeline_counters_t* c = &n->counters;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->name = n->name;
+    stats->packets_in = __atomic_load_n(&c->packets_in, __ATOMIC_RELAXED);
+    stats->packets_out = __atomic_load_n(&c->packets_out, __ATOMIC_RELAXED);
+    stats->errors = __atomic_load_n(&c->errors, __ATOMIC_RELAXED);
+    stats->skipped = __atomic_load_n(&c->skipped, __ATOMIC_RELAXED);
+    stats->latency_max_ns = __atomic_load_n(&c->latency_max_ns, __ATOMIC_RELAXED);
+    if (!n->is_source && stats->packets_in > 0) {
+        stats->latency_avg_ns = __atomic_load_n(&c->latency_sum_ns, __ATOMIC_RELAXED) / stats->packets_in;
+        stats->age_avg_ns = __atomic_load_n(&c->age_sum_ns, __ATOMIC_RELAXED) / stats->packets_in;
+    }
+
+    stats->queue_capacity = n->is_source ? 0 : media_ring_capacity(&n->queue.ring);
+    if (!stats->queue_capacity || n->queue.policy == MEDIA_BACKPRESSURE_KEEP_LATEST) {
+        stats->queue_capacity = n->queue.depth;
+    }
+    stats->queue_depth = n->queue.ring.slots ? media_ring_count(&n->queue.ring) : 0;
+    stats->queue_high_water = __atomic_load_n(&n->queue.high_water, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&n->queue.dropped, __ATOMIC_RELAXED);
+    stats->decimated = __atomic_load_n(&n->queue.decimated, __ATOMIC_RELAXED);
+    stats->blocked_ns = __atomic_load_n(&n->queue.blocked_ns, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void libmedia_pipeline_reset_stats(media_pipeline_t* pipeline)
+{
+    if (!pipeline) {
+        return;
+    }
+
+    for (int i = 0; i < pipeline->node_count; i++) {
+        pipeline_counters_t* c = &pipeline->nodes[i].counters;
+        __atomic_store_n(&c->packets_in, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->packets_out, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->errors, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->latency_sum_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->latency_max_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->age_sum_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->skipped, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&pipeline->nodes[i].queue.dropped, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&pipeline->nodes[i].queue.decimated, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&pipeline->nodes[i].queue.blocked_ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&pipeline->nodes[i].queue.high_water, 0, __ATOMIC_RELAXED);
+    }
+}
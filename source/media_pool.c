@@ -0,0 +1,404 @@
+/**
+ * @file media_pool.c
+ * @brief Aligned frame pools
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Each class owns one anonymous mapping carved into equally sized slots and
+ * an array of handles. Free handles live in a multi-producer multi-consumer
+ * ring, so acquire is one pop and the last unref is one push. Mappings are
+ * pre-faulted with MAP_POPULATE and optionally locked, so the first frame
+ * through a buffer does not pay for page faults either.
+ *
+ * The pool itself is reference counted: the owner holds one reference and
+ * every buffer handed out holds another, so destroying a pool while buffers
+ * are still in use only drops the owner's reference and the memory goes
+ * away with the last buffer.
+ */
+
+#include "media_pool.h"
+#include "media_meta.h"
+#include "media_ring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// ============================================================================
+// Internal Constants and Data Structures
+// ============================================================================
+
+#define POOL_HUGEPAGE_SIZE (2u * 1024 * 1024)   /**< Default huge page size on x86-64 and 4K-granule ARM64 */
+
+typedef struct pool_class pool_class_t;
+
+/**
+ * @struct pool_buffer
+ * @brief Buffer handle with reference count
+ */
+typedef struct {
+    media_pool_buffer_t pub;    /**< Public part, must be first */
+    int refcount;               /**< Reference count (atomic) */
+    pool_class_t* owner;        /**< Class the buffer returns to */
+    media_meta_t meta;          /**< Metadata of the frame held */
+} pool_buffer_t;
+
+struct pool_class {
+    media_pool_key_t key;       /**< Format, geometry and buffer size */
+    uint32_t count;             /**< Number of buffers */
+    size_t slot;                /**< Distance between buffers */
+    void* memory;               /**< Buffer mapping */
+    size_t mapped;              /**< Mapping length */
+    int locked;                 /**< Mapping is mlocked */
+    size_t charged;             /**< Bytes charged to the memory budget */
+    pool_buffer_t* buffers;     /**< Handles */
+    media_ring_t free_list;     /**< Free handles */
+    media_pool_t* pool;         /**< Pool the class belongs to */
+};
+
+struct media_pool {
+    uint32_t flags;                             /**< MEDIA_POOL_* flags */
+    pool_class_t classes[MEDIA_POOL_MAX_CLASSES];
+    int class_count;
+    int refs;                                   /**< Owner plus buffers in use (atomic) */
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * @brief Bytes needed for one frame of a key
+ */
+static size_t pool_key_size(const media_pool_key_t* key)
+{
+    if (key->size) {
+        return key->size;
+    }
+
+    const media_format_desc_t* desc = libmedia_get_format_desc(key->pixelformat);
+    if (!desc || !desc->bits_per_pixel) {
+        return 0;
+    }
+    if (desc->packed) {
+        return libmedia_get_line_bytes(key->pixelformat, key->width) * key->height;
+    }
+    return ((size_t)key->width * key->height * desc->bits_per_pixel + 7) / 8;
+}
+
+static pool_class_t* pool_find_class(const media_pool_t* pool, const media_pool_key_t* key)
+{
+    for (int i = 0; i < pool->class_count; i++) {
+        const pool_class_t* c = &pool->classes[i];
+        if (c->key.pixelformat == key->pixelformat && c->key.width == key->width &&
+            c->key.height == key->height && (key->size == 0 || key->size == c->key.size)) {
+            return (pool_class_t*)c;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Map pre-faulted memory for a class, honouring the pool flags
+ */
+static int pool_map_class(pool_class_t* c, size_t length, uint32_t flags)
+{
+    c->memory = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (flags & MEDIA_POOL_HUGEPAGES) {
+        size_t huge = MEDIA_ALIGN_UP(length, POOL_HUGEPAGE_SIZE);
+        c->memory = mmap(NULL, huge, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (c->memory != MAP_FAILED) {
+            c->mapped = huge;
+        } else {
+            MEDIA_DEBUG(DEBUG_WARNING, "No reserved huge pages, using regular pages");
+        }
+    }
+#endif
+
+    if (c->memory == MAP_FAILED) {
+        c->memory = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (c->memory == MAP_FAILED) {
+            c->memory = NULL;
+            return -1;
+        }
+        c->mapped = length;
+#ifdef MADV_HUGEPAGE
+        if (flags & MEDIA_POOL_HUGEPAGES) {
+            madvise(c->memory, length, MADV_HUGEPAGE);   // Transparent huge pages, best effort
+        }
+#endif
+    }
+
+    if (flags & MEDIA_POOL_LOCKED) {
+        if (mlock(c->memory, c->mapped) < 0) {
+            MEDIA_DEBUG(DEBUG_ERROR, "Failed to lock %zu bytes of pool memory", c->mapped);
+            munmap(c->memory, c->mapped);
+            c->memory = NULL;
+            return -1;
+        }
+        c->locked = 1;
+    }
+    return 0;
+}
+
+static void pool_free_class(pool_class_t* c)
+{
+    if (c->memory) {
+        if (c->locked) {
+            munlock(c->memory, c->mapped);
+        }
+        munmap(c->memory, c->mapped);
+    }
+    media_ring_free(&c->free_list);
+    free(c->buffers);
+    media_budget_release(c->charged);
+    memset(c, 0, sizeof(*c));
+}
+
+/**
+ * @brief Drop a pool reference, freeing the pool on the last one
+ */
+static void pool_put(media_pool_t* pool)
+{
+    if (__atomic_sub_fetch(&pool->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    for (int i = 0; i < pool->class_count; i++) {
+        pool_free_class(&pool->classes[i]);
+    }
+    free(pool);
+}
+
+// ============================================================================
+// Pool API
+// ============================================================================
+
+media_pool_t* libmedia_pool_create(uint32_t flags)
+{
+    if (flags & ~(uint32_t)(MEDIA_POOL_HUGEPAGES | MEDIA_POOL_LOCKED)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_pool_t* pool = calloc(1, sizeof(media_pool_t));
+    if (!pool) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    pool->flags = flags;
+    pool->refs = 1;
+    return pool;
+}
+
+int libmedia_pool_reserve(media_pool_t* pool, const media_pool_key_t* key, uint32_t count)
+{
+    if (!pool || !key || count == 0 || count > 0x40000000u) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (pool->class_count >= MEDIA_POOL_MAX_CLASSES || pool_find_class(pool, key)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    size_t size = pool_key_size(key);
+    if (size == 0) {
+        media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+        return -1;
+    }
+
+    // Page-align buffers that span pages, cache-line-align the rest
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t align = size >= page ? page : MEDIA_CACHE_LINE;
+    size_t slot = MEDIA_ALIGN_UP(size, align);
+    if (slot > SIZE_MAX / count) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pool_class_t* c = &pool->classes[pool->class_count];
+    memset(c, 0, sizeof(*c));
+    c->key = *key;
+    c->key.size = size;
+    c->pool = pool;
+    c->count = count;
+    c->slot = slot;
+
+    // Charge the largest mapping up front and refund what huge page rounding did not take
+    size_t length = slot * count;
+    size_t worst = pool->flags & MEDIA_POOL_HUGEPAGES ? MEDIA_ALIGN_UP(length, POOL_HUGEPAGE_SIZE) : length;
+    if (media_budget_charge(worst + count * sizeof(pool_buffer_t)) < 0) {
+        memset(c, 0, sizeof(*c));
+        return -1;
+    }
+    c->charged = worst + count * sizeof(pool_buffer_t);
+
+    c->buffers = calloc(count, sizeof(pool_buffer_t));
+    if (!c->buffers ||
+        media_ring_init(&c->free_list, MEDIA_RING_MULTI_PRODUCER | MEDIA_RING_MULTI_CONSUMER, count) < 0 ||
+        pool_map_class(c, length, pool->flags) < 0) {
+        pool_free_class(c);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+    media_budget_release(worst - c->mapped);
+    c->charged -= worst - c->mapped;
+
+    for (uint32_t i = 0; i < count; i++) {
+        pool_buffer_t* b = &c->buffers[i];
+        b->owner = c;
+        b->pub.frame.data = (uint8_t*)c->memory + slot * i;
+        b->pub.frame.size = size;
+        b->pub.frame.width = key->width;
+        b->pub.frame.height = key->height;
+        b->pub.frame.pixelformat = key->pixelformat;
+        b->pub.frame.frame_id = i;
+        b->pub.frame.meta = &b->meta;
+        media_ring_push(&c->free_list, b);
+    }
+
+    pool->class_count++;
+    MEDIA_DEBUG(DEBUG_INFO, "Pool class %s %ux%u: %u x %zu bytes (%zu mapped)",
+                libmedia_get_format_name(key->pixelformat), key->width, key->height,
+                count, size, c->mapped);
+    return 0;
+}
+
+/**
+ * @brief Pop a free buffer of a class and hand it out with one reference
+ */
+static media_pool_buffer_t* pool_take(pool_class_t* c)
+{
+    pool_buffer_t* b = media_ring_pop(&c->free_list);
+    if (!b) {
+        return NULL;
+    }
+
+    __atomic_fetch_add(&c->pool->refs, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&b->refcount, 1, __ATOMIC_RELAXED);
+    b->pub.frame.timestamp = 0;
+    b->pub.frame.sequence = 0;
+    libmedia_meta_clear(&b->meta);
+    b->pub.user_data = NULL;
+    return &b->pub;
+}
+
+media_pool_buffer_t* libmedia_pool_acquire(media_pool_t* pool, const media_pool_key_t* key)
+{
+    if (!pool || !key) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    pool_class_t* c = pool_find_class(pool, key);
+    if (!c) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_pool_buffer_t* buffer = pool_take(c);
+    if (!buffer) {
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+    }
+    return buffer;
+}
+
+media_pool_buffer_t* libmedia_pool_acquire_size(media_pool_t* pool, size_t size)
+{
+    if (!pool || size == 0) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    // Classes are few and unordered: walk them smallest first above the last one tried
+    size_t floor = size;
+    int tried_any = 0;
+    for (;;) {
+        pool_class_t* best = NULL;
+        for (int i = 0; i < pool->class_count; i++) {
+            pool_class_t* c = &pool->classes[i];
+            if (c->key.size >= floor && (!best || c->key.size < best->key.size)) {
+                best = c;
+            }
+        }
+        if (!best) {
+            break;
+        }
+
+        media_pool_buffer_t* buffer = pool_take(best);
+        if (buffer) {
+            return buffer;
+        }
+        tried_any = 1;
+        floor = best->key.size + 1;
+    }
+
+    media_set_last_error(tried_any ? MEDIA_ERROR_BUFFER_ERROR : MEDIA_ERROR_INVALID_PARAM);
+    return NULL;
+}
+
+media_pool_buffer_t* libmedia_pool_find_buffer(const media_pool_t* pool, const void* data)
+{
+    if (!pool || !data) {
+        return NULL;
+    }
+
+    uintptr_t address = (uintptr_t)data;
+    for (int i = 0; i < pool->class_count; i++) {
+        const pool_class_t* c = &pool->classes[i];
+        uintptr_t base = (uintptr_t)c->memory;
+        if (address >= base && address < base + c->slot * c->count) {
+            return &c->buffers[(address - base) / c->slot].pub;
+        }
+    }
+    return NULL;
+}
+
+void libmedia_pool_buffer_ref(media_pool_buffer_t* buffer)
+{
+    if (buffer) {
+        __atomic_fetch_add(&((pool_buffer_t*)buffer)->refcount, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void libmedia_pool_buffer_unref(media_pool_buffer_t* buffer)
+{
+    if (!buffer) {
+        return;
+    }
+
+    pool_buffer_t* b = (pool_buffer_t*)buffer;
+    if (__atomic_sub_fetch(&b->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    // Never fails: the ring holds as many slots as the class has buffers
+    media_pool_t* pool = b->owner->pool;
+    media_ring_push(&b->owner->free_list, b);
+    pool_put(pool);
+}
+
+uint32_t libmedia_pool_get_available(const media_pool_t* pool, const media_pool_key_t* key)
+{
+    if (!pool || !key) {
+        return 0;
+    }
+    const pool_class_t* c = pool_find_class(pool, key);
+    return c ? media_ring_count(&c->free_list) : 0;
+}
+
+void libmedia_pool_destroy(media_pool_t* pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    int in_use = __atomic_load_n(&pool->refs, __ATOMIC_RELAXED) - 1;
+    if (in_use > 0) {
+        MEDIA_DEBUG(DEBUG_WARNING, "Pool destroyed with %d buffers still in use, freed on last release", in_use);
+    }
+    pool_put(pool);
+}
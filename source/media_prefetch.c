@@ -0,0 +1,307 @@
+/**
+ * @file media_prefetch.c
+ * @brief Next-frame prefetch on a helper thread
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * A fixed set of frame slots circulates between two SPSC rings: the helper
+ * takes a free slot, captures into it, warms the frame and pushes it on
+ * the ready ring; the consumer pops it, copies the frame out and pushes
+ * the slot back. The number of slots is the depth, so the helper never
+ * holds more frames than configured. Staging buffers for COPY mode come
+ * from a pool reserved at creation, and a released frame is told apart
+ * from a driver buffer by its address.
+ */
+
+#include "media_prefetch.h"
+#include "media_pool.h"
+#include "media_meta.h"
+#include "media_ring.h"
+#include "media_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// ============================================================================
+// Internal Data Structures
+// ============================================================================
+
+#define PREFETCH_CAPTURE_TIMEOUT_MS 100     /**< Capture wait, bounds stop latency */
+#define PREFETCH_RETRY_MS 10                /**< Back-off after a failed capture */
+
+struct media_prefetch {
+    media_session_t* session;
+    media_prefetch_config_t config;
+    media_pool_t* pool;                             /**< Staging buffers (COPY) */
+    media_pool_key_t key;                           /**< Staging buffer class */
+
+    media_frame_t slots[MEDIA_PREFETCH_MAX_DEPTH];  /**< Frames in flight between helper and consumer */
+    media_ring_t ready;                             /**< Warmed slots, helper to consumer */
+    media_ring_t free;                              /**< Empty slots, consumer to helper */
+    media_event_t ready_event;                      /**< Signalled on push to ready and on stop */
+    media_event_t space_event;                      /**< Signalled on push to free and on stop */
+
+    int running;                                    /**< Helper should keep going (atomic) */
+    int started;                                    /**< Helper thread exists */
+    pthread_t thread;
+    uint32_t sink;                                  /**< Result of touching, keeps the loads alive (atomic) */
+    media_prefetch_stats_t stats;                   /**< Counters (atomic) */
+};
+
+static inline int prefetch_running(const media_prefetch_t* pf)
+{
+    return __atomic_load_n(&pf->running, __ATOMIC_ACQUIRE);
+}
+
+static inline void stat_add(uint64_t* counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+// ============================================================================
+// Helper Thread
+// ============================================================================
+
+/**
+ * @brief Read one byte per cache line
+ */
+static uint32_t prefetch_touch(const uint8_t* data, size_t bytes)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < bytes; i += MEDIA_CACHE_LINE) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Bring a captured frame into cache, moving it to a staging buffer in COPY mode
+ */
+static void prefetch_warm(media_prefetch_t* pf, media_frame_t* frame)
+{
+    uint64_t start = libmedia_get_timestamp_ns();
+
+    if (pf->pool) {
+        media_pool_buffer_t* staging = frame->size <= pf->key.size ? libmedia_pool_acquire(pf->pool, &pf->key) : NULL;
+        if (staging) {
+            memcpy(staging->frame.data, frame->data, frame->size);
+            libmedia_meta_merge(staging->frame.meta, frame->meta);
+
+            media_frame_t copy = *frame;
+            copy.data = staging->frame.data;
+            copy.meta = staging->frame.meta;
+            libmedia_session_release_frame(pf->session, frame);
+            *frame = copy;
+            stat_add(&pf->stats.copied, 1);
+            stat_add(&pf->stats.warm_ns, libmedia_get_timestamp_ns() - start);
+            return;
+        }
+        stat_add(&pf->stats.fallbacks, 1);
+    }
+
+    size_t bytes = pf->config.bytes && pf->config.bytes < frame->size ? pf->config.bytes : frame->size;
+    __atomic_store_n(&pf->sink, prefetch_touch(frame->data, bytes), __ATOMIC_RELAXED);
+    stat_add(&pf->stats.warm_ns, libmedia_get_timestamp_ns() - start);
+}
+
+static void* prefetch_thread_main(void* arg)
+{
+    media_prefetch_t* pf = arg;
+    media_frame_t* slot = NULL;
+
+    while (prefetch_running(pf)) {
+        if (!slot && !(slot = media_ring_pop(&pf->free))) {
+            // Re-check after announcing the wait so a concurrent release or stop cannot be missed
+            uint32_t key = media_event_prepare(&pf->space_event);
+            if (prefetch_running(pf) && media_ring_count(&pf->free) == 0) {
+                media_event_wait(&pf->space_event, key, -1);
+            }
+            continue;
+        }
+
+        slot->data = NULL;
+        if (libmedia_session_capture_frame(pf->session, slot, PREFETCH_CAPTURE_TIMEOUT_MS) < 0) {
+            media_error_t error = libmedia_get_last_error();
+            if (error == MEDIA_ERROR_TIMEOUT) {
+                continue;
+            }
+            // Not streaming yet is expected; anything else is worth counting
+            if (error != MEDIA_ERROR_STREAMING_ERROR) {
+                stat_add(&pf->stats.errors, 1);
+            }
+            uint32_t key = media_event_prepare(&pf->space_event);
+            if (prefetch_running(pf)) {
+                media_event_wait(&pf->space_event, key, PREFETCH_RETRY_MS);
+            }
+            continue;
+        }
+        if (!slot->data) {
+            continue;
+        }
+
+        prefetch_warm(pf, slot);
+        stat_add(&pf->stats.prefetched, 1);
+
+        // There are no more slots than the ring holds, so this cannot fail
+        media_ring_push(&pf->ready, slot);
+        slot = NULL;
+        media_event_signal(&pf->ready_event);
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Prefetch API
+// ============================================================================
+
+media_prefetch_t* libmedia_prefetch_create(media_session_t* session, const media_prefetch_config_t* config)
+{
+    media_prefetch_config_t defaults = { 0 };
+    if (!config) {
+        config = &defaults;
+    }
+    if (!session || config->depth > MEDIA_PREFETCH_MAX_DEPTH ||
+        config->mode < MEDIA_PREFETCH_TOUCH || config->mode > MEDIA_PREFETCH_COPY ||
+        (config->mode == MEDIA_PREFETCH_COPY && config->frame_size == 0)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_prefetch_t* pf = calloc(1, sizeof(media_prefetch_t));
+    if (!pf) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    pf->session = session;
+    pf->config = *config;
+    if (pf->config.depth == 0) {
+        pf->config.depth = 1;
+    }
+
+    if (config->mode == MEDIA_PREFETCH_COPY) {
+        pf->key.size = config->frame_size;
+        pf->pool = libmedia_pool_create(config->pool_flags);
+        if (!pf->pool || libmedia_pool_reserve(pf->pool, &pf->key,
+                                               config->staging_count ? config->staging_count : pf->config.depth + 2) < 0) {
+            libmedia_prefetch_destroy(pf);
+            return NULL;
+        }
+    }
+
+    if (media_ring_init(&pf->ready, 0, pf->config.depth) < 0 || media_ring_init(&pf->free, 0, pf->config.depth) < 0) {
+        libmedia_prefetch_destroy(pf);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < pf->config.depth; i++) {
+        media_ring_push(&pf->free, &pf->slots[i]);
+    }
+
+    __atomic_store_n(&pf->running, 1, __ATOMIC_RELEASE);
+    if (media_thread_create(&pf->thread, MEDIA_THREAD_CAPTURE, "media-prefetch", prefetch_thread_main, pf) != 0) {
+        MEDIA_DEBUG(DEBUG_ERROR, "Failed to start prefetch thread");
+        __atomic_store_n(&pf->running, 0, __ATOMIC_RELEASE);
+        libmedia_prefetch_destroy(pf);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    pf->started = 1;
+
+    MEDIA_DEBUG(DEBUG_INFO, "Prefetch started: %s, depth %u",
+                pf->pool ? "copy" : "touch", pf->config.depth);
+    return pf;
+}
+
+int libmedia_prefetch_next(media_prefetch_t* prefetch, media_frame_t* frame, int timeout_ms)
+{
+    if (!prefetch || !frame) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    media_prefetch_t* pf = prefetch;
+
+    media_frame_t* slot = media_ring_pop(&pf->ready);
+    if (slot) {
+        stat_add(&pf->stats.ready, 1);
+    }
+
+    uint64_t deadline = timeout_ms < 0 ? UINT64_MAX : libmedia_get_timestamp_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    while (!slot) {
+        // Re-check after announcing the wait so a concurrent push cannot be missed
+        uint32_t key = media_event_prepare(&pf->ready_event);
+        if ((slot = media_ring_pop(&pf->ready)) != NULL) {
+            break;
+        }
+
+        uint64_t now = libmedia_get_timestamp_ns();
+        if (now >= deadline || !prefetch_running(pf)) {
+            media_set_last_error(MEDIA_ERROR_TIMEOUT);
+            return -1;
+        }
+        media_event_wait(&pf->ready_event, key, deadline == UINT64_MAX ? -1 : (int)((deadline - now + 999999) / 1000000));
+    }
+
+    *frame = *slot;
+    media_ring_push(&pf->free, slot);
+    media_event_signal(&pf->space_event);
+    stat_add(&pf->stats.delivered, 1);
+    return 0;
+}
+
+int libmedia_prefetch_release(media_prefetch_t* prefetch, media_frame_t* frame)
+{
+    if (!prefetch || !frame || !frame->data) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    media_pool_buffer_t* staging = prefetch->pool ? libmedia_pool_find_buffer(prefetch->pool, frame->data) : NULL;
+    if (staging) {
+        libmedia_pool_buffer_unref(staging);
+        return 0;
+    }
+    return libmedia_session_release_frame(prefetch->session, frame);
+}
+
+int libmedia_prefetch_get_stats(const media_prefetch_t* prefetch, media_prefetch_stats_t* stats)
+{
+    if (!prefetch || !stats) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    const media_prefetch_stats_t* s = &prefetch->stats;
+    stats->prefetched = __atomic_load_n(&s->prefetched, __ATOMIC_RELAXED);
+    stats->delivered = __atomic_load_n(&s->delivered, __ATOMIC_RELAXED);
+    stats->copied = __atomic_load_n(&s->copied, __ATOMIC_RELAXED);
+    stats->fallbacks = __atomic_load_n(&s->fallbacks, __ATOMIC_RELAXED);
+    stats->ready = __atomic_load_n(&s->ready, __ATOMIC_RELAXED);
+    stats->warm_ns = __atomic_load_n(&s->warm_ns, __ATOMIC_RELAXED);
+    stats->errors = __atomic_load_n(&s->errors, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void libmedia_prefetch_destroy(media_prefetch_t* prefetch)
+{
+    if (!prefetch) {
+        return;
+    }
+    media_prefetch_t* pf = prefetch;
+
+    if (pf->started) {
+        __atomic_store_n(&pf->running, 0, __ATOMIC_RELEASE);
+        media_event_signal(&pf->space_event);
+        media_event_signal(&pf->ready_event);
+        pthread_join(pf->thread, NULL);
+    }
+
+    // Frames warmed but never taken go back where they came from
+    media_frame_t* slot;
+    while (pf->ready.slots && (slot = media_ring_pop(&pf->ready)) != NULL) {
+        libmedia_prefetch_release(pf, slot);
+    }
+    media_ring_free(&pf->ready);
+    media_ring_free(&pf->free);
+    libmedia_pool_destroy(pf->pool);
+    free(pf);
+}
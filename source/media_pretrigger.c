@@ -0,0 +1,311 @@
+/**
+ * @file media_pretrigger.c
+ * @brief Pre-trigger frame history
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Frame data lives in one pool buffer used as a byte ring: each frame is
+ * copied in whole at the write offset, or at the start when it does not
+ * fit before the end. Frames are never split. A fixed array of records
+ * keeps them in capture order. Storing a frame first evicts the oldest
+ * records it would overwrite. The tail skipped on a wrap is evicted too,
+ * so records always lie in ring order and only the oldest one can be in
+ * the way.
+ */
+
+#include "media_pretrigger.h"
+#include "media_pool.h"
+#include "media_meta.h"
+#include "media_ring.h"
+#include "media_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Internal Data Structures
+// ============================================================================
+
+#define PRETRIGGER_DEFAULT_FRAMES 1024
+
+enum {
+    PRETRIGGER_IDLE,            /**< Filling the history */
+    PRETRIGGER_TRIGGERED,       /**< Next push delivers the history */
+    PRETRIGGER_RECORDING        /**< Pushes go straight to the sink */
+};
+
+/**
+ * @struct pretrigger_record
+ * @brief Frame held in the ring
+ */
+typedef struct {
+    media_frame_t frame;        /**< Frame, data points into the ring */
+    size_t offset;              /**< Start in the ring */
+    size_t stored;              /**< Bytes taken in the ring */
+    media_meta_t meta;          /**< Copy of the frame's metadata */
+} pretrigger_record_t;
+
+struct media_pretrigger {
+    media_pretrigger_config_t config;
+    media_pool_t* pool;
+    media_pool_buffer_t* buffer;        /**< Ring memory */
+    uint8_t* memory;
+    size_t capacity;
+    size_t write;                       /**< Next write offset */
+
+    pretrigger_record_t* records;
+    uint32_t max_frames;
+    uint32_t head;                      /**< Oldest record */
+    uint32_t count;                     /**< Records held */
+    size_t bytes;                       /**< Frame data held */
+
+    int state;                          /**< PRETRIGGER_* (atomic) */
+    media_pretrigger_stats_t stats;     /**< Counters and published contents (atomic) */
+};
+
+// ============================================================================
+// Ring
+// ============================================================================
+
+static pretrigger_record_t* pretrigger_oldest(media_pretrigger_t* pt)
+{
+    return &pt->records[pt->head];
+}
+
+static void pretrigger_pop(media_pretrigger_t* pt)
+{
+    pt->bytes -= pretrigger_oldest(pt)->frame.size;
+    pt->head = (pt->head + 1) % pt->max_frames;
+    pt->count--;
+    if (pt->count == 0) {
+        pt->write = 0;
+    }
+}
+
+static void pretrigger_evict(media_pretrigger_t* pt)
+{
+    pretrigger_pop(pt);
+    __atomic_fetch_add(&pt->stats.evicted, 1, __ATOMIC_RELAXED);
+}
+
+static void pretrigger_publish(media_pretrigger_t* pt)
+{
+    uint64_t span = 0;
+    if (pt->count > 0) {
+        const pretrigger_record_t* newest = &pt->records[(pt->head + pt->count - 1) % pt->max_frames];
+        span = newest->frame.timestamp - pretrigger_oldest(pt)->frame.timestamp;
+    }
+    __atomic_store_n(&pt->stats.span_ns, span, __ATOMIC_RELAXED);
+    __atomic_store_n(&pt->stats.bytes, pt->bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&pt->stats.frames, pt->count, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Copy a frame into the ring, evicting what it replaces
+ */
+static void pretrigger_store(media_pretrigger_t* pt, const media_frame_t* frame)
+{
+    size_t stored = MEDIA_ALIGN_UP(frame->size, MEDIA_CACHE_LINE);
+    if (stored > pt->capacity) {
+        __atomic_fetch_add(&pt->stats.oversized, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    // Out of the time window or out of records
+    while (pt->count > 0 && frame->timestamp - pretrigger_oldest(pt)->frame.timestamp > pt->config.duration_ns) {
+        pretrigger_evict(pt);
+    }
+    if (pt->count == pt->max_frames) {
+        pretrigger_evict(pt);
+    }
+
+    size_t offset = pt->write;
+    if (offset + stored > pt->capacity) {
+        // Wrap: the skipped tail holds the oldest frames
+        while (pt->count > 0 && pretrigger_oldest(pt)->offset >= offset) {
+            pretrigger_evict(pt);
+        }
+        offset = 0;
+    }
+    while (pt->count > 0) {
+        const pretrigger_record_t* oldest = pretrigger_oldest(pt);
+        if (oldest->offset >= offset + stored || oldest->offset + oldest->stored <= offset) {
+            break;
+        }
+        pretrigger_evict(pt);
+    }
+
+    pretrigger_record_t* record = &pt->records[(pt->head + pt->count) % pt->max_frames];
+    record->frame = *frame;
+    record->frame.data = pt->memory + offset;
+    record->frame.meta = &record->meta;
+    libmedia_meta_clear(&record->meta);
+    libmedia_meta_merge(&record->meta, frame->meta);
+    record->offset = offset;
+    record->stored = stored;
+    if (frame->size) {
+        memcpy(record->frame.data, frame->data, frame->size);
+    }
+
+    pt->write = offset + stored;
+    pt->count++;
+    pt->bytes += frame->size;
+    __atomic_fetch_add(&pt->stats.stored, 1, __ATOMIC_RELAXED);
+}
+
+static void pretrigger_deliver(media_pretrigger_t* pt, const media_frame_t* frame, int live)
+{
+    if (pt->config.sink(pt->config.user_data, frame, live) < 0) {
+        __atomic_fetch_add(&pt->stats.sink_errors, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(live ? &pt->stats.live : &pt->stats.history, 1, __ATOMIC_RELAXED);
+}
+
+// ============================================================================
+// Pre-trigger API
+// ============================================================================
+
+media_pretrigger_t* libmedia_pretrigger_create(const media_pretrigger_config_t* config)
+{
+    if (!config || !config->sink || config->bytes == 0 || config->duration_ns == 0) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_pretrigger_t* pt = calloc(1, sizeof(media_pretrigger_t));
+    if (!pt) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    pt->config = *config;
+    pt->max_frames = config->max_frames ? config->max_frames : PRETRIGGER_DEFAULT_FRAMES;
+
+    // A single pool buffer gives pre-faulted, budget-charged, optionally locked memory
+    media_pool_key_t key = { 0 };
+    key.size = config->bytes;
+    pt->pool = libmedia_pool_create(config->pool_flags);
+    if (!pt->pool || libmedia_pool_reserve(pt->pool, &key, 1) < 0) {
+        libmedia_pretrigger_destroy(pt);
+        return NULL;
+    }
+    pt->buffer = libmedia_pool_acquire(pt->pool, &key);
+    if (!pt->buffer) {
+        libmedia_pretrigger_destroy(pt);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    pt->memory = pt->buffer->frame.data;
+    pt->capacity = pt->buffer->frame.size;
+
+    if (media_budget_charge(pt->max_frames * sizeof(pretrigger_record_t)) < 0) {
+        libmedia_pretrigger_destroy(pt);
+        return NULL;
+    }
+    pt->records = calloc(pt->max_frames, sizeof(pretrigger_record_t));
+    if (!pt->records) {
+        media_budget_release(pt->max_frames * sizeof(pretrigger_record_t));
+        libmedia_pretrigger_destroy(pt);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    MEDIA_DEBUG(DEBUG_INFO, "Pre-trigger buffer: %zu bytes, %u frames, %llu ms",
+                pt->capacity, pt->max_frames, (unsigned long long)(config->duration_ns / 1000000));
+    return pt;
+}
+
+int libmedia_pretrigger_push(media_pretrigger_t* pretrigger, const media_frame_t* frame)
+{
+    if (!pretrigger || !frame || (!frame->data && frame->size)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    media_pretrigger_t* pt = pretrigger;
+
+    int state = __atomic_load_n(&pt->state, __ATOMIC_ACQUIRE);
+    if (state == PRETRIGGER_TRIGGERED) {
+        MEDIA_DEBUG(DEBUG_INFO, "Pre-trigger fired, delivering %u frames", pt->count);
+        while (pt->count > 0) {
+            pretrigger_deliver(pt, &pretrigger_oldest(pt)->frame, 0);
+            pretrigger_pop(pt);
+        }
+        pretrigger_publish(pt);
+
+        // A stop that raced with the trigger wins; the frame then starts a new history
+        int expected = PRETRIGGER_TRIGGERED;
+        if (__atomic_compare_exchange_n(&pt->state, &expected, PRETRIGGER_RECORDING, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            state = PRETRIGGER_RECORDING;
+        } else {
+            state = expected;
+        }
+    }
+
+    if (state == PRETRIGGER_RECORDING) {
+        pretrigger_deliver(pt, frame, 1);
+        return 0;
+    }
+
+    pretrigger_store(pt, frame);
+    pretrigger_publish(pt);
+    return 0;
+}
+
+int libmedia_pretrigger_trigger(media_pretrigger_t* pretrigger)
+{
+    if (!pretrigger) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    int expected = PRETRIGGER_IDLE;
+    __atomic_compare_exchange_n(&pretrigger->state, &expected, PRETRIGGER_TRIGGERED, 0,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+int libmedia_pretrigger_stop(media_pretrigger_t* pretrigger)
+{
+    if (!pretrigger) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    __atomic_store_n(&pretrigger->state, PRETRIGGER_IDLE, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int libmedia_pretrigger_get_stats(const media_pretrigger_t* pretrigger, media_pretrigger_stats_t* stats)
+{
+    if (!pretrigger || !stats) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    const media_pretrigger_t* pt = pretrigger;
+    stats->stored = __atomic_load_n(&pt->stats.stored, __ATOMIC_RELAXED);
+    stats->evicted = __atomic_load_n(&pt->stats.evicted, __ATOMIC_RELAXED);
+    stats->oversized = __atomic_load_n(&pt->stats.oversized, __ATOMIC_RELAXED);
+    stats->history = __atomic_load_n(&pt->stats.history, __ATOMIC_RELAXED);
+    stats->live = __atomic_load_n(&pt->stats.live, __ATOMIC_RELAXED);
+    stats->sink_errors = __atomic_load_n(&pt->stats.sink_errors, __ATOMIC_RELAXED);
+    stats->frames = __atomic_load_n(&pt->stats.frames, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&pt->stats.bytes, __ATOMIC_RELAXED);
+    stats->span_ns = __atomic_load_n(&pt->stats.span_ns, __ATOMIC_RELAXED);
+    stats->recording = __atomic_load_n(&pt->state, __ATOMIC_RELAXED) != PRETRIGGER_IDLE;
+    return 0;
+}
+
+void libmedia_pretrigger_destroy(media_pretrigger_t* pretrigger)
+{
+    if (!pretrigger) {
+        return;
+    }
+
+    if (pretrigger->records) {
+        free(pretrigger->records);
+        media_budget_release(pretrigger->max_frames * sizeof(pretrigger_record_t));
+    }
+    libmedia_pool_buffer_unref(pretrigger->buffer);
+    libmedia_pool_destroy(pretrigger->pool);
+    free(pretrigger);
+}
@@ -0,0 +1,43 @@
+/**
+ * @file media_proc.c
+ * @brief Plane view helpers shared by the processing kernels
+ * @version 1.0.0
+ * @date 2025-07-01
+ */
+
+#include "media_proc.h"
+#include "media_internal.h"
+
+// ============================================================================
+// Plane Views
+// ============================================================================
+
+int libmedia_frame_luma_plane(const media_frame_t* frame, media_plane_t* plane)
+{
+    if (!frame || !plane || !frame->data) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    switch (frame->pixelformat) {
+        case V4L2_PIX_FMT_GREY:
+        case V4L2_PIX_FMT_NV12:
+        case V4L2_PIX_FMT_NV21:
+        case V4L2_PIX_FMT_YUV420:
+            break;
+        default:
+            media_set_last_error(MEDIA_ERROR_FORMAT_ERROR);
+            return -1;
+    }
+
+    if (frame->size && frame->size < (size_t)frame->width * frame->height) {
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+
+    plane->data = frame->data;
+    plane->width = frame->width;
+    plane->height = frame->height;
+    plane->stride = frame->width;
+    return 0;
+}
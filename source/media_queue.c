@@ -0,0 +1,372 @@
+/**
+ * @file media_queue.c
+ * @brief Lock-free rings, futex event counts and the public queue API
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * SPSC rings are a plain Lamport ring: each side owns one index and keeps a
+ * cached copy of the other, so the shared cache line is only read when the
+ * cached view says full or empty. Rings with several producers or consumers
+ * use per-slot turn counters: each side claims a slot with one CAS on its
+ * index and hands it over by advancing the slot's turn, so nobody observes
+ * a half-written slot.
+ */
+
+#include "media_queue.h"
+#include "media_ring.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// ============================================================================
+// Rings
+// ============================================================================
+
+int media_ring_init(media_ring_t* ring, int flags, uint32_t capacity)
+{
+    // Turn counters cannot tell a free slot from a full one in a ring of one
+    uint32_t size = flags ? 2 : 1;
+    while (size < capacity && size < 0x40000000u) {
+        size <<= 1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    if (media_budget_charge(size * sizeof(media_ring_slot_t)) < 0) {
+        return -1;
+    }
+    ring->slots = calloc(size, sizeof(media_ring_slot_t));
+    if (!ring->slots) {
+        media_budget_release(size * sizeof(media_ring_slot_t));
+        return -1;
+    }
+
+    ring->mask = size - 1;
+    ring->flags = flags;
+    for (uint32_t i = 0; i < size; i++) {
+        ring->slots[i].seq = i;
+    }
+    return 0;
+}
+
+void media_ring_free(media_ring_t* ring)
+{
+    if (ring->slots) {
+        media_budget_release(media_ring_capacity(ring) * sizeof(media_ring_slot_t));
+    }
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+int media_ring_push(media_ring_t* ring, void* item)
+{
+    if (!ring->flags) {
+        uint32_t tail = ring->tail;
+        if (tail - ring->head_cache > ring->mask) {
+            ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            if (tail - ring->head_cache > ring->mask) {
+                return -1;
+            }
+        }
+        ring->slots[tail & ring->mask].item = item;
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    uint32_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    media_ring_slot_t* slot;
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Slot from one lap ago not yet handed back: either the ring is full, or a
+            // consumer claimed it and is still reading while later pops already finished
+            uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            if ((int32_t)(pos - head) > (int32_t)ring->mask) {
+                return -1;
+            }
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        } else {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->item = item;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void* media_ring_pop(media_ring_t* ring)
+{
+    void* item;
+
+    if (!ring->flags) {
+        uint32_t head = ring->head;
+        if (head == ring->tail_cache) {
+            ring->tail_cache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+            if (head == ring->tail_cache) {
+                return NULL;
+            }
+        }
+        item = ring->slots[head & ring->mask].item;
+        __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+        return item;
+    }
+
+    uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    media_ring_slot_t* slot;
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+        if (diff < 0) {
+            return NULL;    // Not yet published
+        }
+        if (diff > 0) {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (!(ring->flags & MEDIA_RING_MULTI_CONSUMER)) {
+            __atomic_store_n(&ring->head, pos + 1, __ATOMIC_RELAXED);
+            break;
+        }
+        if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    item = slot->item;
+    __atomic_store_n(&slot->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+    return item;
+}
+
+// ============================================================================
+// Event Counts
+// ============================================================================
+
+static long futex(uint32_t* addr, int op, uint32_t value, const struct timespec* timeout)
+{
+#ifdef SYS_futex_time64
+    // 32-bit targets built with a 64-bit time_t need the time64 entry point
+    if (sizeof(timeout->tv_sec) > sizeof(long)) {
+        return syscall(SYS_futex_time64, addr, op, value, timeout, NULL, 0);
+    }
+#endif
+    return syscall(SYS_futex, addr, op, value, timeout, NULL, 0);
+}
+
+int media_event_wait(media_event_t* event, uint32_t key, int timeout_ms)
+{
+    struct timespec ts;
+    struct timespec* timeout = NULL;
+
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        timeout = &ts;
+    }
+
+    // Returns at once if a signal already moved the count past key
+    if (futex(&event->state, FUTEX_WAIT_PRIVATE, key, timeout) < 0 && errno == ETIMEDOUT) {
+        return 0;
+    }
+    return 1;
+}
+
+void media_event_signal(media_event_t* event)
+{
+    // Order the caller's publish before reading the waiter flag (pairs with prepare)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint32_t state = __atomic_load_n(&event->state, __ATOMIC_RELAXED);
+    if (!(state & 1)) {
+        return;
+    }
+    if (__atomic_compare_exchange_n(&event->state, &state, (state + 2) & ~1u, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        futex(&event->state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+    }
+}
+
+// ============================================================================
+// Public Queue
+// ============================================================================
+
+/**
+ * @struct media_queue
+ * @brief Ring plus the event its consumer sleeps on
+ */
+struct media_queue {
+    media_ring_t ring;          /**< Storage */
+    media_event_t event;        /**< Consumer wakeup */
+    int event_fd;               /**< Consumer wakeup for event loops, -1 until requested (atomic) */
+    int fd_armed;               /**< Consumer found the queue empty and waits for the fd (atomic) */
+};
+
+/**
+ * @brief Wake an event loop consumer that drained the queue
+ */
+static void queue_notify_fd(media_queue_t* queue)
+{
+    int fd = __atomic_load_n(&queue->event_fd, __ATOMIC_ACQUIRE);
+    if (fd < 0) {
+        return;
+    }
+    // Pairs with the fence in queue_rearm_fd: either we see the flag or the consumer sees the item
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&queue->fd_armed, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&queue->fd_armed, 0, __ATOMIC_RELAXED)) {
+        uint64_t one = 1;
+        ssize_t written = write(fd, &one, sizeof(one));
+        (void)written;  // Only fails if the counter would overflow, i.e. it is already readable
+    }
+}
+
+/**
+ * @brief Clear the eventfd after an empty pop and ask producers for the next wakeup
+ */
+static void queue_rearm_fd(media_queue_t* queue, int fd)
+{
+    uint64_t count;
+    ssize_t cleared = read(fd, &count, sizeof(count));
+    (void)cleared;  // EAGAIN: nothing was pending
+    __atomic_store_n(&queue->fd_armed, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+media_queue_t* libmedia_queue_create(media_queue_type_t type, uint32_t capacity)
+{
+    if (capacity == 0 || capacity > 0x40000000u || (type != MEDIA_QUEUE_SPSC && type != MEDIA_QUEUE_MPSC)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_queue_t* queue = NULL;
+    if (posix_memalign((void**)&queue, MEDIA_CACHE_LINE, sizeof(media_queue_t)) != 0) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    if (media_ring_init(&queue->ring, type == MEDIA_QUEUE_MPSC ? MEDIA_RING_MULTI_PRODUCER : 0, capacity) < 0) {
+        free(queue);
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    queue->event.state = 0;
+    queue->event_fd = -1;
+    queue->fd_armed = 0;
+    return queue;
+}
+
+int libmedia_queue_push(media_queue_t* queue, void* item)
+{
+    if (!queue || !item) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    if (media_ring_push(&queue->ring, item) < 0) {
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+    media_event_signal(&queue->event);
+    queue_notify_fd(queue);
+    return 0;
+}
+
+int libmedia_queue_pop(media_queue_t* queue, void** item, int timeout_ms)
+{
+    if (!queue || !item) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    uint64_t deadline = timeout_ms > 0 ? libmedia_get_timestamp_ns() + (uint64_t)timeout_ms * 1000000ULL : 0;
+
+    for (;;) {
+        if ((*item = media_ring_pop(&queue->ring)) != NULL) {
+            return 1;
+        }
+        if (timeout_ms == 0) {
+            int fd = __atomic_load_n(&queue->event_fd, __ATOMIC_ACQUIRE);
+            if (fd < 0) {
+                return 0;
+            }
+            queue_rearm_fd(queue, fd);
+            *item = media_ring_pop(&queue->ring);   // Pushed before the flag was visible
+            return *item != NULL;
+        }
+
+        uint32_t key = media_event_prepare(&queue->event);
+        if ((*item = media_ring_pop(&queue->ring)) != NULL) {
+            return 1;
+        }
+
+        int wait_ms = -1;
+        if (timeout_ms > 0) {
+            uint64_t now = libmedia_get_timestamp_ns();
+            if (now >= deadline) {
+                return 0;
+            }
+            wait_ms = (int)((deadline - now + 999999) / 1000000);
+        }
+        media_event_wait(&queue->event, key, wait_ms);
+    }
+}
+
+int libmedia_queue_get_fd(media_queue_t* queue)
+{
+    if (!queue) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    int fd = __atomic_load_n(&queue->event_fd, __ATOMIC_ACQUIRE);
+    if (fd >= 0) {
+        return fd;
+    }
+
+    // Starts readable so the first poll drains whatever is already queued
+    int created = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (created < 0) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+    if (!__atomic_compare_exchange_n(&queue->event_fd, &fd, created, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        close(created);     // Another thread won the race
+        return fd;
+    }
+    return created;
+}
+
+uint32_t libmedia_queue_get_count(const media_queue_t* queue)
+{
+    return queue ? media_ring_count(&queue->ring) : 0;
+}
+
+uint32_t libmedia_queue_get_capacity(const media_queue_t* queue)
+{
+    return queue ? media_ring_capacity(&queue->ring) : 0;
+}
+
+void libmedia_queue_destroy(media_queue_t* queue)
+{
+    if (!queue) {
+        return;
+    }
+    if (queue->event_fd >= 0) {
+        close(queue->event_fd);
+    }
+    media_ring_free(&queue->ring);
+    free(queue);
+}
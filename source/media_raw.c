@@ -0,0 +1,575 @@
+/**
+ * @file media_raw.c
+ * @brief Raw Bayer kernels: pack/unpack, binning, demosaic and statistics
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Every kernel reads its source through raw_load_row(), which decodes one
+ * line of any supported container into LSB aligned 16-bit samples. 16-bit
+ * containers are used in place; 8-bit and MIPI packed lines are decoded
+ * into a line buffer on the stack, so packed frames never need a full
+ * unpacked copy.
+ *
+ * MIPI packing, little end first:
+ *   RAW10: P0[9:2] P1[9:2] P2[9:2] P3[9:2] (P3[1:0] P2[1:0] P1[1:0] P0[1:0])
+ *   RAW12: P0[11:4] P1[11:4] (P1[3:0] P0[3:0])
+ */
+
+#include "media_raw.h"
+#include "media_internal.h"
+#include <string.h>
+
+// ============================================================================
+// Internal Tables
+// ============================================================================
+
+/**
+ * @brief Channel of each 2x2 phase (y & 1) * 2 + (x & 1), indexed by media_bayer_order_t
+ */
+static const uint8_t g_bayer_channels[5][4] = {
+    { 0, 0, 0, 0 },
+    { MEDIA_RAW_CH_B, MEDIA_RAW_CH_GB, MEDIA_RAW_CH_GR, MEDIA_RAW_CH_R },   // BGGR
+    { MEDIA_RAW_CH_GB, MEDIA_RAW_CH_B, MEDIA_RAW_CH_R, MEDIA_RAW_CH_GR },   // GBRG
+    { MEDIA_RAW_CH_GR, MEDIA_RAW_CH_R, MEDIA_RAW_CH_B, MEDIA_RAW_CH_GB },   // GRBG
+    { MEDIA_RAW_CH_R, MEDIA_RAW_CH_GR, MEDIA_RAW_CH_GB, MEDIA_RAW_CH_B },   // RGGB
+};
+
+/**
+ * @brief Container formats of each order, indexed by [order][8/10/12/16 bits]
+ */
+static const uint32_t g_unpacked_formats[5][4] = {
+    { 0, 0, 0, 0 },
+    { V4L2_PIX_FMT_SBGGR8, V4L2_PIX_FMT_SBGGR10, V4L2_PIX_FMT_SBGGR12, V4L2_PIX_FMT_SBGGR16 },
+    { V4L2_PIX_FMT_SGBRG8, V4L2_PIX_FMT_SGBRG10, V4L2_PIX_FMT_SGBRG12, V4L2_PIX_FMT_SGBRG16 },
+    { V4L2_PIX_FMT_SGRBG8, V4L2_PIX_FMT_SGRBG10, V4L2_PIX_FMT_SGRBG12, V4L2_PIX_FMT_SGRBG16 },
+    { V4L2_PIX_FMT_SRGGB8, V4L2_PIX_FMT_SRGGB10, V4L2_PIX_FMT_SRGGB12, V4L2_PIX_FMT_SRGGB16 },
+};
+
+/**
+ * @brief Packed formats of each order, indexed by [order][10/12 bits]
+ */
+static const uint32_t g_packed_formats[5][2] = {
+    { 0, 0 },
+    { V4L2_PIX_FMT_SBGGR10P, V4L2_PIX_FMT_SBGGR12P },
+    { V4L2_PIX_FMT_SGBRG10P, V4L2_PIX_FMT_SGBRG12P },
+    { V4L2_PIX_FMT_SGRBG10P, V4L2_PIX_FMT_SGRBG12P },
+    { V4L2_PIX_FMT_SRGGB10P, V4L2_PIX_FMT_SRGGB12P },
+};
+
+// ============================================================================
+// Line Codecs
+// ============================================================================
+
+/**
+ * @brief Look up a Bayer raw format
+ * @return Descriptor, NULL if the format is not Bayer raw
+ */
+static const media_format_desc_t* raw_format_desc(uint32_t pixelformat)
+{
+    const media_format_desc_t* desc = libmedia_get_format_desc(pixelformat);
+    return desc && desc->bayer != MEDIA_BAYER_NONE ? desc : NULL;
+}
+
+/**
+ * @brief Check a plane holds width x height samples of a format
+ */
+static int raw_plane_valid(const media_plane_t* plane, uint32_t pixelformat)
+{
+    return plane && plane->data && plane->width > 0 && plane->height > 0 &&
+           plane->width <= MEDIA_RAW_MAX_WIDTH &&
+           plane->stride >= libmedia_get_line_bytes(pixelformat, plane->width);
+}
+
+/**
+ * @brief Decode `count` samples starting at an even column `x0` of one line
+ *
+ * Returns a pointer into the line itself for 16-bit containers and into
+ * `scratch` otherwise.
+ */
+static const uint16_t* raw_load_row(const media_format_desc_t* desc, const uint8_t* row,
+                                    uint32_t x0, uint32_t count, uint16_t* restrict scratch)
+{
+    if (!desc->packed && desc->bits_per_pixel == 16) {
+        return (const uint16_t*)row + x0;
+    }
+
+    if (!desc->packed) {
+        row += x0;
+        for (uint32_t i = 0; i < count; i++) {
+            scratch[i] = row[i];
+        }
+        return scratch;
+    }
+
+    uint32_t i = 0;
+    if (desc->bits_per_sample == 12) {
+        const uint8_t* p = row + (x0 / 2) * 3;
+        for (; i + 2 <= count; i += 2, p += 3) {
+            scratch[i] = (uint16_t)((p[0] << 4) | (p[2] & 0x0F));
+            scratch[i + 1] = (uint16_t)((p[1] << 4) | (p[2] >> 4));
+        }
+        if (i < count) {
+            scratch[i] = (uint16_t)((p[0] << 4) | (p[2] & 0x0F));
+        }
+        return scratch;
+    }
+
+    // RAW10: groups of four; x0 is even so a line may start mid-group
+    uint32_t x = x0;
+    const uint8_t* p = row + (x / 4) * 5;
+    for (; i < count && (x & 3); i++, x++) {
+        scratch[i] = (uint16_t)((p[x & 3] << 2) | ((p[4] >> ((x & 3) * 2)) & 3));
+        if ((x & 3) == 3) {
+            p += 5;
+        }
+    }
+    if (x & 3) {
+        return scratch;
+    }
+    for (; i + 4 <= count; i += 4, p += 5) {
+        uint8_t lo = p[4];
+        scratch[i] = (uint16_t)((p[0] << 2) | (lo & 3));
+        scratch[i + 1] = (uint16_t)((p[1] << 2) | ((lo >> 2) & 3));
+        scratch[i + 2] = (uint16_t)((p[2] << 2) | ((lo >> 4) & 3));
+        scratch[i + 3] = (uint16_t)((p[3] << 2) | (lo >> 6));
+    }
+    for (uint32_t k = 0; i < count; i++, k++) {
+        scratch[i] = (uint16_t)((p[k] << 2) | ((p[4] >> (k * 2)) & 3));
+    }
+    return scratch;
+}
+
+/**
+ * @brief Encode one line of LSB aligned samples into a raw container
+ *
+ * Partial trailing groups of packed formats are zero padded.
+ */
+static void raw_store_row(const media_format_desc_t* desc, uint8_t* restrict row,
+                          const uint16_t* restrict src, uint32_t count)
+{
+    if (!desc->packed && desc->bits_per_pixel == 16) {
+        memcpy(row, src, count * sizeof(uint16_t));
+        return;
+    }
+
+    if (!desc->packed) {
+        for (uint32_t i = 0; i < count; i++) {
+            row[i] = (uint8_t)src[i];
+        }
+        return;
+    }
+
+    uint32_t i = 0;
+    uint8_t* p = row;
+    if (desc->bits_per_sample == 12) {
+        for (; i + 2 <= count; i += 2, p += 3) {
+            p[0] = (uint8_t)(src[i] >> 4);
+            p[1] = (uint8_t)(src[i + 1] >> 4);
+            p[2] = (uint8_t)((src[i] & 0x0F) | ((src[i + 1] & 0x0F) << 4));
+        }
+        if (i < count) {
+            p[0] = (uint8_t)(src[i] >> 4);
+            p[1] = 0;
+            p[2] = (uint8_t)(src[i] & 0x0F);
+        }
+        return;
+    }
+
+    for (; i + 4 <= count; i += 4, p += 5) {
+        p[0] = (uint8_t)(src[i] >> 2);
+        p[1] = (uint8_t)(src[i + 1] >> 2);
+        p[2] = (uint8_t)(src[i + 2] >> 2);
+        p[3] = (uint8_t)(src[i + 3] >> 2);
+        p[4] = (uint8_t)((src[i] & 3) | ((src[i + 1] & 3) << 2) |
+                         ((src[i + 2] & 3) << 4) | ((src[i + 3] & 3) << 6));
+    }
+    if (i < count) {
+        memset(p, 0, 5);
+        for (uint32_t k = 0; i < count; i++, k++) {
+            p[k] = (uint8_t)(src[i] >> 2);
+            p[4] |= (uint8_t)((src[i] & 3) << (k * 2));
+        }
+    }
+}
+
+// ============================================================================
+// Formats
+// ============================================================================
+
+static int bits_index(uint32_t bits)
+{
+    switch (bits) {
+        case 8: return 0;
+        case 10: return 1;
+        case 12: return 2;
+        case 16: return 3;
+        default: return -1;
+    }
+}
+
+uint32_t libmedia_raw_unpacked_format(uint32_t pixelformat)
+{
+    const media_format_desc_t* desc = raw_format_desc(pixelformat);
+    if (!desc) {
+        return 0;
+    }
+    return g_unpacked_formats[desc->bayer][bits_index(desc->bits_per_sample)];
+}
+
+uint32_t libmedia_raw_packed_format(uint32_t pixelformat)
+{
+    const media_format_desc_t* desc = raw_format_desc(pixelformat);
+    if (!desc || (desc->bits_per_sample != 10 && desc->bits_per_sample != 12)) {
+        return 0;
+    }
+    return g_packed_formats[desc->bayer][desc->bits_per_sample == 12];
+}
+
+// ============================================================================
+// Pack / Unpack
+// ============================================================================
+
+int libmedia_raw_unpack(const media_plane_t* src, uint32_t src_format, media_plane_t* dst)
+{
+    const media_format_desc_t* desc = raw_format_desc(src_format);
+    if (!desc || !raw_plane_valid(src, src_format) || !dst || !dst->data ||
+        dst->width != src->width || dst->height != src->height ||
+        dst->stride < src->width * sizeof(uint16_t)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    for (uint32_t y = 0; y < src->height; y++) {
+        const uint8_t* in = (const uint8_t*)src->data + (size_t)y * src->stride;
+        uint16_t* out = (uint16_t*)((uint8_t*)dst->data + (size_t)y * dst->stride);
+        const uint16_t* line = raw_load_row(desc, in, 0, src->width, out);
+        if (line != out) {
+            memmove(out, line, src->width * sizeof(uint16_t));
+        }
+    }
+    return 0;
+}
+
+int libmedia_raw_pack(const media_plane_t* src, uint32_t src_bits, media_plane_t* dst, uint32_t dst_format)
+{
+    const media_format_desc_t* desc = raw_format_desc(dst_format);
+    if (!desc || !src || !src->data || src_bits < 8 || src_bits > 16 ||
+        src->stride < src->width * sizeof(uint16_t) || !raw_plane_valid(dst, dst_format) ||
+        dst->width != src->width || dst->height != src->height) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    uint16_t line[MEDIA_RAW_MAX_WIDTH];
+    uint32_t bits = desc->bits_per_sample;
+
+    for (uint32_t y = 0; y < src->height; y++) {
+        const uint16_t* in = (const uint16_t*)((const uint8_t*)src->data + (size_t)y * src->stride);
+        uint8_t* out = (uint8_t*)dst->data + (size_t)y * dst->stride;
+
+        if (src_bits == bits) {
+            raw_store_row(desc, out, in, src->width);
+            continue;
+        }
+
+        if (src_bits > bits) {
+            uint32_t shift = src_bits - bits;
+            for (uint32_t x = 0; x < src->width; x++) {
+                line[x] = (uint16_t)(in[x] >> shift);
+            }
+        } else {
+            uint32_t shift = bits - src_bits;
+            for (uint32_t x = 0; x < src->width; x++) {
+                line[x] = (uint16_t)(in[x] << shift);
+            }
+        }
+        raw_store_row(desc, out, line, src->width);
+    }
+    return 0;
+}
+
+// ============================================================================
+// Binning
+// ============================================================================
+
+int libmedia_raw_bin2x2(const media_plane_t* src, uint32_t src_format, media_plane_t* dst)
+{
+    const media_format_desc_t* desc = raw_format_desc(src_format);
+    if (!desc || !raw_plane_valid(src, src_format) || (src->width & 3) || (src->height & 3) ||
+        !dst || !dst->data || dst->width != src->width / 2 || dst->height != src->height / 2) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    const media_format_desc_t* out_desc = libmedia_get_format_desc(libmedia_raw_unpacked_format(src_format));
+    if (dst->stride < libmedia_get_line_bytes(out_desc->pixelformat, dst->width)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    uint16_t line0[MEDIA_RAW_MAX_WIDTH];
+    uint16_t line1[MEDIA_RAW_MAX_WIDTH];
+    uint16_t sum[MEDIA_RAW_MAX_WIDTH / 2];
+
+    // Output row Y of phase p averages source rows 4*(Y/2)+p and 4*(Y/2)+p+2
+    for (uint32_t y = 0; y < dst->height; y++) {
+        uint32_t sy = (y >> 1) * 4 + (y & 1);
+        const uint16_t* a = raw_load_row(desc, (const uint8_t*)src->data + (size_t)sy * src->stride,
+                                         0, src->width, line0);
+        const uint16_t* b = raw_load_row(desc, (const uint8_t*)src->data + (size_t)(sy + 2) * src->stride,
+                                         0, src->width, line1);
+
+        for (uint32_t x = 0; x < dst->width; x += 2) {
+            uint32_t sx = x * 2;
+            sum[x] = (uint16_t)(((uint32_t)a[sx] + a[sx + 2] + b[sx] + b[sx + 2] + 2) >> 2);
+            sum[x + 1] = (uint16_t)(((uint32_t)a[sx + 1] + a[sx + 3] + b[sx + 1] + b[sx + 3] + 2) >> 2);
+        }
+        raw_store_row(out_desc, (uint8_t*)dst->data + (size_t)y * dst->stride, sum, dst->width);
+    }
+    return 0;
+}
+
+// ============================================================================
+// Demosaic
+// ============================================================================
+
+/**
+ * @brief Load a line with one mirrored sample of padding on each side
+ *
+ * Mirroring about the edge sample keeps the Bayer phase of the padding.
+ */
+static void demosaic_load_line(const media_format_desc_t* desc, const media_plane_t* src,
+                               uint32_t y, uint16_t* restrict line)
+{
+    uint32_t w = src->width;
+    const uint16_t* row = raw_load_row(desc, (const uint8_t*)src->data + (size_t)y * src->stride,
+                                       0, w, line + 1);
+    if (row != line + 1) {
+        memcpy(line + 1, row, w * sizeof(uint16_t));
+    }
+    line[0] = line[2];
+    line[w + 1] = line[w - 1];
+}
+
+/**
+ * @brief Output layouts of the demosaic kernel
+ */
+enum {
+    DEMOSAIC_RGB24 = 0,
+    DEMOSAIC_BGR24 = 1,
+    DEMOSAIC_RGB48 = 2,
+    DEMOSAIC_LAYOUTS = 3
+};
+
+typedef void (*demosaic_row_fn)(const uint16_t* l0, const uint16_t* l1, const uint16_t* l2,
+                                uint32_t w, uint8_t* out, uint32_t shift);
+
+/**
+ * @brief Interpolate and store one pixel whose colour channel is known
+ *
+ * Always inlined with constant `channel` and `layout`, so each row
+ * instantiation below carries no per-pixel branches.
+ */
+static inline __attribute__((always_inline))
+void demosaic_pixel(const uint16_t* c0, const uint16_t* c1, const uint16_t* c2,
+                    int channel, int layout, uint8_t* out, uint32_t x, uint32_t shift)
+{
+    uint32_t rgb[3];
+    uint32_t center = c1[0];
+    uint32_t cross = (c1[-1] + c1[1] + c0[0] + c2[0] + 2) >> 2;
+    uint32_t diag = (c0[-1] + c0[1] + c2[-1] + c2[1] + 2) >> 2;
+    uint32_t horiz = (c1[-1] + c1[1] + 1) >> 1;
+    uint32_t vert = (c0[0] + c2[0] + 1) >> 1;
+
+    switch (channel) {
+        case MEDIA_RAW_CH_R:
+            rgb[0] = center;
+            rgb[1] = cross;
+            rgb[2] = diag;
+            break;
+        case MEDIA_RAW_CH_B:
+            rgb[0] = diag;
+            rgb[1] = cross;
+            rgb[2] = center;
+            break;
+        case MEDIA_RAW_CH_GR:
+            rgb[0] = horiz;
+            rgb[1] = center;
+            rgb[2] = vert;
+            break;
+        default:
+            rgb[0] = vert;
+            rgb[1] = center;
+            rgb[2] = horiz;
+            break;
+    }
+
+    if (layout == DEMOSAIC_RGB48) {
+        uint16_t* out16 = (uint16_t*)out + x * 3;
+        out16[0] = (uint16_t)rgb[0];
+        out16[1] = (uint16_t)rgb[1];
+        out16[2] = (uint16_t)rgb[2];
+    } else {
+        int r_index = layout == DEMOSAIC_BGR24 ? 2 : 0;
+        out[x * 3 + r_index] = (uint8_t)(rgb[0] >> shift);
+        out[x * 3 + 1] = (uint8_t)(rgb[1] >> shift);
+        out[x * 3 + 2 - r_index] = (uint8_t)(rgb[2] >> shift);
+    }
+}
+
+/**
+ * @brief One output row whose even columns are `even` and odd columns `odd`
+ *
+ * Lines carry one sample of padding on each side.
+ */
+static inline __attribute__((always_inline))
+void demosaic_row(const uint16_t* l0, const uint16_t* l1, const uint16_t* l2, uint32_t w,
+                  uint8_t* out, uint32_t shift, int even, int odd, int layout)
+{
+    uint32_t x = 0;
+    for (; x + 2 <= w; x += 2) {
+        demosaic_pixel(l0 + x + 1, l1 + x + 1, l2 + x + 1, even, layout, out, x, shift);
+        demosaic_pixel(l0 + x + 2, l1 + x + 2, l2 + x + 2, odd, layout, out, x + 1, shift);
+    }
+    if (x < w) {
+        demosaic_pixel(l0 + x + 1, l1 + x + 1, l2 + x + 1, even, layout, out, x, shift);
+    }
+}
+
+// Instantiate demosaic_row for one row phase and output layout
+#define DEMOSAIC_ROW(even, odd, layout) \
+    static void demosaic_row_##even##_##layout(const uint16_t* l0, const uint16_t* l1, const uint16_t* l2, \
+                                               uint32_t w, uint8_t* out, uint32_t shift) \
+    { \
+        demosaic_row(l0, l1, l2, w, out, shift, MEDIA_RAW_CH_##even, MEDIA_RAW_CH_##odd, DEMOSAIC_##layout); \
+    }
+
+#define DEMOSAIC_ROWS(even, odd) \
+    DEMOSAIC_ROW(even, odd, RGB24) \
+    DEMOSAIC_ROW(even, odd, BGR24) \
+    DEMOSAIC_ROW(even, odd, RGB48)
+
+DEMOSAIC_ROWS(R, GR)
+DEMOSAIC_ROWS(GR, R)
+DEMOSAIC_ROWS(GB, B)
+DEMOSAIC_ROWS(B, GB)
+
+#define DEMOSAIC_ROW_ENTRY(even) \
+    { demosaic_row_##even##_RGB24, demosaic_row_##even##_BGR24, demosaic_row_##even##_RGB48 }
+
+/**
+ * @brief Row kernels indexed by [channel of the row's even columns][layout]
+ *
+ * The even channel fixes the odd one: every Bayer row is R/GR, GR/R, GB/B or B/GB.
+ */
+static const demosaic_row_fn g_demosaic_rows[MEDIA_RAW_CHANNELS][DEMOSAIC_LAYOUTS] = {
+    [MEDIA_RAW_CH_R] = DEMOSAIC_ROW_ENTRY(R),
+    [MEDIA_RAW_CH_GR] = DEMOSAIC_ROW_ENTRY(GR),
+    [MEDIA_RAW_CH_GB] = DEMOSAIC_ROW_ENTRY(GB),
+    [MEDIA_RAW_CH_B] = DEMOSAIC_ROW_ENTRY(B),
+};
+
+int libmedia_raw_demosaic(const media_plane_t* src, uint32_t src_format, media_plane_t* dst, uint32_t dst_format)
+{
+    const media_format_desc_t* desc = raw_format_desc(src_format);
+    int layout = dst_format == MEDIA_PIX_FMT_RGB48 ? DEMOSAIC_RGB48 :
+                 dst_format == V4L2_PIX_FMT_BGR24 ? DEMOSAIC_BGR24 :
+                 dst_format == V4L2_PIX_FMT_RGB24 ? DEMOSAIC_RGB24 : -1;
+    if (!desc || !raw_plane_valid(src, src_format) || src->width < 2 || src->height < 2 || layout < 0 ||
+        !dst || !dst->data || dst->width != src->width || dst->height != src->height ||
+        dst->stride < dst->width * (layout == DEMOSAIC_RGB48 ? 6u : 3u)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    uint16_t lines[3][MEDIA_RAW_MAX_WIDTH + 2];
+    uint16_t* l0 = lines[0];
+    uint16_t* l1 = lines[1];
+    uint16_t* l2 = lines[2];
+    uint32_t w = src->width;
+    uint32_t h = src->height;
+    uint32_t shift = desc->bits_per_sample - 8;
+    demosaic_row_fn rows[2] = {
+        g_demosaic_rows[g_bayer_channels[desc->bayer][0]][layout],
+        g_demosaic_rows[g_bayer_channels[desc->bayer][2]][layout],
+    };
+
+    demosaic_load_line(desc, src, 1, l0);
+    demosaic_load_line(desc, src, 0, l1);
+    demosaic_load_line(desc, src, 1, l2);
+
+    for (uint32_t y = 0; y < h; y++) {
+        if (y > 0) {
+            uint16_t* t = l0;
+            l0 = l1;
+            l1 = l2;
+            l2 = t;
+            demosaic_load_line(desc, src, y + 1 < h ? y + 1 : h - 2, l2);
+        }
+        rows[y & 1](l0, l1, l2, w, (uint8_t*)dst->data + (size_t)y * dst->stride, shift);
+    }
+    return 0;
+}
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+int libmedia_raw_statistics(const media_plane_t* src, uint32_t src_format, const media_rect_t* roi,
+                            uint32_t step, media_raw_stats_t* stats)
+{
+    const media_format_desc_t* desc = raw_format_desc(src_format);
+    if (!desc || !raw_plane_valid(src, src_format) || !stats) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    media_rect_t r = roi ? *roi : (media_rect_t){ 0, 0, src->width, src->height };
+    r.width += r.x & 1;
+    r.height += r.y & 1;
+    r.x &= ~1u;
+    r.y &= ~1u;
+    if (r.width == 0 || r.height == 0 || r.x + r.width > src->width || r.y + r.height > src->height) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->bits = desc->bits_per_sample;
+    for (int c = 0; c < MEDIA_RAW_CHANNELS; c++) {
+        stats->min[c] = UINT32_MAX;
+    }
+
+    uint16_t line[MEDIA_RAW_MAX_WIDTH];
+    uint32_t full = (1u << desc->bits_per_sample) - 1;
+    uint32_t hist_shift = desc->bits_per_sample - 8;
+    uint32_t stride = (step > 1 ? step : 1) * 2;
+
+    for (uint32_t y = r.y; y < r.y + r.height; y += (y & 1) ? stride - 1 : 1) {
+        const uint16_t* row = raw_load_row(desc, (const uint8_t*)src->data + (size_t)y * src->stride,
+                                           r.x, r.width, line);
+        const uint8_t* channels = g_bayer_channels[desc->bayer] + (y & 1) * 2;
+
+        for (uint32_t i = 0; i < r.width; i += (i & 1) ? stride - 1 : 1) {
+            uint32_t c = channels[i & 1];
+            uint32_t v = row[i] < full ? row[i] : full;
+            stats->count[c]++;
+            stats->sum[c] += v;
+            if (v < stats->min[c]) {
+                stats->min[c] = v;
+            }
+            if (v > stats->max[c]) {
+                stats->max[c] = v;
+            }
+            stats->saturated[c] += v >= full;
+            stats->histogram[c][v >> hist_shift]++;
+        }
+    }
+
+    for (int c = 0; c < MEDIA_RAW_CHANNELS; c++) {
+        if (stats->count[c] == 0) {
+            stats->min[c] = 0;
+        }
+    }
+    return 0;
+}
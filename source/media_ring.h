@@ -0,0 +1,128 @@
+/**
+ * @file media_ring.h
+ * @brief libMedia internal lock-free rings and futex event counts
+ * @version 1.0.0
+ *
+ * Not installed. media_ring_t is a bounded ring of non-NULL pointers for
+ * one or many producers and one or many consumers. Push and pop never
+ * sleep or take locks; a push into a slot another consumer is still
+ * reading retries until that read completes. media_event_t lets a consumer sleep until
+ * a producer signals, without producers paying for a syscall unless the
+ * consumer is actually asleep.
+ */
+
+#ifndef LIBMEDIA_RING_H
+#define LIBMEDIA_RING_H
+
+#include "media_internal.h"
+#include <stdint.h>
+
+#define MEDIA_CACHE_LINE 64
+
+#define MEDIA_RING_MULTI_PRODUCER 1     /**< Several threads may push concurrently */
+#define MEDIA_RING_MULTI_CONSUMER 2     /**< Several threads may pop concurrently */
+
+// ============================================================================
+// Rings
+// ============================================================================
+
+/**
+ * @struct media_ring_slot
+ * @brief Ring entry; seq is only used by multi-producer or multi-consumer rings
+ */
+typedef struct {
+    uint32_t seq;               /**< Turn marker */
+    void* item;                 /**< Stored pointer */
+} media_ring_slot_t;
+
+/**
+ * @struct media_ring
+ * @brief Bounded lock-free ring, producer and consumer indices on separate cache lines
+ */
+typedef struct {
+    uint32_t tail __attribute__((aligned(MEDIA_CACHE_LINE)));   /**< Next slot to fill (producers) */
+    uint32_t head_cache;        /**< Producer's last view of head (SPSC) */
+    uint32_t head __attribute__((aligned(MEDIA_CACHE_LINE)));   /**< Next slot to drain (consumer) */
+    uint32_t tail_cache;        /**< Consumer's last view of tail (SPSC) */
+    media_ring_slot_t* slots __attribute__((aligned(MEDIA_CACHE_LINE)));  /**< Slot array */
+    uint32_t mask;              /**< Capacity - 1 */
+    int flags;                  /**< MEDIA_RING_MULTI_* flags, 0 = SPSC */
+} media_ring_t;
+
+/**
+ * @brief Initialise a ring, rounding capacity up to a power of two
+ * @return 0 on success, negative on error
+ */
+MEDIA_INTERNAL int media_ring_init(media_ring_t* ring, int flags, uint32_t capacity);
+
+/**
+ * @brief Release ring storage
+ */
+MEDIA_INTERNAL void media_ring_free(media_ring_t* ring);
+
+/**
+ * @brief Append an item without blocking
+ * @return 0 on success, -1 if the ring is full
+ */
+MEDIA_INTERNAL int media_ring_push(media_ring_t* ring, void* item);
+
+/**
+ * @brief Take the oldest item
+ * @return Item, NULL if the ring is empty
+ */
+MEDIA_INTERNAL void* media_ring_pop(media_ring_t* ring);
+
+/**
+ * @brief Number of items queued (a snapshot while producers run)
+ */
+static inline uint32_t media_ring_count(const media_ring_t* ring)
+{
+    // head first: tail never falls behind a head read earlier
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - head;
+}
+
+static inline uint32_t media_ring_capacity(const media_ring_t* ring)
+{
+    return ring->slots ? ring->mask + 1 : 0;
+}
+
+// ============================================================================
+// Event Counts
+// ============================================================================
+
+/**
+ * @struct media_event
+ * @brief Futex event count: bit 0 flags a waiter, the upper bits count signals
+ */
+typedef struct {
+    uint32_t state;
+} media_event_t;
+
+/**
+ * @brief Announce that the caller is about to wait
+ *
+ * The caller must re-check its wake condition after this and only then
+ * call media_event_wait() with the returned key.
+ * @return Wait key
+ */
+static inline uint32_t media_event_prepare(media_event_t* event)
+{
+    return __atomic_or_fetch(&event->state, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Sleep until signalled after media_event_prepare()
+ * @param timeout_ms Timeout in milliseconds (-1 for infinite)
+ * @return 1 if signalled (or spurious), 0 on timeout
+ */
+MEDIA_INTERNAL int media_event_wait(media_event_t* event, uint32_t key, int timeout_ms);
+
+/**
+ * @brief Wake all waiters; costs one load when nobody waits
+ *
+ * Call after publishing the data the waiter checks for.
+ */
+MEDIA_INTERNAL void media_event_signal(media_event_t* event);
+
+#endif // LIBMEDIA_RING_H
@@ -0,0 +1,303 @@
+/**
+ * @file media_roi.c
+ * @brief Single-pass multi-ROI crop and downscale
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Source rows are walked top to bottom exactly once. Every region covering
+ * the current row box-sums its segment horizontally into a per-region row
+ * accumulator; after `scale` rows the accumulator is normalised into the
+ * region's output row. NV12 chroma rows are handled right after the second
+ * luma row they belong to, so the whole frame is still one pass.
+ */
+
+#include "media_proc.h"
+#include "media_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Internal Data Structures
+// ============================================================================
+
+/**
+ * @struct roi_output
+ * @brief Precomputed state of one region
+ */
+typedef struct {
+    media_roi_spec_t spec;      /**< Region specification */
+    uint32_t out_width;         /**< Output width */
+    uint32_t out_height;        /**< Output height */
+    uint32_t y_end;             /**< First luma row past the region */
+    uint32_t reciprocal;        /**< Q16 reciprocal of scale^2 */
+    int with_chroma;            /**< Output is NV12 */
+    uint16_t* acc_y;            /**< Luma row accumulator (out_width) */
+    uint16_t* acc_uv;           /**< Interleaved chroma accumulator (out_width) */
+} roi_output_t;
+
+/**
+ * @struct media_roi_plan
+ * @brief Multi-ROI extraction plan
+ */
+struct media_roi_plan {
+    uint32_t src_width;         /**< Source width */
+    uint32_t src_height;        /**< Source height */
+    uint32_t src_pixelformat;   /**< Source format */
+    uint32_t y_begin;           /**< First luma row used by any region */
+    uint32_t y_end;             /**< First luma row past all regions */
+    int count;                  /**< Number of regions */
+    roi_output_t outputs[MEDIA_ROI_MAX_OUTPUTS];
+};
+
+// ============================================================================
+// Row Kernels
+// ============================================================================
+
+/**
+ * @brief Add `count` box sums of `scale` samples spaced `step` bytes apart
+ */
+static void accumulate_row(uint16_t* restrict acc, const uint8_t* restrict src,
+                           uint32_t count, uint32_t scale, uint32_t step)
+{
+    if (scale == 1) {
+        for (uint32_t i = 0; i < count; i++) {
+            acc[i] += src[i];
+        }
+        return;
+    }
+
+    // step == 2 interleaves U and V: sample i of channel c sits at 2*i + c
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t base = (i / step) * scale * step + (i % step);
+        uint16_t sum = 0;
+        for (uint32_t k = 0; k < scale; k++) {
+            sum += src[base + k * step];
+        }
+        acc[i] += sum;
+    }
+}
+
+/**
+ * @brief Normalise an accumulator row into 8-bit output and clear it
+ */
+static void emit_row(uint8_t* restrict dst, uint16_t* restrict acc, uint32_t count,
+                     uint32_t scale, uint32_t reciprocal)
+{
+    if (scale == 1) {
+        for (uint32_t i = 0; i < count; i++) {
+            dst[i] = (uint8_t)acc[i];
+        }
+    } else {
+        for (uint32_t i = 0; i < count; i++) {
+            dst[i] = (uint8_t)((acc[i] * reciprocal + (1u << 15)) >> 16);
+        }
+    }
+    memset(acc, 0, count * sizeof(uint16_t));
+}
+
+// ============================================================================
+// Public Interface
+// ============================================================================
+
+media_roi_plan_t* libmedia_roi_plan_create(uint32_t src_width, uint32_t src_height, uint32_t src_pixelformat,
+                                           const media_roi_spec_t* specs, int count)
+{
+    if (!specs || count <= 0 || count > MEDIA_ROI_MAX_OUTPUTS || src_width == 0 || src_height == 0 ||
+        (src_pixelformat != V4L2_PIX_FMT_NV12 && src_pixelformat != V4L2_PIX_FMT_GREY)) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_roi_plan_t* plan = calloc(1, sizeof(media_roi_plan_t));
+    if (!plan) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    plan->src_width = src_width;
+    plan->src_height = src_height;
+    plan->src_pixelformat = src_pixelformat;
+    plan->y_begin = src_height;
+    plan->count = count;
+
+    for (int i = 0; i < count; i++) {
+        roi_output_t* out = &plan->outputs[i];
+        const media_rect_t* r = &specs[i].rect;
+        out->spec = specs[i];
+        out->with_chroma = specs[i].pixelformat == V4L2_PIX_FMT_NV12;
+
+        int valid = specs[i].scale >= 1 && specs[i].scale <= MEDIA_ROI_MAX_SCALE &&
+                    (specs[i].pixelformat == V4L2_PIX_FMT_NV12 || specs[i].pixelformat == V4L2_PIX_FMT_GREY) &&
+                    r->width > 0 && r->height > 0 &&
+                    r->x <= src_width && r->width <= src_width - r->x &&
+                    r->y <= src_height && r->height <= src_height - r->y;
+        if (valid && out->with_chroma) {
+            valid = src_pixelformat == V4L2_PIX_FMT_NV12 && !(r->x & 1) && !(r->y & 1);
+        }
+
+        out->out_width = valid ? r->width / specs[i].scale : 0;
+        out->out_height = valid ? r->height / specs[i].scale : 0;
+        if (out->with_chroma) {
+            out->out_width &= ~1u;
+            out->out_height &= ~1u;
+        }
+
+        if (!valid || out->out_width == 0 || out->out_height == 0) {
+            MEDIA_DEBUG(DEBUG_ERROR, "Invalid ROI %d: %ux%u+%u+%u scale %u %s", i,
+                        r->width, r->height, r->x, r->y, specs[i].scale,
+                        libmedia_get_format_name(specs[i].pixelformat));
+            libmedia_roi_plan_destroy(plan);
+            media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+            return NULL;
+        }
+
+        out->y_end = r->y + out->out_height * specs[i].scale;
+        out->reciprocal = (65536 + specs[i].scale * specs[i].scale / 2) / (specs[i].scale * specs[i].scale);
+        out->acc_y = calloc(out->out_width, sizeof(uint16_t));
+        out->acc_uv = out->with_chroma ? calloc(out->out_width, sizeof(uint16_t)) : NULL;
+        if (!out->acc_y || (out->with_chroma && !out->acc_uv)) {
+            libmedia_roi_plan_destroy(plan);
+            media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+
+        if (r->y < plan->y_begin) {
+            plan->y_begin = r->y;
+        }
+        if (out->y_end > plan->y_end) {
+            plan->y_end = out->y_end;
+        }
+    }
+
+    MEDIA_DEBUG(DEBUG_INFO, "Created ROI plan with %d outputs over rows %u-%u",
+                count, plan->y_begin, plan->y_end);
+    return plan;
+}
+
+size_t libmedia_roi_plan_get_output(const media_roi_plan_t* plan, int index, uint32_t* width, uint32_t* height)
+{
+    if (!plan || index < 0 || index >= plan->count) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return 0;
+    }
+
+    const roi_output_t* out = &plan->outputs[index];
+    if (width) {
+        *width = out->out_width;
+    }
+    if (height) {
+        *height = out->out_height;
+    }
+
+    size_t luma = (size_t)out->out_width * out->out_height;
+    return out->with_chroma ? luma + luma / 2 : luma;
+}
+
+int libmedia_roi_plan_execute(media_roi_plan_t* plan, const media_frame_t* src, media_frame_t* outputs)
+{
+    if (!plan || !src || !src->data || !outputs ||
+        src->width != plan->src_width || src->height != plan->src_height ||
+        src->pixelformat != plan->src_pixelformat) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    size_t luma_size = (size_t)src->width * src->height;
+    int src_chroma = src->pixelformat == V4L2_PIX_FMT_NV12;
+    if (src->size && src->size < (src_chroma ? luma_size + luma_size / 2 : luma_size)) {
+        media_set_last_error(MEDIA_ERROR_BUFFER_ERROR);
+        return -1;
+    }
+
+    for (int i = 0; i < plan->count; i++) {
+        if (!outputs[i].data) {
+            media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+            return -1;
+        }
+        roi_output_t* out = &plan->outputs[i];
+        outputs[i].size = libmedia_roi_plan_get_output(plan, i, &outputs[i].width, &outputs[i].height);
+        outputs[i].pixelformat = out->spec.pixelformat;
+        outputs[i].timestamp = src->timestamp;
+        outputs[i].frame_id = src->frame_id;
+        outputs[i].sequence = src->sequence;
+        memset(out->acc_y, 0, out->out_width * sizeof(uint16_t));
+        if (out->acc_uv) {
+            memset(out->acc_uv, 0, out->out_width * sizeof(uint16_t));
+        }
+    }
+
+    const uint8_t* luma = src->data;
+    const uint8_t* chroma = luma + luma_size;
+
+    for (uint32_t y = plan->y_begin; y < plan->y_end; y++) {
+        const uint8_t* row = luma + (size_t)y * src->width;
+
+        for (int i = 0; i < plan->count; i++) {
+            roi_output_t* out = &plan->outputs[i];
+            const media_rect_t* r = &out->spec.rect;
+            uint32_t scale = out->spec.scale;
+            if (y < r->y || y >= out->y_end) {
+                continue;
+            }
+
+            uint32_t ry = y - r->y;
+            uint8_t* dst = (uint8_t*)outputs[i].data + (size_t)(ry / scale) * out->out_width;
+
+            if (scale == 1) {
+                memcpy(dst, row + r->x, out->out_width);
+                continue;
+            }
+
+            accumulate_row(out->acc_y, row + r->x, out->out_width, scale, 1);
+            if (ry % scale == scale - 1) {
+                emit_row(dst, out->acc_y, out->out_width, scale, out->reciprocal);
+            }
+        }
+
+        // A chroma row is complete once both of its luma rows have been seen
+        if (!src_chroma || !(y & 1)) {
+            continue;
+        }
+
+        uint32_t cy = y / 2;
+        const uint8_t* crow = chroma + (size_t)cy * src->width;
+
+        for (int i = 0; i < plan->count; i++) {
+            roi_output_t* out = &plan->outputs[i];
+            const media_rect_t* r = &out->spec.rect;
+            uint32_t scale = out->spec.scale;
+            if (!out->with_chroma || cy < r->y / 2 || cy >= out->y_end / 2) {
+                continue;
+            }
+
+            uint32_t rcy = cy - r->y / 2;
+            uint8_t* dst = (uint8_t*)outputs[i].data + (size_t)out->out_width * out->out_height +
+                           (size_t)(rcy / scale) * out->out_width;
+
+            if (scale == 1) {
+                memcpy(dst, crow + r->x, out->out_width);
+                continue;
+            }
+
+            accumulate_row(out->acc_uv, crow + r->x, out->out_width, scale, 2);
+            if (rcy % scale == scale - 1) {
+                emit_row(dst, out->acc_uv, out->out_width, scale, out->reciprocal);
+            }
+        }
+    }
+
+    return 0;
+}
+
+void libmedia_roi_plan_destroy(media_roi_plan_t* plan)
+{
+    if (!plan) {
+        return;
+    }
+
+    for (int i = 0; i < plan->count; i++) {
+        free(plan->outputs[i].acc_y);
+        free(plan->outputs[i].acc_uv);
+    }
+    free(plan);
+}
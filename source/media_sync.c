@@ -0,0 +1,281 @@
+/**
+ * @file media_sync.c
+ * @brief Cross-camera frame synchronization
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Each stream keeps its held frames in arrival order, so the heads are the
+ * oldest frames. Matching only looks at the heads. If they fit together,
+ * they form a set. If not, the head that is too early can never match: the
+ * other streams only deliver later frames. It is dropped and matching
+ * starts again.
+ */
+
+#include "media_sync.h"
+#include "media_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Internal Data Structures
+// ============================================================================
+
+/**
+ * @struct sync_entry
+ * @brief Held frame
+ */
+typedef struct {
+    media_session_t* session;
+    media_frame_t frame;
+} sync_entry_t;
+
+/**
+ * @struct sync_stream
+ * @brief Held frames of one stream, oldest at head
+ */
+typedef struct {
+    sync_entry_t entries[MEDIA_SYNC_MAX_PENDING];
+    int head;
+    int count;
+    uint32_t offset;            /**< Learned sequence offset to stream 0 */
+} sync_stream_t;
+
+struct media_sync {
+    media_sync_config_t config;
+    sync_stream_t streams[MEDIA_SYNC_MAX_STREAMS];
+    int locked;                 /**< Sequence offsets are valid */
+    uint64_t skew_sum;          /**< For the mean skew */
+    media_sync_stats_t stats;
+    pthread_mutex_t lock;
+};
+
+// ============================================================================
+// Matching
+// ============================================================================
+
+static sync_entry_t* sync_head(media_sync_t* sync, int stream)
+{
+    sync_stream_t* s = &sync->streams[stream];
+    return &s->entries[s->head];
+}
+
+static void sync_pop(media_sync_t* sync, int stream)
+{
+    sync_stream_t* s = &sync->streams[stream];
+    s->head = (s->head + 1) % sync->config.max_pending;
+    s->count--;
+}
+
+static void sync_drop_head(media_sync_t* sync, int stream)
+{
+    sync_entry_t* entry = sync_head(sync, stream);
+    libmedia_session_release_frame(entry->session, &entry->frame);
+    sync_pop(sync, stream);
+    sync->stats.dropped[stream]++;
+}
+
+/**
+ * @brief Form sets from the stream heads while every stream has a frame
+ * @return Number of sets delivered
+ */
+static int sync_match(media_sync_t* sync)
+{
+    int n = sync->config.stream_count;
+    int delivered = 0;
+
+    for (;;) {
+        for (int i = 0; i < n; i++) {
+            if (sync->streams[i].count == 0) {
+                return delivered;
+            }
+        }
+
+        int earliest = 0;
+        uint64_t min_ts = sync_head(sync, 0)->frame.timestamp;
+        uint64_t max_ts = min_ts;
+        for (int i = 1; i < n; i++) {
+            uint64_t ts = sync_head(sync, i)->frame.timestamp;
+            if (ts < min_ts) {
+                min_ts = ts;
+                earliest = i;
+            }
+            if (ts > max_ts) {
+                max_ts = ts;
+            }
+        }
+        uint64_t skew = max_ts - min_ts;
+
+        if (sync->locked) {
+            // Sequence numbers relative to stream 0; wrap-safe by signed difference
+            uint32_t key0 = sync_head(sync, 0)->frame.sequence;
+            int lowest = 0;
+            int32_t lowest_diff = 0;
+            int equal = 1;
+            for (int i = 1; i < n; i++) {
+                int32_t diff = (int32_t)(sync_head(sync, i)->frame.sequence - sync->streams[i].offset - key0);
+                if (diff != 0) {
+                    equal = 0;
+                }
+                if (diff < lowest_diff) {
+                    lowest_diff = diff;
+                    lowest = i;
+                }
+            }
+            if (!equal) {
+                sync_drop_head(sync, lowest);   // Stream 0 when every other stream is ahead
+                continue;
+            }
+            if (skew > sync->config.tolerance_ns) {
+                MEDIA_DEBUG(DEBUG_WARNING, "Sequence match with %llu ns skew, resynchronizing",
+                            (unsigned long long)skew);
+                for (int i = 0; i < n; i++) {
+                    sync_drop_head(sync, i);
+                }
+                sync->locked = 0;
+                sync->stats.resyncs++;
+                continue;
+            }
+        } else {
+            if (skew > sync->config.tolerance_ns) {
+                sync_drop_head(sync, earliest);
+                continue;
+            }
+            if (sync->config.match_sequence) {
+                uint32_t key0 = sync_head(sync, 0)->frame.sequence;
+                for (int i = 0; i < n; i++) {
+                    sync->streams[i].offset = sync_head(sync, i)->frame.sequence - key0;
+                }
+                sync->locked = 1;
+            }
+        }
+
+        media_sync_set_t set;
+        set.count = n;
+        set.skew_ns = skew;
+        for (int i = 0; i < n; i++) {
+            sync_entry_t* entry = sync_head(sync, i);
+            set.sessions[i] = entry->session;
+            set.frames[i] = entry->frame;
+            sync_pop(sync, i);
+        }
+
+        sync->stats.sets++;
+        sync->stats.skew_last_ns = skew;
+        if (skew > sync->stats.skew_max_ns) {
+            sync->stats.skew_max_ns = skew;
+        }
+        sync->skew_sum += skew;
+        sync->stats.skew_mean_ns = sync->skew_sum / sync->stats.sets;
+
+        if (sync->config.on_set(sync->config.user_data, &set) == 0) {
+            for (int i = 0; i < n; i++) {
+                libmedia_session_release_frame(set.sessions[i], &set.frames[i]);
+            }
+        }
+        delivered++;
+    }
+}
+
+// ============================================================================
+// Synchronizer API
+// ============================================================================
+
+media_sync_t* libmedia_sync_create(const media_sync_config_t* config)
+{
+    if (!config || !config->on_set || config->stream_count < 2 ||
+        config->stream_count > MEDIA_SYNC_MAX_STREAMS ||
+        config->max_pending < 0 || config->max_pending > MEDIA_SYNC_MAX_PENDING) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return NULL;
+    }
+
+    media_sync_t* sync = calloc(1, sizeof(media_sync_t));
+    if (!sync) {
+        media_set_last_error(MEDIA_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    sync->config = *config;
+    if (sync->config.max_pending == 0) {
+        sync->config.max_pending = 2;
+    }
+    pthread_mutex_init(&sync->lock, NULL);
+    return sync;
+}
+
+int libmedia_sync_push(media_sync_t* sync, int stream, media_session_t* session,
+                       const media_frame_t* frame)
+{
+    if (!session || !frame) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (!sync || stream < 0 || stream >= sync->config.stream_count) {
+        media_frame_t copy = *frame;
+        libmedia_session_release_frame(session, &copy);
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pthread_mutex_lock(&sync->lock);
+
+    sync_stream_t* s = &sync->streams[stream];
+    if (s->count == sync->config.max_pending) {
+        // Other streams fell behind; give the oldest buffer back to the driver
+        sync_drop_head(sync, stream);
+    }
+    sync_entry_t* entry = &s->entries[(s->head + s->count) % sync->config.max_pending];
+    entry->session = session;
+    entry->frame = *frame;
+    s->count++;
+
+    int delivered = sync_match(sync);
+
+    pthread_mutex_unlock(&sync->lock);
+    return delivered;
+}
+
+int libmedia_sync_flush(media_sync_t* sync)
+{
+    if (!sync) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pthread_mutex_lock(&sync->lock);
+    for (int i = 0; i < sync->config.stream_count; i++) {
+        sync_stream_t* s = &sync->streams[i];
+        while (s->count > 0) {
+            sync_entry_t* entry = sync_head(sync, i);
+            libmedia_session_release_frame(entry->session, &entry->frame);
+            sync_pop(sync, i);
+        }
+    }
+    sync->locked = 0;
+    pthread_mutex_unlock(&sync->lock);
+    return 0;
+}
+
+int libmedia_sync_get_stats(media_sync_t* sync, media_sync_stats_t* stats)
+{
+    if (!sync || !stats) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+
+    pthread_mutex_lock(&sync->lock);
+    *stats = sync->stats;
+    pthread_mutex_unlock(&sync->lock);
+    return 0;
+}
+
+void libmedia_sync_destroy(media_sync_t* sync)
+{
+    if (!sync) {
+        return;
+    }
+
+    libmedia_sync_flush(sync);
+    pthread_mutex_destroy(&sync->lock);
+    free(sync);
+}
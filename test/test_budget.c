@@ -0,0 +1,295 @@
+/**
+ * @file test_budget.c
+ * @brief Memory budget: downsized buffer requests and refusals
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Frame pools and queues that do not fit the budget must fail without
+ * charging anything. Capture buffer requests run against a simulated
+ * device behind --wrap'ed open, ioctl, mmap and munmap, on the single- and
+ * multi-planar APIs: a request that does not fit is asked again of the
+ * driver with as many buffers as fit, one that would leave fewer than two
+ * is refused and its driver buffers released, and so is one where the
+ * driver insists on more buffers than fit. A later request replaces the
+ * charge of the earlier one, and freeing the buffers returns it.
+ *
+ * Usage: test_budget [0|1] (single- or multi-planar capture, both when omitted)
+ */
+
+#define _GNU_SOURCE
+#include "media.h"
+#include "media_pool.h"
+#include "media_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+// ============================================================================
+// Simulated Device
+// ============================================================================
+
+#define FAKE_PATH "/dev/libmedia-test-budget"
+#define FAKE_BUFFERS 8
+#define FAKE_BUFFER_BYTES (256 * 1024)      /**< Per buffer, both planes together when multi-planar */
+#define FAKE_PLANES 2
+
+static uint8_t g_storage[FAKE_BUFFERS][FAKE_BUFFER_BYTES];
+
+static struct {
+    int fd;
+    uint32_t min_count;         /**< Fewest buffers the driver grants */
+    uint32_t requests[8];       /**< Counts asked of VIDIOC_REQBUFS, in order */
+    int request_count;
+} fake = { .fd = -1 };
+
+static int fake_ioctl(unsigned long request, void* arg)
+{
+    if ((unsigned)request == (unsigned)VIDIOC_REQBUFS) {
+        struct v4l2_requestbuffers* req = arg;
+        if (fake.request_count < 8) {
+            fake.requests[fake.request_count++] = req->count;
+        }
+        if (req->count > FAKE_BUFFERS) {
+            req->count = FAKE_BUFFERS;
+        }
+        if (req->count && req->count < fake.min_count) {
+            req->count = fake.min_count;
+        }
+        return 0;
+    }
+
+    if ((unsigned)request == (unsigned)VIDIOC_QUERYBUF) {
+        struct v4l2_buffer* b = arg;
+        if (b->index >= FAKE_BUFFERS) {
+            errno = EINVAL;
+            return -1;
+        }
+        uint32_t offset = b->index * FAKE_BUFFER_BYTES;
+        if (b->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+            b->length = FAKE_PLANES;
+            for (uint32_t p = 0; p < FAKE_PLANES; p++) {
+                b->m.planes[p].length = FAKE_BUFFER_BYTES / FAKE_PLANES;
+                b->m.planes[p].m.mem_offset = offset + p * FAKE_BUFFER_BYTES / FAKE_PLANES;
+            }
+        } else {
+            b->length = FAKE_BUFFER_BYTES;
+            b->m.offset = offset;
+        }
+        return 0;
+    }
+
+    errno = ENOTTY;
+    return -1;
+}
+
+static void fake_reset(uint32_t min_count)
+{
+    memset(fake.requests, 0, sizeof(fake.requests));
+    fake.request_count = 0;
+    fake.min_count = min_count;
+}
+
+static uint32_t fake_last_request(void)
+{
+    return fake.request_count ? fake.requests[fake.request_count - 1] : 0xFFFFFFFFu;
+}
+
+// ============================================================================
+// Wrapped System Calls (--wrap)
+// ============================================================================
+
+int __real_open(const char* path, int flags, ...);
+int __real_ioctl(int fd, unsigned long request, ...);
+void* __real_mmap(void* address, size_t length, int prot, int flags, int fd, off_t offset);
+int __real_munmap(void* address, size_t length);
+
+int __wrap_open(const char* path, int flags, ...)
+{
+    if (strcmp(path, FAKE_PATH) == 0) {
+        fake.fd = eventfd(0, EFD_CLOEXEC);
+        return fake.fd;
+    }
+
+    va_list ap;
+    va_start(ap, flags);
+    int mode = va_arg(ap, int);
+    va_end(ap);
+    return __real_open(path, flags, mode);
+}
+
+int __wrap_ioctl(int fd, unsigned long request, ...)
+{
+    va_list ap;
+    va_start(ap, request);
+    void* arg = va_arg(ap, void*);
+    va_end(ap);
+
+    if (fd >= 0 && fd == fake.fd) {
+        return fake_ioctl(request, arg);
+    }
+    return __real_ioctl(fd, request, arg);
+}
+
+void* __wrap_mmap(void* address, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    if (fd >= 0 && fd == fake.fd) {
+        return (uint8_t*)g_storage + offset;
+    }
+    return __real_mmap(address, length, prot, flags, fd, offset);
+}
+
+int __wrap_munmap(void* address, size_t length)
+{
+    if ((uint8_t*)address >= (uint8_t*)g_storage && (uint8_t*)address < (uint8_t*)g_storage + sizeof(g_storage)) {
+        return 0;
+    }
+    return __real_munmap(address, length);
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static media_memory_stats_t stats(void)
+{
+    media_memory_stats_t s;
+    memset(&s, 0, sizeof(s));
+    libmedia_get_memory_stats(&s);
+    return s;
+}
+
+static void test_pool_and_queue(void)
+{
+    printf("pools and queues\n");
+
+    media_memory_stats_t before = stats();
+    CHECK(libmedia_set_memory_budget(before.used + 100000) == 0, "set budget failed");
+
+    media_pool_t* pool = libmedia_pool_create(0);
+    media_pool_key_t key = { 0, 0, 0, 50000 };
+    CHECK(pool && libmedia_pool_reserve(pool, &key, 4) < 0 && libmedia_get_last_error() == MEDIA_ERROR_OUT_OF_MEMORY,
+          "pool of 200000 bytes fit a budget of 100000");
+    media_memory_stats_t s = stats();
+    CHECK(s.used == before.used && s.refused == before.refused + 1, "refused pool charged %zu bytes, %llu refusals",
+          s.used - before.used, (unsigned long long)(s.refused - before.refused));
+
+    CHECK(libmedia_pool_reserve(pool, &key, 1) == 0, "pool of one buffer refused: %d", libmedia_get_last_error());
+    size_t pool_bytes = stats().used - before.used;
+    CHECK(pool_bytes >= 50000 && pool_bytes <= 100000, "pool of one buffer charged %zu bytes", pool_bytes);
+    CHECK(libmedia_set_memory_budget(before.used + 1000) < 0, "budget below current usage accepted");
+
+    CHECK(!libmedia_queue_create(MEDIA_QUEUE_SPSC, 65536) && libmedia_get_last_error() == MEDIA_ERROR_OUT_OF_MEMORY,
+          "queue of 65536 slots fit");
+    media_queue_t* queue = libmedia_queue_create(MEDIA_QUEUE_SPSC, 64);
+    CHECK(queue, "small queue refused");
+
+    libmedia_queue_destroy(queue);
+    libmedia_pool_destroy(pool);
+    s = stats();
+    CHECK(s.used == before.used, "%zd bytes still charged", (ssize_t)(s.used - before.used));
+    CHECK(s.peak >= before.used + pool_bytes, "peak %zu below the pool's charge", s.peak);
+    libmedia_reset_memory_peak();
+    CHECK(stats().peak == s.used, "peak not reset to current usage");
+    libmedia_set_memory_budget(0);
+}
+
+static int request(int handle, int mplane, int count, media_buffer_t* buffers)
+{
+    return mplane ? libmedia_request_buffers_mp(handle, count, buffers)
+                  : libmedia_request_buffers(handle, count, buffers);
+}
+
+static void test_capture(int mplane)
+{
+    printf("%s capture buffers\n", mplane ? "multi-planar" : "single-planar");
+
+    int handle = libmedia_open_device(FAKE_PATH);
+    CHECK(handle >= 0, "open failed");
+    if (handle < 0) {
+        return;
+    }
+    media_buffer_t buffers[FAKE_BUFFERS];
+    memset(buffers, 0, sizeof(buffers));
+    media_memory_stats_t before = stats();
+    const size_t per = FAKE_BUFFER_BYTES;
+
+    // Room for three and a half buffers: eight asked, three granted
+    fake_reset(0);
+    libmedia_set_memory_budget(before.used + 3 * per + per / 2);
+    int granted = request(handle, mplane, 8, buffers);
+    media_memory_stats_t s = stats();
+    CHECK(granted == 3, "%d buffers granted, expected 3", granted);
+    CHECK(fake.request_count == 2 && fake.requests[0] == 8 && fake.requests[1] == 3,
+          "driver asked for %u then %u", fake.requests[0], fake.requests[1]);
+    CHECK(s.used == before.used + 3 * per, "%zu bytes charged for three buffers", s.used - before.used);
+    CHECK(s.downsized == before.downsized + 1, "downsized count %llu", (unsigned long long)s.downsized);
+    CHECK(buffers[2].start[0] == (uint8_t*)g_storage[2], "buffer 2 not mapped");
+
+    // A new request replaces the charge instead of adding to it
+    fake_reset(0);
+    granted = request(handle, mplane, 2, buffers);
+    CHECK(granted == 2 && stats().used == before.used + 2 * per, "second request: %d buffers, %zu bytes", granted,
+          stats().used - before.used);
+    CHECK(libmedia_free_buffers(handle, buffers, granted) == 0 && stats().used == before.used,
+          "free left %zd bytes charged", (ssize_t)(stats().used - before.used));
+
+    // Room for one and a half: below the two-buffer floor, refused
+    fake_reset(0);
+    libmedia_set_memory_budget(before.used + per + per / 2);
+    granted = request(handle, mplane, 8, buffers);
+    s = stats();
+    CHECK(granted < 0 && libmedia_get_last_error() == MEDIA_ERROR_OUT_OF_MEMORY, "request granted %d buffers", granted);
+    CHECK(fake_last_request() == 0, "driver buffers not released, last request %u", fake_last_request());
+    CHECK(s.used == before.used && s.refused == before.refused + 1, "refusal charged %zu bytes, %llu refusals",
+          s.used - before.used, (unsigned long long)(s.refused - before.refused));
+
+    // Room for three, but the driver will not go below four
+    fake_reset(4);
+    libmedia_set_memory_budget(before.used + 3 * per + per / 2);
+    granted = request(handle, mplane, 8, buffers);
+    CHECK(granted < 0 && fake.request_count == 3 && fake.requests[1] == 3 && fake_last_request() == 0,
+          "driver minimum: %d granted, %d requests", granted, fake.request_count);
+    CHECK(stats().used == before.used, "driver minimum left %zu bytes charged", stats().used - before.used);
+
+    // Fits: asked once, nothing downsized
+    fake_reset(0);
+    libmedia_set_memory_budget(before.used + 6 * per);
+    uint64_t downsized = stats().downsized;
+    granted = request(handle, mplane, 4, buffers);
+    CHECK(granted == 4 && fake.request_count == 1 && stats().downsized == downsized, "request that fits was changed");
+
+    libmedia_close_device(handle);
+    CHECK(stats().used == before.used, "close left %zu bytes charged", stats().used - before.used);
+    libmedia_set_memory_budget(0);
+}
+
+int main(int argc, char* argv[])
+{
+    test_pool_and_queue();
+    if (argc < 2 || atoi(argv[1]) == 0) {
+        test_capture(0);
+    }
+    if (argc < 2 || atoi(argv[1]) == 1) {
+        test_capture(1);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+/**
+ * @file test_clahe.c
+ * @brief CLAHE output checks on synthetic planes
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * With a single tile and no clipping CLAHE is plain histogram equalization,
+ * so a ramp holding every value equally often must map to the closed-form
+ * equalization curve. Further checks: a flat plane stays flat, a
+ * low-contrast plane is stretched, the clip limit flattens the curve around
+ * a histogram peak, helper threads and in-place operation give the same
+ * bytes as the single-threaded copy, and an NV12 frame keeps its chroma.
+ */
+
+#include "media_proc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+/**
+ * @brief Plane with its own memory and some row padding
+ */
+typedef struct {
+    media_plane_t plane;
+    uint8_t* memory;
+} test_plane_t;
+
+static int plane_alloc(test_plane_t* p, uint32_t width, uint32_t height)
+{
+    uint32_t stride = width + 16;
+    p->memory = calloc(height, stride);
+    p->plane = (media_plane_t){ p->memory, width, height, stride };
+    return p->memory ? 0 : -1;
+}
+
+static inline uint8_t* pixel(test_plane_t* p, uint32_t x, uint32_t y)
+{
+    return p->memory + (size_t)y * p->plane.stride + x;
+}
+
+/**
+ * @brief Fill with a reproducible random pattern in [lo, lo + range)
+ */
+static void fill_random(test_plane_t* p, uint32_t lo, uint32_t range, uint32_t seed)
+{
+    uint32_t state = seed;
+    for (uint32_t y = 0; y < p->plane.height; y++) {
+        for (uint32_t x = 0; x < p->plane.width; x++) {
+            state = state * 1103515245u + 12345u;
+            *pixel(p, x, y) = (uint8_t)(lo + (state >> 16) % range);
+        }
+    }
+}
+
+static int planes_equal(test_plane_t* a, test_plane_t* b)
+{
+    for (uint32_t y = 0; y < a->plane.height; y++) {
+        if (memcmp(pixel(a, 0, y), pixel(b, 0, y), a->plane.width) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void plane_range(test_plane_t* p, uint32_t* lo, uint32_t* hi)
+{
+    *lo = 255;
+    *hi = 0;
+    for (uint32_t y = 0; y < p->plane.height; y++) {
+        for (uint32_t x = 0; x < p->plane.width; x++) {
+            uint32_t v = *pixel(p, x, y);
+            *lo = v < *lo ? v : *lo;
+            *hi = v > *hi ? v : *hi;
+        }
+    }
+}
+
+static media_clahe_t* create(uint32_t tiles, uint32_t clip, int threads)
+{
+    media_clahe_config_t config = { tiles, tiles, clip, threads };
+    media_clahe_t* clahe = libmedia_clahe_create(&config);
+    CHECK(clahe, "create %ux%u clip %u threads %d failed: %d", tiles, tiles, clip, threads,
+          libmedia_get_last_error());
+    return clahe;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static void test_equalization(void)
+{
+    printf("single tile equalization\n");
+
+    // Every value 64 times: cdf(i) = (i + 1) / 256 of the area
+    test_plane_t src, dst;
+    media_clahe_t* clahe = create(1, 0, 1);
+    if (!clahe || plane_alloc(&src, 256, 64) < 0 || plane_alloc(&dst, 256, 64) < 0) {
+        CHECK(0, "setup failed");
+        return;
+    }
+    for (uint32_t y = 0; y < 64; y++) {
+        for (uint32_t x = 0; x < 256; x++) {
+            *pixel(&src, x, y) = (uint8_t)((x + y * 37) & 0xFF);
+        }
+    }
+
+    CHECK(libmedia_clahe_process(clahe, &src.plane, &dst.plane) == 0, "process failed");
+    int wrong = 0;
+    for (uint32_t y = 0; y < 64; y++) {
+        for (uint32_t x = 0; x < 256; x++) {
+            uint32_t v = *pixel(&src, x, y);
+            wrong += *pixel(&dst, x, y) != ((v + 1) * 255 + 128) / 256;
+        }
+    }
+    CHECK(wrong == 0, "%d pixels off the equalization curve", wrong);
+
+    libmedia_clahe_destroy(clahe);
+    free(src.memory);
+    free(dst.memory);
+}
+
+static void test_flat_and_stretch(void)
+{
+    printf("flat and low-contrast planes\n");
+
+    test_plane_t src, dst;
+    media_clahe_t* clahe = create(4, 512, 1);
+    if (!clahe || plane_alloc(&src, 160, 120) < 0 || plane_alloc(&dst, 160, 120) < 0) {
+        CHECK(0, "setup failed");
+        return;
+    }
+
+    memset(src.memory, 90, (size_t)src.plane.stride * src.plane.height);
+    CHECK(libmedia_clahe_process(clahe, &src.plane, &dst.plane) == 0, "process failed");
+    uint32_t lo, hi;
+    plane_range(&dst, &lo, &hi);
+    CHECK(lo == hi, "flat plane became %u..%u", lo, hi);
+
+    // Sixteen grey levels around mid-grey spread over most of the range
+    libmedia_clahe_destroy(clahe);
+    clahe = create(4, 0, 1);
+    fill_random(&src, 100, 16, 7);
+    CHECK(clahe && libmedia_clahe_process(clahe, &src.plane, &dst.plane) == 0, "process failed");
+    plane_range(&dst, &lo, &hi);
+    CHECK(hi - lo >= 200, "100..115 stretched only to %u..%u", lo, hi);
+
+    libmedia_clahe_destroy(clahe);
+    free(src.memory);
+    free(dst.memory);
+}
+
+static void test_clip_limit(void)
+{
+    printf("clip limit\n");
+
+    // Nine in ten pixels 128, the rest spread over the whole range
+    test_plane_t src, clipped, unclipped;
+    if (plane_alloc(&src, 200, 100) < 0 || plane_alloc(&clipped, 200, 100) < 0 ||
+        plane_alloc(&unclipped, 200, 100) < 0) {
+        CHECK(0, "setup failed");
+        return;
+    }
+    fill_random(&src, 0, 256, 3);
+    for (uint32_t i = 0; i < 200 * 100; i++) {
+        if (i % 10) {
+            *pixel(&src, i % 200, i / 200) = 128;
+        }
+    }
+    *pixel(&src, 0, 0) = 120;
+    *pixel(&src, 1, 0) = 136;
+
+    media_clahe_t* a = create(1, 512, 1);
+    media_clahe_t* b = create(1, 0, 1);
+    CHECK(a && b && libmedia_clahe_process(a, &src.plane, &clipped.plane) == 0 &&
+          libmedia_clahe_process(b, &src.plane, &unclipped.plane) == 0, "process failed");
+
+    // The peak owns most of the unclipped curve; clipping gives it a small step
+    int clipped_step = *pixel(&clipped, 1, 0) - *pixel(&clipped, 0, 0);
+    int unclipped_step = *pixel(&unclipped, 1, 0) - *pixel(&unclipped, 0, 0);
+    CHECK(unclipped_step > 200, "unclipped step across the peak %d", unclipped_step);
+    CHECK(clipped_step > 0 && clipped_step < 64, "clipped step across the peak %d", clipped_step);
+
+    libmedia_clahe_destroy(a);
+    libmedia_clahe_destroy(b);
+    free(src.memory);
+    free(clipped.memory);
+    free(unclipped.memory);
+}
+
+static void test_threads_and_in_place(void)
+{
+    printf("threads and in-place\n");
+
+    test_plane_t src, single, threaded;
+    if (plane_alloc(&src, 333, 211) < 0 || plane_alloc(&single, 333, 211) < 0 ||
+        plane_alloc(&threaded, 333, 211) < 0) {
+        CHECK(0, "setup failed");
+        return;
+    }
+    fill_random(&src, 0, 256, 11);
+
+    media_clahe_t* one = create(8, 768, 1);
+    media_clahe_t* four = create(8, 768, 4);
+    CHECK(one && four && libmedia_clahe_process(one, &src.plane, &single.plane) == 0 &&
+          libmedia_clahe_process(four, &src.plane, &threaded.plane) == 0, "process failed");
+    CHECK(planes_equal(&single, &threaded), "four threads differ from one");
+
+    // Same context, a narrower plane: column tables are rebuilt
+    media_plane_t narrow = { src.memory, 200, 211, src.plane.stride };
+    media_plane_t narrow_out = { threaded.memory, 200, 211, threaded.plane.stride };
+    CHECK(libmedia_clahe_process(four, &narrow, &narrow_out) == 0, "narrow process failed");
+    CHECK(libmedia_clahe_process(four, &src.plane, &threaded.plane) == 0 && planes_equal(&single, &threaded),
+          "output changed after a size change");
+
+    CHECK(libmedia_clahe_process(four, &src.plane, &src.plane) == 0, "in-place process failed");
+    CHECK(planes_equal(&single, &src), "in-place output differs");
+
+    libmedia_clahe_destroy(one);
+    libmedia_clahe_destroy(four);
+    free(src.memory);
+    free(single.memory);
+    free(threaded.memory);
+}
+
+static void test_frame_and_errors(void)
+{
+    printf("frames and errors\n");
+
+    const uint32_t w = 64, h = 48;
+    uint8_t* nv12 = malloc(w * h * 3 / 2);
+    media_clahe_t* clahe = create(4, 512, 1);
+    if (!nv12 || !clahe) {
+        CHECK(0, "setup failed");
+        free(nv12);
+        return;
+    }
+    for (uint32_t i = 0; i < w * h; i++) {
+        nv12[i] = (uint8_t)(100 + i % 16);
+    }
+    memset(nv12 + w * h, 77, w * h / 2);
+
+    media_frame_t frame = { .data = nv12, .size = w * h * 3 / 2, .width = w, .height = h,
+                            .pixelformat = V4L2_PIX_FMT_NV12 };
+    CHECK(libmedia_clahe_process_frame(clahe, &frame) == 0, "NV12 frame failed");
+    int chroma_changed = 0;
+    for (uint32_t i = w * h; i < w * h * 3 / 2; i++) {
+        chroma_changed += nv12[i] != 77;
+    }
+    CHECK(chroma_changed == 0, "%d chroma bytes changed", chroma_changed);
+
+    frame.pixelformat = V4L2_PIX_FMT_YUYV;
+    CHECK(libmedia_clahe_process_frame(clahe, &frame) < 0 && libmedia_get_last_error() == MEDIA_ERROR_FORMAT_ERROR,
+          "YUYV frame accepted");
+
+    media_plane_t tiny = { nv12, 3, 3, 3 };
+    CHECK(libmedia_clahe_process(clahe, &tiny, &tiny) < 0, "plane narrower than the tile grid accepted");
+    media_plane_t bad_stride = { nv12, 64, 8, 32 };
+    CHECK(libmedia_clahe_process(clahe, &bad_stride, &bad_stride) < 0, "stride below width accepted");
+
+    media_clahe_config_t config = { 65, 8, 0, 1 };
+    CHECK(!libmedia_clahe_create(&config), "65 tiles accepted");
+
+    libmedia_clahe_destroy(clahe);
+    free(nv12);
+}
+
+int main(void)
+{
+    test_equalization();
+    test_flat_and_stretch();
+    test_clip_limit();
+    test_threads_and_in_place();
+    test_frame_and_errors();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
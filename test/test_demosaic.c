@@ -0,0 +1,301 @@
+/**
+ * @file test_demosaic.c
+ * @brief Demosaic row kernels against the per-pixel reference
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * libmedia_raw_demosaic() runs one specialized kernel per Bayer row phase
+ * and output layout. The reference below is the per-pixel loop those
+ * kernels replaced, with its channel switch and layout branch. Random
+ * frames of all four Bayer orders, in 8-bit, 16-bit and MIPI packed
+ * containers, are demosaiced to RGB24, BGR24 and RGB48 by both; the outputs
+ * must match byte for byte and row padding must stay untouched.
+ *
+ * Afterwards both are timed on a 1080p RAW10 frame in 16-bit containers,
+ * where they load lines the same way. Timings are printed only.
+ *
+ * Usage: test_demosaic [runs] (timing runs, 0 skips timing, default 7)
+ */
+
+#include "media_raw.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Reference
+// ============================================================================
+
+enum { LAYOUT_RGB24, LAYOUT_BGR24, LAYOUT_RGB48, LAYOUTS };
+
+static const uint32_t g_layout_formats[LAYOUTS] = { V4L2_PIX_FMT_RGB24, V4L2_PIX_FMT_BGR24, MEDIA_PIX_FMT_RGB48 };
+static const char* const g_layout_names[LAYOUTS] = { "RGB24", "BGR24", "RGB48" };
+static const uint32_t g_layout_bytes[LAYOUTS] = { 3, 3, 6 };
+
+/**
+ * @brief Source formats, one per Bayer order, with the channel of each phase (y & 1) * 2 + (x & 1)
+ */
+static const struct {
+    uint32_t format;
+    uint32_t bits;
+    uint8_t channels[4];
+} g_sources[] = {
+    { V4L2_PIX_FMT_SRGGB10, 10, { MEDIA_RAW_CH_R, MEDIA_RAW_CH_GR, MEDIA_RAW_CH_GB, MEDIA_RAW_CH_B } },
+    { V4L2_PIX_FMT_SGRBG8, 8, { MEDIA_RAW_CH_GR, MEDIA_RAW_CH_R, MEDIA_RAW_CH_B, MEDIA_RAW_CH_GB } },
+    { V4L2_PIX_FMT_SGBRG12P, 12, { MEDIA_RAW_CH_GB, MEDIA_RAW_CH_B, MEDIA_RAW_CH_R, MEDIA_RAW_CH_GR } },
+    { V4L2_PIX_FMT_SBGGR10P, 10, { MEDIA_RAW_CH_B, MEDIA_RAW_CH_GB, MEDIA_RAW_CH_GR, MEDIA_RAW_CH_R } },
+};
+
+/**
+ * @brief Copy row y of the samples with one mirrored sample of padding on each side
+ */
+static void reference_load_line(const uint16_t* samples, uint32_t w, uint32_t y, uint16_t* line)
+{
+    memcpy(line + 1, samples + (size_t)y * w, w * sizeof(uint16_t));
+    line[0] = line[2];
+    line[w + 1] = line[w - 1];
+}
+
+/**
+ * @brief Per-pixel bilinear demosaic, as libmedia_raw_demosaic() computed it before the row kernels
+ */
+static void reference_demosaic(const uint16_t* samples, uint32_t w, uint32_t h, const uint8_t* phase_channels,
+                               uint32_t bits, int layout, uint8_t* dst, size_t stride)
+{
+    uint16_t lines[3][MEDIA_RAW_MAX_WIDTH + 2];
+    uint16_t* l0 = lines[0];
+    uint16_t* l1 = lines[1];
+    uint16_t* l2 = lines[2];
+    uint32_t shift = bits - 8;
+    int r_index = layout == LAYOUT_BGR24 ? 2 : 0;
+
+    reference_load_line(samples, w, 1, l0);
+    reference_load_line(samples, w, 0, l1);
+    reference_load_line(samples, w, 1, l2);
+
+    for (uint32_t y = 0; y < h; y++) {
+        if (y > 0) {
+            uint16_t* t = l0;
+            l0 = l1;
+            l1 = l2;
+            l2 = t;
+            reference_load_line(samples, w, y + 1 < h ? y + 1 : h - 2, l2);
+        }
+
+        const uint8_t* channels = phase_channels + (y & 1) * 2;
+        uint8_t* out8 = dst + (size_t)y * stride;
+        uint16_t* out16 = (uint16_t*)out8;
+
+        for (uint32_t x = 0; x < w; x++) {
+            const uint16_t* c0 = l0 + x + 1;
+            const uint16_t* c1 = l1 + x + 1;
+            const uint16_t* c2 = l2 + x + 1;
+            uint32_t rgb[3];
+            uint32_t center = c1[0];
+            uint32_t horiz = (c1[-1] + c1[1] + 1) >> 1;
+            uint32_t vert = (c0[0] + c2[0] + 1) >> 1;
+
+            switch (channels[x & 1]) {
+                case MEDIA_RAW_CH_R:
+                    rgb[0] = center;
+                    rgb[1] = (c1[-1] + c1[1] + c0[0] + c2[0] + 2) >> 2;
+                    rgb[2] = (c0[-1] + c0[1] + c2[-1] + c2[1] + 2) >> 2;
+                    break;
+                case MEDIA_RAW_CH_B:
+                    rgb[2] = center;
+                    rgb[1] = (c1[-1] + c1[1] + c0[0] + c2[0] + 2) >> 2;
+                    rgb[0] = (c0[-1] + c0[1] + c2[-1] + c2[1] + 2) >> 2;
+                    break;
+                case MEDIA_RAW_CH_GR:
+                    rgb[0] = horiz;
+                    rgb[1] = center;
+                    rgb[2] = vert;
+                    break;
+                default:
+                    rgb[0] = vert;
+                    rgb[1] = center;
+                    rgb[2] = horiz;
+                    break;
+            }
+
+            if (layout == LAYOUT_RGB48) {
+                out16[x * 3 + 0] = (uint16_t)rgb[0];
+                out16[x * 3 + 1] = (uint16_t)rgb[1];
+                out16[x * 3 + 2] = (uint16_t)rgb[2];
+            } else {
+                out8[x * 3 + r_index] = (uint8_t)(rgb[0] >> shift);
+                out8[x * 3 + 1] = (uint8_t)(rgb[1] >> shift);
+                out8[x * 3 + 2 - r_index] = (uint8_t)(rgb[2] >> shift);
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+#define PAD_BYTES 8                 /**< Untouched bytes after each output row */
+#define PAD_VALUE 0xA5
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+/**
+ * @brief Fill samples with a reproducible random pattern of the given depth
+ */
+static void fill_samples(uint16_t* samples, size_t count, uint32_t bits, uint32_t seed)
+{
+    uint32_t state = seed;
+    for (size_t i = 0; i < count; i++) {
+        state = state * 1103515245u + 12345u;
+        samples[i] = (uint16_t)((state >> 12) & ((1u << bits) - 1));
+    }
+}
+
+/**
+ * @brief Encode 16-bit samples into a raw format
+ * @return Frame memory, NULL on error
+ */
+static uint8_t* encode_frame(uint16_t* samples, uint32_t w, uint32_t h, uint32_t format, uint32_t bits,
+                             media_plane_t* plane)
+{
+    media_plane_t src = { samples, w, h, w * sizeof(uint16_t) };
+    size_t stride = libmedia_get_line_bytes(format, w);
+    uint8_t* data = calloc(h, stride);
+    *plane = (media_plane_t){ data, w, h, (uint32_t)stride };
+    if (!data || libmedia_raw_pack(&src, bits, plane, format) < 0) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+static void test_compare(uint32_t w, uint32_t h)
+{
+    uint16_t* samples = malloc((size_t)w * h * sizeof(uint16_t));
+    if (!samples) {
+        CHECK(0, "out of memory");
+        return;
+    }
+
+    for (size_t s = 0; s < sizeof(g_sources) / sizeof(g_sources[0]); s++) {
+        const media_format_desc_t* desc = libmedia_get_format_desc(g_sources[s].format);
+        fill_samples(samples, (size_t)w * h, g_sources[s].bits, (uint32_t)(s * 7919 + w * 31 + h));
+
+        media_plane_t src;
+        uint8_t* raw = encode_frame(samples, w, h, g_sources[s].format, g_sources[s].bits, &src);
+        CHECK(raw, "%s %ux%u: pack failed: %d", desc->name, w, h, libmedia_get_last_error());
+        if (!raw) {
+            continue;
+        }
+
+        for (int layout = 0; layout < LAYOUTS; layout++) {
+            size_t row_bytes = (size_t)w * g_layout_bytes[layout];
+            size_t stride = row_bytes + PAD_BYTES;
+            uint8_t* expected = malloc(stride * h);
+            uint8_t* actual = malloc(stride * h);
+            if (!expected || !actual) {
+                CHECK(0, "out of memory");
+                free(expected);
+                free(actual);
+                continue;
+            }
+            memset(expected, PAD_VALUE, stride * h);
+            memset(actual, PAD_VALUE, stride * h);
+
+            reference_demosaic(samples, w, h, g_sources[s].channels, g_sources[s].bits, layout, expected, stride);
+            media_plane_t dst = { actual, w, h, (uint32_t)stride };
+            int result = libmedia_raw_demosaic(&src, g_sources[s].format, &dst, g_layout_formats[layout]);
+            CHECK(result == 0, "%s %ux%u to %s failed: %d", desc->name, w, h, g_layout_names[layout],
+                  libmedia_get_last_error());
+
+            size_t mismatch = stride * h;
+            for (size_t i = 0; result == 0 && i < stride * h && mismatch == stride * h; i++) {
+                if (actual[i] != expected[i]) {
+                    mismatch = i;
+                }
+            }
+            CHECK(result != 0 || mismatch == stride * h, "%s %ux%u to %s differs at row %zu byte %zu",
+                  desc->name, w, h, g_layout_names[layout], mismatch / stride, mismatch % stride);
+
+            free(expected);
+            free(actual);
+        }
+        free(raw);
+    }
+    free(samples);
+}
+
+static int compare_ms(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench(int runs)
+{
+    const uint32_t w = 1920;
+    const uint32_t h = 1080;
+    uint16_t* samples = malloc((size_t)w * h * sizeof(uint16_t));
+    uint8_t* out = malloc((size_t)w * h * 3);
+    double* times = malloc(runs * 2 * sizeof(double));
+    if (!samples || !out || !times) {
+        CHECK(0, "out of memory");
+        free(samples);
+        free(out);
+        free(times);
+        return;
+    }
+    fill_samples(samples, (size_t)w * h, 10, 1);
+
+    // 16-bit containers are demosaiced in place, so both sides copy lines the same way
+    media_plane_t src = { samples, w, h, w * sizeof(uint16_t) };
+    media_plane_t dst = { out, w, h, w * 3 };
+    for (int i = 0; i < runs; i++) {
+        uint64_t start = libmedia_get_timestamp_ns();
+        reference_demosaic(samples, w, h, g_sources[0].channels, 10, LAYOUT_RGB24, out, w * 3);
+        uint64_t middle = libmedia_get_timestamp_ns();
+        libmedia_raw_demosaic(&src, V4L2_PIX_FMT_SRGGB10, &dst, V4L2_PIX_FMT_RGB24);
+        uint64_t end = libmedia_get_timestamp_ns();
+        times[i] = (middle - start) / 1e6;
+        times[runs + i] = (end - middle) / 1e6;
+    }
+    qsort(times, runs, sizeof(double), compare_ms);
+    qsort(times + runs, runs, sizeof(double), compare_ms);
+
+    printf("bench SRGGB10 %ux%u to RGB24, median of %d runs\n", w, h, runs);
+    printf("  per-pixel reference %8.3f ms\n", times[runs / 2]);
+    printf("  row kernels         %8.3f ms\n", times[runs + runs / 2]);
+
+    free(samples);
+    free(out);
+    free(times);
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? atoi(argv[1]) : 7;
+
+    // Odd sizes exercise the single-pixel row tail and the bottom mirror
+    const uint32_t sizes[][2] = { { 37, 21 }, { 64, 16 }, { 2, 2 }, { 3, 5 } };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("compare %ux%u\n", sizes[i][0], sizes[i][1]);
+        test_compare(sizes[i][0], sizes[i][1]);
+    }
+    if (runs > 0) {
+        bench(runs);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+/**
+ * @file test_gradient.c
+ * @brief Gradient kernels against a scalar reference
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * The vector kernels are compared with a direct 3x3 evaluation that
+ * clamps coordinates at the image border: for 8- and 16-bit sources, both
+ * operators, both norms, 4 and 8 orientation bins, whole planes and
+ * regions inside and at the edge of the image. Step edges check the
+ * orientation bins by direction, a full-scale 16-bit edge checks
+ * saturation, and regions or strides that do not fit the source,
+ * including ones whose end wraps around 2^32, must be rejected.
+ */
+
+#include "media_proc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Reference
+// ============================================================================
+
+/**
+ * @brief Source image held as 32-bit samples, independent of the plane layout
+ */
+typedef struct {
+    int32_t* samples;
+    uint32_t width;
+    uint32_t height;
+} image_t;
+
+static int32_t sample_at(const image_t* img, int64_t x, int64_t y)
+{
+    x = x < 0 ? 0 : x >= img->width ? img->width - 1 : x;
+    y = y < 0 ? 0 : y >= img->height ? img->height - 1 : y;
+    return img->samples[(size_t)y * img->width + x];
+}
+
+/**
+ * @brief Magnitude and orientation bin of one pixel
+ */
+static void reference_pixel(const image_t* img, const media_gradient_config_t* config, uint32_t x, uint32_t y,
+                            uint16_t* magnitude, uint8_t* orientation)
+{
+    const int32_t k[3] = { config->op == MEDIA_GRADIENT_SCHARR ? 3 : 1, config->op == MEDIA_GRADIENT_SCHARR ? 10 : 2,
+                           config->op == MEDIA_GRADIENT_SCHARR ? 3 : 1 };
+    int32_t gx = 0;
+    int32_t gy = 0;
+    for (int d = -1; d <= 1; d++) {
+        gx += k[d + 1] * (sample_at(img, (int64_t)x + 1, (int64_t)y + d) - sample_at(img, (int64_t)x - 1, (int64_t)y + d));
+        gy += k[d + 1] * (sample_at(img, (int64_t)x + d, (int64_t)y + 1) - sample_at(img, (int64_t)x + d, (int64_t)y - 1));
+    }
+
+    int32_t ax = gx < 0 ? -gx : gx;
+    int32_t ay = gy < 0 ? -gy : gy;
+    int32_t m;
+    if (config->norm == MEDIA_GRADIENT_L2) {
+        int32_t hi = ax > ay ? ax : ay;
+        int32_t lo = ax > ay ? ay : ax;
+        m = hi - (hi >> 4) + (lo >> 1) - (lo >> 5);
+    } else {
+        m = ax + ay;
+    }
+    m >>= config->shift;
+    *magnitude = (uint16_t)(m > 0xFFFF ? 0xFFFF : m);
+
+    // 0 horizontal, 1 and 3 the diagonals, 2 vertical; 8 bins add 4 for the opposite direction
+    int bin;
+    if ((int64_t)ay * 12 <= (int64_t)ax * 5) {
+        bin = 0;
+    } else if ((int64_t)ay * 5 >= (int64_t)ax * 12) {
+        bin = 2;
+    } else {
+        bin = (gx < 0) == (gy < 0) ? 1 : 3;
+    }
+    if (config->orientation_bins == 8 &&
+        (((bin == 0 || bin == 1) && gx < 0) || (bin == 2 && gy < 0) || (bin == 3 && gx > 0))) {
+        bin += 4;
+    }
+    *orientation = (uint8_t)bin;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+/**
+ * @brief Source plane in 8- or 16-bit samples with row padding, filled from img
+ */
+static void* make_plane(const image_t* img, int wide, media_plane_t* plane)
+{
+    uint32_t bytes = wide ? 2 : 1;
+    uint32_t stride = img->width * bytes + 24;
+    uint8_t* data = calloc(img->height, stride);
+    if (!data) {
+        return NULL;
+    }
+    for (uint32_t y = 0; y < img->height; y++) {
+        for (uint32_t x = 0; x < img->width; x++) {
+            int32_t v = img->samples[(size_t)y * img->width + x];
+            if (wide) {
+                ((uint16_t*)(data + (size_t)y * stride))[x] = (uint16_t)v;
+            } else {
+                data[(size_t)y * stride + x] = (uint8_t)v;
+            }
+        }
+    }
+    *plane = (media_plane_t){ data, img->width, img->height, stride };
+    return data;
+}
+
+static void fill_random(image_t* img, uint32_t bits, uint32_t seed)
+{
+    uint32_t state = seed;
+    for (size_t i = 0; i < (size_t)img->width * img->height; i++) {
+        state = state * 1103515245u + 12345u;
+        img->samples[i] = (int32_t)((state >> 8) & ((1u << bits) - 1));
+    }
+}
+
+/**
+ * @brief Run one kernel over roi and compare every output pixel with the reference
+ */
+static void compare(const image_t* img, int wide, const media_gradient_config_t* config, const media_rect_t* roi)
+{
+    media_rect_t r = roi ? *roi : (media_rect_t){ 0, 0, img->width, img->height };
+    media_plane_t src;
+    void* src_data = make_plane(img, wide, &src);
+    uint32_t mag_stride = r.width * 2 + 8;
+    uint32_t ori_stride = r.width + 8;
+    uint8_t* mag_data = calloc(r.height, mag_stride);
+    uint8_t* ori_data = calloc(r.height, ori_stride);
+    media_gradient_t* gradient = libmedia_gradient_create(config);
+    if (!src_data || !mag_data || !ori_data || !gradient) {
+        CHECK(0, "setup failed");
+        goto done;
+    }
+
+    media_plane_t magnitude = { mag_data, r.width, r.height, mag_stride };
+    media_plane_t orientation = { ori_data, r.width, r.height, ori_stride };
+    int result = wide ? libmedia_gradient_u16(gradient, &src, roi, &magnitude, &orientation)
+                      : libmedia_gradient_u8(gradient, &src, roi, &magnitude, &orientation);
+    CHECK(result == 0, "u%d %ux%u+%u+%u failed: %d", wide ? 16 : 8, r.width, r.height, r.x, r.y,
+          libmedia_get_last_error());
+    if (result < 0) {
+        goto done;
+    }
+
+    int mag_wrong = 0;
+    int ori_wrong = 0;
+    for (uint32_t y = 0; y < r.height; y++) {
+        const uint16_t* mag = (const uint16_t*)(mag_data + (size_t)y * mag_stride);
+        const uint8_t* ori = ori_data + (size_t)y * ori_stride;
+        for (uint32_t x = 0; x < r.width; x++) {
+            uint16_t m;
+            uint8_t o;
+            reference_pixel(img, config, r.x + x, r.y + y, &m, &o);
+            mag_wrong += mag[x] != m;
+            ori_wrong += ori[x] != o;
+        }
+    }
+    CHECK(mag_wrong == 0 && ori_wrong == 0, "u%d op %d norm %d bins %u %ux%u+%u+%u: %d magnitudes, %d bins differ",
+          wide ? 16 : 8, config->op, config->norm, config->orientation_bins, r.width, r.height, r.x, r.y,
+          mag_wrong, ori_wrong);
+
+done:
+    libmedia_gradient_destroy(gradient);
+    free(src_data);
+    free(mag_data);
+    free(ori_data);
+}
+
+static void test_reference(void)
+{
+    printf("reference comparison\n");
+
+    image_t img = { malloc(45 * 29 * sizeof(int32_t)), 45, 29 };
+    if (!img.samples) {
+        CHECK(0, "out of memory");
+        return;
+    }
+    const media_rect_t inner = { 7, 5, 20, 11 };
+    const media_rect_t corner = { 25, 18, 20, 11 };
+    const media_rect_t column = { 0, 0, 1, 29 };
+
+    const media_gradient_config_t narrow[] = {
+        { MEDIA_GRADIENT_SOBEL, MEDIA_GRADIENT_L1, 4, 0 },
+        { MEDIA_GRADIENT_SCHARR, MEDIA_GRADIENT_L2, 8, 0 },
+    };
+    fill_random(&img, 8, 1);
+    for (size_t i = 0; i < sizeof(narrow) / sizeof(narrow[0]); i++) {
+        compare(&img, 0, &narrow[i], NULL);
+        compare(&img, 0, &narrow[i], &inner);
+        compare(&img, 0, &narrow[i], &corner);
+        compare(&img, 0, &narrow[i], &column);
+    }
+
+    const media_gradient_config_t wide[] = {
+        { MEDIA_GRADIENT_SOBEL, MEDIA_GRADIENT_L1, 8, 2 },
+        { MEDIA_GRADIENT_SCHARR, MEDIA_GRADIENT_L2, 4, 0 },
+    };
+    fill_random(&img, 12, 2);
+    for (size_t i = 0; i < sizeof(wide) / sizeof(wide[0]); i++) {
+        compare(&img, 1, &wide[i], NULL);
+        compare(&img, 1, &wide[i], &inner);
+        compare(&img, 1, &wide[i], &corner);
+    }
+
+    // Full-scale edge: Scharr magnitudes pass 16 bits and saturate
+    for (uint32_t i = 0; i < img.width * img.height; i++) {
+        img.samples[i] = i % img.width < img.width / 2 ? 0 : 0xFFFF;
+    }
+    compare(&img, 1, &wide[1], NULL);
+    free(img.samples);
+}
+
+static void test_edges(void)
+{
+    printf("edge orientation\n");
+
+    // Bright right half, bright bottom half, bright left half
+    const struct {
+        int axis;
+        int bright_first;
+        uint8_t bin;
+    } cases[] = { { 0, 0, 0 }, { 1, 0, 2 }, { 0, 1, 4 }, { 1, 1, 6 } };
+    media_gradient_config_t config = { MEDIA_GRADIENT_SOBEL, MEDIA_GRADIENT_L1, 8, 0 };
+    media_gradient_t* gradient = libmedia_gradient_create(&config);
+    uint8_t src_data[16 * 16];
+    uint16_t mag[16 * 16];
+    uint8_t ori[16 * 16];
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        for (uint32_t y = 0; y < 16; y++) {
+            for (uint32_t x = 0; x < 16; x++) {
+                uint32_t pos = cases[c].axis ? y : x;
+                src_data[y * 16 + x] = (pos >= 8) != cases[c].bright_first ? 200 : 40;
+            }
+        }
+        media_plane_t src = { src_data, 16, 16, 16 };
+        media_plane_t magnitude = { mag, 16, 16, 32 };
+        media_plane_t orientation = { ori, 16, 16, 16 };
+        CHECK(libmedia_gradient_u8(gradient, &src, NULL, &magnitude, &orientation) == 0, "edge %zu failed", c);
+
+        // Sobel across a 160 step: 4 * 160 on both sides of the edge, 0 away from it
+        uint32_t edge = cases[c].axis ? 7 * 16 + 5 : 5 * 16 + 7;
+        uint32_t flat = 2 * 16 + 2;
+        CHECK(mag[edge] == 640 && ori[edge] == cases[c].bin, "edge %zu: magnitude %u bin %u, expected 640 bin %u",
+              c, mag[edge], ori[edge], cases[c].bin);
+        CHECK(mag[flat] == 0, "edge %zu: flat area magnitude %u", c, mag[flat]);
+    }
+    libmedia_gradient_destroy(gradient);
+}
+
+static void test_rejects(void)
+{
+    printf("bounds and strides\n");
+
+    static uint8_t data[64 * 32 * 2];
+    static uint16_t mag[64 * 32];
+    media_gradient_t* gradient = libmedia_gradient_create(NULL);
+    media_plane_t src = { data, 64, 32, 64 };
+    media_plane_t magnitude = { mag, 64, 32, 128 };
+
+    const struct {
+        media_rect_t roi;
+        int ok;
+    } rois[] = {
+        { { 63, 31, 1, 1 }, 1 },
+        { { 0, 0, 64, 32 }, 1 },
+        { { 64, 0, 1, 1 }, 0 },
+        { { 60, 0, 5, 1 }, 0 },
+        { { 0, 30, 1, 3 }, 0 },
+        { { UINT32_MAX - 3, 0, 8, 4 }, 0 },     // x + width wraps to 4
+        { { 0, UINT32_MAX - 1, 4, 4 }, 0 },     // y + height wraps to 2
+        { { 0, 0, 0, 4 }, 0 },
+    };
+    for (size_t i = 0; i < sizeof(rois) / sizeof(rois[0]); i++) {
+        const media_rect_t* r = &rois[i].roi;
+        int result = libmedia_gradient_u8(gradient, &src, r, &magnitude, NULL);
+        CHECK((result == 0) == rois[i].ok, "roi %ux%u+%u+%u %s", r->width, r->height, r->x, r->y,
+              rois[i].ok ? "rejected" : "accepted");
+    }
+
+    media_plane_t short_u8 = { data, 64, 32, 63 };
+    CHECK(libmedia_gradient_u8(gradient, &short_u8, NULL, &magnitude, NULL) < 0, "8-bit stride below width accepted");
+    media_plane_t short_u16 = { data, 64, 32, 127 };
+    CHECK(libmedia_gradient_u16(gradient, &short_u16, NULL, &magnitude, NULL) < 0,
+          "16-bit stride below two bytes per sample accepted");
+    media_plane_t small = { mag, 32, 32, 128 };
+    CHECK(libmedia_gradient_u8(gradient, &src, NULL, &small, NULL) < 0, "magnitude plane smaller than roi accepted");
+
+    libmedia_gradient_destroy(gradient);
+}
+
+int main(void)
+{
+    test_reference();
+    test_edges();
+    test_rejects();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,573 @@
+/**
+ * @file test_m2m.c
+ * @brief M2M session test against a simulated device
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Runs media_m2m.c without hardware. open, ioctl, mmap, munmap and poll are
+ * wrapped (--wrap) for one device path, behind which a small in-process device
+ * scales GREY frames by two in each direction on both the single- and
+ * multi-planar APIs. The capture session side of DMABUF chaining is
+ * replaced with --wrap stubs backed by memfds, so the test covers buffer
+ * export, chained submission, completion and the release of capture
+ * frames once the device is done with them. Halfway through, the camera's
+ * buffer generation changes as if the capture session had been destroyed
+ * and a new one created at the same address: every buffer must be exported
+ * again and no descriptor of the old set may stay open.
+ *
+ * Usage: test_m2m [0|1] (single- or multi-planar, both when omitted)
+ */
+
+#define _GNU_SOURCE
+#include "media_m2m.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+// ============================================================================
+// Simulated Device
+// ============================================================================
+
+#define FAKE_PATH "/dev/libmedia-test-m2m"
+#define FAKE_BUFFERS 16
+#define FAKE_ORDER 64
+#define FAKE_INPUT_OFFSET 0x10000
+#define FAKE_OUTPUT_OFFSET 0x20000
+
+#define IN_WIDTH 64
+#define IN_HEIGHT 32
+
+typedef struct {
+    uint8_t* memory;        /**< MMAP memory */
+    size_t length;
+    int queued;
+    int done;
+    int dmabuf;             /**< Descriptor queued in DMABUF mode */
+    uint32_t bytes;
+    struct timeval timestamp;
+} fake_buffer_t;
+
+typedef struct {
+    int order[FAKE_ORDER];  /**< Queue order of buffer indices */
+    int head;
+    int tail;
+} fake_order_t;
+
+static struct {
+    int fd;
+    int mplane;
+    uint32_t in_width, in_height, out_width, out_height;
+    uint32_t input_memory;
+    int streaming;
+    uint32_t sequence;
+    fake_buffer_t inputs[FAKE_BUFFERS];
+    fake_buffer_t outputs[FAKE_BUFFERS];
+    fake_order_t input_order;
+    fake_order_t output_order;
+} fake = { .fd = -1 };
+
+static int is_output_queue(uint32_t type)
+{
+    return type == V4L2_BUF_TYPE_VIDEO_OUTPUT || type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+}
+
+/**
+ * @brief First queued buffer in queue order that satisfies done == want_done
+ */
+static int fake_next(fake_order_t* order, fake_buffer_t* buffers, int want_done)
+{
+    for (int k = order->head; k < order->tail; k++) {
+        int i = order->order[k % FAKE_ORDER];
+        if (buffers[i].queued && buffers[i].done == want_done) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Process queued pairs while both queues stream: nearest-neighbour 2x downscale
+ */
+static void fake_process(void)
+{
+    while (fake.streaming == 2) {
+        int i = fake_next(&fake.input_order, fake.inputs, 0);
+        int o = fake_next(&fake.output_order, fake.outputs, 0);
+        if (i < 0 || o < 0) {
+            return;
+        }
+
+        fake_buffer_t* in = &fake.inputs[i];
+        fake_buffer_t* out = &fake.outputs[o];
+        const uint8_t* src = in->memory;
+        if (fake.input_memory == V4L2_MEMORY_DMABUF) {
+            src = mmap(NULL, in->bytes, PROT_READ, MAP_SHARED, in->dmabuf, 0);
+        }
+        for (uint32_t y = 0; y < fake.out_height; y++) {
+            for (uint32_t x = 0; x < fake.out_width; x++) {
+                out->memory[y * fake.out_width + x] = src[2 * y * fake.in_width + 2 * x];
+            }
+        }
+        if (fake.input_memory == V4L2_MEMORY_DMABUF) {
+            munmap((void*)src, in->bytes);
+        }
+
+        in->done = 1;
+        out->done = 1;
+        out->bytes = fake.out_width * fake.out_height;
+        out->timestamp = in->timestamp;
+    }
+}
+
+static int fake_ioctl(unsigned long request, void* arg)
+{
+    switch (request) {
+    case VIDIOC_QUERYCAP: {
+        struct v4l2_capability* cap = arg;
+        memset(cap, 0, sizeof(*cap));
+        cap->capabilities = fake.mplane ? V4L2_CAP_VIDEO_M2M_MPLANE : V4L2_CAP_VIDEO_M2M;
+        return 0;
+    }
+    case VIDIOC_S_FMT: {
+        struct v4l2_format* f = arg;
+        uint32_t width = fake.mplane ? f->fmt.pix_mp.width : f->fmt.pix.width;
+        uint32_t height = fake.mplane ? f->fmt.pix_mp.height : f->fmt.pix.height;
+        if (is_output_queue(f->type)) {
+            fake.in_width = width;
+            fake.in_height = height;
+        } else {
+            // The device only halves the input, whatever was asked for
+            width = fake.out_width = fake.in_width / 2;
+            height = fake.out_height = fake.in_height / 2;
+        }
+        if (fake.mplane) {
+            f->fmt.pix_mp.width = width;
+            f->fmt.pix_mp.height = height;
+            f->fmt.pix_mp.num_planes = 1;
+            f->fmt.pix_mp.plane_fmt[0].sizeimage = width * height;
+        } else {
+            f->fmt.pix.width = width;
+            f->fmt.pix.height = height;
+            f->fmt.pix.sizeimage = width * height;
+        }
+        return 0;
+    }
+    case VIDIOC_REQBUFS: {
+        struct v4l2_requestbuffers* req = arg;
+        if (req->count > FAKE_BUFFERS) {
+            req->count = FAKE_BUFFERS;
+        }
+        int input = is_output_queue(req->type);
+        fake_buffer_t* buffers = input ? fake.inputs : fake.outputs;
+        size_t length = input ? fake.in_width * fake.in_height : fake.out_width * fake.out_height;
+        if (input) {
+            fake.input_memory = req->memory;
+        }
+        for (uint32_t i = 0; i < req->count; i++) {
+            if (req->memory == V4L2_MEMORY_MMAP && !buffers[i].memory) {
+                buffers[i].memory = calloc(1, length);
+            }
+            buffers[i].length = length;
+        }
+        return 0;
+    }
+    case VIDIOC_QUERYBUF: {
+        struct v4l2_buffer* b = arg;
+        int input = is_output_queue(b->type);
+        size_t length = input ? fake.inputs[b->index].length : fake.outputs[b->index].length;
+        uint32_t offset = (input ? FAKE_INPUT_OFFSET : FAKE_OUTPUT_OFFSET) + b->index;
+        if (fake.mplane) {
+            b->m.planes[0].length = length;
+            b->m.planes[0].m.mem_offset = offset;
+        } else {
+            b->length = length;
+            b->m.offset = offset;
+        }
+        return 0;
+    }
+    case VIDIOC_QBUF: {
+        struct v4l2_buffer* b = arg;
+        int input = is_output_queue(b->type);
+        fake_buffer_t* buffer = input ? &fake.inputs[b->index] : &fake.outputs[b->index];
+        fake_order_t* order = input ? &fake.input_order : &fake.output_order;
+        if (buffer->queued) {
+            errno = EINVAL;
+            return -1;
+        }
+        buffer->queued = 1;
+        buffer->done = 0;
+        if (input) {
+            buffer->timestamp = b->timestamp;
+            buffer->bytes = fake.mplane ? b->m.planes[0].bytesused : b->bytesused;
+            if (b->memory == V4L2_MEMORY_DMABUF) {
+                buffer->dmabuf = fake.mplane ? b->m.planes[0].m.fd : b->m.fd;
+            }
+        }
+        order->order[order->tail++ % FAKE_ORDER] = b->index;
+        fake_process();
+        return 0;
+    }
+    case VIDIOC_DQBUF: {
+        struct v4l2_buffer* b = arg;
+        int input = is_output_queue(b->type);
+        fake_buffer_t* buffers = input ? fake.inputs : fake.outputs;
+        fake_order_t* order = input ? &fake.input_order : &fake.output_order;
+        while (order->head < order->tail && !buffers[order->order[order->head % FAKE_ORDER]].queued) {
+            order->head++;
+        }
+        if (order->head == order->tail || !buffers[order->order[order->head % FAKE_ORDER]].done) {
+            errno = EAGAIN;
+            return -1;
+        }
+        int index = order->order[order->head++ % FAKE_ORDER];
+        buffers[index].queued = 0;
+        b->index = index;
+        if (!input) {
+            b->timestamp = buffers[index].timestamp;
+            b->sequence = fake.sequence++;
+            if (fake.mplane) {
+                b->m.planes[0].bytesused = buffers[index].bytes;
+            } else {
+                b->bytesused = buffers[index].bytes;
+            }
+        }
+        return 0;
+    }
+    case VIDIOC_STREAMON:
+        fake.streaming++;
+        fake_process();
+        return 0;
+    case VIDIOC_STREAMOFF:
+        fake.streaming = 0;
+        for (int i = 0; i < FAKE_BUFFERS; i++) {
+            fake.inputs[i].queued = fake.outputs[i].queued = 0;
+        }
+        return 0;
+    }
+    errno = ENOTTY;
+    return -1;
+}
+
+static void fake_reset(int mplane)
+{
+    for (int i = 0; i < FAKE_BUFFERS; i++) {
+        free(fake.inputs[i].memory);
+        free(fake.outputs[i].memory);
+    }
+    memset(&fake, 0, sizeof(fake));
+    fake.fd = -1;
+    fake.mplane = mplane;
+}
+
+// ============================================================================
+// Wrapped System Calls (--wrap)
+// ============================================================================
+
+int __real_open(const char* path, int flags, ...);
+int __real_ioctl(int fd, unsigned long request, ...);
+void* __real_mmap(void* address, size_t length, int prot, int flags, int fd, off_t offset);
+int __real_munmap(void* address, size_t length);
+int __real_poll(struct pollfd* fds, nfds_t count, int timeout);
+
+int __wrap_open(const char* path, int flags, ...)
+{
+    if (strcmp(path, FAKE_PATH) == 0) {
+        fake.fd = eventfd(0, EFD_CLOEXEC);
+        return fake.fd;
+    }
+
+    va_list ap;
+    va_start(ap, flags);
+    int mode = va_arg(ap, int);
+    va_end(ap);
+    return __real_open(path, flags, mode);
+}
+
+int __wrap_ioctl(int fd, unsigned long request, ...)
+{
+    va_list ap;
+    va_start(ap, request);
+    void* arg = va_arg(ap, void*);
+    va_end(ap);
+
+    if (fd == fake.fd) {
+        return fake_ioctl(request, arg);
+    }
+    return __real_ioctl(fd, request, arg);
+}
+
+void* __wrap_mmap(void* address, size_t length, int prot, int flags, int fd, off_t offset)
+{
+    if (fd >= 0 && fd == fake.fd) {
+        return offset >= FAKE_OUTPUT_OFFSET ? fake.outputs[offset - FAKE_OUTPUT_OFFSET].memory
+                                            : fake.inputs[offset - FAKE_INPUT_OFFSET].memory;
+    }
+    return __real_mmap(address, length, prot, flags, fd, offset);
+}
+
+int __wrap_munmap(void* address, size_t length)
+{
+    for (int i = 0; i < FAKE_BUFFERS; i++) {
+        if (address && (address == fake.inputs[i].memory || address == fake.outputs[i].memory)) {
+            return 0;
+        }
+    }
+    return __real_munmap(address, length);
+}
+
+int __wrap_poll(struct pollfd* fds, nfds_t count, int timeout)
+{
+    if (count == 1 && fds->fd == fake.fd) {
+        fds->revents = fake_next(&fake.output_order, fake.outputs, 1) >= 0 ? POLLIN : 0;
+        if (!fds->revents && timeout > 0) {
+            usleep((useconds_t)timeout * 1000);
+        }
+        return fds->revents ? 1 : 0;
+    }
+    return __real_poll(fds, count, timeout);
+}
+
+// ============================================================================
+// Capture Session Stubs (--wrap)
+// ============================================================================
+
+#define CAMERA_BUFFERS 4
+
+typedef struct {
+    int memfd[CAMERA_BUFFERS];
+    uint8_t* map[CAMERA_BUFFERS];
+    uint32_t generation;
+    int exports;
+    int released;
+} fake_camera_t;
+
+static fake_camera_t camera;
+
+int __wrap_libmedia_session_get_device_handle(media_session_t* session)
+{
+    (void)session;
+    return 0;
+}
+
+uint32_t __wrap_media_device_buffer_generation(int handle)
+{
+    (void)handle;
+    return camera.generation;
+}
+
+int __wrap_libmedia_export_buffer(int handle, int index)
+{
+    (void)handle;
+    camera.exports++;
+    return dup(camera.memfd[index]);
+}
+
+int __wrap_libmedia_session_release_frame(media_session_t* session, media_frame_t* frame)
+{
+    (void)session;
+    (void)frame;
+    camera.released++;
+    return 0;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+/**
+ * @brief Check a scaled frame against an input filled with base + i
+ */
+static int scaled_ok(const media_frame_t* frame, uint8_t base)
+{
+    const uint8_t* data = frame->data;
+    for (uint32_t y = 0; y < frame->height; y++) {
+        for (uint32_t x = 0; x < frame->width; x++) {
+            if (data[y * frame->width + x] != (uint8_t)(base + 2 * x + 2 * y * IN_WIDTH)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void test_mmap(int mplane)
+{
+    fake_reset(mplane);
+    media_m2m_config_t config = {
+        .device_path = FAKE_PATH,
+        .input = { .width = IN_WIDTH, .height = IN_HEIGHT, .pixelformat = V4L2_PIX_FMT_GREY },
+        .output = { .width = IN_WIDTH / 2, .height = IN_HEIGHT / 2, .pixelformat = V4L2_PIX_FMT_GREY }
+    };
+    media_m2m_t* m2m = libmedia_m2m_create(&config);
+    CHECK(m2m, "create failed: %d", libmedia_get_last_error());
+    if (!m2m) {
+        return;
+    }
+
+    media_format_t in, out;
+    libmedia_m2m_get_formats(m2m, &in, &out);
+    CHECK(out.width == IN_WIDTH / 2 && out.height == IN_HEIGHT / 2, "output %ux%u", out.width, out.height);
+
+    int good = 0;
+    for (int k = 0; k < 20; k++) {
+        media_frame_t frame;
+        if (libmedia_m2m_acquire_input(m2m, &frame) != 1) {
+            CHECK(0, "no input buffer at frame %d", k);
+            break;
+        }
+        for (uint32_t i = 0; i < IN_WIDTH * IN_HEIGHT; i++) {
+            ((uint8_t*)frame.data)[i] = (uint8_t)(k + i);
+        }
+        frame.size = IN_WIDTH * IN_HEIGHT;
+        frame.timestamp = 1000000ULL * (k + 1);
+        CHECK(libmedia_m2m_submit(m2m, &frame) == 0, "submit %d", k);
+
+        media_frame_t result;
+        if (libmedia_m2m_complete(m2m, &result, 100) == 0) {
+            good += scaled_ok(&result, (uint8_t)k) && result.timestamp == frame.timestamp;
+            libmedia_m2m_release_frame(m2m, &result);
+        }
+    }
+    CHECK(good == 20, "%d of 20 frames scaled correctly", good);
+
+    media_frame_t result;
+    CHECK(libmedia_m2m_complete(m2m, &result, 10) < 0 && libmedia_get_last_error() == MEDIA_ERROR_TIMEOUT,
+          "complete on an idle device should time out");
+    libmedia_m2m_destroy(m2m);
+}
+
+/**
+ * @brief Count the open descriptors of the process
+ */
+static int count_fds(void)
+{
+    DIR* dir = opendir("/proc/self/fd");
+    int count = 0;
+    if (!dir) {
+        return -1;
+    }
+    while (readdir(dir)) {
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+static void test_dmabuf(int mplane)
+{
+    fake_reset(mplane);
+    memset(&camera, 0, sizeof(camera));
+    camera.generation = 1;
+    for (int i = 0; i < CAMERA_BUFFERS; i++) {
+        camera.memfd[i] = memfd_create("camera", MFD_CLOEXEC);
+        if (camera.memfd[i] < 0 || ftruncate(camera.memfd[i], IN_WIDTH * IN_HEIGHT) < 0) {
+            CHECK(0, "memfd: %s", strerror(errno));
+            return;
+        }
+        camera.map[i] = mmap(NULL, IN_WIDTH * IN_HEIGHT, PROT_READ | PROT_WRITE, MAP_SHARED, camera.memfd[i], 0);
+    }
+
+    media_m2m_config_t config = {
+        .device_path = FAKE_PATH,
+        .input = { .width = IN_WIDTH, .height = IN_HEIGHT, .pixelformat = V4L2_PIX_FMT_GREY },
+        .output = { .width = IN_WIDTH / 2, .height = IN_HEIGHT / 2, .pixelformat = V4L2_PIX_FMT_GREY },
+        .input_memory = MEDIA_M2M_MEMORY_DMABUF
+    };
+    int fds = count_fds();
+    media_m2m_t* m2m = libmedia_m2m_create(&config);
+    CHECK(m2m, "create failed: %d", libmedia_get_last_error());
+    if (!m2m) {
+        return;
+    }
+
+    media_session_t* session = (media_session_t*)&camera;
+    int good = 0;
+    int busy = 0;
+    int open_exports = 0;
+    for (int k = 0; k < 80; k++) {
+        int index = k % CAMERA_BUFFERS;
+        if (k == 40) {
+            // Capture buffers reallocated behind the same session pointer
+            open_exports = count_fds();
+            camera.generation++;
+        } else if (k == 41) {
+            // One buffer of the new set exported, the four old ones closed
+            CHECK(count_fds() == open_exports - CAMERA_BUFFERS + 1, "%d descriptors open, expected %d",
+                  count_fds(), open_exports - CAMERA_BUFFERS + 1);
+        }
+        for (uint32_t i = 0; i < IN_WIDTH * IN_HEIGHT; i++) {
+            camera.map[index][i] = (uint8_t)(k * 3 + i);
+        }
+        media_frame_t frame = {
+            .data = camera.map[index],
+            .size = IN_WIDTH * IN_HEIGHT,
+            .width = IN_WIDTH,
+            .height = IN_HEIGHT,
+            .frame_id = index,
+            .timestamp = 1000000ULL * (k + 1)
+        };
+        if (libmedia_m2m_submit_frame(m2m, session, &frame) < 0) {
+            busy++;
+            continue;
+        }
+
+        media_frame_t result;
+        if (libmedia_m2m_complete(m2m, &result, 100) == 0) {
+            good += scaled_ok(&result, (uint8_t)(k * 3)) && result.timestamp == frame.timestamp;
+            libmedia_m2m_release_frame(m2m, &result);
+        }
+    }
+
+    media_m2m_stats_t stats;
+    libmedia_m2m_get_stats(m2m, &stats);
+    libmedia_m2m_destroy(m2m);
+
+    CHECK(good == 80 && busy == 0, "%d of 80 frames scaled correctly, %d busy", good, busy);
+    CHECK(camera.exports == 2 * CAMERA_BUFFERS, "%d exports, each buffer should be exported once per generation",
+          camera.exports);
+    CHECK(camera.released == 80, "%d of 80 capture frames released", camera.released);
+    CHECK(stats.submitted == 80 && stats.completed == 80, "stats %llu submitted, %llu completed",
+          (unsigned long long)stats.submitted, (unsigned long long)stats.completed);
+    CHECK(count_fds() == fds, "%d descriptors left open after destroy", count_fds() - fds);
+
+    for (int i = 0; i < CAMERA_BUFFERS; i++) {
+        munmap(camera.map[i], IN_WIDTH * IN_HEIGHT);
+        close(camera.memfd[i]);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int first = argc > 1 ? atoi(argv[1]) : 0;
+    int last = argc > 1 ? first : 1;
+
+    for (int mplane = first; mplane <= last; mplane++) {
+        printf("%s-planar: mmap input\n", mplane ? "multi" : "single");
+        test_mmap(mplane);
+        printf("%s-planar: dmabuf chaining\n", mplane ? "multi" : "single");
+        test_dmabuf(mplane);
+    }
+    fake_reset(0);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
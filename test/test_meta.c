@@ -0,0 +1,215 @@
+/**
+ * @file test_meta.c
+ * @brief Frame metadata set, merge and serialization round trips
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Checks replacing keys, floating-point values, the full-block limit and
+ * clearing; that merge only adds keys the destination lacks; the exact
+ * little-endian wire layout, a full-block round trip through
+ * serialize/deserialize and rejection of truncated or malformed input.
+ * Several threads adding their own keys to one block concurrently must
+ * all land, with a reader scanning alongside.
+ */
+
+#include "media_meta.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+#define THREADS 4
+#define KEYS_PER_THREAD 5
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static void test_set_get(void)
+{
+    printf("set and get\n");
+
+    media_meta_t meta;
+    memset(&meta, 0, sizeof(meta));
+    uint64_t value = 0;
+    double real = 0;
+
+    CHECK(libmedia_meta_set(&meta, MEDIA_META_EXPOSURE, 1000) == 0, "set failed");
+    CHECK(libmedia_meta_set(&meta, MEDIA_META_EXPOSURE, 2000) == 0 && meta.count == 1, "replace took a new slot");
+    CHECK(libmedia_meta_get(&meta, MEDIA_META_EXPOSURE, &value) == 1 && value == 2000, "exposure %llu",
+          (unsigned long long)value);
+    CHECK(libmedia_meta_set_f64(&meta, MEDIA_META_MEAN_LUMA, 117.25) == 0 &&
+          libmedia_meta_get_f64(&meta, MEDIA_META_MEAN_LUMA, &real) == 1 && real == 117.25, "mean luma %f", real);
+    CHECK(libmedia_meta_get(&meta, MEDIA_META_GAIN, NULL) == 0, "absent key found");
+    CHECK(libmedia_meta_set(&meta, 0, 1) < 0 && libmedia_meta_get(&meta, 0, NULL) == 0, "key 0 accepted");
+    CHECK(libmedia_meta_set(NULL, MEDIA_META_GAIN, 1) == 0 && libmedia_meta_get(NULL, MEDIA_META_GAIN, NULL) == 0,
+          "NULL block not a no-op");
+
+    // Fill the block; further new keys are dropped, existing ones still update
+    for (uint32_t key = MEDIA_META_USER; meta.count < MEDIA_META_MAX_ENTRIES; key++) {
+        libmedia_meta_set(&meta, key, key);
+    }
+    CHECK(libmedia_meta_set(&meta, MEDIA_META_GAIN, 8) < 0 && meta.dropped == 1, "set into a full block");
+    CHECK(libmedia_meta_set(&meta, MEDIA_META_EXPOSURE, 3000) == 0 &&
+          libmedia_meta_get(&meta, MEDIA_META_EXPOSURE, &value) && value == 3000, "update in a full block failed");
+
+    libmedia_meta_clear(&meta);
+    CHECK(meta.count == 0 && meta.dropped == 0 && !libmedia_meta_get(&meta, MEDIA_META_EXPOSURE, NULL),
+          "clear left entries");
+    CHECK(libmedia_meta_set(&meta, MEDIA_META_GAIN, 4) == 0 && libmedia_meta_get(&meta, MEDIA_META_GAIN, &value) &&
+          value == 4, "set after clear failed");
+}
+
+static void test_merge(void)
+{
+    printf("merge\n");
+
+    media_meta_t src, dst;
+    memset(&src, 0, sizeof(src));
+    memset(&dst, 0, sizeof(dst));
+    libmedia_meta_set(&src, MEDIA_META_SEQUENCE, 41);
+    libmedia_meta_set(&src, MEDIA_META_EXPOSURE, 1000);
+    libmedia_meta_set(&src, MEDIA_META_GAIN, 16);
+    libmedia_meta_set(&dst, MEDIA_META_EXPOSURE, 500);
+    libmedia_meta_set(&dst, MEDIA_META_STAGE_NS + 2, 123456);
+
+    uint64_t value = 0;
+    CHECK(libmedia_meta_merge(&dst, &src) == 2, "merge did not add exactly the two missing keys");
+    CHECK(libmedia_meta_get(&dst, MEDIA_META_EXPOSURE, &value) && value == 500, "merge overwrote exposure: %llu",
+          (unsigned long long)value);
+    CHECK(libmedia_meta_get(&dst, MEDIA_META_SEQUENCE, &value) && value == 41 &&
+          libmedia_meta_get(&dst, MEDIA_META_GAIN, &value) && value == 16 &&
+          libmedia_meta_get(&dst, MEDIA_META_STAGE_NS + 2, NULL), "merged block incomplete");
+    CHECK(libmedia_meta_merge(&dst, &src) == 0 && dst.count == 4, "second merge added entries");
+    CHECK(libmedia_meta_merge(&dst, NULL) == 0 && libmedia_meta_merge(&dst, &dst) == 0, "merge from NULL or self");
+}
+
+static void test_serialize(void)
+{
+    printf("serialize round trip\n");
+
+    media_meta_t meta, copy;
+    memset(&meta, 0, sizeof(meta));
+    memset(&copy, 0, sizeof(copy));
+    uint8_t buffer[4 + 12 * MEDIA_META_MAX_ENTRIES + 16];
+
+    // Wire layout: count, then key and value, all little endian
+    libmedia_meta_set(&meta, MEDIA_META_SEQUENCE, 0x0102030405060708ull);
+    libmedia_meta_set(&meta, MEDIA_META_USER + 1, 0xFFFFFFFF00000001ull);
+    const uint8_t expected[] = {
+        2, 0, 0, 0,
+        1, 0, 0, 0, 0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,
+        0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
+    };
+    size_t size = libmedia_meta_serialize(&meta, buffer, sizeof(buffer));
+    CHECK(size == sizeof(expected) && memcmp(buffer, expected, sizeof(expected)) == 0,
+          "%zu bytes, layout differs from count/key/value little endian", size);
+    CHECK(libmedia_meta_serialize(&meta, buffer, sizeof(expected) - 1) == 0, "serialized into a short buffer");
+    CHECK(libmedia_meta_serialize(NULL, buffer, 4) == 4 && buffer[0] == 0, "NULL block not serialized as empty");
+
+    // A full block with integer and floating-point values survives the round trip
+    libmedia_meta_clear(&meta);
+    uint32_t state = 1;
+    for (uint32_t i = 0; i < MEDIA_META_MAX_ENTRIES; i++) {
+        state = state * 1103515245u + 12345u;
+        if (i % 3 == 0) {
+            libmedia_meta_set_f64(&meta, MEDIA_META_USER + i, (double)state / 7.0);
+        } else {
+            libmedia_meta_set(&meta, MEDIA_META_USER + i, (uint64_t)state << 29 | i);
+        }
+    }
+    libmedia_meta_set(&copy, MEDIA_META_GAIN, 99);
+    size = libmedia_meta_serialize(&meta, buffer, sizeof(buffer));
+    CHECK(size == 4 + 12 * MEDIA_META_MAX_ENTRIES, "full block serialized to %zu bytes", size);
+    CHECK(libmedia_meta_deserialize(&copy, buffer, size) == size, "deserialize failed");
+    int wrong = 0;
+    for (uint32_t i = 0; i < MEDIA_META_MAX_ENTRIES; i++) {
+        uint64_t a = 0, b = 0;
+        libmedia_meta_get(&meta, MEDIA_META_USER + i, &a);
+        wrong += !libmedia_meta_get(&copy, MEDIA_META_USER + i, &b) || a != b;
+    }
+    CHECK(wrong == 0 && copy.count == MEDIA_META_MAX_ENTRIES, "%d entries differ after the round trip", wrong);
+    CHECK(!libmedia_meta_get(&copy, MEDIA_META_GAIN, NULL), "deserialize kept an old entry");
+
+    // Malformed input
+    CHECK(libmedia_meta_deserialize(&copy, buffer, size - 1) == 0, "truncated data accepted");
+    buffer[0] = MEDIA_META_MAX_ENTRIES + 1;
+    CHECK(libmedia_meta_deserialize(&copy, buffer, sizeof(buffer)) == 0, "count above the block size accepted");
+    memcpy(buffer, expected, sizeof(expected));
+    memset(buffer + 4, 0, 4);
+    CHECK(libmedia_meta_deserialize(&copy, buffer, sizeof(expected)) == 0, "key 0 accepted");
+}
+
+typedef struct {
+    media_meta_t* meta;
+    uint32_t id;
+} writer_arg_t;
+
+static void* writer_thread(void* arg)
+{
+    writer_arg_t* w = arg;
+    for (uint32_t i = 0; i < KEYS_PER_THREAD; i++) {
+        libmedia_meta_set(w->meta, MEDIA_META_USER + w->id * 16 + i, (uint64_t)w->id << 32 | i);
+    }
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    printf("concurrent writers\n");
+
+    int wrong = 0;
+    for (int round = 0; round < 2000; round++) {
+        media_meta_t meta;
+        memset(&meta, 0, sizeof(meta));
+        writer_arg_t args[THREADS];
+        pthread_t threads[THREADS];
+        for (int i = 0; i < THREADS; i++) {
+            args[i] = (writer_arg_t){ &meta, (uint32_t)i };
+            pthread_create(&threads[i], NULL, writer_thread, &args[i]);
+        }
+
+        // Whatever a reader sees while they run is a published value
+        for (int spin = 0; spin < 100; spin++) {
+            uint64_t value;
+            if (libmedia_meta_get(&meta, MEDIA_META_USER + 16 + 2, &value)) {
+                wrong += value != ((uint64_t)1 << 32 | 2);
+            }
+        }
+        for (int i = 0; i < THREADS; i++) {
+            pthread_join(threads[i], NULL);
+        }
+
+        for (uint32_t t = 0; t < THREADS; t++) {
+            for (uint32_t i = 0; i < KEYS_PER_THREAD; i++) {
+                uint64_t value;
+                wrong += !libmedia_meta_get(&meta, MEDIA_META_USER + t * 16 + i, &value) ||
+                         value != ((uint64_t)t << 32 | i);
+            }
+        }
+        wrong += meta.count != THREADS * KEYS_PER_THREAD;
+    }
+    CHECK(wrong == 0, "%d keys lost or wrong", wrong);
+}
+
+int main(void)
+{
+    test_set_get();
+    test_merge();
+    test_serialize();
+    test_concurrent();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file test_pool.c
+ * @brief Frame pool reference counting and free-list reuse
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * A buffer goes back to its class only when its last reference is dropped,
+ * and is handed out again with its metadata and owner data cleared.
+ * Size-based acquire falls through to larger classes once smaller ones are
+ * exhausted. A pool destroyed while buffers are still out keeps its memory
+ * mapped and charged to the memory budget until the last of them is
+ * released. Several threads cycling a few buffers through acquire, extra
+ * references and release must never share a buffer or lose one.
+ */
+
+#include "media_pool.h"
+#include "media_meta.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+#define THREADS 4
+#define THREAD_ROUNDS 100000
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static const media_pool_key_t g_rgb = { V4L2_PIX_FMT_RGB24, 640, 480, 0 };
+static const media_pool_key_t g_tensor = { 0, 0, 0, 1000 };
+
+static size_t budget_used(void)
+{
+    media_memory_stats_t stats;
+    return libmedia_get_memory_stats(&stats) == 0 ? stats.used : 0;
+}
+
+/**
+ * @brief Check whether a page-aligned range is still mapped
+ */
+static int is_mapped(void* data, size_t size)
+{
+    unsigned char vec[512];
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = (size + page - 1) / page;
+    return mincore(data, (pages < sizeof(vec) ? pages : sizeof(vec)) * page, vec) == 0 || errno != ENOMEM;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static void test_refcounts(void)
+{
+    printf("reference counts and reuse\n");
+
+    CHECK(!libmedia_pool_create(0x80), "unknown flag accepted");
+    media_pool_t* pool = libmedia_pool_create(0);
+    CHECK(pool && libmedia_pool_reserve(pool, &g_rgb, 3) == 0, "reserve failed: %d", libmedia_get_last_error());
+    if (!pool) {
+        return;
+    }
+    CHECK(libmedia_pool_reserve(pool, &g_rgb, 2) < 0, "class reserved twice");
+    CHECK(libmedia_pool_get_available(pool, &g_rgb) == 3, "%u available", libmedia_pool_get_available(pool, &g_rgb));
+
+    media_pool_buffer_t* b[4];
+    for (int i = 0; i < 3; i++) {
+        b[i] = libmedia_pool_acquire(pool, &g_rgb);
+        CHECK(b[i] && b[i]->frame.size == 640 * 480 * 3 && ((uintptr_t)b[i]->frame.data & 4095) == 0,
+              "buffer %d missing, wrong size or not page aligned", i);
+    }
+    CHECK(b[0] != b[1] && b[1] != b[2] && b[0] != b[2], "same buffer handed out twice");
+    b[3] = libmedia_pool_acquire(pool, &g_rgb);
+    CHECK(!b[3] && libmedia_get_last_error() == MEDIA_ERROR_BUFFER_ERROR, "fourth buffer from a class of three");
+    if (!b[0] || !b[1] || !b[2]) {
+        libmedia_pool_destroy(pool);
+        return;
+    }
+
+    // A second reference keeps the buffer out of the free list
+    media_pool_buffer_t* held = b[1];
+    uint32_t index = (uint32_t)held->frame.frame_id;
+    libmedia_pool_buffer_ref(held);
+    libmedia_pool_buffer_unref(held);
+    CHECK(libmedia_pool_get_available(pool, &g_rgb) == 0, "buffer freed while still referenced");
+    CHECK(libmedia_pool_find_buffer(pool, (uint8_t*)held->frame.data + 1234) == held, "find_buffer inside a buffer");
+
+    held->user_data = &index;
+    held->frame.timestamp = 99;
+    libmedia_meta_set(held->frame.meta, MEDIA_META_EXPOSURE, 1000);
+    libmedia_pool_buffer_unref(held);
+    CHECK(libmedia_pool_get_available(pool, &g_rgb) == 1, "last unref did not free the buffer");
+
+    // The only free buffer comes back, cleared for its new owner
+    media_pool_buffer_t* again = libmedia_pool_acquire(pool, &g_rgb);
+    uint64_t exposure;
+    CHECK(again == held && again->frame.frame_id == index, "free buffer not reused");
+    CHECK(again && !again->user_data && again->frame.timestamp == 0 &&
+          !libmedia_meta_get(again->frame.meta, MEDIA_META_EXPOSURE, &exposure),
+          "reused buffer still carries the previous frame's data");
+
+    libmedia_pool_buffer_unref(again);
+    libmedia_pool_buffer_unref(b[0]);
+    libmedia_pool_buffer_unref(b[2]);
+    CHECK(libmedia_pool_get_available(pool, &g_rgb) == 3, "%u of 3 back", libmedia_pool_get_available(pool, &g_rgb));
+    libmedia_pool_destroy(pool);
+}
+
+static void test_acquire_size(void)
+{
+    printf("size classes\n");
+
+    media_pool_t* pool = libmedia_pool_create(0);
+    CHECK(pool && libmedia_pool_reserve(pool, &g_rgb, 1) == 0 && libmedia_pool_reserve(pool, &g_tensor, 2) == 0,
+          "reserve failed: %d", libmedia_get_last_error());
+    if (!pool) {
+        return;
+    }
+
+    media_pool_buffer_t* a = libmedia_pool_acquire_size(pool, 500);
+    media_pool_buffer_t* b = libmedia_pool_acquire_size(pool, 1000);
+    CHECK(a && b && a->frame.size == 1000 && b->frame.size == 1000, "smallest class not used first");
+    CHECK(a && ((uintptr_t)a->frame.data & 63) == 0, "tensor buffer not cache-line aligned");
+
+    media_pool_buffer_t* c = libmedia_pool_acquire_size(pool, 1);
+    CHECK(c && c->frame.size == 640 * 480 * 3, "exhausted class did not fall through to the larger one");
+    CHECK(!libmedia_pool_acquire_size(pool, 1) && libmedia_get_last_error() == MEDIA_ERROR_BUFFER_ERROR,
+          "buffer from an exhausted pool");
+    CHECK(!libmedia_pool_acquire_size(pool, 640 * 480 * 3 + 1) &&
+          libmedia_get_last_error() == MEDIA_ERROR_INVALID_PARAM, "size above every class accepted");
+
+    int dummy;
+    CHECK(!libmedia_pool_find_buffer(pool, &dummy), "stack address found in the pool");
+
+    libmedia_pool_buffer_unref(a);
+    libmedia_pool_buffer_unref(b);
+    libmedia_pool_buffer_unref(c);
+    libmedia_pool_destroy(pool);
+}
+
+static void test_destroy_with_buffers_out(void)
+{
+    printf("destroy with buffers out\n");
+
+    size_t before = budget_used();
+    media_pool_t* pool = libmedia_pool_create(0);
+    CHECK(pool && libmedia_pool_reserve(pool, &g_rgb, 2) == 0, "reserve failed");
+    if (!pool) {
+        return;
+    }
+    size_t charged = budget_used() - before;
+    CHECK(charged >= 2 * 640 * 480 * 3, "%zu bytes charged for two RGB buffers", charged);
+
+    media_pool_buffer_t* a = libmedia_pool_acquire(pool, &g_rgb);
+    media_pool_buffer_t* b = libmedia_pool_acquire(pool, &g_rgb);
+    if (!a || !b) {
+        CHECK(0, "acquire failed");
+        libmedia_pool_destroy(pool);
+        return;
+    }
+    void* data = a->frame.data;
+    size_t size = a->frame.size;
+    libmedia_pool_destroy(pool);
+
+    memset(a->frame.data, 1, a->frame.size);
+    CHECK(is_mapped(data, size), "memory unmapped with buffers still out");
+    libmedia_pool_buffer_unref(a);
+    CHECK(is_mapped(data, size) && budget_used() - before == charged, "memory released before the last buffer");
+    libmedia_pool_buffer_unref(b);
+    CHECK(!is_mapped(data, size), "memory still mapped after the last buffer");
+    CHECK(budget_used() == before, "%zu bytes still charged after the last buffer", budget_used() - before);
+}
+
+typedef struct {
+    media_pool_t* pool;
+    uint32_t id;
+    int collisions;
+    int misses;
+} thread_arg_t;
+
+/**
+ * @brief Own a buffer exclusively for a moment, with a second reference on the side
+ */
+static void* pool_thread(void* arg)
+{
+    thread_arg_t* t = arg;
+    for (int i = 0; i < THREAD_ROUNDS; i++) {
+        media_pool_buffer_t* buffer = libmedia_pool_acquire(t->pool, &g_tensor);
+        if (!buffer) {
+            // All taken, or a release preempted halfway through its push
+            t->misses++;
+            sched_yield();
+            continue;
+        }
+        uint32_t* owner = buffer->frame.data;
+        *owner = t->id;
+        libmedia_pool_buffer_ref(buffer);
+        libmedia_pool_buffer_unref(buffer);
+        t->collisions += *owner != t->id;
+        libmedia_pool_buffer_unref(buffer);
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    printf("%d threads x %d rounds\n", THREADS, THREAD_ROUNDS);
+
+    media_pool_t* pool = libmedia_pool_create(0);
+    CHECK(pool && libmedia_pool_reserve(pool, &g_tensor, 3) == 0, "reserve failed");
+    if (!pool) {
+        return;
+    }
+
+    thread_arg_t args[THREADS];
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        args[i] = (thread_arg_t){ pool, (uint32_t)i + 1, 0, 0 };
+        pthread_create(&threads[i], NULL, pool_thread, &args[i]);
+    }
+    int collisions = 0, misses = 0;
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        collisions += args[i].collisions;
+        misses += args[i].misses;
+    }
+
+    printf("  %d acquires found the class empty\n", misses);
+    CHECK(collisions == 0, "%d buffers held by two threads at once", collisions);
+    CHECK(libmedia_pool_get_available(pool, &g_tensor) == 3, "%u of 3 buffers back",
+          libmedia_pool_get_available(pool, &g_tensor));
+    libmedia_pool_destroy(pool);
+}
+
+int main(void)
+{
+    test_refcounts();
+    test_acquire_size();
+    test_destroy_with_buffers_out();
+    test_threads();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file test_prefetch.c
+ * @brief Prefetcher test against a stubbed capture session
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * libmedia_session_capture_frame() and libmedia_session_release_frame()
+ * are replaced (--wrap) by a session that hands out a fixed set of heap
+ * buffers, each filled with its sequence number. The test runs both modes
+ * at several depths and checks that frames arrive complete and in order,
+ * that COPY mode copies what fits and falls back for the rest, and that
+ * every driver buffer is back with the session after destroy.
+ */
+
+#include "media_prefetch.h"
+#include "media_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// ============================================================================
+// Stubbed Session
+// ============================================================================
+
+#define STUB_BUFFERS 6
+#define STUB_FRAME_SIZE (1u << 20)
+#define STUB_SESSION ((media_session_t*)&stub)
+
+static struct {
+    uint8_t* buffers[STUB_BUFFERS];
+    int held[STUB_BUFFERS];     /**< Buffer is out with a caller (atomic) */
+    int streaming;              /**< Capture succeeds (atomic) */
+    uint32_t sequence;          /**< Next sequence number, capture thread only */
+    uint32_t empty;             /**< Waits that found no buffer, capture thread only */
+    int outstanding;            /**< Frames captured and not released (atomic) */
+    int bad_releases;           /**< Releases of frames not held (atomic) */
+} stub;
+
+int __wrap_libmedia_session_capture_frame(media_session_t* session, media_frame_t* frame, int timeout_ms)
+{
+    (void)timeout_ms;
+    if (session != STUB_SESSION) {
+        media_set_last_error(MEDIA_ERROR_INVALID_PARAM);
+        return -1;
+    }
+    if (!__atomic_load_n(&stub.streaming, __ATOMIC_ACQUIRE)) {
+        media_set_last_error(MEDIA_ERROR_STREAMING_ERROR);
+        return -1;
+    }
+
+    usleep(2000);   // Frame interval
+    for (int i = 0; i < STUB_BUFFERS; i++) {
+        if (__atomic_load_n(&stub.held[i], __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        __atomic_store_n(&stub.held[i], 1, __ATOMIC_RELEASE);
+
+        // Odd frames are a little shorter, so COPY with a smaller staging size must fall back on even ones
+        uint32_t sequence = stub.sequence++;
+        memset(frame, 0, sizeof(*frame));
+        frame->size = STUB_FRAME_SIZE - (sequence % 2) * 100;
+        frame->data = stub.buffers[i];
+        memset(frame->data, (uint8_t)sequence, frame->size);
+        frame->frame_id = i;
+        frame->sequence = sequence;
+        __atomic_fetch_add(&stub.outstanding, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    // Every buffer is out: report a timeout both ways the real session does
+    if (stub.empty++ % 2) {
+        media_set_last_error(MEDIA_ERROR_TIMEOUT);
+        return -1;
+    }
+    return 0;
+}
+
+int __wrap_libmedia_session_release_frame(media_session_t* session, media_frame_t* frame)
+{
+    if (session != STUB_SESSION || frame->frame_id >= STUB_BUFFERS ||
+        frame->data != stub.buffers[frame->frame_id] ||
+        !__atomic_exchange_n(&stub.held[frame->frame_id], 0, __ATOMIC_ACQ_REL)) {
+        __atomic_fetch_add(&stub.bad_releases, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    __atomic_fetch_sub(&stub.outstanding, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+#define TEST_FRAMES 100
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static void test_stream(media_prefetch_mode_t mode, uint32_t depth, size_t frame_size)
+{
+    printf("%s depth %u staging %zu\n", mode == MEDIA_PREFETCH_COPY ? "copy" : "touch", depth, frame_size);
+
+    media_prefetch_config_t config = { .mode = mode, .depth = depth, .frame_size = frame_size, .bytes = 4096 };
+    media_prefetch_t* prefetch = libmedia_prefetch_create(STUB_SESSION, &config);
+    CHECK(prefetch, "create failed: %d", libmedia_get_last_error());
+    if (!prefetch) {
+        return;
+    }
+
+    // The helper must wait for the session to start streaming
+    usleep(20000);
+    __atomic_store_n(&stub.streaming, 1, __ATOMIC_RELEASE);
+
+    int complete = 0;
+    int in_order = 1;
+    uint32_t last = 0;
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        media_frame_t frame;
+        if (libmedia_prefetch_next(prefetch, &frame, 1000) < 0) {
+            CHECK(0, "next failed at frame %d: %d", i, libmedia_get_last_error());
+            break;
+        }
+        if (i > 0 && frame.sequence != last + 1) {
+            in_order = 0;
+        }
+        last = frame.sequence;
+
+        const uint8_t* data = frame.data;
+        complete += data[0] == (uint8_t)frame.sequence && data[frame.size - 1] == (uint8_t)frame.sequence;
+        usleep(3000);   // Consumer slower than the device
+        CHECK(libmedia_prefetch_release(prefetch, &frame) == 0, "release failed at frame %d", i);
+    }
+
+    media_prefetch_stats_t stats;
+    libmedia_prefetch_get_stats(prefetch, &stats);
+    libmedia_prefetch_destroy(prefetch);
+    __atomic_store_n(&stub.streaming, 0, __ATOMIC_RELEASE);
+
+    CHECK(complete == TEST_FRAMES, "%d of %d frames complete", complete, TEST_FRAMES);
+    CHECK(in_order, "frames out of order");
+    CHECK(stats.delivered == TEST_FRAMES, "%llu delivered", (unsigned long long)stats.delivered);
+    CHECK(stats.errors == 0, "%llu capture errors", (unsigned long long)stats.errors);
+    if (mode == MEDIA_PREFETCH_COPY && frame_size >= STUB_FRAME_SIZE) {
+        CHECK(stats.copied > 0 && stats.fallbacks == 0, "%llu copied, %llu fallbacks",
+              (unsigned long long)stats.copied, (unsigned long long)stats.fallbacks);
+    } else if (mode == MEDIA_PREFETCH_COPY) {
+        CHECK(stats.copied > 0 && stats.fallbacks > 0, "%llu copied, %llu fallbacks",
+              (unsigned long long)stats.copied, (unsigned long long)stats.fallbacks);
+    } else {
+        CHECK(stats.copied == 0, "TOUCH mode copied frames");
+    }
+    CHECK(__atomic_load_n(&stub.outstanding, __ATOMIC_RELAXED) == 0, "%d frames not returned to the session",
+          stub.outstanding);
+    CHECK(__atomic_load_n(&stub.bad_releases, __ATOMIC_RELAXED) == 0, "%d bad releases", stub.bad_releases);
+}
+
+static void test_errors(void)
+{
+    printf("errors\n");
+
+    media_prefetch_config_t config = { .mode = MEDIA_PREFETCH_COPY };
+    CHECK(!libmedia_prefetch_create(STUB_SESSION, &config), "COPY without a frame size accepted");
+    config.depth = MEDIA_PREFETCH_MAX_DEPTH + 1;
+    config.mode = MEDIA_PREFETCH_TOUCH;
+    CHECK(!libmedia_prefetch_create(STUB_SESSION, &config), "depth above the maximum accepted");
+
+    // Not streaming: next times out
+    media_prefetch_t* prefetch = libmedia_prefetch_create(STUB_SESSION, NULL);
+    CHECK(prefetch, "create with defaults failed");
+    if (prefetch) {
+        media_frame_t frame;
+        int result = libmedia_prefetch_next(prefetch, &frame, 50);
+        CHECK(result < 0 && libmedia_get_last_error() == MEDIA_ERROR_TIMEOUT, "next on an idle session: %d", result);
+        libmedia_prefetch_destroy(prefetch);
+    }
+}
+
+int main(void)
+{
+    for (int i = 0; i < STUB_BUFFERS; i++) {
+        stub.buffers[i] = malloc(STUB_FRAME_SIZE);
+        if (!stub.buffers[i]) {
+            printf("Out of memory\n");
+            return 1;
+        }
+    }
+
+    test_stream(MEDIA_PREFETCH_TOUCH, 0, 0);
+    test_stream(MEDIA_PREFETCH_TOUCH, 3, 0);
+    test_stream(MEDIA_PREFETCH_COPY, 2, STUB_FRAME_SIZE);
+    test_stream(MEDIA_PREFETCH_COPY, 1, STUB_FRAME_SIZE - 50);
+    test_errors();
+
+    for (int i = 0; i < STUB_BUFFERS; i++) {
+        free(stub.buffers[i]);
+    }
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
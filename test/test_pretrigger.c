@@ -0,0 +1,234 @@
+/**
+ * @file test_pretrigger.c
+ * @brief Pre-trigger history wrap-around and eviction
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Frames of varying size, each filled with a pattern derived from its id,
+ * are pushed through a small byte ring many times over. On trigger the
+ * history must come out oldest first as an unbroken run ending at the
+ * newest frame, every frame intact and carrying its metadata, and the run
+ * must fill the ring up to at most one frame of wrap slack. Further checks:
+ * eviction by time window and by frame count, frames larger than the ring,
+ * live frames passed through uncopied, and a new history after stop.
+ */
+
+#include "media_pretrigger.h"
+#include "media_meta.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+#define PERIOD_NS 33333333ull
+#define MAX_FRAME 1000
+#define MAX_LOG 512
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct {
+    int count;
+    uint32_t ids[MAX_LOG];
+    int live[MAX_LOG];
+    const void* data[MAX_LOG];
+    int corrupt;                /**< Frames whose bytes or metadata were wrong */
+    int fail;                   /**< Sink return value */
+} sink_log_t;
+
+static uint8_t g_data[MAX_FRAME + 4096];
+
+static size_t frame_size(uint32_t id)
+{
+    return 100 + (id * 389) % (MAX_FRAME - 100);
+}
+
+static size_t aligned(size_t size)
+{
+    return (size + 63) & ~(size_t)63;
+}
+
+static int sink(void* user_data, const media_frame_t* frame, int live)
+{
+    sink_log_t* log = user_data;
+    const uint8_t* data = frame->data;
+    uint64_t source;
+    int bad = frame->size != frame_size((uint32_t)frame->frame_id) ||
+              !frame->meta || !libmedia_meta_get(frame->meta, MEDIA_META_SOURCE, &source) || source != frame->frame_id;
+    for (size_t i = 0; !bad && i < frame->size; i++) {
+        bad = data[i] != (uint8_t)(frame->frame_id * 7 + i);
+    }
+    log->corrupt += bad;
+    if (log->count < MAX_LOG) {
+        log->ids[log->count] = (uint32_t)frame->frame_id;
+        log->live[log->count] = live;
+        log->data[log->count] = frame->data;
+        log->count++;
+    }
+    return log->fail;
+}
+
+/**
+ * @brief Push frame `id` at 30 fps, written into the shared source buffer as a capture would
+ */
+static int push(media_pretrigger_t* pt, uint32_t id, size_t size)
+{
+    static media_meta_t meta;
+    for (size_t i = 0; i < size; i++) {
+        g_data[i] = (uint8_t)(id * 7 + i);
+    }
+    libmedia_meta_clear(&meta);
+    libmedia_meta_set(&meta, MEDIA_META_SOURCE, id);
+
+    media_frame_t frame = { 0 };
+    frame.data = g_data;
+    frame.size = size;
+    frame.frame_id = id;
+    frame.timestamp = 1000000000ull + id * PERIOD_NS;
+    frame.meta = &meta;
+    return libmedia_pretrigger_push(pt, &frame);
+}
+
+static media_pretrigger_stats_t stats(media_pretrigger_t* pt)
+{
+    media_pretrigger_stats_t s;
+    memset(&s, 0, sizeof(s));
+    libmedia_pretrigger_get_stats(pt, &s);
+    return s;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static void test_wrap(void)
+{
+    printf("byte ring wrap-around\n");
+
+    const size_t capacity = 4096;
+    sink_log_t log = { 0 };
+    media_pretrigger_config_t config = { .duration_ns = 1000 * PERIOD_NS, .bytes = capacity,
+                                         .sink = sink, .user_data = &log };
+    media_pretrigger_t* pt = libmedia_pretrigger_create(&config);
+    CHECK(pt, "create failed: %d", libmedia_get_last_error());
+    if (!pt) {
+        return;
+    }
+
+    const uint32_t frames = 300;
+    for (uint32_t id = 0; id < frames; id++) {
+        push(pt, id, frame_size(id));
+    }
+    media_pretrigger_stats_t s = stats(pt);
+    CHECK(s.stored == frames && s.evicted == frames - s.frames, "stored %llu, evicted %llu, holding %u",
+          (unsigned long long)s.stored, (unsigned long long)s.evicted, s.frames);
+    CHECK(s.span_ns == (s.frames - 1) * PERIOD_NS, "span %llu ns for %u frames", (unsigned long long)s.span_ns,
+          s.frames);
+
+    CHECK(libmedia_pretrigger_trigger(pt) == 0 && stats(pt).recording, "trigger failed");
+    push(pt, frames, frame_size(frames));
+
+    // History: an unbroken run ending at the newest frame, then the live frame uncopied
+    int history = log.count - 1;
+    CHECK(history == (int)s.frames && history > 0, "%d history frames, %u held", history, s.frames);
+    int gaps = 0;
+    size_t used = 0;
+    for (int i = 0; i < history; i++) {
+        gaps += log.live[i] || log.ids[i] != frames - (uint32_t)history + (uint32_t)i;
+        used += aligned(frame_size(log.ids[i]));
+    }
+    CHECK(gaps == 0, "%d history frames out of order or missing", gaps);
+    CHECK(log.corrupt == 0, "%d frames delivered with wrong bytes or metadata", log.corrupt);
+    CHECK(used <= capacity, "history takes %zu bytes of a %zu byte ring", used, capacity);
+    size_t older = aligned(frame_size(frames - (uint32_t)history - 1));
+    CHECK(used + older > capacity - aligned(MAX_FRAME), "history of %zu bytes evicted a frame of %zu that fit",
+          used, older);
+    CHECK(log.live[history] && log.ids[history] == frames && log.data[history] == g_data, "live frame copied");
+
+    s = stats(pt);
+    CHECK(s.frames == 0 && s.bytes == 0 && s.history == (uint64_t)history && s.live == 1,
+          "after trigger: %u frames held, %llu history, %llu live", s.frames, (unsigned long long)s.history,
+          (unsigned long long)s.live);
+
+    // After stop the history fills again
+    libmedia_pretrigger_stop(pt);
+    push(pt, frames + 1, frame_size(frames + 1));
+    push(pt, frames + 2, frame_size(frames + 2));
+    s = stats(pt);
+    CHECK(!s.recording && s.frames == 2 && s.live == 1, "after stop: %u frames held, %llu live", s.frames,
+          (unsigned long long)s.live);
+
+    libmedia_pretrigger_destroy(pt);
+}
+
+static void test_window_and_limits(void)
+{
+    printf("time window and frame limit\n");
+
+    sink_log_t log = { 0 };
+    media_pretrigger_config_t config = { .duration_ns = 3 * PERIOD_NS, .bytes = 1 << 20,
+                                         .sink = sink, .user_data = &log };
+    media_pretrigger_t* pt = libmedia_pretrigger_create(&config);
+    CHECK(pt, "create failed");
+    if (!pt) {
+        return;
+    }
+    for (uint32_t id = 0; id < 20; id++) {
+        push(pt, id, frame_size(id));
+    }
+    media_pretrigger_stats_t s = stats(pt);
+    CHECK(s.frames == 4 && s.span_ns == 3 * PERIOD_NS, "window of 3 periods holds %u frames over %llu ns",
+          s.frames, (unsigned long long)s.span_ns);
+
+    // Larger than the whole ring: counted, not stored, history untouched
+    static uint8_t big[(1 << 20) + 64];
+    media_frame_t frame = { .data = big, .size = sizeof(big), .frame_id = 20,
+                            .timestamp = 1000000000ull + 20 * PERIOD_NS };
+    CHECK(libmedia_pretrigger_push(pt, &frame) == 0, "oversized push failed");
+    s = stats(pt);
+    CHECK(s.oversized == 1 && s.frames == 4, "oversized frame: %llu counted, %u held",
+          (unsigned long long)s.oversized, s.frames);
+    libmedia_pretrigger_destroy(pt);
+
+    config.duration_ns = 1000 * PERIOD_NS;
+    config.max_frames = 5;
+    log.fail = -1;
+    pt = libmedia_pretrigger_create(&config);
+    CHECK(pt, "create failed");
+    if (!pt) {
+        return;
+    }
+    for (uint32_t id = 0; id < 20; id++) {
+        push(pt, id, frame_size(id));
+    }
+    CHECK(stats(pt).frames == 5 && stats(pt).evicted == 15, "frame limit 5 holds %u frames", stats(pt).frames);
+    libmedia_pretrigger_trigger(pt);
+    push(pt, 20, frame_size(20));
+    s = stats(pt);
+    CHECK(log.count == 6 && log.ids[0] == 15 && s.sink_errors == 6, "%d delivered from %u, %llu sink errors",
+          log.count, log.ids[0], (unsigned long long)s.sink_errors);
+    libmedia_pretrigger_destroy(pt);
+
+    config.duration_ns = 0;
+    CHECK(!libmedia_pretrigger_create(&config), "zero window accepted");
+}
+
+int main(void)
+{
+    test_wrap();
+    test_window_and_limits();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file test_queue.c
+ * @brief Lock-free queue and ring tests
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Checks capacity rounding, full and empty behaviour and FIFO order of
+ * media_queue on one thread, then ordering under contention: one producer
+ * into an SPSC queue, and several producers into a small MPSC queue where
+ * each producer's items must arrive in the order it pushed them. A
+ * multi-producer, multi-consumer ring that holds exactly as many items as
+ * it has slots has items popped and pushed back by several threads; the
+ * ring is never over-full, so no push may fail.
+ *
+ * Finally a consumer that only sleeps in poll() on the queue's eventfd,
+ * draining with zero-timeout pops, takes two million items from an SPSC
+ * producer. Every empty pop re-arms the fd while the producer races to
+ * notify it, so a lost wakeup shows up as a poll timeout with items still
+ * to come. Run it under TSan to check the fd handshake as well.
+ *
+ * Usage: test_queue [items] (eventfd run, default 2000000)
+ */
+
+#include "media_queue.h"
+#include "media_ring.h"
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+#define SPSC_ITEMS 200000u
+#define MPSC_PRODUCERS 4
+#define MPSC_ITEMS 50000u           /**< Per producer */
+#define RING_THREADS 4
+#define RING_ROUNDS 200000
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+/** @brief Encode a producer id and sequence number as a non-NULL item */
+#define ITEM(producer, seq) ((void*)(((uintptr_t)(producer) << 24 | (seq)) + 1))
+#define ITEM_PRODUCER(item) ((uint32_t)(((uintptr_t)(item) - 1) >> 24))
+#define ITEM_SEQ(item) ((uint32_t)(((uintptr_t)(item) - 1) & 0xFFFFFF))
+
+typedef struct {
+    media_queue_t* queue;
+    uint32_t producer;
+    uint32_t count;
+} producer_arg_t;
+
+/**
+ * @brief Push count items in order, yielding while the queue is full
+ */
+static void* producer_thread(void* arg)
+{
+    producer_arg_t* p = arg;
+    for (uint32_t i = 0; i < p->count; i++) {
+        while (libmedia_queue_push(p->queue, ITEM(p->producer, i)) < 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_single_thread(void)
+{
+    printf("single thread\n");
+
+    CHECK(!libmedia_queue_create(MEDIA_QUEUE_SPSC, 0), "capacity 0 accepted");
+    CHECK(!libmedia_queue_create((media_queue_type_t)7, 4), "unknown type accepted");
+
+    for (int type = MEDIA_QUEUE_SPSC; type <= MEDIA_QUEUE_MPSC; type++) {
+        media_queue_t* queue = libmedia_queue_create(type, 5);
+        CHECK(queue, "create failed: %d", libmedia_get_last_error());
+        if (!queue) {
+            continue;
+        }
+        uint32_t capacity = libmedia_queue_get_capacity(queue);
+        CHECK(capacity == 8, "capacity 5 rounded to %u", capacity);
+        CHECK(libmedia_queue_push(queue, NULL) < 0, "NULL item accepted");
+
+        for (uint32_t i = 0; i < capacity; i++) {
+            CHECK(libmedia_queue_push(queue, ITEM(0, i)) == 0, "push %u into a queue of %u failed", i, capacity);
+        }
+        CHECK(libmedia_queue_get_count(queue) == capacity, "count %u", libmedia_queue_get_count(queue));
+        CHECK(libmedia_queue_push(queue, ITEM(0, capacity)) < 0 &&
+              libmedia_get_last_error() == MEDIA_ERROR_BUFFER_ERROR, "push into a full queue succeeded");
+
+        // Wrap around the ring a few times
+        void* item;
+        uint32_t next = 0;
+        for (uint32_t i = capacity; i < 4 * capacity; i++) {
+            CHECK(libmedia_queue_pop(queue, &item, 0) == 1 && ITEM_SEQ(item) == next, "pop %u out of order", next);
+            next++;
+            CHECK(libmedia_queue_push(queue, ITEM(0, i)) == 0, "push %u after a pop failed", i);
+        }
+        while (libmedia_queue_pop(queue, &item, 0) == 1) {
+            CHECK(ITEM_SEQ(item) == next, "drained %u, expected %u", ITEM_SEQ(item), next);
+            next++;
+        }
+        CHECK(next == 4 * capacity, "%u items drained, expected %u", next, 4 * capacity);
+        CHECK(libmedia_queue_pop(queue, &item, 20) == 0, "timed pop on an empty queue did not time out");
+        libmedia_queue_destroy(queue);
+    }
+}
+
+static void test_spsc(void)
+{
+    printf("spsc %u items\n", SPSC_ITEMS);
+
+    media_queue_t* queue = libmedia_queue_create(MEDIA_QUEUE_SPSC, 64);
+    CHECK(queue, "create failed: %d", libmedia_get_last_error());
+    if (!queue) {
+        return;
+    }
+
+    producer_arg_t arg = { queue, 0, SPSC_ITEMS };
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer_thread, &arg);
+
+    uint32_t received = 0;
+    uint32_t out_of_order = 0;
+    void* item;
+    while (received < SPSC_ITEMS && libmedia_queue_pop(queue, &item, 2000) == 1) {
+        out_of_order += ITEM_SEQ(item) != received;
+        received++;
+    }
+    pthread_join(thread, NULL);
+
+    CHECK(received == SPSC_ITEMS, "%u of %u items received", received, SPSC_ITEMS);
+    CHECK(out_of_order == 0, "%u items out of order", out_of_order);
+    libmedia_queue_destroy(queue);
+}
+
+static void test_mpsc(void)
+{
+    printf("mpsc %d producers x %u items\n", MPSC_PRODUCERS, MPSC_ITEMS);
+
+    // Small, so producers keep finding it full
+    media_queue_t* queue = libmedia_queue_create(MEDIA_QUEUE_MPSC, 16);
+    CHECK(queue, "create failed: %d", libmedia_get_last_error());
+    if (!queue) {
+        return;
+    }
+
+    producer_arg_t args[MPSC_PRODUCERS];
+    pthread_t threads[MPSC_PRODUCERS];
+    for (int i = 0; i < MPSC_PRODUCERS; i++) {
+        args[i] = (producer_arg_t){ queue, (uint32_t)i, MPSC_ITEMS };
+        pthread_create(&threads[i], NULL, producer_thread, &args[i]);
+    }
+
+    uint32_t next[MPSC_PRODUCERS] = { 0 };
+    uint32_t received = 0;
+    uint32_t out_of_order = 0;
+    void* item;
+    while (received < MPSC_PRODUCERS * MPSC_ITEMS && libmedia_queue_pop(queue, &item, 2000) == 1) {
+        uint32_t producer = ITEM_PRODUCER(item);
+        if (producer >= MPSC_PRODUCERS || ITEM_SEQ(item) != next[producer]) {
+            out_of_order++;
+        } else {
+            next[producer]++;
+        }
+        received++;
+    }
+    for (int i = 0; i < MPSC_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    CHECK(received == MPSC_PRODUCERS * MPSC_ITEMS, "%u of %u items received", received,
+          MPSC_PRODUCERS * MPSC_ITEMS);
+    CHECK(out_of_order == 0, "%u items out of producer order", out_of_order);
+    libmedia_queue_destroy(queue);
+}
+
+typedef struct {
+    media_ring_t* ring;
+    int push_failures;
+} ring_arg_t;
+
+/**
+ * @brief Take an item and put it straight back, like pool acquire and release
+ */
+static void* ring_thread(void* arg)
+{
+    ring_arg_t* r = arg;
+    for (int i = 0; i < RING_ROUNDS; i++) {
+        void* item;
+        while (!(item = media_ring_pop(r->ring))) {
+            sched_yield();
+        }
+        if (media_ring_push(r->ring, item) < 0) {
+            // The item is lost, as a pool buffer would be; stop before the others run dry
+            r->push_failures++;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void test_mpmc_ring(void)
+{
+    printf("mpmc ring %d threads x %d rounds\n", RING_THREADS, RING_ROUNDS);
+
+    media_ring_t ring;
+    if (media_ring_init(&ring, MEDIA_RING_MULTI_PRODUCER | MEDIA_RING_MULTI_CONSUMER, 8) < 0) {
+        CHECK(0, "ring init failed");
+        return;
+    }
+    uint32_t capacity = media_ring_capacity(&ring);
+    for (uint32_t i = 0; i < capacity; i++) {
+        CHECK(media_ring_push(&ring, ITEM(0, i)) == 0, "filling push %u failed", i);
+    }
+    CHECK(media_ring_push(&ring, ITEM(0, capacity)) < 0, "push into a full ring succeeded");
+
+    ring_arg_t args[RING_THREADS];
+    pthread_t threads[RING_THREADS];
+    for (int i = 0; i < RING_THREADS; i++) {
+        args[i] = (ring_arg_t){ &ring, 0 };
+        pthread_create(&threads[i], NULL, ring_thread, &args[i]);
+    }
+    int push_failures = 0;
+    for (int i = 0; i < RING_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        push_failures += args[i].push_failures;
+    }
+    CHECK(push_failures == 0, "%d pushes into a ring that was not full failed", push_failures);
+
+    // Every item is still there exactly once
+    uint32_t seen = 0;
+    void* item;
+    while ((item = media_ring_pop(&ring))) {
+        seen |= 1u << ITEM_SEQ(item);
+    }
+    CHECK(seen == (1u << capacity) - 1, "items left 0x%x, expected 0x%x", seen, (1u << capacity) - 1);
+    media_ring_free(&ring);
+}
+
+static void test_event_fd(uint32_t count)
+{
+    printf("eventfd spsc %u items\n", count);
+
+    media_queue_t* queue = libmedia_queue_create(MEDIA_QUEUE_SPSC, 256);
+    int fd = queue ? libmedia_queue_get_fd(queue) : -1;
+    CHECK(queue && fd >= 0, "create failed: %d", libmedia_get_last_error());
+    if (fd < 0) {
+        libmedia_queue_destroy(queue);
+        return;
+    }
+    CHECK(libmedia_queue_get_fd(queue) == fd, "second get_fd returned another descriptor");
+
+    producer_arg_t arg = { queue, 0, count };
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer_thread, &arg);
+
+    uint32_t received = 0;
+    uint32_t out_of_order = 0;
+    uint32_t wakeups = 0;
+    void* item;
+    while (received < count) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, 2000) <= 0) {
+            CHECK(0, "lost wakeup: poll timed out with %u of %u items received", received, count);
+            break;
+        }
+        wakeups++;
+        while (libmedia_queue_pop(queue, &item, 0) == 1) {
+            out_of_order += ITEM_SEQ(item) != (received & 0xFFFFFF);
+            received++;
+        }
+    }
+
+    // After a failure, unblock the producer before joining it
+    while (received < count && libmedia_queue_pop(queue, &item, 1000) == 1) {
+        received++;
+    }
+    pthread_join(thread, NULL);
+
+    printf("  %u wakeups\n", wakeups);
+    CHECK(received == count, "%u of %u items received", received, count);
+    CHECK(out_of_order == 0, "%u items out of order", out_of_order);
+    libmedia_queue_destroy(queue);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t event_items = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 2000000u;
+
+    test_single_thread();
+    test_spsc();
+    test_mpsc();
+    test_mpmc_ring();
+    test_event_fd(event_items);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
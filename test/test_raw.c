@@ -0,0 +1,294 @@
+/**
+ * @file test_raw.c
+ * @brief Raw pack/unpack round trips and 2x2 binning
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Random samples of every bit depth are packed into each raw container,
+ * 8/10/12/16-bit and MIPI RAW10P/RAW12P, and unpacked again; the round trip
+ * must return the same samples, at widths that end mid-group for the packed
+ * formats. The packed byte layout is checked against hand-built groups,
+ * bit-depth conversion against shifts of the input, and 2x2 binning
+ * against a direct same-colour average.
+ */
+
+#include "media_raw.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+/**
+ * @brief 16-bit plane with some row padding
+ */
+static media_plane_t plane16_alloc(uint32_t width, uint32_t height)
+{
+    uint32_t stride = (width + 8) * sizeof(uint16_t);
+    return (media_plane_t){ calloc(height, stride), width, height, stride };
+}
+
+/**
+ * @brief Raw plane of a format, padded rows filled with a marker byte
+ */
+static media_plane_t raw_alloc(uint32_t format, uint32_t width, uint32_t height)
+{
+    uint32_t stride = (uint32_t)libmedia_get_line_bytes(format, width) + 7;
+    void* data = malloc((size_t)height * stride);
+    if (data) {
+        memset(data, 0xA5, (size_t)height * stride);
+    }
+    return (media_plane_t){ data, width, height, stride };
+}
+
+static inline uint16_t* sample(const media_plane_t* p, uint32_t x, uint32_t y)
+{
+    return (uint16_t*)((uint8_t*)p->data + (size_t)y * p->stride) + x;
+}
+
+static void fill_random(media_plane_t* p, uint32_t bits, uint32_t seed)
+{
+    uint32_t state = seed;
+    for (uint32_t y = 0; y < p->height; y++) {
+        for (uint32_t x = 0; x < p->width; x++) {
+            state = state * 1103515245u + 12345u;
+            *sample(p, x, y) = (uint16_t)((state >> 8) & ((1u << bits) - 1));
+        }
+    }
+}
+
+/**
+ * @brief Count samples of b that differ from a after a shift
+ */
+static int count_mismatches(const media_plane_t* a, const media_plane_t* b, int shift)
+{
+    int mismatches = 0;
+    for (uint32_t y = 0; y < a->height; y++) {
+        for (uint32_t x = 0; x < a->width; x++) {
+            uint32_t v = *sample(a, x, y);
+            uint32_t expected = shift >= 0 ? v << shift : v >> -shift;
+            mismatches += *sample(b, x, y) != expected;
+        }
+    }
+    return mismatches;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static void test_formats(void)
+{
+    printf("format mapping\n");
+
+    CHECK(libmedia_raw_unpacked_format(V4L2_PIX_FMT_SGRBG10P) == V4L2_PIX_FMT_SGRBG10, "SGRBG10P unpacked");
+    CHECK(libmedia_raw_unpacked_format(V4L2_PIX_FMT_SBGGR12P) == V4L2_PIX_FMT_SBGGR12, "SBGGR12P unpacked");
+    CHECK(libmedia_raw_unpacked_format(V4L2_PIX_FMT_SRGGB8) == V4L2_PIX_FMT_SRGGB8, "SRGGB8 unpacked");
+    CHECK(libmedia_raw_unpacked_format(V4L2_PIX_FMT_NV12) == 0, "NV12 treated as raw");
+    CHECK(libmedia_raw_packed_format(V4L2_PIX_FMT_SGBRG12) == V4L2_PIX_FMT_SGBRG12P, "SGBRG12 packed");
+    CHECK(libmedia_raw_packed_format(V4L2_PIX_FMT_SRGGB10P) == V4L2_PIX_FMT_SRGGB10P, "SRGGB10P packed");
+    CHECK(libmedia_raw_packed_format(V4L2_PIX_FMT_SBGGR16) == 0, "SBGGR16 has a packed format");
+}
+
+static void test_round_trips(void)
+{
+    printf("pack/unpack round trips\n");
+
+    static const struct {
+        uint32_t format;
+        uint32_t bits;
+    } formats[] = {
+        { V4L2_PIX_FMT_SRGGB8, 8 },
+        { V4L2_PIX_FMT_SGRBG10, 10 },
+        { V4L2_PIX_FMT_SGBRG12, 12 },
+        { V4L2_PIX_FMT_SBGGR16, 16 },
+        { V4L2_PIX_FMT_SBGGR10P, 10 },
+        { V4L2_PIX_FMT_SRGGB10P, 10 },
+        { V4L2_PIX_FMT_SGRBG12P, 12 },
+        { V4L2_PIX_FMT_SGBRG12P, 12 },
+    };
+    static const uint32_t widths[] = { 1, 2, 3, 5, 6, 37, 38, 39, 40, 641 };
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        const char* name = libmedia_get_format_name(formats[f].format);
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            uint32_t width = widths[w], height = 5;
+            media_plane_t in = plane16_alloc(width, height);
+            media_plane_t out = plane16_alloc(width, height);
+            media_plane_t raw = raw_alloc(formats[f].format, width, height);
+            if (!in.data || !out.data || !raw.data) {
+                CHECK(0, "allocation failed");
+                free(in.data);
+                free(out.data);
+                free(raw.data);
+                return;
+            }
+            fill_random(&in, formats[f].bits, (uint32_t)(f * 131 + width));
+
+            CHECK(libmedia_raw_pack(&in, formats[f].bits, &raw, formats[f].format) == 0, "%s pack failed", name);
+            CHECK(libmedia_raw_unpack(&raw, formats[f].format, &out) == 0, "%s unpack failed", name);
+            int mismatches = count_mismatches(&in, &out, 0);
+            CHECK(mismatches == 0, "%s width %u: %d samples changed by the round trip", name, width, mismatches);
+
+            // Row padding past the line stays untouched
+            size_t line = libmedia_get_line_bytes(formats[f].format, width);
+            int padding = 0;
+            for (uint32_t y = 0; y < height; y++) {
+                const uint8_t* row = (const uint8_t*)raw.data + (size_t)y * raw.stride;
+                for (size_t i = line; i < raw.stride; i++) {
+                    padding += row[i] != 0xA5;
+                }
+            }
+            CHECK(padding == 0, "%s width %u: %d padding bytes written", name, width, padding);
+
+            free(in.data);
+            free(out.data);
+            free(raw.data);
+        }
+    }
+}
+
+static void test_packed_layout(void)
+{
+    printf("packed byte layout\n");
+
+    // RAW10: P0[9:2] P1[9:2] P2[9:2] P3[9:2] (P3[1:0] P2[1:0] P1[1:0] P0[1:0]); last group zero padded
+    uint16_t in10[6] = { 0x3FF, 0x001, 0x2AA, 0x155, 0x202, 0x0FD };
+    uint8_t raw10[10];
+    media_plane_t src = { in10, 6, 1, sizeof(in10) };
+    media_plane_t dst = { raw10, 6, 1, sizeof(raw10) };
+    const uint8_t expected10[10] = { 0xFF, 0x00, 0xAA, 0x55, 0x67, 0x80, 0x3F, 0x00, 0x00, 0x06 };
+    CHECK(libmedia_raw_pack(&src, 10, &dst, V4L2_PIX_FMT_SRGGB10P) == 0 && memcmp(raw10, expected10, 10) == 0,
+          "RAW10P bytes %02x %02x %02x %02x %02x | %02x %02x %02x %02x %02x", raw10[0], raw10[1], raw10[2],
+          raw10[3], raw10[4], raw10[5], raw10[6], raw10[7], raw10[8], raw10[9]);
+
+    // RAW12: P0[11:4] P1[11:4] (P1[3:0] P0[3:0]); odd tail keeps P1 zero
+    uint16_t in12[3] = { 0xABC, 0x123, 0xF0E };
+    uint8_t raw12[6];
+    src = (media_plane_t){ in12, 3, 1, sizeof(in12) };
+    dst = (media_plane_t){ raw12, 3, 1, sizeof(raw12) };
+    const uint8_t expected12[6] = { 0xAB, 0x12, 0x3C, 0xF0, 0x00, 0x0E };
+    CHECK(libmedia_raw_pack(&src, 12, &dst, V4L2_PIX_FMT_SBGGR12P) == 0 && memcmp(raw12, expected12, 6) == 0,
+          "RAW12P bytes %02x %02x %02x | %02x %02x %02x", raw12[0], raw12[1], raw12[2], raw12[3], raw12[4], raw12[5]);
+}
+
+static void test_depth_conversion(void)
+{
+    printf("bit depth conversion\n");
+
+    static const struct {
+        uint32_t src_bits;
+        uint32_t format;
+        uint32_t bits;
+    } cases[] = {
+        { 12, V4L2_PIX_FMT_SRGGB10P, 10 },
+        { 16, V4L2_PIX_FMT_SRGGB8, 8 },
+        { 8, V4L2_PIX_FMT_SGRBG12P, 12 },
+        { 10, V4L2_PIX_FMT_SBGGR16, 16 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        media_plane_t in = plane16_alloc(70, 4);
+        media_plane_t out = plane16_alloc(70, 4);
+        media_plane_t raw = raw_alloc(cases[i].format, 70, 4);
+        if (in.data && out.data && raw.data) {
+            fill_random(&in, cases[i].src_bits, (uint32_t)i + 1);
+            CHECK(libmedia_raw_pack(&in, cases[i].src_bits, &raw, cases[i].format) == 0 &&
+                  libmedia_raw_unpack(&raw, cases[i].format, &out) == 0, "%u-bit to %s failed", cases[i].src_bits,
+                  libmedia_get_format_name(cases[i].format));
+            int mismatches = count_mismatches(&in, &out, (int)cases[i].bits - (int)cases[i].src_bits);
+            CHECK(mismatches == 0, "%u-bit to %s: %d samples not shifted", cases[i].src_bits,
+                  libmedia_get_format_name(cases[i].format), mismatches);
+        }
+        free(in.data);
+        free(out.data);
+        free(raw.data);
+    }
+}
+
+static void test_bin2x2(void)
+{
+    printf("2x2 binning\n");
+
+    const uint32_t width = 40, height = 24;
+    media_plane_t in = plane16_alloc(width, height);
+    media_plane_t raw = raw_alloc(V4L2_PIX_FMT_SGRBG10P, width, height);
+    media_plane_t out = plane16_alloc(width / 2, height / 2);
+    if (!in.data || !raw.data || !out.data) {
+        CHECK(0, "allocation failed");
+        free(in.data);
+        free(raw.data);
+        free(out.data);
+        return;
+    }
+    fill_random(&in, 10, 99);
+    CHECK(libmedia_raw_pack(&in, 10, &raw, V4L2_PIX_FMT_SGRBG10P) == 0, "pack failed");
+    CHECK(libmedia_raw_bin2x2(&raw, V4L2_PIX_FMT_SGRBG10P, &out) == 0, "bin failed: %d", libmedia_get_last_error());
+
+    // Output (x, y) averages the four nearest source samples of the same Bayer phase
+    int mismatches = 0;
+    for (uint32_t y = 0; y < height / 2; y++) {
+        for (uint32_t x = 0; x < width / 2; x++) {
+            uint32_t sx = (x >> 1) * 4 + (x & 1);
+            uint32_t sy = (y >> 1) * 4 + (y & 1);
+            uint32_t sum = *sample(&in, sx, sy) + *sample(&in, sx + 2, sy) +
+                           *sample(&in, sx, sy + 2) + *sample(&in, sx + 2, sy + 2);
+            mismatches += *sample(&out, x, y) != (sum + 2) >> 2;
+        }
+    }
+    CHECK(mismatches == 0, "%d binned samples differ from the same-colour average", mismatches);
+
+    media_plane_t odd = { raw.data, 38, height, raw.stride };
+    CHECK(libmedia_raw_bin2x2(&odd, V4L2_PIX_FMT_SGRBG10P, &out) < 0, "width not a multiple of 4 accepted");
+
+    free(in.data);
+    free(raw.data);
+    free(out.data);
+}
+
+static void test_errors(void)
+{
+    printf("invalid planes\n");
+
+    media_plane_t in = plane16_alloc(64, 2);
+    media_plane_t raw = raw_alloc(V4L2_PIX_FMT_SRGGB12P, 64, 2);
+
+    media_plane_t short_stride = raw;
+    short_stride.stride = (uint32_t)libmedia_get_line_bytes(V4L2_PIX_FMT_SRGGB12P, 64) - 1;
+    CHECK(libmedia_raw_pack(&in, 12, &short_stride, V4L2_PIX_FMT_SRGGB12P) < 0, "short packed stride accepted");
+    CHECK(libmedia_raw_pack(&in, 7, &raw, V4L2_PIX_FMT_SRGGB12P) < 0, "7-bit source accepted");
+    CHECK(libmedia_raw_pack(&in, 12, &raw, V4L2_PIX_FMT_NV12) < 0, "NV12 destination accepted");
+    media_plane_t wide = { in.data, MEDIA_RAW_MAX_WIDTH + 2, 1, (MEDIA_RAW_MAX_WIDTH + 2) * 2 };
+    CHECK(libmedia_raw_unpack(&wide, V4L2_PIX_FMT_SRGGB16, &wide) < 0, "line wider than the limit accepted");
+    media_plane_t half = { in.data, 32, 2, in.stride };
+    CHECK(libmedia_raw_unpack(&raw, V4L2_PIX_FMT_SRGGB12P, &half) < 0 &&
+          libmedia_get_last_error() == MEDIA_ERROR_INVALID_PARAM, "size mismatch accepted");
+
+    free(in.data);
+    free(raw.data);
+}
+
+int main(void)
+{
+    test_formats();
+    test_round_trips();
+    test_packed_layout();
+    test_depth_conversion();
+    test_bin2x2();
+    test_errors();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
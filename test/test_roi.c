@@ -0,0 +1,237 @@
+/**
+ * @file test_roi.c
+ * @brief Multi-ROI extraction against a direct box filter
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Overlapping regions of a random NV12 and a random GREY frame are
+ * extracted in one plan: crops, box downscales with odd factors and odd
+ * origins, and a whole-frame scale of 8. Every output sample, luma and
+ * interleaved chroma, must equal the rounded mean of its source box. Plan
+ * creation must reject regions outside the frame, including ones whose end
+ * wraps past UINT32_MAX, and execution must reject frames that do not match
+ * the plan.
+ */
+
+#include "media_proc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Reference
+// ============================================================================
+
+/**
+ * @brief Rounded mean of a scale x scale box, same Q16 rounding as the plan
+ */
+static uint8_t box_mean(const uint8_t* plane, uint32_t stride, uint32_t x0, uint32_t y0, uint32_t scale,
+                        uint32_t step)
+{
+    uint32_t sum = 0;
+    for (uint32_t j = 0; j < scale; j++) {
+        for (uint32_t i = 0; i < scale; i++) {
+            sum += plane[(size_t)(y0 + j) * stride + x0 + i * step];
+        }
+    }
+    uint32_t reciprocal = (65536 + scale * scale / 2) / (scale * scale);
+    return scale == 1 ? (uint8_t)sum : (uint8_t)((sum * reciprocal + (1u << 15)) >> 16);
+}
+
+/**
+ * @brief Count output samples that differ from the box filter of their source area
+ */
+static int reference_errors(const media_frame_t* src, const media_roi_spec_t* spec, const media_frame_t* out)
+{
+    const uint8_t* luma = src->data;
+    const uint8_t* dst = out->data;
+    int errors = 0;
+
+    for (uint32_t y = 0; y < out->height; y++) {
+        for (uint32_t x = 0; x < out->width; x++) {
+            uint8_t expected = box_mean(luma, src->width, spec->rect.x + x * spec->scale,
+                                        spec->rect.y + y * spec->scale, spec->scale, 1);
+            errors += dst[(size_t)y * out->width + x] != expected;
+        }
+    }
+    if (spec->pixelformat != V4L2_PIX_FMT_NV12) {
+        return errors;
+    }
+
+    // Interleaved UV: output byte i holds channel i % 2 of chroma sample i / 2
+    const uint8_t* chroma = luma + (size_t)src->width * src->height;
+    const uint8_t* dst_uv = dst + (size_t)out->width * out->height;
+    for (uint32_t y = 0; y < out->height / 2; y++) {
+        for (uint32_t i = 0; i < out->width; i++) {
+            uint32_t x0 = spec->rect.x + (i / 2) * spec->scale * 2 + (i % 2);
+            uint8_t expected = box_mean(chroma, src->width, x0, spec->rect.y / 2 + y * spec->scale, spec->scale, 2);
+            errors += dst_uv[(size_t)y * out->width + i] != expected;
+        }
+    }
+    return errors;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+#define SRC_WIDTH 96
+#define SRC_HEIGHT 64
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static void fill_random(uint8_t* data, size_t size, uint32_t seed)
+{
+    uint32_t state = seed;
+    for (size_t i = 0; i < size; i++) {
+        state = state * 1103515245u + 12345u;
+        data[i] = (uint8_t)(state >> 16);
+    }
+}
+
+static void run_plan(uint32_t src_format, const media_roi_spec_t* specs, int count, const uint32_t (*sizes)[2])
+{
+    size_t luma = SRC_WIDTH * SRC_HEIGHT;
+    size_t size = src_format == V4L2_PIX_FMT_NV12 ? luma * 3 / 2 : luma;
+    uint8_t* data = malloc(size);
+    media_roi_plan_t* plan = libmedia_roi_plan_create(SRC_WIDTH, SRC_HEIGHT, src_format, specs, count);
+    CHECK(plan, "%s plan failed: %d", libmedia_get_format_name(src_format), libmedia_get_last_error());
+    if (!plan || !data) {
+        libmedia_roi_plan_destroy(plan);
+        free(data);
+        return;
+    }
+    fill_random(data, size, src_format);
+
+    media_frame_t src = { .data = data, .size = size, .width = SRC_WIDTH, .height = SRC_HEIGHT,
+                          .pixelformat = src_format, .timestamp = 123456789, .frame_id = 5, .sequence = 42 };
+    media_frame_t outputs[MEDIA_ROI_MAX_OUTPUTS];
+    memset(outputs, 0, sizeof(outputs));
+    for (int i = 0; i < count; i++) {
+        uint32_t w, h;
+        size_t bytes = libmedia_roi_plan_get_output(plan, i, &w, &h);
+        CHECK(w == sizes[i][0] && h == sizes[i][1], "output %d is %ux%u, expected %ux%u", i, w, h,
+              sizes[i][0], sizes[i][1]);
+        CHECK(bytes == (size_t)w * h * (specs[i].pixelformat == V4L2_PIX_FMT_NV12 ? 3 : 2) / 2,
+              "output %d needs %zu bytes", i, bytes);
+        outputs[i].data = malloc(bytes);
+    }
+
+    CHECK(libmedia_roi_plan_execute(plan, &src, outputs) == 0, "execute failed: %d", libmedia_get_last_error());
+    for (int i = 0; i < count; i++) {
+        CHECK(outputs[i].pixelformat == specs[i].pixelformat && outputs[i].timestamp == src.timestamp &&
+              outputs[i].frame_id == src.frame_id && outputs[i].sequence == src.sequence,
+              "output %d frame fields not filled in", i);
+        int errors = reference_errors(&src, &specs[i], &outputs[i]);
+        CHECK(errors == 0, "output %d (%ux%u+%u+%u / %u): %d samples differ from the box filter", i,
+              specs[i].rect.width, specs[i].rect.height, specs[i].rect.x, specs[i].rect.y, specs[i].scale, errors);
+    }
+
+    // A second frame through the same plan starts from clean accumulators
+    fill_random(data, size, src_format + 1);
+    CHECK(libmedia_roi_plan_execute(plan, &src, outputs) == 0, "second execute failed");
+    for (int i = 0; i < count; i++) {
+        CHECK(reference_errors(&src, &specs[i], &outputs[i]) == 0, "output %d wrong on the second frame", i);
+        free(outputs[i].data);
+    }
+
+    // Frames that do not match the plan
+    media_frame_t other = src;
+    other.width = SRC_WIDTH / 2;
+    CHECK(libmedia_roi_plan_execute(plan, &other, outputs) < 0, "frame of another size accepted");
+    other = src;
+    other.size = size - 1;
+    CHECK(libmedia_roi_plan_execute(plan, &other, outputs) < 0 && libmedia_get_last_error() == MEDIA_ERROR_BUFFER_ERROR,
+          "short frame accepted");
+    outputs[0].data = NULL;
+    CHECK(libmedia_roi_plan_execute(plan, &src, outputs) < 0, "output without a buffer accepted");
+
+    libmedia_roi_plan_destroy(plan);
+    free(data);
+}
+
+static void test_nv12(void)
+{
+    printf("nv12 source\n");
+    const media_roi_spec_t specs[] = {
+        { { 8, 6, 32, 20 }, 1, V4L2_PIX_FMT_NV12 },
+        { { 2, 4, 64, 40 }, 4, V4L2_PIX_FMT_NV12 },
+        { { 1, 3, 45, 33 }, 3, V4L2_PIX_FMT_GREY },
+        { { 0, 0, SRC_WIDTH, SRC_HEIGHT }, 8, V4L2_PIX_FMT_NV12 },
+        { { 50, 10, 46, 54 }, 3, V4L2_PIX_FMT_NV12 },
+    };
+    const uint32_t sizes[][2] = { { 32, 20 }, { 16, 10 }, { 15, 11 }, { 12, 8 }, { 14, 18 } };
+    run_plan(V4L2_PIX_FMT_NV12, specs, 5, sizes);
+}
+
+static void test_grey(void)
+{
+    printf("grey source\n");
+    const media_roi_spec_t specs[] = {
+        { { 3, 5, 7, 9 }, 1, V4L2_PIX_FMT_GREY },
+        { { 11, 1, 80, 60 }, 5, V4L2_PIX_FMT_GREY },
+        { { 94, 62, 2, 2 }, 2, V4L2_PIX_FMT_GREY },
+    };
+    const uint32_t sizes[][2] = { { 7, 9 }, { 16, 12 }, { 1, 1 } };
+    run_plan(V4L2_PIX_FMT_GREY, specs, 3, sizes);
+}
+
+static void test_rejects(void)
+{
+    printf("invalid plans\n");
+
+    const struct {
+        uint32_t src_format;
+        media_roi_spec_t spec;
+        const char* what;
+    } cases[] = {
+        { V4L2_PIX_FMT_NV12, { { 90, 0, 8, 8 }, 1, V4L2_PIX_FMT_GREY }, "rect past the right edge" },
+        { V4L2_PIX_FMT_NV12, { { 0, 60, 8, 8 }, 1, V4L2_PIX_FMT_GREY }, "rect past the bottom edge" },
+        { V4L2_PIX_FMT_NV12, { { UINT32_MAX - 3, 0, 8, 8 }, 1, V4L2_PIX_FMT_GREY }, "x + width wrapping" },
+        { V4L2_PIX_FMT_NV12, { { 0, UINT32_MAX - 1, 8, 8 }, 1, V4L2_PIX_FMT_GREY }, "y + height wrapping" },
+        { V4L2_PIX_FMT_NV12, { { 1, 0, 8, 8 }, 1, V4L2_PIX_FMT_NV12 }, "odd NV12 origin" },
+        { V4L2_PIX_FMT_GREY, { { 0, 0, 8, 8 }, 1, V4L2_PIX_FMT_NV12 }, "NV12 output from GREY" },
+        { V4L2_PIX_FMT_NV12, { { 0, 0, 8, 8 }, 0, V4L2_PIX_FMT_GREY }, "scale 0" },
+        { V4L2_PIX_FMT_NV12, { { 0, 0, 64, 64 }, MEDIA_ROI_MAX_SCALE + 1, V4L2_PIX_FMT_GREY }, "scale 9" },
+        { V4L2_PIX_FMT_NV12, { { 0, 0, 3, 8 }, 4, V4L2_PIX_FMT_GREY }, "rect narrower than the scale" },
+        { V4L2_PIX_FMT_NV12, { { 0, 0, 8, 8 }, 1, V4L2_PIX_FMT_YUYV }, "YUYV output" },
+        { V4L2_PIX_FMT_YUYV, { { 0, 0, 8, 8 }, 1, V4L2_PIX_FMT_GREY }, "YUYV source" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        media_roi_plan_t* plan = libmedia_roi_plan_create(SRC_WIDTH, SRC_HEIGHT, cases[i].src_format, &cases[i].spec, 1);
+        CHECK(!plan, "%s accepted", cases[i].what);
+        libmedia_roi_plan_destroy(plan);
+    }
+
+    media_roi_spec_t specs[MEDIA_ROI_MAX_OUTPUTS + 1];
+    for (int i = 0; i <= MEDIA_ROI_MAX_OUTPUTS; i++) {
+        specs[i] = (media_roi_spec_t){ { 0, 0, 8, 8 }, 1, V4L2_PIX_FMT_GREY };
+    }
+    CHECK(!libmedia_roi_plan_create(SRC_WIDTH, SRC_HEIGHT, V4L2_PIX_FMT_GREY, specs, 0), "no regions accepted");
+    CHECK(!libmedia_roi_plan_create(SRC_WIDTH, SRC_HEIGHT, V4L2_PIX_FMT_GREY, specs, MEDIA_ROI_MAX_OUTPUTS + 1),
+          "%d regions accepted", MEDIA_ROI_MAX_OUTPUTS + 1);
+    media_roi_plan_t* plan = libmedia_roi_plan_create(SRC_WIDTH, SRC_HEIGHT, V4L2_PIX_FMT_GREY, specs,
+                                                      MEDIA_ROI_MAX_OUTPUTS);
+    CHECK(plan, "%d regions rejected", MEDIA_ROI_MAX_OUTPUTS);
+    CHECK(libmedia_roi_plan_get_output(plan, MEDIA_ROI_MAX_OUTPUTS, NULL, NULL) == 0, "output index past the end");
+    libmedia_roi_plan_destroy(plan);
+}
+
+int main(void)
+{
+    test_nv12();
+    test_grey();
+    test_rejects();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file test_sync.c
+ * @brief Cross-camera set matching and straggler drops
+ * @version 1.0.0
+ * @date 2025-07-01
+ *
+ * Streams of synthetic frames at 30 fps with small timestamp jitter are
+ * pushed into a synchronizer. libmedia_session_release_frame is wrapped
+ * (--wrap) so the test sees every frame given back to its session. Sets
+ * must pair frames of the same exposure, a frame whose partner never came
+ * must be dropped as a straggler, a stream that runs ahead must lose its
+ * oldest frames beyond max_pending, and sequence matching must drop the
+ * frames around a gap and resynchronize after a set that fails the
+ * timestamp check. Every frame pushed is released exactly once, unless the
+ * set callback keeps it.
+ */
+
+#include "media_sync.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Session Stub (--wrap)
+// ============================================================================
+
+#define MAX_FRAMES 256
+#define PERIOD_NS 33333333ull
+#define TOLERANCE_NS 1000000ull
+
+static int g_released[MAX_FRAMES];      /**< Release count per frame_id */
+static int g_release_total;
+static int g_session;                   /**< Stands in for a media_session_t */
+#define SESSION ((media_session_t*)&g_session)
+
+int __wrap_libmedia_session_release_frame(media_session_t* session, media_frame_t* frame)
+{
+    if (session == SESSION && frame->frame_id < MAX_FRAMES) {
+        g_released[frame->frame_id]++;
+    }
+    g_release_total++;
+    return 0;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static int failures;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+/** @brief frame_id of exposure k on a stream */
+#define FRAME_ID(stream, k) ((uint32_t)((stream) * 64 + (k)))
+
+typedef struct {
+    int sets;
+    int mismatched;             /**< Sets whose frames belong to different exposures */
+    int keep;                   /**< Callback return value */
+    uint32_t last_ids[MEDIA_SYNC_MAX_STREAMS];
+} set_log_t;
+
+static int on_set(void* user_data, media_sync_set_t* set)
+{
+    set_log_t* log = user_data;
+    uint32_t exposure = set->frames[0].frame_id % 64;
+    for (int i = 0; i < set->count; i++) {
+        log->mismatched += set->frames[i].frame_id != FRAME_ID(i, exposure) || set->sessions[i] != SESSION;
+        log->last_ids[i] = set->frames[i].frame_id;
+    }
+    log->sets++;
+    return log->keep;
+}
+
+static void reset_releases(void)
+{
+    memset(g_released, 0, sizeof(g_released));
+    g_release_total = 0;
+}
+
+/**
+ * @brief Push exposure k of a stream: 30 fps plus jitter, sequence offset per stream
+ */
+static int push(media_sync_t* sync, int stream, uint32_t k, int64_t jitter_ns)
+{
+    media_frame_t frame = { 0 };
+    frame.frame_id = FRAME_ID(stream, k);
+    frame.timestamp = (uint64_t)((int64_t)(1000000000ull + k * PERIOD_NS) + jitter_ns);
+    frame.sequence = k + (uint32_t)stream * 1000;
+    return libmedia_sync_push(sync, stream, SESSION, &frame);
+}
+
+static void test_timestamp_matching(void)
+{
+    printf("timestamp matching\n");
+    reset_releases();
+
+    set_log_t log = { 0 };
+    media_sync_config_t config = { 2, TOLERANCE_NS, 3, 0, on_set, &log };
+    media_sync_t* sync = libmedia_sync_create(&config);
+    CHECK(sync, "create failed");
+    if (!sync) {
+        return;
+    }
+
+    // Stream 1 lags by up to 400 us and never delivers exposure 5
+    int pushed = 0;
+    for (uint32_t k = 0; k < 20; k++) {
+        push(sync, 0, k, 0);
+        pushed++;
+        if (k != 5) {
+            push(sync, 1, k, (int64_t)(k % 5) * 100000);
+            pushed++;
+        }
+    }
+
+    media_sync_stats_t stats;
+    libmedia_sync_get_stats(sync, &stats);
+    CHECK(log.sets == 19 && stats.sets == 19, "%d sets delivered, expected 19", log.sets);
+    CHECK(log.mismatched == 0, "%d sets paired different exposures", log.mismatched);
+    CHECK(stats.dropped[0] == 1 && stats.dropped[1] == 0, "dropped %llu / %llu, expected the lone exposure 5",
+          (unsigned long long)stats.dropped[0], (unsigned long long)stats.dropped[1]);
+    CHECK(g_released[FRAME_ID(0, 5)] == 1, "straggler not released");
+    CHECK(stats.skew_max_ns == 400000 && stats.skew_last_ns == 400000 && stats.skew_mean_ns > 0 &&
+          stats.skew_mean_ns < 400000, "skew last %llu max %llu mean %llu", (unsigned long long)stats.skew_last_ns,
+          (unsigned long long)stats.skew_max_ns, (unsigned long long)stats.skew_mean_ns);
+
+    // A stream that runs ahead keeps only max_pending frames
+    for (uint32_t k = 20; k < 25; k++) {
+        push(sync, 0, k, 0);
+        pushed++;
+    }
+    libmedia_sync_get_stats(sync, &stats);
+    CHECK(stats.dropped[0] == 3 && g_released[FRAME_ID(0, 20)] == 1 && g_released[FRAME_ID(0, 21)] == 1 &&
+          !g_released[FRAME_ID(0, 22)], "stream ahead: %llu dropped", (unsigned long long)stats.dropped[0]);
+
+    // Its partner arrives late: the oldest held frame no longer fits, 22 does
+    push(sync, 1, 22, 0);
+    pushed++;
+    CHECK(log.sets == 20 && log.last_ids[0] == FRAME_ID(0, 22), "late partner did not complete a set");
+
+    libmedia_sync_destroy(sync);
+    int wrong = 0;
+    for (int i = 0; i < MAX_FRAMES; i++) {
+        wrong += g_released[i] > 1;
+    }
+    CHECK(g_release_total == pushed && wrong == 0, "%d releases for %d frames, %d released twice",
+          g_release_total, pushed, wrong);
+}
+
+static void test_sequence_matching(void)
+{
+    printf("sequence matching\n");
+    reset_releases();
+
+    set_log_t log = { 0 };
+    media_sync_config_t config = { 3, TOLERANCE_NS, 4, 1, on_set, &log };
+    media_sync_t* sync = libmedia_sync_create(&config);
+    CHECK(sync, "create failed");
+    if (!sync) {
+        return;
+    }
+
+    // Stream 2 skips exposure 3, stream 1's exposure 8 is 5 ms late
+    int pushed = 0;
+    for (uint32_t k = 0; k < 12; k++) {
+        for (int s = 0; s < 3; s++) {
+            if (s == 2 && k == 3) {
+                continue;
+            }
+            push(sync, s, k, s == 1 && k == 8 ? 5000000 : s * 50000);
+            pushed++;
+        }
+    }
+
+    media_sync_stats_t stats;
+    libmedia_sync_get_stats(sync, &stats);
+    CHECK(log.mismatched == 0, "%d sets paired different exposures", log.mismatched);
+    CHECK(g_released[FRAME_ID(0, 3)] == 1 && g_released[FRAME_ID(1, 3)] == 1,
+          "frames around the gap not dropped");
+    CHECK(stats.resyncs == 1, "%llu resyncs, expected 1", (unsigned long long)stats.resyncs);
+    CHECK(g_released[FRAME_ID(0, 8)] == 1 && g_released[FRAME_ID(1, 8)] == 1 && g_released[FRAME_ID(2, 8)] == 1,
+          "set failing the timestamp check not dropped");
+    CHECK(log.sets == 10 && log.last_ids[2] == FRAME_ID(2, 11), "%d sets, last exposure %u", log.sets,
+          log.last_ids[2] % 64);
+
+    libmedia_sync_destroy(sync);
+    CHECK(g_release_total == pushed, "%d releases for %d frames", g_release_total, pushed);
+}
+
+static void test_ownership(void)
+{
+    printf("ownership\n");
+    reset_releases();
+
+    set_log_t log = { .keep = 1 };
+    media_sync_config_t config = { 2, TOLERANCE_NS, 0, 0, on_set, &log };
+    media_sync_t* sync = libmedia_sync_create(&config);
+    CHECK(sync, "create failed");
+    if (!sync) {
+        return;
+    }
+
+    push(sync, 0, 0, 0);
+    CHECK(push(sync, 1, 0, 0) == 1, "set not delivered");
+    CHECK(g_release_total == 0, "frames kept by the callback were released");
+
+    // Invalid stream: the frame is still given back
+    CHECK(push(sync, 2, 1, 0) < 0 && g_released[FRAME_ID(2, 1)] == 1, "frame for stream 2 not released");
+
+    push(sync, 0, 1, 0);
+    CHECK(libmedia_sync_flush(sync) == 0 && g_released[FRAME_ID(0, 1)] == 1, "flush did not release held frames");
+    libmedia_sync_destroy(sync);
+
+    config.stream_count = 1;
+    CHECK(!libmedia_sync_create(&config), "one stream accepted");
+    config.stream_count = 2;
+    config.max_pending = MEDIA_SYNC_MAX_PENDING + 1;
+    CHECK(!libmedia_sync_create(&config), "max_pending %d accepted", MEDIA_SYNC_MAX_PENDING + 1);
+}
+
+int main(void)
+{
+    test_timestamp_matching();
+    test_sequence_matching();
+    test_ownership();
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}